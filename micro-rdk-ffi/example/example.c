@@ -35,8 +35,9 @@ int config_my_generic_sensor_A(struct config_context *ctx, void *user_data,
 int get_readings_my_generic_sensorA(struct get_readings_context *ctx, void* data) {
   struct my_generic_sensor_A *sensorA = data;
 
-  get_readings_add_binary_blob(ctx, "an_int", (uint8_t*)&sensorA->an_int, sizeof(sensorA->an_int));
-  get_readings_add_binary_blob(ctx, "an_int_from_config", (uint8_t*)&sensorA->an_int_from_config, sizeof(sensorA->an_int_from_config));
+  get_readings_add_i64(ctx, "an_int", sensorA->an_int);
+  get_readings_add_i64(ctx, "an_int_from_config", sensorA->an_int_from_config);
+  get_readings_add_binary_blob(ctx, "an_int_as_blob", (uint8_t*)&sensorA->an_int, sizeof(sensorA->an_int));
 
   return VIAM_OK;
 }
@@ -88,6 +89,8 @@ int main() {
   generic_c_sensor_config_set_config_callback(config_A,
                                               config_my_generic_sensor_A);
   generic_c_sensor_config_set_readings_callback(config_A, get_readings_my_generic_sensorA);
+  generic_c_sensor_config_set_max_keys(config_A, 3);
+  generic_c_sensor_config_set_cache_ttl(config_A, 100);
   viam_code ret =
     viam_server_register_c_generic_sensor(viam_ctx, "sensorA", config_A);
 
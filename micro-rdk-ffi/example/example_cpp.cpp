@@ -0,0 +1,45 @@
+#include <micrordk.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+
+class MyCppSensor : public viam::Sensor<MyCppSensor> {
+public:
+  explicit MyCppSensor(viam::Config &cfg) {
+    if (!cfg.get("offset", offset_)) {
+      std::printf("defaulting offset to 0\r\n");
+    }
+    cfg.get("enabled", enabled_);
+  }
+
+  bool configured() const noexcept { return enabled_; }
+
+  int get_readings(viam::Readings &r) {
+    r.add("value", 42.0 + offset_);
+    r.add("count", ++count_);
+    r.add("enabled", enabled_);
+    return 0;
+  }
+
+private:
+  double offset_ = 0.0;
+  bool enabled_ = true;
+  int64_t count_ = 0;
+};
+
+int main() {
+  viam_server_context *viam_ctx = init_viam_server_context();
+
+  viam_code ret = MyCppSensor::register_model(viam_ctx, "my_cpp_sensor", {3, 0});
+  if (ret != VIAM_OK) {
+    std::printf("couldn't register my_cpp_sensor model cause : %i", ret);
+    return EXIT_FAILURE;
+  }
+
+  ret = viam_server_start(viam_ctx);
+  if (ret != VIAM_OK) {
+    std::printf("viam server failed to start : %i", ret);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
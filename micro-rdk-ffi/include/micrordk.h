@@ -19,6 +19,10 @@ typedef enum viam_code {
   VIAM_REGISTRY_ERROR,
 } viam_code;
 
+#if defined(VIAM_MICRORDK_CAMERA)
+typedef struct c_camera_config c_camera_config;
+#endif
+
 typedef struct config_context config_context;
 
 typedef struct generic_c_sensor_config generic_c_sensor_config;
@@ -27,14 +31,242 @@ typedef struct get_readings_context get_readings_context;
 
 typedef struct viam_server_context viam_server_context;
 
+/*
+ Latencies of the callbacks registered for a model, durations are expressed in microseconds
+ percentiles are approximated by the upper bound of a power of two bucket
+ */
+typedef struct viam_callback_stats {
+  uint32_t config_count;
+  uint32_t config_p50_us;
+  uint32_t config_p99_us;
+  uint32_t config_max_us;
+  uint32_t readings_count;
+  uint32_t readings_p50_us;
+  uint32_t readings_p99_us;
+  uint32_t readings_max_us;
+} viam_callback_stats;
+
+/*
+ Heap, stack and connection usage of the viam server, sizes are expressed in bytes. Heap fields
+ */
+typedef struct viam_telemetry {
+  size_t internal_free;
+  size_t internal_largest_free_block;
+  size_t internal_minimum_free;
+  size_t psram_free;
+  size_t psram_largest_free_block;
+  size_t psram_minimum_free;
+  /*
+   lowest free stack of the task running the server, zero when unknown
+   */
+  size_t server_stack_minimum_free;
+  uint32_t executor_tasks;
+  uint32_t connections;
+  /*
+   bytes held in the data store and bytes it can hold, summed over the collectors
+   */
+  size_t data_store_stored;
+  size_t data_store_capacity;
+  /*
+   collection ticks skipped because collecting took longer than the minimum interval
+   */
+  uint32_t data_missed_deadlines;
+  uint32_t data_collection_errors;
+  /*
+   upload metrics of the data manager, counters wrap around
+   */
+  uint32_t data_uploaded_bytes;
+  uint32_t data_uploaded_messages;
+  uint32_t data_failed_uploads;
+  uint32_t data_in_flight_bytes;
+  uint32_t data_backlog_bytes;
+  /*
+   bytes per second acknowledged during the last sync
+   */
+  uint32_t data_sync_throughput;
+} viam_telemetry;
+
+/*
+ Allocation hook, receives the size and alignment of the requested block followed by the user data
+ */
+typedef void *(*viam_alloc_fn)(size_t, size_t, void*);
+
+/*
+ Deallocation hook, receives a block previously returned by the allocation hook, its size and the
+ */
+typedef void (*viam_free_fn)(void*, size_t, void*);
+
 typedef int (*config_callback)(struct config_context*, void*, void**);
 
+#if defined(VIAM_MICRORDK_CAMERA)
+typedef int (*get_image_callback)(unsigned char*, size_t, size_t*, void*);
+#endif
+
 typedef int (*get_readings_callback)(struct get_readings_context*, void*);
 
+typedef int (*get_readings_async_callback)(struct get_readings_context*, void*);
+
+typedef int (*get_readings_batch_callback)(struct get_readings_context*, void*);
+
+typedef int (*close_callback)(void*);
+
+/*
+ Callbacks implementing a board in C, registered with `viam_server_register_c_board`
+ */
+typedef struct c_board_vtable {
+  config_callback config;
+  int (*set_gpio_pin_level)(int32_t, bool, void*);
+  int (*get_gpio_level)(int32_t, bool*, void*);
+  int (*get_pwm_duty)(int32_t, double*, void*);
+  int (*set_pwm_duty)(int32_t, double, void*);
+  int (*get_pwm_frequency)(int32_t, uint64_t*, void*);
+  int (*set_pwm_frequency)(int32_t, uint64_t, void*);
+  int (*get_digital_interrupt_value)(int32_t, uint32_t*, void*);
+  /*
+   reads the analog reader named by the null terminated string passed as first argument
+   */
+  int (*read_analog)(const char*, uint16_t*, void*);
+  /*
+   releases the pointer written by `config`, called when the board is dropped (for
+   example on reconfiguration)
+   */
+  close_callback close;
+} c_board_vtable;
+
+/*
+ Callbacks implementing an encoder in C, registered with `viam_server_register_c_encoder`
+ */
+typedef struct c_encoder_vtable {
+  config_callback config;
+  int (*get_position_ticks)(float*, void*);
+  int (*get_position_degrees)(float*, void*);
+  int (*reset_position)(void*);
+  /*
+   releases the pointer written by `config`, called when the encoder is dropped (for
+   example on reconfiguration)
+   */
+  close_callback close;
+} c_encoder_vtable;
+
+/*
+ Callbacks implementing a motor in C, registered with `viam_server_register_c_motor`
+ */
+typedef struct c_motor_vtable {
+  config_callback config;
+  int (*set_power)(double, void*);
+  int (*get_position)(int32_t*, void*);
+  /*
+   should start the motor and return immediately, it isn't waited upon
+   */
+  int (*go_for)(double, double, void*);
+  int (*stop)(void*);
+  int (*is_moving)(bool*, void*);
+  /*
+   releases the pointer written by `config`, called when the motor is dropped (for
+   example on reconfiguration)
+   */
+  close_callback close;
+} c_motor_vtable;
+
+typedef int (*vector3_callback)(double*, double*, double*, void*);
+
+/*
+ Callbacks implementing a movement sensor in C, registered with `viam_server_register_c_movement_sensor`
+ */
+typedef struct c_movement_sensor_vtable {
+  config_callback config;
+  /*
+   writes the latitude, longitude and altitude
+   */
+  int (*get_position)(double*, double*, float*, void*);
+  vector3_callback get_linear_velocity;
+  vector3_callback get_angular_velocity;
+  vector3_callback get_linear_acceleration;
+  int (*get_compass_heading)(double*, void*);
+  /*
+   releases the pointer written by `config`, called when the movement sensor is dropped (for
+   example on reconfiguration)
+   */
+  close_callback close;
+} c_movement_sensor_vtable;
+
+/*
+ Callbacks implementing a power sensor in C, registered with `viam_server_register_c_power_sensor`
+ */
+typedef struct c_power_sensor_vtable {
+  config_callback config;
+  /*
+   writes the voltage in volts and whether the power supply is AC
+   */
+  int (*get_voltage)(double*, bool*, void*);
+  /*
+   writes the current in amperes and whether the power supply is AC
+   */
+  int (*get_current)(double*, bool*, void*);
+  /*
+   writes the power in watts
+   */
+  int (*get_power)(double*, void*);
+  /*
+   releases the pointer written by `config`, called when the power sensor is dropped (for
+   example on reconfiguration)
+   */
+  close_callback close;
+} c_power_sensor_vtable;
+
 #ifdef __cplusplus
 extern "C" {
 #endif // __cplusplus
 
+/*
+ Route every allocation made by the library through `alloc_fn` and `free_fn`, for example to place
+ */
+enum viam_code viam_server_set_allocator(viam_alloc_fn alloc_fn, viam_free_fn free_fn, void *user_data);
+
+#if defined(VIAM_MICRORDK_CAMERA)
+/*
+ Creates an new camera config to be used for registering a C camera with the Robot's registry
+ */
+struct c_camera_config *c_camera_config_new(void);
+#endif
+
+#if defined(VIAM_MICRORDK_CAMERA)
+/*
+ Set the user data pointer, the value will then be passed to the `config_callback` during the configuration step
+ */
+enum viam_code c_camera_config_set_user_data(struct c_camera_config *ctx, void *data);
+#endif
+
+#if defined(VIAM_MICRORDK_CAMERA)
+/*
+ Set the config callback, which will be called when this camera is configured
+ */
+enum viam_code c_camera_config_set_config_callback(struct c_camera_config *ctx,
+                                                   config_callback cb);
+#endif
+
+#if defined(VIAM_MICRORDK_CAMERA)
+/*
+ Set the get image callback, which will be called when GetImage is called on a properly
+ */
+enum viam_code c_camera_config_set_get_image_callback(struct c_camera_config *ctx,
+                                                      get_image_callback cb);
+#endif
+
+#if defined(VIAM_MICRORDK_CAMERA)
+/*
+ Set the MIME type reported along the frames produced by the camera
+ */
+enum viam_code c_camera_config_set_mime_type(struct c_camera_config *ctx, const char *mime_type);
+#endif
+
+#if defined(VIAM_MICRORDK_CAMERA)
+/*
+ Set the close callback, called with the camera data returned by `config_callback` when the
+ */
+enum viam_code c_camera_config_set_close_callback(struct c_camera_config *ctx, close_callback cb);
+#endif
+
 /*
  Get a string from the attribute section of a sensor configuration
  */
@@ -50,6 +282,42 @@ enum viam_code config_free_string(struct config_context*, char *ptr);
  */
 enum viam_code config_get_i32(struct config_context *ctx, const char *key, int *out);
 
+/*
+ Get a string from the attribute section of a sensor configuration without copying it
+ */
+enum viam_code config_get_string_ref(struct config_context *ctx,
+                                     const char *key,
+                                     const char **out,
+                                     size_t *len);
+
+/*
+ Get a double from the attribute section of a sensor configuration
+ */
+enum viam_code config_get_double(struct config_context *ctx, const char *key, double *out);
+
+/*
+ Get a boolean from the attribute section of a sensor configuration
+ */
+enum viam_code config_get_bool(struct config_context *ctx, const char *key, bool *out);
+
+/*
+ Get an array of int32 from the attribute section of a sensor configuration
+ */
+enum viam_code config_get_i32_array(struct config_context *ctx,
+                                    const char *key,
+                                    int *out,
+                                    size_t len,
+                                    size_t *count);
+
+/*
+ Get an array of doubles from the attribute section of a sensor configuration
+ */
+enum viam_code config_get_double_array(struct config_context *ctx,
+                                       const char *key,
+                                       double *out,
+                                       size_t len,
+                                       size_t *count);
+
 /*
  Creates a new Viam server context
  */
@@ -62,6 +330,68 @@ enum viam_code viam_server_register_c_generic_sensor(struct viam_server_context
                                                      const char *model,
                                                      struct generic_c_sensor_config *sensor);
 
+#if defined(VIAM_MICRORDK_CAMERA)
+/*
+ Register a camera in the Registry making configurable via Viam config
+ */
+enum viam_code viam_server_register_c_camera(struct viam_server_context *ctx,
+                                             const char *model,
+                                             struct c_camera_config *camera);
+#endif
+
+/*
+ Register a motor implemented by the callbacks of `vtable` in the Registry making configurable via Viam config
+ */
+enum viam_code viam_server_register_c_motor(struct viam_server_context *ctx,
+                                            const char *model,
+                                            const struct c_motor_vtable *vtable,
+                                            void *user_data);
+
+/*
+ Register a board implemented by the callbacks of `vtable` in the Registry making configurable via Viam config
+ */
+enum viam_code viam_server_register_c_board(struct viam_server_context *ctx,
+                                            const char *model,
+                                            const struct c_board_vtable *vtable,
+                                            void *user_data);
+
+/*
+ Register a movement sensor implemented by the callbacks of `vtable` in the Registry making configurable
+ */
+enum viam_code viam_server_register_c_movement_sensor(struct viam_server_context *ctx,
+                                                      const char *model,
+                                                      const struct c_movement_sensor_vtable *vtable,
+                                                      void *user_data);
+
+/*
+ Register an encoder implemented by the callbacks of `vtable` in the Registry making configurable via Viam config
+ */
+enum viam_code viam_server_register_c_encoder(struct viam_server_context *ctx,
+                                              const char *model,
+                                              const struct c_encoder_vtable *vtable,
+                                              void *user_data);
+
+/*
+ Register a power sensor implemented by the callbacks of `vtable` in the Registry making configurable
+ */
+enum viam_code viam_server_register_c_power_sensor(struct viam_server_context *ctx,
+                                                   const char *model,
+                                                   const struct c_power_sensor_vtable *vtable,
+                                                   void *user_data);
+
+/*
+ Sets the size in bytes of the memory used to buffer collected data before it is uploaded, replacing the
+ */
+enum viam_code viam_server_context_set_data_store_size(struct viam_server_context *ctx,
+                                                       size_t size,
+                                                       bool use_psram);
+
+/*
+ Sets the maximum number of connections served at the same time, replacing the default of 10 on native
+ */
+enum viam_code viam_server_context_set_max_connections(struct viam_server_context *ctx,
+                                                       size_t max_connections);
+
 /*
  Starts the viam server, the function will take ownership of `ctx` therefore future call
  */
@@ -90,6 +420,36 @@ enum viam_code generic_c_sensor_config_set_config_callback(struct generic_c_sens
 enum viam_code generic_c_sensor_config_set_readings_callback(struct generic_c_sensor_config *ctx,
                                                              get_readings_callback cb);
 
+/*
+ Set the maximum number of keys the sensor is expected to report, when set the readings context
+ */
+enum viam_code generic_c_sensor_config_set_max_keys(struct generic_c_sensor_config *ctx,
+                                                    unsigned int max_keys);
+
+/*
+ Set the get readings batch callback, which will be called by the data manager when collecting
+ */
+enum viam_code generic_c_sensor_config_set_readings_batch_callback(struct generic_c_sensor_config *ctx,
+                                                                   get_readings_batch_callback cb);
+
+/*
+ Set the asynchronous get readings callback, for drivers that have to wait on the hardware before
+ */
+enum viam_code generic_c_sensor_config_set_readings_async_callback(struct generic_c_sensor_config *ctx,
+                                                                   get_readings_async_callback cb);
+
+/*
+ Set the close callback, called with the sensor data returned by `config_callback` when the
+ */
+enum viam_code generic_c_sensor_config_set_close_callback(struct generic_c_sensor_config *ctx,
+                                                          close_callback cb);
+
+/*
+ Set for how long, in milliseconds, readings are served from a cache rather than by calling the
+ */
+enum viam_code generic_c_sensor_config_set_cache_ttl(struct generic_c_sensor_config *ctx,
+                                                     unsigned int max_age_ms);
+
 /*
  This function can be use by a sensor during the call to `get_readings_callback` to add binary data to a response
  */
@@ -105,6 +465,61 @@ enum viam_code get_readings_add_string(struct get_readings_context *ctx,
                                        const char *key,
                                        const char *value);
 
+/*
+ This function can be use by a sensor during the call to `get_readings_callback` to add a double to a response
+ */
+enum viam_code get_readings_add_double(struct get_readings_context *ctx,
+                                       const char *key,
+                                       double value);
+
+/*
+ This function can be use by a sensor during the call to `get_readings_callback` to add an int64 to a response
+ */
+enum viam_code get_readings_add_i64(struct get_readings_context *ctx,
+                                    const char *key,
+                                    int64_t value);
+
+/*
+ This function can be use by a sensor during the call to `get_readings_callback` to add a boolean to a response
+ */
+enum viam_code get_readings_add_bool(struct get_readings_context *ctx, const char *key, bool value);
+
+/*
+ This function can be use by a sensor during the call to `get_readings_callback` to add an array of doubles
+ */
+enum viam_code get_readings_add_double_array(struct get_readings_context *ctx,
+                                             const char *key,
+                                             const double *array,
+                                             unsigned int len);
+
+/*
+ This function can be use by a sensor during the call to `get_readings_batch_callback` to start a new sample
+ */
+enum viam_code get_readings_add_sample(struct get_readings_context *ctx, int64_t timestamp_ns);
+
+/*
+ This function should be called by a sensor once the readings started by `get_readings_async_callback`
+ */
+enum viam_code get_readings_complete(struct get_readings_context *ctx, int code);
+
+/*
+ Get the latency statistics of the callbacks of `model`, the result is written to `out`
+ */
+enum viam_code viam_server_get_callback_stats(const char *model, struct viam_callback_stats *out);
+
+/*
+ Get the telemetry of the viam server, the result is written to `out`
+ */
+enum viam_code viam_server_get_telemetry(struct viam_telemetry *out);
+
+/*
+ Get the bytes held in the data store by the collector of `method` on component `name`, and the
+ */
+enum viam_code viam_server_get_data_store_fill(const char *name,
+                                               const char *method,
+                                               size_t *stored,
+                                               size_t *capacity);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif // __cplusplus
@@ -0,0 +1,229 @@
+/*
+ * Copyright 2024 Viamrobotics. GNU AGPL.
+ *
+ * C++17 wrapper around the micro-RDK C API.
+ *
+ * Sensors are written as a class deriving from `viam::Sensor<T>` (CRTP), the C callbacks are
+ * generated at compile time and call straight into `T`, no virtual dispatch involved:
+ *
+ *   class MySensor : public viam::Sensor<MySensor> {
+ *   public:
+ *     explicit MySensor(viam::Config &cfg) { cfg.get("offset", offset_); }
+ *     int get_readings(viam::Readings &r) {
+ *       r.add("value", read_hw() + offset_);
+ *       return 0;
+ *     }
+ *   private:
+ *     double offset_ = 0.0;
+ *   };
+ *
+ *   MySensor::register_model(ctx, "my_sensor");
+ *
+ * Keys are passed as C strings, no std::string is built on the readings path.
+ */
+
+#ifndef VIAM_MICRORDK_HPP
+#define VIAM_MICRORDK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string_view>
+#include <type_traits>
+
+#include "micrordk.h"
+
+namespace viam {
+
+/*
+ Typed access to the attributes of a component configuration, only valid during configuration
+ */
+class Config {
+public:
+  explicit Config(config_context *ctx) noexcept : ctx_(ctx) {}
+
+  bool get(const char *key, int32_t &out) const noexcept {
+    int v = 0;
+    if (config_get_i32(ctx_, key, &v) != VIAM_OK) {
+      return false;
+    }
+    out = v;
+    return true;
+  }
+
+  bool get(const char *key, double &out) const noexcept {
+    return config_get_double(ctx_, key, &out) == VIAM_OK;
+  }
+
+  bool get(const char *key, bool &out) const noexcept {
+    return config_get_bool(ctx_, key, &out) == VIAM_OK;
+  }
+
+  /*
+   The string is borrowed from the configuration, copy it if it is needed after configuration
+   */
+  bool get(const char *key, std::string_view &out) const noexcept {
+    const char *ptr = nullptr;
+    size_t len = 0;
+    if (config_get_string_ref(ctx_, key, &ptr, &len) != VIAM_OK) {
+      return false;
+    }
+    out = std::string_view(ptr, len);
+    return true;
+  }
+
+  /*
+   Fills `out` with up to `N` elements, `count` receives the length of the array in the configuration
+   */
+  template <size_t N> bool get(const char *key, int (&out)[N], size_t &count) const noexcept {
+    return config_get_i32_array(ctx_, key, out, N, &count) == VIAM_OK;
+  }
+
+  template <size_t N> bool get(const char *key, double (&out)[N], size_t &count) const noexcept {
+    return config_get_double_array(ctx_, key, out, N, &count) == VIAM_OK;
+  }
+
+  config_context *raw() const noexcept { return ctx_; }
+
+private:
+  config_context *ctx_;
+};
+
+/*
+ Readings being reported by a sensor, each `add` overload maps to the matching typed C call
+ */
+class Readings {
+public:
+  explicit Readings(get_readings_context *ctx) noexcept : ctx_(ctx) {}
+
+  viam_code add(const char *key, double value) noexcept {
+    return get_readings_add_double(ctx_, key, value);
+  }
+
+  viam_code add(const char *key, float value) noexcept {
+    return get_readings_add_double(ctx_, key, static_cast<double>(value));
+  }
+
+  viam_code add(const char *key, bool value) noexcept {
+    return get_readings_add_bool(ctx_, key, value);
+  }
+
+  template <typename I, std::enable_if_t<std::is_integral_v<I> && !std::is_same_v<I, bool>, int> = 0>
+  viam_code add(const char *key, I value) noexcept {
+    return get_readings_add_i64(ctx_, key, static_cast<int64_t>(value));
+  }
+
+  viam_code add(const char *key, const char *value) noexcept {
+    return get_readings_add_string(ctx_, key, value);
+  }
+
+  viam_code add(const char *key, const double *values, size_t len) noexcept {
+    return get_readings_add_double_array(ctx_, key, values, static_cast<unsigned int>(len));
+  }
+
+  template <size_t N> viam_code add(const char *key, const double (&values)[N]) noexcept {
+    return add(key, values, N);
+  }
+
+  /*
+   The content is encoded in BASE64
+   */
+  viam_code add_blob(const char *key, const uint8_t *data, size_t len) noexcept {
+    return get_readings_add_binary_blob(ctx_, key, data, static_cast<unsigned int>(len));
+  }
+
+  /*
+   Starts a new sample, only meaningful while reporting a batch
+   */
+  viam_code add_sample(int64_t timestamp_ns) noexcept {
+    return get_readings_add_sample(ctx_, timestamp_ns);
+  }
+
+  get_readings_context *raw() const noexcept { return ctx_; }
+
+private:
+  get_readings_context *ctx_;
+};
+
+/*
+ Options applied to the generic sensor config when a model is registered
+ */
+struct SensorOptions {
+  // see generic_c_sensor_config_set_max_keys
+  unsigned int max_keys = 0;
+  // see generic_c_sensor_config_set_cache_ttl
+  unsigned int cache_ttl_ms = 0;
+};
+
+/*
+ Base of a generic sensor implemented in C++.
+
+ `T` must be constructible from a `viam::Config &` and provide `int get_readings(viam::Readings &)`
+ returning 0 on success. It can also provide `int get_readings_batch(viam::Readings &)`, used by data
+ collection, and `bool configured() const` to reject a configuration. Instances are allocated once
+ per configured sensor and deleted when the sensor is removed from the robot (e.g. when its config
+ changes).
+ */
+template <typename T> class Sensor {
+public:
+  static viam_code register_model(viam_server_context *ctx, const char *model,
+                                  SensorOptions options = {}) noexcept {
+    generic_c_sensor_config *config = generic_c_sensor_config_new();
+    generic_c_sensor_config_set_config_callback(config, &Sensor::config_trampoline);
+    generic_c_sensor_config_set_readings_callback(config, &Sensor::readings_trampoline);
+    generic_c_sensor_config_set_close_callback(config, &Sensor::close_trampoline);
+    if constexpr (has_batch<T>::value) {
+      generic_c_sensor_config_set_readings_batch_callback(config, &Sensor::batch_trampoline);
+    }
+    generic_c_sensor_config_set_max_keys(config, options.max_keys);
+    generic_c_sensor_config_set_cache_ttl(config, options.cache_ttl_ms);
+    return viam_server_register_c_generic_sensor(ctx, model, config);
+  }
+
+  bool configured() const noexcept { return true; }
+
+protected:
+  Sensor() = default;
+
+private:
+  // returned by the config callback when the sensor can't be allocated
+  static constexpr int ENOMEM_CODE = -2;
+
+  template <typename U, typename = void> struct has_batch : std::false_type {};
+  template <typename U>
+  struct has_batch<U, std::void_t<decltype(std::declval<U &>().get_readings_batch(
+                          std::declval<Readings &>()))>> : std::true_type {};
+
+  static int config_trampoline(config_context *ctx, void *, void **out) noexcept {
+    Config config(ctx);
+    T *sensor = new (std::nothrow) T(config);
+    if (sensor == nullptr) {
+      return ENOMEM_CODE;
+    }
+    if (!sensor->configured()) {
+      delete sensor;
+      return -1;
+    }
+    *out = sensor;
+    return 0;
+  }
+
+  static int close_trampoline(void *data) noexcept {
+    delete static_cast<T *>(data);
+    return 0;
+  }
+
+  static int readings_trampoline(get_readings_context *ctx, void *data) noexcept {
+    Readings readings(ctx);
+    return static_cast<T *>(data)->get_readings(readings);
+  }
+
+  static int batch_trampoline(get_readings_context *ctx, void *data) noexcept {
+    Readings readings(ctx);
+    return static_cast<T *>(data)->get_readings_batch(readings);
+  }
+};
+
+} // namespace viam
+
+#endif /* VIAM_MICRORDK_HPP */
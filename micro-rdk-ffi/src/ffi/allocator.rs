@@ -0,0 +1,164 @@
+use std::{
+    alloc::{GlobalAlloc, Layout, System},
+    ffi::c_void,
+    sync::{
+        atomic::{AtomicU32, Ordering},
+        OnceLock,
+    },
+};
+
+use super::errors::viam_code;
+
+/// Allocation hook, receives the size and alignment of the requested block followed by the user data
+/// registered with `viam_server_set_allocator`. Must return a block aligned on at least the requested
+/// alignment, or NULL when out of memory
+#[allow(non_camel_case_types)]
+pub type viam_alloc_fn = extern "C" fn(usize, usize, *mut c_void) -> *mut c_void;
+
+/// Deallocation hook, receives a block previously returned by the allocation hook, its size and the
+/// user data registered with `viam_server_set_allocator`
+#[allow(non_camel_case_types)]
+pub type viam_free_fn = extern "C" fn(*mut c_void, usize, *mut c_void);
+
+struct AllocatorHooks {
+    alloc: viam_alloc_fn,
+    free: viam_free_fn,
+    user_data: *mut c_void,
+}
+
+// The user data is only ever handed back to the hooks, which must be callable from any task
+unsafe impl Send for AllocatorHooks {}
+unsafe impl Sync for AllocatorHooks {}
+
+static HOOKS: OnceLock<AllocatorHooks> = OnceLock::new();
+
+// Which allocator serves the library, decided once by either the first allocation or
+// `viam_server_set_allocator`. Once the system allocator served a block it could end up released
+// through the hooks, so they can't be installed anymore
+const UNDECIDED: u32 = 0;
+const SYSTEM: u32 = 1;
+// the hooks are being written into `HOOKS`, allocations wait for them
+const INSTALLING: u32 = 2;
+const HOOKED: u32 = 3;
+static STATE: AtomicU32 = AtomicU32::new(UNDECIDED);
+
+/// Hooks serving the allocations, `None` when the system allocator does
+fn hooks() -> Option<&'static AllocatorHooks> {
+    loop {
+        match STATE.load(Ordering::Acquire) {
+            SYSTEM => return None,
+            HOOKED => return HOOKS.get(),
+            INSTALLING => std::hint::spin_loop(),
+            _ => {
+                if STATE
+                    .compare_exchange(UNDECIDED, SYSTEM, Ordering::Acquire, Ordering::Acquire)
+                    .is_ok()
+                {
+                    return None;
+                }
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+thread_local! {
+    /// Allocations made by the current thread, only counted by the test builds for the benchmarks.
+    /// Counting per thread keeps the tests running in parallel out of the measures
+    pub(crate) static ALLOCATIONS: std::cell::Cell<usize> = const { std::cell::Cell::new(0) };
+}
+
+#[cfg(test)]
+fn count_allocation() {
+    // the counter is gone while the thread is being torn down
+    let _ = ALLOCATIONS.try_with(|count| count.set(count.get() + 1));
+}
+
+/// Global allocator of the library, forwards to the hooks installed with `viam_server_set_allocator`
+/// or to the system allocator when there are none
+struct ViamAllocator;
+
+#[global_allocator]
+static ALLOCATOR: ViamAllocator = ViamAllocator;
+
+unsafe impl GlobalAlloc for ViamAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        #[cfg(test)]
+        count_allocation();
+        if let Some(hooks) = hooks() {
+            return (hooks.alloc)(layout.size(), layout.align(), hooks.user_data) as *mut u8;
+        }
+        unsafe { System.alloc(layout) }
+    }
+
+    unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
+        #[cfg(test)]
+        count_allocation();
+        if let Some(hooks) = hooks() {
+            let ptr = (hooks.alloc)(layout.size(), layout.align(), hooks.user_data) as *mut u8;
+            if !ptr.is_null() {
+                unsafe { ptr.write_bytes(0, layout.size()) };
+            }
+            return ptr;
+        }
+        unsafe { System.alloc_zeroed(layout) }
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        if let Some(hooks) = hooks() {
+            return (hooks.free)(ptr as *mut c_void, layout.size(), hooks.user_data);
+        }
+        unsafe { System.dealloc(ptr, layout) }
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        if hooks().is_some() {
+            // no realloc hook, grow by copying into a new block
+            let new_layout = unsafe { Layout::from_size_align_unchecked(new_size, layout.align()) };
+            let new_ptr = unsafe { self.alloc(new_layout) };
+            if !new_ptr.is_null() {
+                unsafe {
+                    std::ptr::copy_nonoverlapping(ptr, new_ptr, layout.size().min(new_size));
+                    self.dealloc(ptr, layout);
+                }
+            }
+            return new_ptr;
+        }
+        #[cfg(test)]
+        count_allocation();
+        unsafe { System.realloc(ptr, layout, new_size) }
+    }
+}
+
+/// Route every allocation made by the library through `alloc_fn` and `free_fn`, for example to place
+/// them in PSRAM or in a dedicated pool. `user_data` is passed to both hooks.
+///
+/// The hooks must be installed before any other call to the library (including `init_viam_server_context`)
+/// and can only be installed once, VIAM_INVALID_ARG is returned otherwise. Both hooks may be called from
+/// any task.
+///
+/// # Safety
+/// `alloc_fn` and `free_fn` must be valid for the remainder of the program
+#[no_mangle]
+pub unsafe extern "C" fn viam_server_set_allocator(
+    alloc_fn: viam_alloc_fn,
+    free_fn: viam_free_fn,
+    user_data: *mut c_void,
+) -> viam_code {
+    // checking that nothing was allocated yet and claiming the allocator is a single step, an
+    // allocation made meanwhile by another task either wins and gets the system allocator, or
+    // waits for the hooks
+    if STATE
+        .compare_exchange(UNDECIDED, INSTALLING, Ordering::Acquire, Ordering::Relaxed)
+        .is_err()
+    {
+        return viam_code::VIAM_INVALID_ARG;
+    }
+    let _ = HOOKS.set(AllocatorHooks {
+        alloc: alloc_fn,
+        free: free_fn,
+        user_data,
+    });
+    STATE.store(HOOKED, Ordering::Release);
+    viam_code::VIAM_OK
+}
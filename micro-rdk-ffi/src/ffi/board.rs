@@ -0,0 +1,200 @@
+use micro_rdk::{
+    common::{
+        analog::{AnalogError, AnalogReader, AnalogReaderType, AnalogResolution},
+        board::{Board, BoardError},
+        i2c::I2cHandleType,
+        status::Status,
+    },
+    proto::component,
+    DoCommand,
+};
+use std::{
+    collections::HashMap,
+    ffi::{c_char, c_double, c_int, c_void, CString},
+    sync::{Arc, Mutex},
+    time::Duration,
+};
+
+use super::sensor::{close_callback, config_callback};
+
+/// Callbacks implementing a board in C, registered with `viam_server_register_c_board`
+///
+/// Every callback receives as its last argument the pointer written by the `config` callback and
+/// returns 0 on success. A NULL callback makes the matching method unimplemented
+#[repr(C)]
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy)]
+pub struct c_board_vtable {
+    pub config: Option<config_callback>,
+    pub set_gpio_pin_level: Option<extern "C" fn(i32, bool, *mut c_void) -> c_int>,
+    pub get_gpio_level: Option<extern "C" fn(i32, *mut bool, *mut c_void) -> c_int>,
+    pub get_pwm_duty: Option<extern "C" fn(i32, *mut c_double, *mut c_void) -> c_int>,
+    pub set_pwm_duty: Option<extern "C" fn(i32, c_double, *mut c_void) -> c_int>,
+    pub get_pwm_frequency: Option<extern "C" fn(i32, *mut u64, *mut c_void) -> c_int>,
+    pub set_pwm_frequency: Option<extern "C" fn(i32, u64, *mut c_void) -> c_int>,
+    pub get_digital_interrupt_value: Option<extern "C" fn(i32, *mut u32, *mut c_void) -> c_int>,
+    /// reads the analog reader named by the null terminated string passed as first argument
+    pub read_analog: Option<extern "C" fn(*const c_char, *mut u16, *mut c_void) -> c_int>,
+    /// releases the pointer written by `config`, called when the board is dropped (for
+    /// example on reconfiguration)
+    pub close: Option<close_callback>,
+}
+
+#[allow(non_camel_case_types)]
+#[derive(DoCommand)]
+pub struct c_board {
+    user_data: *mut c_void,
+    vtable: c_board_vtable,
+}
+
+unsafe impl Send for c_board {}
+unsafe impl Sync for c_board {}
+
+impl c_board {
+    pub(crate) fn new(user_data: *mut c_void, vtable: c_board_vtable) -> Self {
+        Self { user_data, vtable }
+    }
+}
+
+impl Drop for c_board {
+    fn drop(&mut self) {
+        if let Some(close) = self.vtable.close {
+            let ret = close(self.user_data);
+            if ret != 0 {
+                log::warn!("board close callback returned {}", ret);
+            }
+        }
+    }
+}
+
+fn board_result(code: c_int) -> Result<(), BoardError> {
+    match code {
+        0 => Ok(()),
+        code => Err(BoardError::BoardCodeError(code)),
+    }
+}
+
+impl Board for c_board {
+    fn set_gpio_pin_level(&mut self, pin: i32, is_high: bool) -> Result<(), BoardError> {
+        let cb = self
+            .vtable
+            .set_gpio_pin_level
+            .ok_or(BoardError::BoardMethodNotSupported("set_gpio_pin_level"))?;
+        board_result(cb(pin, is_high, self.user_data))
+    }
+    fn get_gpio_level(&self, pin: i32) -> Result<bool, BoardError> {
+        let cb = self
+            .vtable
+            .get_gpio_level
+            .ok_or(BoardError::BoardMethodNotSupported("get_gpio_level"))?;
+        let mut is_high = false;
+        board_result(cb(pin, &mut is_high as *mut _, self.user_data))?;
+        Ok(is_high)
+    }
+    fn get_analog_reader_by_name(&self, name: String) -> Result<AnalogReaderType<u16>, BoardError> {
+        let read = self
+            .vtable
+            .read_analog
+            .ok_or(BoardError::AnalogReaderNotFound(name.clone()))?;
+        let c_name = CString::new(name.clone())
+            .map_err(|_| BoardError::AnalogReaderNotFound(name.clone()))?;
+        Ok(Arc::new(Mutex::new(c_analog_reader {
+            name,
+            c_name,
+            read,
+            user_data: self.user_data,
+        })))
+    }
+    fn set_power_mode(
+        &self,
+        _: component::board::v1::PowerMode,
+        _: Option<Duration>,
+    ) -> Result<(), BoardError> {
+        Err(BoardError::BoardMethodNotSupported("set_power_mode"))
+    }
+    fn get_i2c_by_name(&self, name: String) -> Result<I2cHandleType, BoardError> {
+        Err(BoardError::I2CBusNotFound(name))
+    }
+    fn get_digital_interrupt_value(&self, pin: i32) -> Result<u32, BoardError> {
+        let cb =
+            self.vtable
+                .get_digital_interrupt_value
+                .ok_or(BoardError::BoardMethodNotSupported(
+                    "get_digital_interrupt_value",
+                ))?;
+        let mut value: u32 = 0;
+        board_result(cb(pin, &mut value as *mut _, self.user_data))?;
+        Ok(value)
+    }
+    fn get_pwm_duty(&self, pin: i32) -> f64 {
+        let cb = match self.vtable.get_pwm_duty {
+            Some(cb) => cb,
+            None => return 0.0,
+        };
+        let mut duty: f64 = 0.0;
+        if let Err(e) = board_result(cb(pin, &mut duty as *mut _, self.user_data)) {
+            log::error!("couldn't get pwm duty of pin {} : {:?}", pin, e);
+            return 0.0;
+        }
+        duty
+    }
+    fn set_pwm_duty(&mut self, pin: i32, duty_cycle_pct: f64) -> Result<(), BoardError> {
+        let cb = self
+            .vtable
+            .set_pwm_duty
+            .ok_or(BoardError::BoardMethodNotSupported("set_pwm_duty"))?;
+        board_result(cb(pin, duty_cycle_pct, self.user_data))
+    }
+    fn get_pwm_frequency(&self, pin: i32) -> Result<u64, BoardError> {
+        let cb = self
+            .vtable
+            .get_pwm_frequency
+            .ok_or(BoardError::BoardMethodNotSupported("get_pwm_frequency"))?;
+        let mut frequency: u64 = 0;
+        board_result(cb(pin, &mut frequency as *mut _, self.user_data))?;
+        Ok(frequency)
+    }
+    fn set_pwm_frequency(&mut self, pin: i32, frequency_hz: u64) -> Result<(), BoardError> {
+        let cb = self
+            .vtable
+            .set_pwm_frequency
+            .ok_or(BoardError::BoardMethodNotSupported("set_pwm_frequency"))?;
+        board_result(cb(pin, frequency_hz, self.user_data))
+    }
+}
+
+impl Status for c_board {
+    fn get_status(
+        &self,
+    ) -> Result<Option<micro_rdk::google::protobuf::Struct>, micro_rdk::common::status::StatusError>
+    {
+        Ok(Some(micro_rdk::google::protobuf::Struct {
+            fields: HashMap::new(),
+        }))
+    }
+}
+
+#[allow(non_camel_case_types)]
+struct c_analog_reader {
+    name: String,
+    c_name: CString,
+    read: extern "C" fn(*const c_char, *mut u16, *mut c_void) -> c_int,
+    user_data: *mut c_void,
+}
+
+impl AnalogReader<u16> for c_analog_reader {
+    type Error = AnalogError;
+    fn name(&self) -> String {
+        self.name.clone()
+    }
+    fn read(&mut self) -> Result<u16, Self::Error> {
+        let mut value: u16 = 0;
+        match (self.read)(self.c_name.as_ptr(), &mut value as *mut _, self.user_data) {
+            0 => Ok(value),
+            code => Err(AnalogError::AnalogReadError(code)),
+        }
+    }
+    fn resolution(&self) -> AnalogResolution {
+        Default::default()
+    }
+}
@@ -0,0 +1,249 @@
+use bytes::{BufMut, BytesMut};
+use micro_rdk::{
+    common::{
+        camera::{Camera, CameraError},
+        status::Status,
+    },
+    DoCommand,
+};
+use std::{
+    collections::HashMap,
+    ffi::{c_char, c_int, c_uchar, c_void, CStr},
+};
+
+use super::{
+    config::config_context,
+    errors::viam_code,
+    sensor::{close_callback, config_callback},
+};
+
+#[allow(non_camel_case_types)]
+type get_image_callback = extern "C" fn(*mut c_uchar, usize, *mut usize, *mut c_void) -> c_int;
+
+// GetImageResponse tags for `mime_type` (field 1) and `image` (field 2), both length delimited
+const MIME_TYPE_KEY: u8 = 0x0a;
+const IMAGE_KEY: u8 = 0x12;
+// The frame size isn't known before the callback writes it, so room for a 5 bytes varint
+// (enough to express any frame that fits the buffer) is reserved and padded once the size is known
+const PADDED_LEN_SIZE: usize = 5;
+
+#[allow(non_camel_case_types)]
+pub struct c_camera_config {
+    pub(crate) user_data: *mut c_void,
+    pub(crate) config_callback: config_callback,
+    pub(crate) get_image_callback: get_image_callback,
+    pub(crate) mime_type: String,
+    pub(crate) close_callback: Option<close_callback>,
+}
+
+#[allow(non_camel_case_types)]
+#[derive(DoCommand)]
+pub struct c_camera {
+    pub(crate) user_data: *mut c_void,
+    pub(crate) get_image_callback: get_image_callback,
+    pub(crate) mime_type: String,
+    pub(crate) close_callback: Option<close_callback>,
+}
+
+impl Drop for c_camera {
+    fn drop(&mut self) {
+        if let Some(close) = self.close_callback {
+            let ret = close(self.user_data);
+            if ret != 0 {
+                log::warn!("camera close callback returned {}", ret);
+            }
+        }
+    }
+}
+
+unsafe impl Send for c_camera {}
+unsafe impl Sync for c_camera {}
+
+/// Creates an new camera config to be used for registering a C camera with the Robot's registry
+///
+/// The configure and get image functions should be set with
+/// `c_camera_config_set_config_callback` and `c_camera_config_set_get_image_callback`
+///
+/// Optionally you can set a pointer to some data to be passed during the configuration step with
+/// `c_camera_config_set_user_data`, the MIME type of the frames defaults to "image/jpeg" and can be
+/// changed with `c_camera_config_set_mime_type`
+#[no_mangle]
+pub extern "C" fn c_camera_config_new() -> *mut c_camera_config {
+    Box::into_raw(Box::new(c_camera_config {
+        user_data: std::ptr::null_mut(),
+        config_callback: config_noop,
+        get_image_callback: get_image_noop,
+        mime_type: "image/jpeg".to_owned(),
+        close_callback: None,
+    }))
+}
+
+/// Set the user data pointer, the value will then be passed to the `config_callback` during the configuration step
+///
+/// # Safety
+/// `ctx` must be a valid pointer
+#[no_mangle]
+pub unsafe extern "C" fn c_camera_config_set_user_data(
+    ctx: *mut c_camera_config,
+    data: *mut c_void,
+) -> viam_code {
+    if !ctx.is_null() {
+        let ctx = unsafe { &mut *ctx };
+        ctx.user_data = data;
+        return viam_code::VIAM_OK;
+    }
+    viam_code::VIAM_INVALID_ARG
+}
+
+/// Set the config callback, which will be called when this camera is configured
+///
+/// # Safety
+/// `ctx` must be a valid pointer
+#[no_mangle]
+pub unsafe extern "C" fn c_camera_config_set_config_callback(
+    ctx: *mut c_camera_config,
+    cb: config_callback,
+) -> viam_code {
+    if !ctx.is_null() {
+        let ctx = unsafe { &mut *ctx };
+        ctx.config_callback = cb;
+        return viam_code::VIAM_OK;
+    }
+    viam_code::VIAM_INVALID_ARG
+}
+
+/// Set the get image callback, which will be called when GetImage is called on a properly
+/// configured camera.
+///
+/// The callback receives a pointer into the response buffer and its capacity, the frame should be
+/// written directly there and its length stored in the `size_t` out parameter. Returning a
+/// non zero value fails the request.
+///
+/// # Safety
+/// `ctx` must be a valid pointer
+#[no_mangle]
+pub unsafe extern "C" fn c_camera_config_set_get_image_callback(
+    ctx: *mut c_camera_config,
+    cb: get_image_callback,
+) -> viam_code {
+    if !ctx.is_null() {
+        let ctx = unsafe { &mut *ctx };
+        ctx.get_image_callback = cb;
+        return viam_code::VIAM_OK;
+    }
+    viam_code::VIAM_INVALID_ARG
+}
+
+/// Set the MIME type reported along the frames produced by the camera
+///
+/// # Safety
+/// `ctx` and `mime_type` must be valid pointers
+/// `mime_type` must be a null terminated C string
+#[no_mangle]
+pub unsafe extern "C" fn c_camera_config_set_mime_type(
+    ctx: *mut c_camera_config,
+    mime_type: *const c_char,
+) -> viam_code {
+    if ctx.is_null() || mime_type.is_null() {
+        return viam_code::VIAM_INVALID_ARG;
+    }
+    let ctx = unsafe { &mut *ctx };
+    let mime_type = if let Ok(s) = unsafe { CStr::from_ptr(mime_type) }.to_str() {
+        s
+    } else {
+        return viam_code::VIAM_INVALID_ARG;
+    };
+    ctx.mime_type = mime_type.to_owned();
+    viam_code::VIAM_OK
+}
+
+/// Set the close callback, called with the camera data returned by `config_callback` when the
+/// camera is removed from the robot, either because its config changed or it was deleted. The
+/// driver should release the resources held by the camera.
+///
+/// # Safety
+/// `ctx` must be a valid pointer
+#[no_mangle]
+pub unsafe extern "C" fn c_camera_config_set_close_callback(
+    ctx: *mut c_camera_config,
+    cb: close_callback,
+) -> viam_code {
+    if !ctx.is_null() {
+        let ctx = unsafe { &mut *ctx };
+        ctx.close_callback = Some(cb);
+        return viam_code::VIAM_OK;
+    }
+    viam_code::VIAM_INVALID_ARG
+}
+
+/// cbindgen:ignore
+extern "C" fn config_noop(_: *mut config_context, _: *mut c_void, _: *mut *mut c_void) -> c_int {
+    -1
+}
+
+/// cbindgen:ignore
+extern "C" fn get_image_noop(_: *mut c_uchar, _: usize, _: *mut usize, _: *mut c_void) -> c_int {
+    -1
+}
+
+fn put_varint(buffer: &mut BytesMut, mut value: u64) {
+    while value >= 0x80 {
+        buffer.put_u8((value as u8 & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    buffer.put_u8(value as u8);
+}
+
+impl Camera for c_camera {
+    fn get_image(&mut self, mut buffer: BytesMut) -> Result<BytesMut, CameraError> {
+        // The response is encoded by hand so the frame can be written by the callback straight
+        // into the gRPC buffer rather than being copied into an intermediate GetImageResponse
+        if !self.mime_type.is_empty() {
+            buffer.put_u8(MIME_TYPE_KEY);
+            put_varint(&mut buffer, self.mime_type.len() as u64);
+            buffer.put_slice(self.mime_type.as_bytes());
+        }
+        buffer.put_u8(IMAGE_KEY);
+        let len_idx = buffer.len();
+        buffer.put_bytes(0, PADDED_LEN_SIZE);
+
+        let spare = buffer.spare_capacity_mut();
+        let capacity = spare.len();
+        let mut written: usize = 0;
+        let ret = (self.get_image_callback)(
+            spare.as_mut_ptr() as *mut c_uchar,
+            capacity,
+            &mut written as *mut _,
+            self.user_data,
+        );
+        if ret != 0 {
+            return Err(CameraError::FailedToGetImage);
+        }
+        if written > capacity {
+            return Err(CameraError::ImageTooBig);
+        }
+        // Safety: the callback initialized `written` bytes of the spare capacity
+        unsafe { buffer.set_len(len_idx + PADDED_LEN_SIZE + written) };
+
+        // padded varint, a non minimal encoding is valid protobuf
+        let len = &mut buffer[len_idx..len_idx + PADDED_LEN_SIZE];
+        for (i, b) in len.iter_mut().enumerate() {
+            *b = ((written >> (7 * i)) & 0x7f) as u8;
+            if i < PADDED_LEN_SIZE - 1 {
+                *b |= 0x80;
+            }
+        }
+        Ok(buffer)
+    }
+}
+
+impl Status for c_camera {
+    fn get_status(
+        &self,
+    ) -> Result<Option<micro_rdk::google::protobuf::Struct>, micro_rdk::common::status::StatusError>
+    {
+        Ok(Some(micro_rdk::google::protobuf::Struct {
+            fields: HashMap::new(),
+        }))
+    }
+}
@@ -1,6 +1,6 @@
-use std::ffi::{c_char, c_int, CStr, CString};
+use std::ffi::{c_char, c_double, c_int, CStr, CString};
 
-use micro_rdk::common::config::{AttributeError, ConfigType};
+use micro_rdk::common::config::{AttributeError, ConfigType, Kind};
 
 use super::errors;
 
@@ -87,3 +87,181 @@ pub unsafe extern "C" fn config_get_i32(
     unsafe { *out = val };
     errors::viam_code::VIAM_OK
 }
+
+/// Get a string from the attribute section of a sensor configuration without copying it
+/// if found a pointer to the content of the string will be written to `out` and its length to `len`
+///
+/// The string is borrowed from the configuration, it is *not* null terminated and remains valid only
+/// for the duration of the `config_callback`
+/// # Safety
+/// `ctx`, `key`, `out`, `len` must be valid pointers for the duration of the call
+/// `key` must be a null terminated C string
+#[no_mangle]
+pub unsafe extern "C" fn config_get_string_ref(
+    ctx: *mut config_context,
+    key: *const c_char,
+    out: *mut *const c_char,
+    len: *mut usize,
+) -> errors::viam_code {
+    if ctx.is_null() || key.is_null() || out.is_null() || len.is_null() {
+        return errors::viam_code::VIAM_INVALID_ARG;
+    }
+    let key = if let Ok(s) = unsafe { CStr::from_ptr(key) }.to_str() {
+        s
+    } else {
+        return errors::viam_code::VIAM_INVALID_ARG;
+    };
+    let ctx = unsafe { &mut *ctx };
+    let val = match ctx.cfg.get_attribute::<&str>(key) {
+        Ok(val) => val,
+        Err(AttributeError::KeyNotFound(_)) => return errors::viam_code::VIAM_KEY_NOT_FOUND,
+        Err(_) => return errors::viam_code::VIAM_INVALID_ARG,
+    };
+    unsafe {
+        *out = val.as_ptr() as *const c_char;
+        *len = val.len();
+    };
+    errors::viam_code::VIAM_OK
+}
+
+/// Get a double from the attribute section of a sensor configuration
+/// if found the value will be written to `out`
+///
+/// # Safety
+/// `ctx`, `key`, `out` must be valid pointers for the duration of the call
+/// `key` must be a null terminated C string
+#[no_mangle]
+pub unsafe extern "C" fn config_get_double(
+    ctx: *mut config_context,
+    key: *const c_char,
+    out: *mut c_double,
+) -> errors::viam_code {
+    if ctx.is_null() || key.is_null() || out.is_null() {
+        return errors::viam_code::VIAM_INVALID_ARG;
+    }
+    let key = if let Ok(s) = unsafe { CStr::from_ptr(key) }.to_str() {
+        s
+    } else {
+        return errors::viam_code::VIAM_INVALID_ARG;
+    };
+    let ctx = unsafe { &mut *ctx };
+    let val = match ctx.cfg.get_attribute::<f64>(key) {
+        Ok(val) => val,
+        Err(AttributeError::KeyNotFound(_)) => return errors::viam_code::VIAM_KEY_NOT_FOUND,
+        Err(_) => return errors::viam_code::VIAM_INVALID_ARG,
+    };
+    unsafe { *out = val };
+    errors::viam_code::VIAM_OK
+}
+
+/// Get a boolean from the attribute section of a sensor configuration
+/// if found the value will be written to `out`
+///
+/// # Safety
+/// `ctx`, `key`, `out` must be valid pointers for the duration of the call
+/// `key` must be a null terminated C string
+#[no_mangle]
+pub unsafe extern "C" fn config_get_bool(
+    ctx: *mut config_context,
+    key: *const c_char,
+    out: *mut bool,
+) -> errors::viam_code {
+    if ctx.is_null() || key.is_null() || out.is_null() {
+        return errors::viam_code::VIAM_INVALID_ARG;
+    }
+    let key = if let Ok(s) = unsafe { CStr::from_ptr(key) }.to_str() {
+        s
+    } else {
+        return errors::viam_code::VIAM_INVALID_ARG;
+    };
+    let ctx = unsafe { &mut *ctx };
+    let val = match ctx.cfg.get_attribute::<bool>(key) {
+        Ok(val) => val,
+        Err(AttributeError::KeyNotFound(_)) => return errors::viam_code::VIAM_KEY_NOT_FOUND,
+        Err(_) => return errors::viam_code::VIAM_INVALID_ARG,
+    };
+    unsafe { *out = val };
+    errors::viam_code::VIAM_OK
+}
+
+// Elements are converted straight from the configuration into the caller's buffer, no intermediate
+// Vec is allocated
+unsafe fn config_get_array<T>(
+    ctx: *mut config_context,
+    key: *const c_char,
+    out: *mut T,
+    len: usize,
+    count: *mut usize,
+) -> errors::viam_code
+where
+    T: for<'a> TryFrom<&'a Kind, Error = AttributeError>,
+{
+    if ctx.is_null() || key.is_null() || count.is_null() || (out.is_null() && len > 0) {
+        return errors::viam_code::VIAM_INVALID_ARG;
+    }
+    let key = if let Ok(s) = unsafe { CStr::from_ptr(key) }.to_str() {
+        s
+    } else {
+        return errors::viam_code::VIAM_INVALID_ARG;
+    };
+    let ctx = unsafe { &mut *ctx };
+    let values = match ctx.cfg.get_attribute::<&Kind>(key) {
+        Ok(Kind::VecValue(values)) => values,
+        Ok(_) => return errors::viam_code::VIAM_INVALID_ARG,
+        Err(AttributeError::KeyNotFound(_)) => return errors::viam_code::VIAM_KEY_NOT_FOUND,
+        Err(_) => return errors::viam_code::VIAM_INVALID_ARG,
+    };
+    unsafe { *count = values.len() };
+    if values.len() > len {
+        return errors::viam_code::VIAM_INVALID_ARG;
+    }
+    for (i, v) in values.iter().enumerate() {
+        match T::try_from(v) {
+            Ok(v) => unsafe { out.add(i).write(v) },
+            Err(_) => return errors::viam_code::VIAM_INVALID_ARG,
+        }
+    }
+    errors::viam_code::VIAM_OK
+}
+
+/// Get an array of int32 from the attribute section of a sensor configuration
+/// if found the values will be written to `out` which can hold up to `len` elements, the number of
+/// elements of the array is written to `count`.
+///
+/// When the array holds more than `len` elements nothing is written to `out` and VIAM_INVALID_ARG is
+/// returned, `count` can then be used to size the buffer. `out` may be NULL if `len` is 0
+/// # Safety
+/// `ctx`, `key`, `count` must be valid pointers for the duration of the call
+/// `out` must point to at least `len` int32
+/// `key` must be a null terminated C string
+#[no_mangle]
+pub unsafe extern "C" fn config_get_i32_array(
+    ctx: *mut config_context,
+    key: *const c_char,
+    out: *mut c_int,
+    len: usize,
+    count: *mut usize,
+) -> errors::viam_code {
+    unsafe { config_get_array::<i32>(ctx, key, out, len, count) }
+}
+
+/// Get an array of doubles from the attribute section of a sensor configuration
+/// if found the values will be written to `out` which can hold up to `len` elements, the number of
+/// elements of the array is written to `count`.
+///
+/// When the array holds more than `len` elements nothing is written to `out` and VIAM_INVALID_ARG is
+/// returned, `count` can then be used to size the buffer. `out` may be NULL if `len` is 0
+/// # Safety
+/// `ctx`, `key`, `count` must be valid pointers for the duration of the call
+/// `out` must point to at least `len` doubles
+/// `key` must be a null terminated C string
+#[no_mangle]
+pub unsafe extern "C" fn config_get_double_array(
+    ctx: *mut config_context,
+    key: *const c_char,
+    out: *mut c_double,
+    len: usize,
+    count: *mut usize,
+) -> errors::viam_code {
+    unsafe { config_get_array::<f64>(ctx, key, out, len, count) }
+}
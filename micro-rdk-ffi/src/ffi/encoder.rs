@@ -0,0 +1,125 @@
+use micro_rdk::{
+    common::{
+        encoder::{
+            Encoder, EncoderError, EncoderPosition, EncoderPositionType,
+            EncoderSupportedRepresentations,
+        },
+        status::Status,
+    },
+    DoCommand,
+};
+use std::{
+    collections::HashMap,
+    ffi::{c_float, c_int, c_void},
+};
+
+use super::sensor::{close_callback, config_callback};
+
+/// Callbacks implementing an encoder in C, registered with `viam_server_register_c_encoder`
+///
+/// Every callback receives as its last argument the pointer written by the `config` callback and
+/// returns 0 on success. A NULL callback makes the matching method unimplemented, the supported
+/// position representations are derived from the position callbacks that are set
+#[repr(C)]
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy)]
+pub struct c_encoder_vtable {
+    pub config: Option<config_callback>,
+    pub get_position_ticks: Option<extern "C" fn(*mut c_float, *mut c_void) -> c_int>,
+    pub get_position_degrees: Option<extern "C" fn(*mut c_float, *mut c_void) -> c_int>,
+    pub reset_position: Option<extern "C" fn(*mut c_void) -> c_int>,
+    /// releases the pointer written by `config`, called when the encoder is dropped (for
+    /// example on reconfiguration)
+    pub close: Option<close_callback>,
+}
+
+#[allow(non_camel_case_types)]
+#[derive(DoCommand)]
+pub struct c_encoder {
+    user_data: *mut c_void,
+    vtable: c_encoder_vtable,
+}
+
+unsafe impl Send for c_encoder {}
+unsafe impl Sync for c_encoder {}
+
+impl c_encoder {
+    pub(crate) fn new(user_data: *mut c_void, vtable: c_encoder_vtable) -> Self {
+        Self { user_data, vtable }
+    }
+}
+
+impl Drop for c_encoder {
+    fn drop(&mut self) {
+        if let Some(close) = self.vtable.close {
+            let ret = close(self.user_data);
+            if ret != 0 {
+                log::warn!("encoder close callback returned {}", ret);
+            }
+        }
+    }
+}
+
+impl Encoder for c_encoder {
+    fn get_properties(&mut self) -> EncoderSupportedRepresentations {
+        EncoderSupportedRepresentations {
+            ticks_count_supported: self.vtable.get_position_ticks.is_some(),
+            angle_degrees_supported: self.vtable.get_position_degrees.is_some(),
+        }
+    }
+    fn get_position(
+        &self,
+        position_type: EncoderPositionType,
+    ) -> Result<EncoderPosition, EncoderError> {
+        let (position_type, cb) = match position_type {
+            EncoderPositionType::DEGREES => (
+                EncoderPositionType::DEGREES,
+                self.vtable
+                    .get_position_degrees
+                    .ok_or(EncoderError::EncoderAngularNotSupported)?,
+            ),
+            EncoderPositionType::TICKS => (
+                EncoderPositionType::TICKS,
+                self.vtable
+                    .get_position_ticks
+                    .ok_or(EncoderError::EncoderMethodUnimplemented)?,
+            ),
+            EncoderPositionType::UNSPECIFIED => {
+                match (
+                    self.vtable.get_position_ticks,
+                    self.vtable.get_position_degrees,
+                ) {
+                    (Some(cb), _) => (EncoderPositionType::TICKS, cb),
+                    (None, Some(cb)) => (EncoderPositionType::DEGREES, cb),
+                    (None, None) => return Err(EncoderError::EncoderMethodUnimplemented),
+                }
+            }
+        };
+        let mut value: f32 = 0.0;
+        match cb(&mut value as *mut _, self.user_data) {
+            0 => Ok(position_type.wrap_value(value)),
+            code => Err(EncoderError::EncoderCodeError(code)),
+        }
+    }
+    fn reset_position(&mut self) -> Result<(), EncoderError> {
+        let cb = self
+            .vtable
+            .reset_position
+            .ok_or(EncoderError::EncoderMethodUnimplemented)?;
+        match cb(self.user_data) {
+            0 => Ok(()),
+            code => Err(EncoderError::EncoderCodeError(code)),
+        }
+    }
+}
+
+impl Status for c_encoder {
+    fn get_status(
+        &self,
+    ) -> Result<Option<micro_rdk::google::protobuf::Struct>, micro_rdk::common::status::StatusError>
+    {
+        Ok(Some(micro_rdk::google::protobuf::Struct {
+            fields: HashMap::new(),
+        }))
+    }
+}
@@ -1,4 +1,13 @@
+pub mod allocator;
+pub mod board;
+#[cfg(feature = "camera")]
+pub mod camera;
 pub mod config;
+pub mod encoder;
 pub mod errors;
+pub mod motor;
+pub mod movement_sensor;
+pub mod power_sensor;
 pub mod runtime;
 pub mod sensor;
+pub mod stats;
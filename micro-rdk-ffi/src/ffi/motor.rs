@@ -0,0 +1,136 @@
+use micro_rdk::{
+    common::{
+        actuator::{Actuator, ActuatorError},
+        motor::{Motor, MotorError, MotorSupportedProperties},
+        status::Status,
+    },
+    DoCommand,
+};
+use std::{
+    collections::HashMap,
+    ffi::{c_double, c_int, c_void},
+    time::Duration,
+};
+
+use super::sensor::{close_callback, config_callback};
+
+/// Callbacks implementing a motor in C, registered with `viam_server_register_c_motor`
+///
+/// Every callback receives as its last argument the pointer written by the `config` callback and
+/// returns 0 on success. A NULL callback makes the matching method unimplemented
+#[repr(C)]
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy)]
+pub struct c_motor_vtable {
+    pub config: Option<config_callback>,
+    pub set_power: Option<extern "C" fn(c_double, *mut c_void) -> c_int>,
+    pub get_position: Option<extern "C" fn(*mut i32, *mut c_void) -> c_int>,
+    /// should start the motor and return immediately, it isn't waited upon
+    pub go_for: Option<extern "C" fn(c_double, c_double, *mut c_void) -> c_int>,
+    pub stop: Option<extern "C" fn(*mut c_void) -> c_int>,
+    pub is_moving: Option<extern "C" fn(*mut bool, *mut c_void) -> c_int>,
+    /// releases the pointer written by `config`, called when the motor is dropped (for
+    /// example on reconfiguration)
+    pub close: Option<close_callback>,
+}
+
+#[allow(non_camel_case_types)]
+#[derive(DoCommand)]
+pub struct c_motor {
+    user_data: *mut c_void,
+    vtable: c_motor_vtable,
+}
+
+unsafe impl Send for c_motor {}
+unsafe impl Sync for c_motor {}
+
+impl c_motor {
+    pub(crate) fn new(user_data: *mut c_void, vtable: c_motor_vtable) -> Self {
+        Self { user_data, vtable }
+    }
+}
+
+impl Drop for c_motor {
+    fn drop(&mut self) {
+        if let Some(close) = self.vtable.close {
+            let ret = close(self.user_data);
+            if ret != 0 {
+                log::warn!("motor close callback returned {}", ret);
+            }
+        }
+    }
+}
+
+impl Motor for c_motor {
+    fn set_power(&mut self, pct: f64) -> Result<(), MotorError> {
+        let cb = self
+            .vtable
+            .set_power
+            .ok_or(MotorError::MotorMethodUnimplemented("set_power"))?;
+        match cb(pct, self.user_data) {
+            0 => Ok(()),
+            code => Err(MotorError::MotorCodeError(code)),
+        }
+    }
+    fn get_position(&mut self) -> Result<i32, MotorError> {
+        let cb = self
+            .vtable
+            .get_position
+            .ok_or(MotorError::MotorMethodUnimplemented("get_position"))?;
+        let mut position: i32 = 0;
+        match cb(&mut position as *mut _, self.user_data) {
+            0 => Ok(position),
+            code => Err(MotorError::MotorCodeError(code)),
+        }
+    }
+    fn go_for(&mut self, rpm: f64, revolutions: f64) -> Result<Option<Duration>, MotorError> {
+        let cb = self
+            .vtable
+            .go_for
+            .ok_or(MotorError::MotorMethodUnimplemented("go_for"))?;
+        match cb(rpm, revolutions, self.user_data) {
+            0 => Ok(None),
+            code => Err(MotorError::MotorCodeError(code)),
+        }
+    }
+    fn get_properties(&mut self) -> MotorSupportedProperties {
+        MotorSupportedProperties {
+            position_reporting: self.vtable.get_position.is_some(),
+        }
+    }
+}
+
+impl Actuator for c_motor {
+    fn stop(&mut self) -> Result<(), ActuatorError> {
+        let cb = self
+            .vtable
+            .stop
+            .ok_or(ActuatorError::ActuatorMethodUnimplemented("stop"))?;
+        match cb(self.user_data) {
+            0 => Ok(()),
+            code => Err(ActuatorError::ActuatorCodeError(code)),
+        }
+    }
+    fn is_moving(&mut self) -> Result<bool, ActuatorError> {
+        let cb = self
+            .vtable
+            .is_moving
+            .ok_or(ActuatorError::ActuatorMethodUnimplemented("is_moving"))?;
+        let mut moving = false;
+        match cb(&mut moving as *mut _, self.user_data) {
+            0 => Ok(moving),
+            code => Err(ActuatorError::ActuatorCodeError(code)),
+        }
+    }
+}
+
+impl Status for c_motor {
+    fn get_status(
+        &self,
+    ) -> Result<Option<micro_rdk::google::protobuf::Struct>, micro_rdk::common::status::StatusError>
+    {
+        Ok(Some(micro_rdk::google::protobuf::Struct {
+            fields: HashMap::new(),
+        }))
+    }
+}
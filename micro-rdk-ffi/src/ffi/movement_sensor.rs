@@ -0,0 +1,150 @@
+use micro_rdk::{
+    common::{
+        math_utils::Vector3,
+        movement_sensor::{GeoPosition, MovementSensor, MovementSensorSupportedMethods},
+        sensor::SensorError,
+        status::Status,
+    },
+    DoCommand, MovementSensorReadings,
+};
+use std::{
+    collections::HashMap,
+    ffi::{c_double, c_float, c_int, c_void},
+};
+
+use super::sensor::{close_callback, config_callback};
+
+#[allow(non_camel_case_types)]
+type vector3_callback =
+    extern "C" fn(*mut c_double, *mut c_double, *mut c_double, *mut c_void) -> c_int;
+
+/// Callbacks implementing a movement sensor in C, registered with `viam_server_register_c_movement_sensor`
+///
+/// Every callback receives as its last argument the pointer written by the `config` callback and
+/// returns 0 on success. The supported methods reported by the sensor are the callbacks that are
+/// set, vectors are written as their x, y and z components
+#[repr(C)]
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy)]
+pub struct c_movement_sensor_vtable {
+    pub config: Option<config_callback>,
+    /// writes the latitude, longitude and altitude
+    pub get_position:
+        Option<extern "C" fn(*mut c_double, *mut c_double, *mut c_float, *mut c_void) -> c_int>,
+    pub get_linear_velocity: Option<vector3_callback>,
+    pub get_angular_velocity: Option<vector3_callback>,
+    pub get_linear_acceleration: Option<vector3_callback>,
+    pub get_compass_heading: Option<extern "C" fn(*mut c_double, *mut c_void) -> c_int>,
+    /// releases the pointer written by `config`, called when the movement sensor is dropped (for
+    /// example on reconfiguration)
+    pub close: Option<close_callback>,
+}
+
+#[allow(non_camel_case_types)]
+#[derive(DoCommand, MovementSensorReadings)]
+pub struct c_movement_sensor {
+    user_data: *mut c_void,
+    vtable: c_movement_sensor_vtable,
+}
+
+unsafe impl Send for c_movement_sensor {}
+unsafe impl Sync for c_movement_sensor {}
+
+impl c_movement_sensor {
+    pub(crate) fn new(user_data: *mut c_void, vtable: c_movement_sensor_vtable) -> Self {
+        Self { user_data, vtable }
+    }
+
+    fn get_vector3(
+        &self,
+        cb: Option<vector3_callback>,
+        method: &'static str,
+    ) -> Result<Vector3, SensorError> {
+        let cb = cb.ok_or(SensorError::SensorMethodUnimplemented(method))?;
+        let mut v = Vector3::new();
+        match cb(
+            &mut v.x as *mut _,
+            &mut v.y as *mut _,
+            &mut v.z as *mut _,
+            self.user_data,
+        ) {
+            0 => Ok(v),
+            code => Err(SensorError::SensorCodeError(code)),
+        }
+    }
+}
+
+impl Drop for c_movement_sensor {
+    fn drop(&mut self) {
+        if let Some(close) = self.vtable.close {
+            let ret = close(self.user_data);
+            if ret != 0 {
+                log::warn!("movement sensor close callback returned {}", ret);
+            }
+        }
+    }
+}
+
+impl MovementSensor for c_movement_sensor {
+    fn get_position(&mut self) -> Result<GeoPosition, SensorError> {
+        let cb = self
+            .vtable
+            .get_position
+            .ok_or(SensorError::SensorMethodUnimplemented("get_position"))?;
+        let mut pos = GeoPosition::default();
+        match cb(
+            &mut pos.lat as *mut _,
+            &mut pos.lon as *mut _,
+            &mut pos.alt as *mut _,
+            self.user_data,
+        ) {
+            0 => Ok(pos),
+            code => Err(SensorError::SensorCodeError(code)),
+        }
+    }
+    fn get_linear_velocity(&mut self) -> Result<Vector3, SensorError> {
+        self.get_vector3(self.vtable.get_linear_velocity, "get_linear_velocity")
+    }
+    fn get_angular_velocity(&mut self) -> Result<Vector3, SensorError> {
+        self.get_vector3(self.vtable.get_angular_velocity, "get_angular_velocity")
+    }
+    fn get_linear_acceleration(&mut self) -> Result<Vector3, SensorError> {
+        self.get_vector3(
+            self.vtable.get_linear_acceleration,
+            "get_linear_acceleration",
+        )
+    }
+    fn get_compass_heading(&mut self) -> Result<f64, SensorError> {
+        let cb = self
+            .vtable
+            .get_compass_heading
+            .ok_or(SensorError::SensorMethodUnimplemented(
+                "get_compass_heading",
+            ))?;
+        let mut heading: f64 = 0.0;
+        match cb(&mut heading as *mut _, self.user_data) {
+            0 => Ok(heading),
+            code => Err(SensorError::SensorCodeError(code)),
+        }
+    }
+    fn get_properties(&self) -> MovementSensorSupportedMethods {
+        MovementSensorSupportedMethods {
+            position_supported: self.vtable.get_position.is_some(),
+            linear_velocity_supported: self.vtable.get_linear_velocity.is_some(),
+            angular_velocity_supported: self.vtable.get_angular_velocity.is_some(),
+            linear_acceleration_supported: self.vtable.get_linear_acceleration.is_some(),
+            compass_heading_supported: self.vtable.get_compass_heading.is_some(),
+        }
+    }
+}
+
+impl Status for c_movement_sensor {
+    fn get_status(
+        &self,
+    ) -> Result<Option<micro_rdk::google::protobuf::Struct>, micro_rdk::common::status::StatusError>
+    {
+        Ok(Some(micro_rdk::google::protobuf::Struct {
+            fields: HashMap::new(),
+        }))
+    }
+}
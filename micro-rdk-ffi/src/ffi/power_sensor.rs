@@ -0,0 +1,122 @@
+use micro_rdk::{
+    common::{
+        power_sensor::{Current, PowerSensor, PowerSupplyType, Voltage},
+        sensor::SensorError,
+        status::Status,
+    },
+    DoCommand, PowerSensorReadings,
+};
+use std::{
+    collections::HashMap,
+    ffi::{c_double, c_int, c_void},
+};
+
+use super::sensor::{close_callback, config_callback};
+
+/// Callbacks implementing a power sensor in C, registered with `viam_server_register_c_power_sensor`
+///
+/// Every callback receives as its last argument the pointer written by the `config` callback and
+/// returns 0 on success. A NULL callback makes the matching method unimplemented
+#[repr(C)]
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy)]
+pub struct c_power_sensor_vtable {
+    pub config: Option<config_callback>,
+    /// writes the voltage in volts and whether the power supply is AC
+    pub get_voltage: Option<extern "C" fn(*mut c_double, *mut bool, *mut c_void) -> c_int>,
+    /// writes the current in amperes and whether the power supply is AC
+    pub get_current: Option<extern "C" fn(*mut c_double, *mut bool, *mut c_void) -> c_int>,
+    /// writes the power in watts
+    pub get_power: Option<extern "C" fn(*mut c_double, *mut c_void) -> c_int>,
+    /// releases the pointer written by `config`, called when the power sensor is dropped (for
+    /// example on reconfiguration)
+    pub close: Option<close_callback>,
+}
+
+#[allow(non_camel_case_types)]
+#[derive(DoCommand, PowerSensorReadings)]
+pub struct c_power_sensor {
+    user_data: *mut c_void,
+    vtable: c_power_sensor_vtable,
+}
+
+unsafe impl Send for c_power_sensor {}
+unsafe impl Sync for c_power_sensor {}
+
+impl c_power_sensor {
+    pub(crate) fn new(user_data: *mut c_void, vtable: c_power_sensor_vtable) -> Self {
+        Self { user_data, vtable }
+    }
+}
+
+impl Drop for c_power_sensor {
+    fn drop(&mut self) {
+        if let Some(close) = self.vtable.close {
+            let ret = close(self.user_data);
+            if ret != 0 {
+                log::warn!("power sensor close callback returned {}", ret);
+            }
+        }
+    }
+}
+
+fn power_supply_type(is_ac: bool) -> PowerSupplyType {
+    if is_ac {
+        PowerSupplyType::AC
+    } else {
+        PowerSupplyType::DC
+    }
+}
+
+impl PowerSensor for c_power_sensor {
+    fn get_voltage(&mut self) -> Result<Voltage, SensorError> {
+        let cb = self
+            .vtable
+            .get_voltage
+            .ok_or(SensorError::SensorMethodUnimplemented("get_voltage"))?;
+        let (mut volts, mut is_ac) = (0.0, false);
+        match cb(&mut volts as *mut _, &mut is_ac as *mut _, self.user_data) {
+            0 => Ok(Voltage {
+                volts,
+                power_supply_type: power_supply_type(is_ac),
+            }),
+            code => Err(SensorError::SensorCodeError(code)),
+        }
+    }
+    fn get_current(&mut self) -> Result<Current, SensorError> {
+        let cb = self
+            .vtable
+            .get_current
+            .ok_or(SensorError::SensorMethodUnimplemented("get_current"))?;
+        let (mut amperes, mut is_ac) = (0.0, false);
+        match cb(&mut amperes as *mut _, &mut is_ac as *mut _, self.user_data) {
+            0 => Ok(Current {
+                amperes,
+                power_supply_type: power_supply_type(is_ac),
+            }),
+            code => Err(SensorError::SensorCodeError(code)),
+        }
+    }
+    fn get_power(&mut self) -> Result<f64, SensorError> {
+        let cb = self
+            .vtable
+            .get_power
+            .ok_or(SensorError::SensorMethodUnimplemented("get_power"))?;
+        let mut watts: f64 = 0.0;
+        match cb(&mut watts as *mut _, self.user_data) {
+            0 => Ok(watts),
+            code => Err(SensorError::SensorCodeError(code)),
+        }
+    }
+}
+
+impl Status for c_power_sensor {
+    fn get_status(
+        &self,
+    ) -> Result<Option<micro_rdk::google::protobuf::Struct>, micro_rdk::common::status::StatusError>
+    {
+        Ok(Some(micro_rdk::google::protobuf::Struct {
+            fields: HashMap::new(),
+        }))
+    }
+}
@@ -1,25 +1,45 @@
 use std::{
     ffi::{c_char, c_void, CStr},
     marker::{PhantomData, PhantomPinned},
+    mem::MaybeUninit,
     sync::{Arc, Mutex},
+    time::Instant,
 };
 
 use micro_rdk::common::{
+    board::{BoardError, BoardType},
     config::ConfigType,
+    encoder::{Encoder, EncoderError},
     entry::RobotRepresentation,
+    motor::{MotorError, MotorType},
+    movement_sensor::MovementSensorType,
+    power_sensor::PowerSensorType,
     registry::{ComponentRegistry, Dependency},
     sensor::{SensorError, SensorType},
 };
 
 use super::{
+    board::{c_board, c_board_vtable},
     config::config_context,
+    encoder::{c_encoder, c_encoder_vtable},
     errors::viam_code,
-    sensor::{generic_c_sensor, generic_c_sensor_config},
+    motor::{c_motor, c_motor_vtable},
+    movement_sensor::{c_movement_sensor, c_movement_sensor_vtable},
+    power_sensor::{c_power_sensor, c_power_sensor_vtable},
+    sensor::{config_callback, generic_c_sensor, generic_c_sensor_config},
+    stats,
+};
+
+#[cfg(feature = "camera")]
+use {
+    super::camera::{c_camera, c_camera_config},
+    micro_rdk::common::camera::{Camera, CameraError},
 };
 
 #[allow(non_camel_case_types)]
 pub struct viam_server_context {
     registry: Box<ComponentRegistry>,
+    max_connections: Option<usize>,
     _marker: PhantomData<(*mut u8, PhantomPinned)>, // Non Send, Non Sync
 }
 
@@ -38,6 +58,7 @@ pub extern "C" fn init_viam_server_context() -> *mut viam_server_context {
     let registry = Box::<ComponentRegistry>::default();
     Box::into_raw(Box::new(viam_server_context {
         registry,
+        max_connections: None,
         _marker: Default::default(),
     }))
 }
@@ -77,24 +98,24 @@ pub unsafe extern "C" fn viam_server_register_c_generic_sensor(
     // Because registry expects a &'static str for its key, we have to copy the name passed
     // as an argument and leak it so it remains valid for the duration of the program.
     let name: &'static str = Box::leak(name.to_owned().into_boxed_str());
+    let stats = stats::register_model(name);
 
     let f = Box::new(move |cfg: ConfigType<'_>, _: Vec<Dependency>| {
         let sensor_config = unsafe { &mut *sensor };
         let mut config = config_context { cfg };
         // obj will hold sensor specific data
         let mut obj: *mut c_void = std::ptr::null_mut();
+        let start = Instant::now();
         let ret = (sensor_config.config_callback)(
             &mut config as *mut _,
             sensor_config.user_data,
             &mut obj as *mut *mut _,
         );
+        stats.config.record(start.elapsed());
         if ret != 0 {
             return Err(SensorError::ConfigError(name));
         }
-        let s = generic_c_sensor {
-            user_data: obj,
-            get_readings_callback: sensor_config.get_readings_callback,
-        };
+        let s = generic_c_sensor::new(obj, sensor_config, stats);
         Ok::<SensorType, SensorError>(Arc::new(Mutex::new(s)))
     });
 
@@ -106,6 +127,373 @@ pub unsafe extern "C" fn viam_server_register_c_generic_sensor(
     viam_code::VIAM_OK
 }
 
+/// Register a camera in the Registry making configurable via Viam config
+///
+/// `model` is the model name the camera should be referred to in the Viam config
+/// for example calling `viam_server_register_c_camera(ctx,"my_camera", config)` will make the camera
+/// configurable with `{
+///      "name": "camera1",
+///      "namespace": "rdk",
+///      "type": "camera",
+///      "model": "my_camera",
+///    }`
+///
+/// Frames are written by the `get_image_callback` directly into the response buffer
+/// returns VIAM_OK on success
+/// # Safety
+/// `ctx`, `model` must be valid pointers
+#[cfg(feature = "camera")]
+#[no_mangle]
+pub unsafe extern "C" fn viam_server_register_c_camera(
+    ctx: *mut viam_server_context,
+    model: *const c_char,
+    camera: *mut c_camera_config,
+) -> viam_code {
+    if ctx.is_null() || model.is_null() || camera.is_null() {
+        return viam_code::VIAM_INVALID_ARG;
+    }
+
+    let ctx = unsafe { &mut *ctx };
+    let name = if let Ok(s) = unsafe { CStr::from_ptr(model) }.to_str() {
+        s
+    } else {
+        return viam_code::VIAM_INVALID_ARG;
+    };
+
+    // Because registry expects a &'static str for its key, we have to copy the name passed
+    // as an argument and leak it so it remains valid for the duration of the program.
+    let name: &'static str = Box::leak(name.to_owned().into_boxed_str());
+    let stats = stats::register_model(name);
+
+    let f = Box::new(move |cfg: ConfigType<'_>, _: Vec<Dependency>| {
+        let camera_config = unsafe { &mut *camera };
+        let mut config = config_context { cfg };
+        // obj will hold camera specific data
+        let mut obj: *mut c_void = std::ptr::null_mut();
+        let start = Instant::now();
+        let ret = (camera_config.config_callback)(
+            &mut config as *mut _,
+            camera_config.user_data,
+            &mut obj as *mut *mut _,
+        );
+        stats.config.record(start.elapsed());
+        if ret != 0 {
+            return Err(CameraError::ConfigError(name));
+        }
+        let c = c_camera {
+            user_data: obj,
+            get_image_callback: camera_config.get_image_callback,
+            mime_type: camera_config.mime_type.clone(),
+            close_callback: camera_config.close_callback,
+        };
+        Ok::<Arc<Mutex<dyn Camera>>, CameraError>(Arc::new(Mutex::new(c)))
+    });
+
+    if let Err(e) = ctx.registry.register_camera(name, Box::leak(f)) {
+        log::error!("couldn't register camera {:?}", e);
+        return viam_code::VIAM_REGISTRY_ERROR;
+    }
+
+    viam_code::VIAM_OK
+}
+
+// Runs the config callback of a component registered through a vtable, recording its latency in
+// `stats`, and returns the component specific data it wrote on success or the callback's error
+// code. A missing callback fails like the default config callback of sensors
+fn configure_c_component(
+    config_callback: Option<config_callback>,
+    user_data: *mut c_void,
+    cfg: ConfigType<'_>,
+    stats: &stats::callback_stats,
+) -> Result<*mut c_void, i32> {
+    let config_callback = config_callback.ok_or(-1)?;
+    let mut config = config_context { cfg };
+    let mut obj: *mut c_void = std::ptr::null_mut();
+    let start = Instant::now();
+    let ret = config_callback(&mut config as *mut _, user_data, &mut obj as *mut *mut _);
+    stats.config.record(start.elapsed());
+    match ret {
+        0 => Ok(obj),
+        code => Err(code),
+    }
+}
+
+// Copies the model name passed as an argument and leaks it, because registry expects a &'static str
+// for its key and it should remain valid for the duration of the program.
+unsafe fn leak_model_name(model: *const c_char) -> Option<&'static str> {
+    let name = unsafe { CStr::from_ptr(model) }.to_str().ok()?;
+    Some(Box::leak(name.to_owned().into_boxed_str()))
+}
+
+/// Register a motor implemented by the callbacks of `vtable` in the Registry making configurable via Viam config
+///
+/// `model` is the model name the motor should be referred to in the Viam config, `vtable` is copied
+/// during the call and `user_data` will be passed to its `config` callback.
+/// MotorService requests are dispatched straight to the matching callback
+/// returns VIAM_OK on success
+/// # Safety
+/// `ctx`, `model` and `vtable` must be valid pointers
+#[no_mangle]
+pub unsafe extern "C" fn viam_server_register_c_motor(
+    ctx: *mut viam_server_context,
+    model: *const c_char,
+    vtable: *const c_motor_vtable,
+    user_data: *mut c_void,
+) -> viam_code {
+    if ctx.is_null() || model.is_null() || vtable.is_null() {
+        return viam_code::VIAM_INVALID_ARG;
+    }
+    let ctx = unsafe { &mut *ctx };
+    let name = match unsafe { leak_model_name(model) } {
+        Some(name) => name,
+        None => return viam_code::VIAM_INVALID_ARG,
+    };
+    let vtable = unsafe { *vtable };
+    let stats = stats::register_model(name);
+
+    let f = Box::new(move |cfg: ConfigType<'_>, _: Vec<Dependency>| {
+        let obj = configure_c_component(vtable.config, user_data, cfg, stats)
+            .map_err(|_| MotorError::ConfigError(name))?;
+        Ok::<MotorType, MotorError>(Arc::new(Mutex::new(c_motor::new(obj, vtable))))
+    });
+
+    if let Err(e) = ctx.registry.register_motor(name, Box::leak(f)) {
+        log::error!("couldn't register motor {:?}", e);
+        return viam_code::VIAM_REGISTRY_ERROR;
+    }
+
+    viam_code::VIAM_OK
+}
+
+/// Register a board implemented by the callbacks of `vtable` in the Registry making configurable via Viam config
+///
+/// `model` is the model name the board should be referred to in the Viam config, `vtable` is copied
+/// during the call and `user_data` will be passed to its `config` callback.
+/// returns VIAM_OK on success
+/// # Safety
+/// `ctx`, `model` and `vtable` must be valid pointers
+#[no_mangle]
+pub unsafe extern "C" fn viam_server_register_c_board(
+    ctx: *mut viam_server_context,
+    model: *const c_char,
+    vtable: *const c_board_vtable,
+    user_data: *mut c_void,
+) -> viam_code {
+    if ctx.is_null() || model.is_null() || vtable.is_null() {
+        return viam_code::VIAM_INVALID_ARG;
+    }
+    let ctx = unsafe { &mut *ctx };
+    let name = match unsafe { leak_model_name(model) } {
+        Some(name) => name,
+        None => return viam_code::VIAM_INVALID_ARG,
+    };
+    let vtable = unsafe { *vtable };
+    let stats = stats::register_model(name);
+
+    let f = Box::new(move |cfg: ConfigType<'_>| {
+        let obj = configure_c_component(vtable.config, user_data, cfg, stats)
+            .map_err(BoardError::BoardCodeError)?;
+        Ok::<BoardType, BoardError>(Arc::new(Mutex::new(c_board::new(obj, vtable))))
+    });
+
+    if let Err(e) = ctx.registry.register_board(name, Box::leak(f)) {
+        log::error!("couldn't register board {:?}", e);
+        return viam_code::VIAM_REGISTRY_ERROR;
+    }
+
+    viam_code::VIAM_OK
+}
+
+/// Register a movement sensor implemented by the callbacks of `vtable` in the Registry making configurable
+/// via Viam config
+///
+/// `model` is the model name the movement sensor should be referred to in the Viam config, `vtable` is copied
+/// during the call and `user_data` will be passed to its `config` callback.
+/// returns VIAM_OK on success
+/// # Safety
+/// `ctx`, `model` and `vtable` must be valid pointers
+#[no_mangle]
+pub unsafe extern "C" fn viam_server_register_c_movement_sensor(
+    ctx: *mut viam_server_context,
+    model: *const c_char,
+    vtable: *const c_movement_sensor_vtable,
+    user_data: *mut c_void,
+) -> viam_code {
+    if ctx.is_null() || model.is_null() || vtable.is_null() {
+        return viam_code::VIAM_INVALID_ARG;
+    }
+    let ctx = unsafe { &mut *ctx };
+    let name = match unsafe { leak_model_name(model) } {
+        Some(name) => name,
+        None => return viam_code::VIAM_INVALID_ARG,
+    };
+    let vtable = unsafe { *vtable };
+    let stats = stats::register_model(name);
+
+    let f = Box::new(move |cfg: ConfigType<'_>, _: Vec<Dependency>| {
+        let obj = configure_c_component(vtable.config, user_data, cfg, stats)
+            .map_err(|_| SensorError::ConfigError(name))?;
+        Ok::<MovementSensorType, SensorError>(Arc::new(Mutex::new(c_movement_sensor::new(
+            obj, vtable,
+        ))))
+    });
+
+    if let Err(e) = ctx.registry.register_movement_sensor(name, Box::leak(f)) {
+        log::error!("couldn't register movement sensor {:?}", e);
+        return viam_code::VIAM_REGISTRY_ERROR;
+    }
+
+    viam_code::VIAM_OK
+}
+
+/// Register an encoder implemented by the callbacks of `vtable` in the Registry making configurable via Viam config
+///
+/// `model` is the model name the encoder should be referred to in the Viam config, `vtable` is copied
+/// during the call and `user_data` will be passed to its `config` callback.
+/// returns VIAM_OK on success
+/// # Safety
+/// `ctx`, `model` and `vtable` must be valid pointers
+#[no_mangle]
+pub unsafe extern "C" fn viam_server_register_c_encoder(
+    ctx: *mut viam_server_context,
+    model: *const c_char,
+    vtable: *const c_encoder_vtable,
+    user_data: *mut c_void,
+) -> viam_code {
+    if ctx.is_null() || model.is_null() || vtable.is_null() {
+        return viam_code::VIAM_INVALID_ARG;
+    }
+    let ctx = unsafe { &mut *ctx };
+    let name = match unsafe { leak_model_name(model) } {
+        Some(name) => name,
+        None => return viam_code::VIAM_INVALID_ARG,
+    };
+    let vtable = unsafe { *vtable };
+    let stats = stats::register_model(name);
+
+    let f = Box::new(move |cfg: ConfigType<'_>, _: Vec<Dependency>| {
+        let obj = configure_c_component(vtable.config, user_data, cfg, stats)
+            .map_err(EncoderError::EncoderCodeError)?;
+        Ok::<Arc<Mutex<dyn Encoder>>, EncoderError>(Arc::new(Mutex::new(c_encoder::new(
+            obj, vtable,
+        ))))
+    });
+
+    if let Err(e) = ctx.registry.register_encoder(name, Box::leak(f)) {
+        log::error!("couldn't register encoder {:?}", e);
+        return viam_code::VIAM_REGISTRY_ERROR;
+    }
+
+    viam_code::VIAM_OK
+}
+
+/// Register a power sensor implemented by the callbacks of `vtable` in the Registry making configurable
+/// via Viam config
+///
+/// `model` is the model name the power sensor should be referred to in the Viam config, `vtable` is copied
+/// during the call and `user_data` will be passed to its `config` callback.
+/// returns VIAM_OK on success
+/// # Safety
+/// `ctx`, `model` and `vtable` must be valid pointers
+#[no_mangle]
+pub unsafe extern "C" fn viam_server_register_c_power_sensor(
+    ctx: *mut viam_server_context,
+    model: *const c_char,
+    vtable: *const c_power_sensor_vtable,
+    user_data: *mut c_void,
+) -> viam_code {
+    if ctx.is_null() || model.is_null() || vtable.is_null() {
+        return viam_code::VIAM_INVALID_ARG;
+    }
+    let ctx = unsafe { &mut *ctx };
+    let name = match unsafe { leak_model_name(model) } {
+        Some(name) => name,
+        None => return viam_code::VIAM_INVALID_ARG,
+    };
+    let vtable = unsafe { *vtable };
+    let stats = stats::register_model(name);
+
+    let f = Box::new(move |cfg: ConfigType<'_>, _: Vec<Dependency>| {
+        let obj = configure_c_component(vtable.config, user_data, cfg, stats)
+            .map_err(|_| SensorError::ConfigError(name))?;
+        Ok::<PowerSensorType, SensorError>(Arc::new(Mutex::new(c_power_sensor::new(obj, vtable))))
+    });
+
+    if let Err(e) = ctx.registry.register_power_sensor(name, Box::leak(f)) {
+        log::error!("couldn't register power sensor {:?}", e);
+        return viam_code::VIAM_REGISTRY_ERROR;
+    }
+
+    viam_code::VIAM_OK
+}
+
+/// Sets the size in bytes of the memory used to buffer collected data before it is uploaded, replacing the
+/// default static buffer. When `use_psram` is true and PSRAM is available the memory is allocated from it.
+/// Each data collector receives a share of this memory proportional to its `buffer_weight` attribute
+///
+/// returns VIAM_INVALID_ARG if `size` is 0 or if the data store is already in use
+/// # Safety
+/// `ctx` must be a valid pointer
+#[no_mangle]
+pub unsafe extern "C" fn viam_server_context_set_data_store_size(
+    ctx: *mut viam_server_context,
+    size: usize,
+    use_psram: bool,
+) -> viam_code {
+    if ctx.is_null() || size == 0 {
+        return viam_code::VIAM_INVALID_ARG;
+    }
+
+    #[cfg(target_os = "espidf")]
+    let region: &'static mut [MaybeUninit<u8>] = if use_psram && unsafe { g_spiram_ok } {
+        use micro_rdk::esp32::esp_idf_svc::sys::{heap_caps_malloc, MALLOC_CAP_SPIRAM};
+        let ptr = unsafe { heap_caps_malloc(size, MALLOC_CAP_SPIRAM) } as *mut MaybeUninit<u8>;
+        if ptr.is_null() {
+            log::error!(
+                "couldn't allocate {} bytes of PSRAM for the data store",
+                size
+            );
+            return viam_code::VIAM_INVALID_ARG;
+        }
+        unsafe { std::slice::from_raw_parts_mut(ptr, size) }
+    } else {
+        Box::leak(vec![MaybeUninit::uninit(); size].into_boxed_slice())
+    };
+    #[cfg(not(target_os = "espidf"))]
+    let region: &'static mut [MaybeUninit<u8>] = {
+        let _ = use_psram;
+        Box::leak(vec![MaybeUninit::uninit(); size].into_boxed_slice())
+    };
+
+    if let Err(e) = micro_rdk::common::data_store::set_data_store_region(region) {
+        log::error!("couldn't set the data store memory {:?}", e);
+        return viam_code::VIAM_INVALID_ARG;
+    }
+
+    viam_code::VIAM_OK
+}
+
+/// Sets the maximum number of connections served at the same time, replacing the default of 10 on native
+/// and 3 on ESP32 (1 without PSRAM). Connections only use memory once they are established and a new
+/// one is only added while enough memory is free, otherwise it replaces the active connection with the
+/// lowest priority
+///
+/// returns VIAM_INVALID_ARG if `max_connections` is 0
+/// # Safety
+/// `ctx` must be a valid pointer
+#[no_mangle]
+pub unsafe extern "C" fn viam_server_context_set_max_connections(
+    ctx: *mut viam_server_context,
+    max_connections: usize,
+) -> viam_code {
+    if ctx.is_null() || max_connections == 0 {
+        return viam_code::VIAM_INVALID_ARG;
+    }
+    let ctx = unsafe { &mut *ctx };
+    let _ = ctx.max_connections.insert(max_connections);
+    viam_code::VIAM_OK
+}
+
 #[allow(dead_code)]
 const ROBOT_ID: Option<&str> = option_env!("MICRO_RDK_ROBOT_ID");
 #[allow(dead_code)]
@@ -146,7 +534,7 @@ pub unsafe extern "C" fn viam_server_start(ctx: *mut viam_server_context) -> via
         .unwrap();
     }
 
-    let max_connection = {
+    let default_max_connection = {
         #[cfg(not(target_os = "espidf"))]
         {
             10
@@ -164,6 +552,7 @@ pub unsafe extern "C" fn viam_server_start(ctx: *mut viam_server_context) -> via
             }
         }
     };
+    let max_connection = ctx.max_connections.unwrap_or(default_max_connection);
 
     let repr = RobotRepresentation::WithRegistry(ctx.registry);
 
@@ -249,3 +638,72 @@ pub unsafe extern "C" fn viam_server_start(ctx: *mut viam_server_context) -> via
 
     viam_code::VIAM_OK
 }
+
+#[cfg(test)]
+mod tests {
+    use std::ffi::{c_int, c_void};
+
+    use micro_rdk::common::config::{ConfigType, DynamicComponentConfig};
+
+    use super::configure_c_component;
+    use crate::ffi::{config::config_context, stats::callback_stats};
+
+    // component specific data written by the config callback
+    static DATA: u8 = 0;
+
+    fn data() -> *mut c_void {
+        &DATA as *const u8 as *mut c_void
+    }
+
+    extern "C" fn config_ok(
+        _: *mut config_context,
+        _: *mut c_void,
+        out: *mut *mut c_void,
+    ) -> c_int {
+        unsafe { *out = data() };
+        0
+    }
+
+    extern "C" fn config_fail(
+        _: *mut config_context,
+        _: *mut c_void,
+        _: *mut *mut c_void,
+    ) -> c_int {
+        -3
+    }
+
+    #[test]
+    fn test_configure_c_component_records_latency() {
+        let stats = callback_stats::default();
+        let cfg = DynamicComponentConfig::default();
+        assert_eq!(
+            configure_c_component(
+                Some(config_ok),
+                std::ptr::null_mut(),
+                ConfigType::Dynamic(&cfg),
+                &stats
+            ),
+            Ok(data())
+        );
+        assert_eq!(
+            configure_c_component(
+                Some(config_fail),
+                std::ptr::null_mut(),
+                ConfigType::Dynamic(&cfg),
+                &stats
+            ),
+            Err(-3)
+        );
+        assert_eq!(stats.config.count(), 2);
+        // a missing callback isn't timed
+        assert!(configure_c_component(
+            None,
+            std::ptr::null_mut(),
+            ConfigType::Dynamic(&cfg),
+            &stats
+        )
+        .is_err());
+        assert_eq!(stats.config.count(), 2);
+        assert_eq!(stats.readings.count(), 0);
+    }
+}
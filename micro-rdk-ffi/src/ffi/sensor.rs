@@ -1,36 +1,199 @@
 use micro_rdk::{
     common::{
+        base64_encoding,
+        generic::{DoCommand, GenericError},
         sensor::{GenericReadingsResult, Readings, Sensor, SensorError},
         status::Status,
     },
-    google::protobuf::Value,
-    DoCommand,
+    google::protobuf::{value::Kind, ListValue, Struct, Timestamp, Value},
+    proto::app::data_sync::v1::{SensorData, SensorMetadata},
 };
 use std::{
     collections::HashMap,
-    ffi::{c_char, c_int, c_uchar, c_uint, c_void, CStr},
+    ffi::{c_char, c_double, c_int, c_uchar, c_uint, c_void, CStr},
+    sync::{
+        atomic::{AtomicBool, AtomicI32, Ordering},
+        Arc, Mutex,
+    },
+    task::{Context, Poll, Waker},
+    time::{Duration, Instant, SystemTime, UNIX_EPOCH},
 };
 
-use super::{config::config_context, errors::viam_code};
+use super::{config::config_context, errors::viam_code, stats::callback_stats};
 
 #[allow(non_camel_case_types)]
-type config_callback = extern "C" fn(*mut config_context, *mut c_void, *mut *mut c_void) -> c_int;
+pub type config_callback =
+    extern "C" fn(*mut config_context, *mut c_void, *mut *mut c_void) -> c_int;
 
 #[allow(non_camel_case_types)]
 type get_readings_callback = extern "C" fn(*mut get_readings_context, *mut c_void) -> c_int;
 
+#[allow(non_camel_case_types)]
+type get_readings_async_callback = extern "C" fn(*mut get_readings_context, *mut c_void) -> c_int;
+
+#[allow(non_camel_case_types)]
+type get_readings_batch_callback = extern "C" fn(*mut get_readings_context, *mut c_void) -> c_int;
+
+#[allow(non_camel_case_types)]
+pub type close_callback = extern "C" fn(*mut c_void) -> c_int;
+
 #[allow(non_camel_case_types)]
 pub struct generic_c_sensor_config {
     pub(crate) user_data: *mut c_void,
     pub(crate) config_callback: config_callback,
     pub(crate) get_readings_callback: get_readings_callback,
+    pub(crate) get_readings_batch_callback: Option<get_readings_batch_callback>,
+    pub(crate) get_readings_async_callback: Option<get_readings_async_callback>,
+    pub(crate) close_callback: Option<close_callback>,
+    pub(crate) max_keys: usize,
+    pub(crate) cache_ttl: Option<Duration>,
 }
 
 #[allow(non_camel_case_types)]
-#[derive(DoCommand)]
 pub struct generic_c_sensor {
     pub(crate) user_data: *mut c_void,
     pub(crate) get_readings_callback: get_readings_callback,
+    pub(crate) get_readings_batch_callback: Option<get_readings_batch_callback>,
+    // when the sensor was configured with `generic_c_sensor_config_set_max_keys` the readings
+    // context is kept between calls, its map is sized for `max_keys`, handed over to the caller and
+    // filled again once recycled
+    pub(crate) readings_ctx: Option<get_readings_context>,
+    pub(crate) get_readings_async_callback: Option<get_readings_async_callback>,
+    // context handed to the C driver by `get_readings_async_callback`, owned by the driver until
+    // it calls `get_readings_complete`, and its completion
+    pending: Option<(*mut get_readings_context, Arc<readings_completion>)>,
+    // the last completed readings, kept for the tasks that were waiting on them and haven't
+    // polled them yet
+    completed: Option<completed_readings>,
+    // when the pending readings polled by data collection were requested
+    batch_requested: Option<SystemTime>,
+    stats: &'static callback_stats,
+    // readings younger than `cache_ttl` are served without calling the driver
+    cache_ttl: Option<Duration>,
+    cache: Option<(Instant, GenericReadingsResult)>,
+    close_callback: Option<close_callback>,
+}
+
+impl generic_c_sensor {
+    pub(crate) fn new(
+        user_data: *mut c_void,
+        config: &generic_c_sensor_config,
+        stats: &'static callback_stats,
+    ) -> Self {
+        let readings_ctx = if config.max_keys > 0 {
+            Some(get_readings_context {
+                readings: GenericReadingsResult::with_capacity(config.max_keys),
+                max_keys: config.max_keys,
+                spare_strings: Vec::with_capacity(config.max_keys),
+                ..Default::default()
+            })
+        } else {
+            None
+        };
+        Self {
+            user_data,
+            get_readings_callback: config.get_readings_callback,
+            get_readings_batch_callback: config.get_readings_batch_callback,
+            readings_ctx,
+            get_readings_async_callback: config.get_readings_async_callback,
+            pending: None,
+            completed: None,
+            batch_requested: None,
+            stats,
+            cache_ttl: config.cache_ttl,
+            cache: None,
+            close_callback: config.close_callback,
+        }
+    }
+
+    fn cached_readings(&self) -> Option<GenericReadingsResult> {
+        let ttl = self.cache_ttl?;
+        match self.cache.as_ref() {
+            Some((taken_at, readings)) if taken_at.elapsed() < ttl => Some(readings.clone()),
+            _ => None,
+        }
+    }
+
+    fn update_cache(&mut self, readings: &GenericReadingsResult) {
+        if self.cache_ttl.is_some() {
+            self.cache = Some((Instant::now(), readings.clone()));
+        }
+    }
+
+    /// The completed readings `waker` was waiting for, if it hasn't been served them yet
+    fn completed_readings(
+        &mut self,
+        waker: &Waker,
+    ) -> Option<Result<GenericReadingsResult, c_int>> {
+        let completed = self.completed.as_mut()?;
+        let index = completed
+            .waiters
+            .iter()
+            .position(|waiter| waiter.will_wake(waker))?;
+        let _ = completed.waiters.swap_remove(index);
+        if completed.waiters.is_empty() {
+            return self.completed.take().map(|completed| completed.readings);
+        }
+        Some(completed.readings.clone())
+    }
+
+    fn read_readings(&mut self) -> Result<GenericReadingsResult, SensorError> {
+        if let Some(ctx) = self.readings_ctx.as_mut() {
+            // the previous readings weren't recycled
+            if ctx.readings.capacity() == 0 {
+                ctx.readings.reserve(ctx.max_keys);
+            }
+            let start = Instant::now();
+            let ret = (self.get_readings_callback)(ctx as *mut _, self.user_data);
+            self.stats.readings.record(start.elapsed());
+            if ret != 0 {
+                ctx.reset_values();
+                return Err(SensorError::SensorCodeError(ret));
+            }
+            return Ok(ctx.take_readings());
+        }
+
+        let mut ctx = get_readings_context::default();
+
+        let start = Instant::now();
+        let ret = (self.get_readings_callback)(&mut ctx as *mut _, self.user_data);
+        self.stats.readings.record(start.elapsed());
+        if ret != 0 {
+            return Err(SensorError::SensorCodeError(ret));
+        }
+        Ok(ctx.readings)
+    }
+}
+
+impl DoCommand for generic_c_sensor {
+    /// `{"callback_stats": {}}` returns the latencies of the callbacks registered for this model
+    fn do_command(
+        &mut self,
+        command_struct: Option<Struct>,
+    ) -> Result<Option<Struct>, GenericError> {
+        match command_struct {
+            Some(cmd) if cmd.fields.contains_key("callback_stats") => {
+                Ok(Some(self.stats.to_struct()))
+            }
+            _ => Err(GenericError::MethodUnimplemented("do_command")),
+        }
+    }
+}
+
+impl Drop for generic_c_sensor {
+    fn drop(&mut self) {
+        if let Some((ctx, _)) = self.pending.take() {
+            // The driver may still write to the context, leak it rather than freeing memory in use
+            log::warn!("sensor dropped while readings were pending, leaking its context");
+            let _ = ctx;
+        }
+        if let Some(close) = self.close_callback {
+            let ret = close(self.user_data);
+            if ret != 0 {
+                log::warn!("sensor close callback returned {}", ret);
+            }
+        }
+    }
 }
 
 unsafe impl Send for generic_c_sensor {}
@@ -49,6 +212,11 @@ pub extern "C" fn generic_c_sensor_config_new() -> *mut generic_c_sensor_config
         user_data: std::ptr::null_mut(),
         config_callback: config_noop,
         get_readings_callback: get_readings_noop,
+        get_readings_batch_callback: None,
+        get_readings_async_callback: None,
+        close_callback: None,
+        max_keys: 0,
+        cache_ttl: None,
     }))
 }
 
@@ -104,6 +272,118 @@ pub unsafe extern "C" fn generic_c_sensor_config_set_readings_callback(
     viam_code::VIAM_INVALID_ARG
 }
 
+/// Set the maximum number of keys the sensor is expected to report, when set the readings context
+/// is allocated once per configured sensor and reused between calls to `get_readings_callback`.
+/// Its map is sized for `max_keys` and keeps the keys seen in the previous calls, the readings are
+/// moved out of it without copying the values and filled again once the server is done with them.
+/// Once every key was seen, numbers, booleans, strings and blobs are added without allocating.
+/// Adding more than `max_keys` keys during a call fails with `VIAM_INVALID_ARG`.
+///
+/// Passing 0 (the default) allocates a new readings context on every call
+///
+/// # Safety
+/// `ctx` must be a valid pointer
+#[no_mangle]
+pub unsafe extern "C" fn generic_c_sensor_config_set_max_keys(
+    ctx: *mut generic_c_sensor_config,
+    max_keys: c_uint,
+) -> viam_code {
+    if !ctx.is_null() {
+        let ctx = unsafe { &mut *ctx };
+        ctx.max_keys = max_keys as usize;
+        return viam_code::VIAM_OK;
+    }
+    viam_code::VIAM_INVALID_ARG
+}
+
+/// Set the get readings batch callback, which will be called by the data manager when collecting
+/// readings from this sensor.
+///
+/// During the callback the sensor can report several buffered samples, each one started by a call
+/// to `get_readings_add_sample`, every sample will be stored as its own reading. GetReadings requests
+/// still go through the callback set with `generic_c_sensor_config_set_readings_callback`
+///
+/// # Safety
+/// `ctx` must be a valid pointer
+#[no_mangle]
+pub unsafe extern "C" fn generic_c_sensor_config_set_readings_batch_callback(
+    ctx: *mut generic_c_sensor_config,
+    cb: get_readings_batch_callback,
+) -> viam_code {
+    if !ctx.is_null() {
+        let ctx = unsafe { &mut *ctx };
+        ctx.get_readings_batch_callback = Some(cb);
+        return viam_code::VIAM_OK;
+    }
+    viam_code::VIAM_INVALID_ARG
+}
+
+/// Set the asynchronous get readings callback, for drivers that have to wait on the hardware before
+/// readings are available (e.g. an I2C conversion).
+///
+/// The callback should start the operation and return immediately, the `get_readings_context` passed to
+/// it remains valid until the driver calls `get_readings_complete` which can be done later from another
+/// task. Values should be added to the context with `get_readings_add_*` before completing it, meanwhile
+/// the server keeps serving other requests. When set it replaces the callback set with
+/// `generic_c_sensor_config_set_readings_callback`, callers that can't wait for the completion
+/// are only served readings from the cache set with `generic_c_sensor_config_set_cache_ttl`
+///
+/// # Safety
+/// `ctx` must be a valid pointer
+#[no_mangle]
+pub unsafe extern "C" fn generic_c_sensor_config_set_readings_async_callback(
+    ctx: *mut generic_c_sensor_config,
+    cb: get_readings_async_callback,
+) -> viam_code {
+    if !ctx.is_null() {
+        let ctx = unsafe { &mut *ctx };
+        ctx.get_readings_async_callback = Some(cb);
+        return viam_code::VIAM_OK;
+    }
+    viam_code::VIAM_INVALID_ARG
+}
+
+/// Set the close callback, called with the sensor data returned by `config_callback` when the
+/// sensor is removed from the robot, either because its config changed or it was deleted. The
+/// driver should release the resources held by the sensor. Asynchronous readings still pending at
+/// that point are abandoned, the driver must not complete them after returning.
+///
+/// # Safety
+/// `ctx` must be a valid pointer
+#[no_mangle]
+pub unsafe extern "C" fn generic_c_sensor_config_set_close_callback(
+    ctx: *mut generic_c_sensor_config,
+    cb: close_callback,
+) -> viam_code {
+    if !ctx.is_null() {
+        let ctx = unsafe { &mut *ctx };
+        ctx.close_callback = Some(cb);
+        return viam_code::VIAM_OK;
+    }
+    viam_code::VIAM_INVALID_ARG
+}
+
+/// Set for how long, in milliseconds, readings are served from a cache rather than by calling the
+/// readings callback. Concurrent clients polling the sensor within that window share a single read
+/// of the hardware, failed reads are not cached.
+///
+/// Passing 0 (the default) disables the cache
+///
+/// # Safety
+/// `ctx` must be a valid pointer
+#[no_mangle]
+pub unsafe extern "C" fn generic_c_sensor_config_set_cache_ttl(
+    ctx: *mut generic_c_sensor_config,
+    max_age_ms: c_uint,
+) -> viam_code {
+    if !ctx.is_null() {
+        let ctx = unsafe { &mut *ctx };
+        ctx.cache_ttl = (max_age_ms > 0).then(|| Duration::from_millis(max_age_ms as u64));
+        return viam_code::VIAM_OK;
+    }
+    viam_code::VIAM_INVALID_ARG
+}
+
 /// cbindgen:ignore
 extern "C" fn config_noop(_: *mut config_context, _: *mut c_void, _: *mut *mut c_void) -> c_int {
     -1
@@ -119,15 +399,162 @@ impl Readings for generic_c_sensor {
     fn get_generic_readings(
         &mut self,
     ) -> Result<GenericReadingsResult, micro_rdk::common::sensor::SensorError> {
-        let mut ctx = get_readings_context {
-            readings: GenericReadingsResult::default(),
+        if let Some(readings) = self.cached_readings() {
+            return Ok(readings);
+        }
+
+        if self.get_readings_async_callback.is_some() {
+            // waiting for the driver here would block the executor until it completes, asynchronous
+            // readings are only served to callers polling them
+            return Err(SensorError::SensorGenericError(
+                "asynchronous readings have to be polled",
+            ));
+        }
+
+        let readings = self.read_readings()?;
+        self.update_cache(&readings);
+        Ok(readings)
+    }
+
+    fn recycle_generic_readings(&mut self, readings: GenericReadingsResult) {
+        if let Some(ctx) = self.readings_ctx.as_mut() {
+            ctx.recycle(readings);
+        }
+    }
+
+    fn poll_generic_readings(
+        &mut self,
+        cx: &mut Context<'_>,
+    ) -> Poll<Result<GenericReadingsResult, SensorError>> {
+        let cb = match self.get_readings_async_callback {
+            Some(cb) => cb,
+            None => return Poll::Ready(self.get_generic_readings()),
         };
 
-        let ret = (self.get_readings_callback)(&mut ctx as *mut _, self.user_data);
+        if let Some(readings) = self.completed_readings(cx.waker()) {
+            return Poll::Ready(readings.map_err(SensorError::SensorCodeError));
+        }
+
+        let (ctx, completion) = match self.pending.as_ref() {
+            Some((ctx, completion)) => (*ctx, completion.clone()),
+            None => {
+                if let Some(readings) = self.cached_readings() {
+                    return Poll::Ready(Ok(readings));
+                }
+                let completion = Arc::new(readings_completion::default());
+                let ctx = Box::into_raw(Box::new(get_readings_context {
+                    completion: Some(completion.clone()),
+                    ..Default::default()
+                }));
+                // only the time spent starting the operation blocks the executor
+                let start = Instant::now();
+                let ret = cb(ctx, self.user_data);
+                self.stats.readings.record(start.elapsed());
+                if ret != 0 {
+                    // the driver refused to start, the context is still ours
+                    let _ = unsafe { Box::from_raw(ctx) };
+                    return Poll::Ready(Err(SensorError::SensorCodeError(ret)));
+                }
+                self.pending = Some((ctx, completion.clone()));
+                (ctx, completion)
+            }
+        };
+
+        // every task polling the readings is woken on completion, the context itself isn't
+        // touched until then since the driver may be writing to it
+        completion.register(cx.waker());
+        if !completion.done.load(Ordering::Acquire) {
+            return Poll::Pending;
+        }
+
+        let _ = self.pending.take();
+        // the driver doesn't touch the context after completing it
+        let mut ctx = unsafe { Box::from_raw(ctx) };
+        let readings = match completion.code.load(Ordering::Relaxed) {
+            0 => Ok(std::mem::take(&mut ctx.readings)),
+            code => Err(code),
+        };
+        if let Ok(readings) = readings.as_ref() {
+            self.update_cache(readings);
+        }
+        // every other task that waited for these readings gets them rather than starting a new read
+        let mut waiters = completion.take_waiters();
+        waiters.retain(|waiter| !waiter.will_wake(cx.waker()));
+        self.completed = (!waiters.is_empty()).then(|| completed_readings {
+            readings: readings.clone(),
+            waiters,
+        });
+        Poll::Ready(readings.map_err(SensorError::SensorCodeError))
+    }
+
+    fn get_readings_data_batch(&mut self) -> Result<Vec<SensorData>, SensorError> {
+        let cb = match self.get_readings_batch_callback {
+            Some(cb) => cb,
+            None => return Ok(vec![self.get_readings_data()?]),
+        };
+        let mut ctx = get_readings_context::default();
+
+        let start = Instant::now();
+        let ret = cb(&mut ctx as *mut _, self.user_data);
+        self.stats.readings.record(start.elapsed());
         if ret != 0 {
             return Err(SensorError::SensorCodeError(ret));
         }
-        Ok(ctx.readings)
+        ctx.finish_sample();
+
+        Ok(ctx
+            .samples
+            .into_iter()
+            .map(|(timestamp_ns, readings)| {
+                let timestamp = ns_timestamp(timestamp_ns);
+                SensorData {
+                    metadata: Some(SensorMetadata {
+                        time_received: Some(timestamp.clone()),
+                        time_requested: Some(timestamp),
+                    }),
+                    data: Some(readings.into()),
+                }
+            })
+            .collect())
+    }
+
+    fn poll_readings_data_batch(
+        &mut self,
+        cx: &mut Context<'_>,
+    ) -> Poll<Result<Vec<SensorData>, SensorError>> {
+        if self.get_readings_batch_callback.is_some() || self.get_readings_async_callback.is_none()
+        {
+            return Poll::Ready(self.get_readings_data_batch());
+        }
+        if self.pending.is_none() || self.batch_requested.is_none() {
+            self.batch_requested = Some(SystemTime::now());
+        }
+        let readings = match self.poll_generic_readings(cx) {
+            Poll::Pending => return Poll::Pending,
+            Poll::Ready(readings) => readings,
+        };
+        let requested = self.batch_requested.take().map(system_time_ns);
+        let readings = readings?;
+        let received = system_time_ns(SystemTime::now());
+        Poll::Ready(Ok(vec![SensorData {
+            metadata: Some(SensorMetadata {
+                time_received: Some(ns_timestamp(received)),
+                time_requested: Some(ns_timestamp(requested.unwrap_or(received))),
+            }),
+            data: Some(readings.into()),
+        }]))
+    }
+}
+
+fn system_time_ns(time: SystemTime) -> i64 {
+    time.duration_since(UNIX_EPOCH)
+        .map_or(0, |d| d.as_nanos() as i64)
+}
+
+fn ns_timestamp(timestamp_ns: i64) -> Timestamp {
+    Timestamp {
+        seconds: timestamp_ns.div_euclid(1_000_000_000),
+        nanos: timestamp_ns.rem_euclid(1_000_000_000) as i32,
     }
 }
 
@@ -143,8 +570,130 @@ impl Status for generic_c_sensor {
 }
 
 #[allow(non_camel_case_types)]
+#[derive(Default)]
 pub struct get_readings_context {
     readings: GenericReadingsResult,
+    // limit of the keys of `readings`, 0 when unlimited
+    max_keys: usize,
+    // buffers of the strings of recycled readings, reused by the next strings added
+    spare_strings: Vec<String>,
+    // samples completed during a `get_readings_batch_callback`, with their timestamp in ns since epoch
+    samples: Vec<(i64, GenericReadingsResult)>,
+    sample_timestamp_ns: Option<i64>,
+    // set on a context handed to a `get_readings_async_callback`
+    completion: Option<Arc<readings_completion>>,
+}
+
+/// Completion of the readings requested from a `get_readings_async_callback`, shared by the sensor
+/// and the driver so the context can be freed by the sensor as soon as it is completed
+#[allow(non_camel_case_types)]
+#[derive(Default)]
+struct readings_completion {
+    done: AtomicBool,
+    code: AtomicI32,
+    // the tasks polling the readings
+    waiters: Mutex<Vec<Waker>>,
+}
+
+impl readings_completion {
+    fn register(&self, waker: &Waker) {
+        let mut waiters = self.waiters.lock().unwrap();
+        if !waiters.iter().any(|w| w.will_wake(waker)) {
+            waiters.push(waker.clone());
+        }
+    }
+
+    fn complete(&self, code: c_int) {
+        self.code.store(code, Ordering::Relaxed);
+        self.done.store(true, Ordering::Release);
+        // the waiters are kept, the sensor serves the readings to each of them
+        self.waiters
+            .lock()
+            .unwrap()
+            .iter()
+            .for_each(Waker::wake_by_ref);
+    }
+
+    fn take_waiters(&self) -> Vec<Waker> {
+        std::mem::take(&mut *self.waiters.lock().unwrap())
+    }
+}
+
+/// Readings completed by a `get_readings_async_callback`, or the code it failed with, along with
+/// the tasks that were waiting for them and didn't poll them yet
+#[allow(non_camel_case_types)]
+struct completed_readings {
+    readings: Result<GenericReadingsResult, c_int>,
+    waiters: Vec<Waker>,
+}
+
+impl get_readings_context {
+    /// Stores `kind` under `key`, fails when `key` is new and the context already holds `max_keys`
+    fn set(&mut self, key: &str, kind: Kind) -> viam_code {
+        if let Some(value) = self.readings.get_mut(key) {
+            value.kind = Some(kind);
+            return viam_code::VIAM_OK;
+        }
+        if self.max_keys > 0 && self.readings.len() >= self.max_keys {
+            // make room by forgetting the recycled keys that weren't reported yet
+            self.readings.retain(|_, value| value.kind.is_some());
+            if self.readings.len() >= self.max_keys {
+                return viam_code::VIAM_INVALID_ARG;
+            }
+        }
+        let _ = self
+            .readings
+            .insert(key.to_owned(), Value { kind: Some(kind) });
+        viam_code::VIAM_OK
+    }
+
+    /// Closes the sample being filled, if values were added without a call to `get_readings_add_sample`
+    /// they are timestamped with the current time
+    fn finish_sample(&mut self) {
+        if let Some(timestamp_ns) = self.sample_timestamp_ns.take() {
+            self.samples
+                .push((timestamp_ns, std::mem::take(&mut self.readings)));
+        } else if !self.readings.is_empty() {
+            let timestamp_ns = system_time_ns(SystemTime::now());
+            self.samples
+                .push((timestamp_ns, std::mem::take(&mut self.readings)));
+        }
+    }
+
+    /// An empty string, reusing the buffer of a recycled string when there is one
+    fn spare_string(&mut self) -> String {
+        self.spare_strings.pop().unwrap_or_default()
+    }
+
+    /// Moves the readings of the last call out of a reused context, without the recycled keys that
+    /// weren't reported by this call. The context is left without a map until they are recycled
+    fn take_readings(&mut self) -> GenericReadingsResult {
+        let mut readings = std::mem::take(&mut self.readings);
+        readings.retain(|_, value| value.kind.is_some());
+        readings
+    }
+
+    /// Takes back readings returned by `take_readings`, their keys are kept and their values reset
+    fn recycle(&mut self, readings: GenericReadingsResult) {
+        // readings were added to the map since, they are kept
+        if !self.readings.is_empty() {
+            return;
+        }
+        self.readings = readings;
+        self.reset_values();
+    }
+
+    /// Resets the values of the readings, keeping their keys and the buffers of their strings
+    fn reset_values(&mut self) {
+        for value in self.readings.values_mut() {
+            if let Some(Kind::StringValue(mut string)) = value.kind.take() {
+                if self.spare_strings.len() < self.max_keys {
+                    string.clear();
+                    self.spare_strings.push(string);
+                }
+            }
+        }
+    }
 }
 
 /// This function can be use by a sensor during the call to `get_readings_callback` to add binary data to a response
@@ -160,7 +709,6 @@ pub unsafe extern "C" fn get_readings_add_binary_blob(
     array: *const c_uchar,
     len: c_uint,
 ) -> viam_code {
-    use base64::{engine::general_purpose::STANDARD, Engine as _};
     if ctx.is_null() || array.is_null() || key.is_null() {
         return viam_code::VIAM_INVALID_ARG;
     }
@@ -174,16 +722,10 @@ pub unsafe extern "C" fn get_readings_add_binary_blob(
         return viam_code::VIAM_INVALID_ARG;
     };
     let array = unsafe { core::slice::from_raw_parts(array, len as usize) };
-    let enc = STANDARD.encode(array);
-
-    let _ = ctx.readings.insert(
-        key.to_owned(),
-        Value {
-            kind: Some(micro_rdk::google::protobuf::value::Kind::StringValue(enc)),
-        },
-    );
+    let mut enc = ctx.spare_string();
+    base64_encoding::encode_into(array, &mut enc);
 
-    viam_code::VIAM_OK
+    ctx.set(key, Kind::StringValue(enc))
 }
 
 /// This function can be use by a sensor during the call to `get_readings_callback` to add a string to a response
@@ -212,14 +754,389 @@ pub unsafe extern "C" fn get_readings_add_string(
         return viam_code::VIAM_INVALID_ARG;
     };
 
-    let _ = ctx.readings.insert(
-        key.to_owned(),
-        Value {
-            kind: Some(micro_rdk::google::protobuf::value::Kind::StringValue(
-                value.to_owned(),
-            )),
-        },
-    );
+    let mut string = ctx.spare_string();
+    string.push_str(value);
+    ctx.set(key, Kind::StringValue(string))
+}
+
+/// This function can be use by a sensor during the call to `get_readings_callback` to add a double to a response
+/// The value is stored as a number, no encoding step is involved
+///
+/// # Safety
+/// `ctx` and `key` must be valid pointers for the duration of the call
+/// `key` must be a null terminated C string
+#[no_mangle]
+pub unsafe extern "C" fn get_readings_add_double(
+    ctx: *mut get_readings_context,
+    key: *const c_char,
+    value: c_double,
+) -> viam_code {
+    if ctx.is_null() || key.is_null() {
+        return viam_code::VIAM_INVALID_ARG;
+    }
+    let ctx = unsafe { &mut *ctx };
+    let key = if let Ok(s) = unsafe { CStr::from_ptr(key) }.to_str() {
+        s
+    } else {
+        return viam_code::VIAM_INVALID_ARG;
+    };
+
+    ctx.set(key, Kind::NumberValue(value))
+}
+
+/// This function can be use by a sensor during the call to `get_readings_callback` to add an int64 to a response
+/// The value is stored as a number (double), values with a magnitude greater than 2^53 will lose precision
+///
+/// # Safety
+/// `ctx` and `key` must be valid pointers for the duration of the call
+/// `key` must be a null terminated C string
+#[no_mangle]
+pub unsafe extern "C" fn get_readings_add_i64(
+    ctx: *mut get_readings_context,
+    key: *const c_char,
+    value: i64,
+) -> viam_code {
+    if ctx.is_null() || key.is_null() {
+        return viam_code::VIAM_INVALID_ARG;
+    }
+    let ctx = unsafe { &mut *ctx };
+    let key = if let Ok(s) = unsafe { CStr::from_ptr(key) }.to_str() {
+        s
+    } else {
+        return viam_code::VIAM_INVALID_ARG;
+    };
+
+    ctx.set(key, Kind::NumberValue(value as f64))
+}
+
+/// This function can be use by a sensor during the call to `get_readings_callback` to add a boolean to a response
+///
+/// # Safety
+/// `ctx` and `key` must be valid pointers for the duration of the call
+/// `key` must be a null terminated C string
+#[no_mangle]
+pub unsafe extern "C" fn get_readings_add_bool(
+    ctx: *mut get_readings_context,
+    key: *const c_char,
+    value: bool,
+) -> viam_code {
+    if ctx.is_null() || key.is_null() {
+        return viam_code::VIAM_INVALID_ARG;
+    }
+    let ctx = unsafe { &mut *ctx };
+    let key = if let Ok(s) = unsafe { CStr::from_ptr(key) }.to_str() {
+        s
+    } else {
+        return viam_code::VIAM_INVALID_ARG;
+    };
+
+    ctx.set(key, Kind::BoolValue(value))
+}
+
+/// This function can be use by a sensor during the call to `get_readings_callback` to add an array of doubles
+/// to a response. The values are stored as a list of numbers
+///
+/// # Safety
+/// `ctx`, `key` and `array` must be valid pointers for the duration of the call
+/// `key` must be a null terminated C string
+/// `array` must point to at least `len` doubles
+#[no_mangle]
+pub unsafe extern "C" fn get_readings_add_double_array(
+    ctx: *mut get_readings_context,
+    key: *const c_char,
+    array: *const c_double,
+    len: c_uint,
+) -> viam_code {
+    if ctx.is_null() || array.is_null() || key.is_null() {
+        return viam_code::VIAM_INVALID_ARG;
+    }
+    let ctx = unsafe { &mut *ctx };
+    if len == 0 {
+        return viam_code::VIAM_INVALID_ARG;
+    }
+    let key = if let Ok(s) = unsafe { CStr::from_ptr(key) }.to_str() {
+        s
+    } else {
+        return viam_code::VIAM_INVALID_ARG;
+    };
+    let array = unsafe { core::slice::from_raw_parts(array, len as usize) };
+
+    ctx.set(
+        key,
+        Kind::ListValue(ListValue {
+            values: array
+                .iter()
+                .map(|v| Value {
+                    kind: Some(Kind::NumberValue(*v)),
+                })
+                .collect(),
+        }),
+    )
+}
+
+/// This function can be use by a sensor during the call to `get_readings_batch_callback` to start a new sample
+/// taken at `timestamp_ns` (nanoseconds since the UNIX epoch). Values added afterward with `get_readings_add_*`
+/// belong to this sample until the next call to `get_readings_add_sample`
+///
+/// # Safety
+/// `ctx` must be a valid pointer for the duration of the call
+#[no_mangle]
+pub unsafe extern "C" fn get_readings_add_sample(
+    ctx: *mut get_readings_context,
+    timestamp_ns: i64,
+) -> viam_code {
+    if ctx.is_null() {
+        return viam_code::VIAM_INVALID_ARG;
+    }
+    let ctx = unsafe { &mut *ctx };
+    ctx.finish_sample();
+    ctx.sample_timestamp_ns = Some(timestamp_ns);
+
+    viam_code::VIAM_OK
+}
+
+/// This function should be called by a sensor once the readings started by `get_readings_async_callback`
+/// are available, `code` being 0 on success. It can be called from a different task than the one the
+/// callback ran on, after this call `ctx` must not be used anymore.
+///
+/// # Safety
+/// `ctx` must be a context passed to `get_readings_async_callback` that wasn't completed yet
+#[no_mangle]
+pub unsafe extern "C" fn get_readings_complete(
+    ctx: *mut get_readings_context,
+    code: c_int,
+) -> viam_code {
+    if ctx.is_null() {
+        return viam_code::VIAM_INVALID_ARG;
+    }
+    // the sensor frees the context once it sees it completed, only the completion is used past
+    // that point
+    let completion = match unsafe { &*ctx }.completion.clone() {
+        Some(completion) => completion,
+        None => return viam_code::VIAM_INVALID_ARG,
+    };
+    completion.complete(code);
 
     viam_code::VIAM_OK
 }
+
+#[cfg(test)]
+mod tests {
+    use std::cell::Cell;
+    use std::ffi::{c_char, c_int, c_void};
+    use std::hint::black_box;
+    use std::sync::atomic::{AtomicBool, AtomicPtr, Ordering};
+    use std::sync::Arc;
+    use std::task::{Context, Poll, Wake, Waker};
+    use std::time::Instant;
+
+    use micro_rdk::common::sensor::Readings;
+    use micro_rdk::google::protobuf::value::Kind;
+
+    use super::{
+        generic_c_sensor, generic_c_sensor_config_new, get_readings_add_binary_blob,
+        get_readings_add_double, get_readings_add_i64, get_readings_add_string,
+        get_readings_complete, get_readings_context,
+    };
+    use crate::ffi::{allocator::ALLOCATIONS, errors::viam_code, stats::callback_stats};
+
+    // a spectral blob, the largest payload drivers add
+    static BLOB: [u8; 2048] = [0x5a; 2048];
+
+    fn key(key: &'static [u8]) -> *const c_char {
+        key.as_ptr() as *const c_char
+    }
+
+    /// Runs `op` `iterations` times after a warm up, prints its mean latency and allocations.
+    /// Benchmarks are ignored tests run with `make bench`.
+    fn bench<T>(name: &str, iterations: u32, mut op: impl FnMut() -> T) {
+        for _ in 0..(iterations / 10).max(1) {
+            let _ = black_box(op());
+        }
+        let allocations = ALLOCATIONS.with(Cell::get);
+        let start = Instant::now();
+        for _ in 0..iterations {
+            let _ = black_box(op());
+        }
+        let elapsed = start.elapsed();
+        println!(
+            "{:<40} {:>10} ns/op {:>12.0} ops/s {:>8.2} allocs/op",
+            name,
+            (elapsed / iterations).as_nanos(),
+            iterations as f64 / elapsed.as_secs_f64(),
+            (ALLOCATIONS.with(Cell::get) - allocations) as f64 / iterations as f64
+        );
+    }
+
+    // the readings of sensor A of example/example.c, with a blob of spectral data
+    extern "C" fn example_readings(ctx: *mut get_readings_context, _: *mut c_void) -> c_int {
+        unsafe {
+            get_readings_add_i64(ctx, key(b"an_int\0"), 1234567);
+            get_readings_add_double(ctx, key(b"a_double\0"), 0.5);
+            get_readings_add_string(ctx, key(b"a_string\0"), key(b"the default string\0"));
+            get_readings_add_binary_blob(ctx, key(b"spectrum\0"), BLOB.as_ptr(), BLOB.len() as _);
+        }
+        0
+    }
+
+    static PENDING: AtomicPtr<get_readings_context> = AtomicPtr::new(std::ptr::null_mut());
+
+    extern "C" fn start_readings(ctx: *mut get_readings_context, _: *mut c_void) -> c_int {
+        PENDING.store(ctx, Ordering::Release);
+        0
+    }
+
+    #[derive(Default)]
+    struct Flag(AtomicBool);
+
+    impl Wake for Flag {
+        fn wake(self: Arc<Self>) {
+            self.0.store(true, Ordering::Release);
+        }
+    }
+
+    #[test]
+    fn test_async_readings_wake_every_poller() {
+        let mut config = unsafe { Box::from_raw(generic_c_sensor_config_new()) };
+        config.get_readings_async_callback = Some(start_readings);
+        let stats: &'static callback_stats = Box::leak(Box::default());
+        let mut sensor = generic_c_sensor::new(std::ptr::null_mut(), &config, stats);
+
+        let flags: Vec<Arc<Flag>> = (0..2).map(|_| Arc::default()).collect();
+        let wakers: Vec<Waker> = flags.iter().map(|f| Waker::from(f.clone())).collect();
+        for waker in &wakers {
+            let mut cx = Context::from_waker(waker);
+            assert!(sensor.poll_generic_readings(&mut cx).is_pending());
+        }
+        // synchronous callers aren't blocked on the pending readings
+        assert!(sensor.get_generic_readings().is_err());
+
+        let ctx = PENDING.load(Ordering::Acquire) as usize;
+        std::thread::spawn(move || unsafe {
+            let ctx = ctx as *mut get_readings_context;
+            get_readings_add_double(ctx, key(b"value\0"), 0.5);
+            get_readings_complete(ctx, 0);
+        })
+        .join()
+        .unwrap();
+        assert!(flags.iter().all(|f| f.0.load(Ordering::Acquire)));
+
+        PENDING.store(std::ptr::null_mut(), Ordering::Release);
+        // every poller gets the readings it waited for, without the driver being called again
+        for waker in &wakers {
+            let mut cx = Context::from_waker(waker);
+            let Poll::Ready(Ok(readings)) = sensor.poll_generic_readings(&mut cx) else {
+                panic!("completed readings aren't ready");
+            };
+            assert_eq!(
+                readings.get("value").unwrap().kind,
+                Some(Kind::NumberValue(0.5))
+            );
+        }
+        assert!(PENDING.load(Ordering::Acquire).is_null());
+
+        // once served, polling again starts a new read
+        let mut cx = Context::from_waker(&wakers[1]);
+        assert!(sensor.poll_generic_readings(&mut cx).is_pending());
+        let ctx = PENDING.load(Ordering::Acquire);
+        assert!(!ctx.is_null());
+        unsafe { get_readings_complete(ctx, -1) };
+        assert!(matches!(
+            sensor.poll_generic_readings(&mut cx),
+            Poll::Ready(Err(_))
+        ));
+    }
+
+    extern "C" fn three_readings(ctx: *mut get_readings_context, _: *mut c_void) -> c_int {
+        unsafe {
+            get_readings_add_double(ctx, key(b"a\0"), 1.0);
+            get_readings_add_double(ctx, key(b"b\0"), 2.0);
+            match get_readings_add_double(ctx, key(b"c\0"), 3.0) {
+                viam_code::VIAM_INVALID_ARG => 0,
+                _ => -1,
+            }
+        }
+    }
+
+    #[test]
+    fn test_max_keys() {
+        let mut config = unsafe { Box::from_raw(generic_c_sensor_config_new()) };
+        config.get_readings_callback = three_readings;
+        config.max_keys = 2;
+        let stats: &'static callback_stats = Box::leak(Box::default());
+        let mut sensor = generic_c_sensor::new(std::ptr::null_mut(), &config, stats);
+        for _ in 0..2 {
+            // the key past the limit is refused, the callback returns 0 when it is
+            let readings = sensor.get_generic_readings().unwrap();
+            assert_eq!(readings.len(), 2);
+            assert_eq!(
+                readings.get("b").unwrap().kind,
+                Some(Kind::NumberValue(2.0))
+            );
+            sensor.recycle_generic_readings(readings);
+            // the keys are kept for the next call, without their values
+            let ctx = sensor.readings_ctx.as_ref().unwrap();
+            assert_eq!(ctx.readings.len(), 2);
+            assert!(ctx.readings.values().all(|value| value.kind.is_none()));
+        }
+    }
+
+    #[test]
+    fn test_max_keys_readings_dont_allocate() {
+        let mut config = unsafe { Box::from_raw(generic_c_sensor_config_new()) };
+        config.get_readings_callback = example_readings;
+        config.max_keys = 4;
+        let stats: &'static callback_stats = Box::leak(Box::default());
+        let mut sensor = generic_c_sensor::new(std::ptr::null_mut(), &config, stats);
+        let mut read = || {
+            let readings = sensor.get_generic_readings().unwrap();
+            assert_eq!(readings.len(), 4);
+            sensor.recycle_generic_readings(readings);
+        };
+        // the first call interns the keys and allocates the strings
+        read();
+        let allocations = ALLOCATIONS.with(Cell::get);
+        for _ in 0..100 {
+            read();
+        }
+        assert_eq!(ALLOCATIONS.with(Cell::get) - allocations, 0);
+    }
+
+    #[test]
+    #[ignore]
+    fn bench_get_readings_add() {
+        let mut ctx = get_readings_context::default();
+        let ctx = &mut ctx as *mut _;
+        bench("get_readings_add_i64", 100_000, || unsafe {
+            get_readings_add_i64(ctx, key(b"an_int\0"), 1234567)
+        });
+        bench("get_readings_add_double", 100_000, || unsafe {
+            get_readings_add_double(ctx, key(b"a_double\0"), 0.5)
+        });
+        bench("get_readings_add_string", 100_000, || unsafe {
+            get_readings_add_string(ctx, key(b"a_string\0"), key(b"the default string\0"))
+        });
+        bench("get_readings_add_binary_blob (2KB)", 100_000, || unsafe {
+            get_readings_add_binary_blob(ctx, key(b"spectrum\0"), BLOB.as_ptr(), BLOB.len() as _)
+        });
+    }
+
+    #[test]
+    #[ignore]
+    fn bench_c_sensor_readings() {
+        for (name, max_keys) in [
+            ("C sensor readings", 0),
+            ("C sensor readings (max keys)", 4),
+        ] {
+            let mut config = unsafe { Box::from_raw(generic_c_sensor_config_new()) };
+            config.get_readings_callback = example_readings;
+            config.max_keys = max_keys;
+            let stats: &'static callback_stats = Box::leak(Box::default());
+            let mut sensor = generic_c_sensor::new(std::ptr::null_mut(), &config, stats);
+            bench(name, 20_000, || {
+                let readings = sensor.get_generic_readings().unwrap();
+                sensor.recycle_generic_readings(readings);
+            });
+        }
+    }
+}
@@ -0,0 +1,293 @@
+use std::{
+    ffi::{c_char, CStr},
+    sync::{
+        atomic::{AtomicU32, Ordering},
+        Mutex,
+    },
+    time::Duration,
+};
+
+use micro_rdk::{
+    common::telemetry::{Telemetry, SERVER_TASK_NAME},
+    google::protobuf::{value::Kind, Struct, Value},
+};
+
+use super::errors::viam_code;
+
+// Bucket i counts callbacks that took [2^(i-1), 2^i) microseconds, bucket 0 the ones that took
+// less than a microsecond and the last one everything above ~4s.
+// Only 32 bits atomics are used since they are the only ones available on the ESP32
+const HISTOGRAM_BUCKETS: usize = 24;
+
+/// Fixed size latency histogram that can be recorded into without locking
+pub(crate) struct latency_histogram {
+    buckets: [AtomicU32; HISTOGRAM_BUCKETS],
+    count: AtomicU32,
+    max_us: AtomicU32,
+}
+
+impl Default for latency_histogram {
+    fn default() -> Self {
+        Self {
+            buckets: std::array::from_fn(|_| AtomicU32::new(0)),
+            count: AtomicU32::new(0),
+            max_us: AtomicU32::new(0),
+        }
+    }
+}
+
+impl latency_histogram {
+    pub(crate) fn record(&self, elapsed: Duration) {
+        let us = elapsed.as_micros().min(u32::MAX as u128) as u32;
+        let idx = ((u32::BITS - us.leading_zeros()) as usize).min(HISTOGRAM_BUCKETS - 1);
+        self.buckets[idx].fetch_add(1, Ordering::Relaxed);
+        self.count.fetch_add(1, Ordering::Relaxed);
+        self.max_us.fetch_max(us, Ordering::Relaxed);
+    }
+
+    pub(crate) fn count(&self) -> u32 {
+        self.count.load(Ordering::Relaxed)
+    }
+
+    pub(crate) fn max_us(&self) -> u32 {
+        self.max_us.load(Ordering::Relaxed)
+    }
+
+    /// Returns the upper bound in microseconds of the bucket holding the `percent`th percentile
+    pub(crate) fn percentile_us(&self, percent: u32) -> u32 {
+        let count = self.count() as u64;
+        if count == 0 {
+            return 0;
+        }
+        let target = (count * percent as u64).div_ceil(100).max(1);
+        let mut seen = 0_u64;
+        for (idx, bucket) in self.buckets.iter().enumerate() {
+            seen += bucket.load(Ordering::Relaxed) as u64;
+            if seen >= target {
+                let upper = if idx == HISTOGRAM_BUCKETS - 1 {
+                    u32::MAX
+                } else {
+                    (1_u32 << idx).saturating_sub(1)
+                };
+                return upper.min(self.max_us());
+            }
+        }
+        self.max_us()
+    }
+}
+
+/// Latencies of the callbacks of a model registered through the C API
+#[derive(Default)]
+pub(crate) struct callback_stats {
+    // the config callback of every model
+    pub(crate) config: latency_histogram,
+    // covers the readings, batch readings and async readings callbacks of generic sensors, the
+    // method callbacks of the vtable models aren't timed
+    pub(crate) readings: latency_histogram,
+}
+
+impl callback_stats {
+    pub(crate) fn to_struct(&self) -> Struct {
+        let number = |v: u32| Value {
+            kind: Some(Kind::NumberValue(v as f64)),
+        };
+        Struct {
+            fields: [
+                ("config_count", number(self.config.count())),
+                ("config_p50_us", number(self.config.percentile_us(50))),
+                ("config_p99_us", number(self.config.percentile_us(99))),
+                ("config_max_us", number(self.config.max_us())),
+                ("readings_count", number(self.readings.count())),
+                ("readings_p50_us", number(self.readings.percentile_us(50))),
+                ("readings_p99_us", number(self.readings.percentile_us(99))),
+                ("readings_max_us", number(self.readings.max_us())),
+            ]
+            .into_iter()
+            .map(|(k, v)| (k.to_owned(), v))
+            .collect(),
+        }
+    }
+}
+
+lazy_static::lazy_static! {
+    // Only locked when a model is registered or when stats are queried, recording is lock free
+    static ref MODEL_STATS: Mutex<Vec<(&'static str, &'static callback_stats)>> = Mutex::new(vec![]);
+}
+
+/// Returns the stats of `model`, allocating them the first time a model is registered
+pub(crate) fn register_model(model: &'static str) -> &'static callback_stats {
+    let mut models = MODEL_STATS.lock().unwrap();
+    if let Some((_, stats)) = models.iter().find(|(name, _)| *name == model) {
+        return stats;
+    }
+    let stats: &'static callback_stats = Box::leak(Box::default());
+    models.push((model, stats));
+    stats
+}
+
+/// Latencies of the callbacks registered for a model, durations are expressed in microseconds
+/// percentiles are approximated by the upper bound of a power of two bucket. The config callback is
+/// timed for every model, the readings callbacks only exist for generic sensors
+#[repr(C)]
+#[allow(non_camel_case_types)]
+#[derive(Default)]
+pub struct viam_callback_stats {
+    pub config_count: u32,
+    pub config_p50_us: u32,
+    pub config_p99_us: u32,
+    pub config_max_us: u32,
+    pub readings_count: u32,
+    pub readings_p50_us: u32,
+    pub readings_p99_us: u32,
+    pub readings_max_us: u32,
+}
+
+/// Get the latency statistics of the callbacks of `model`, the result is written to `out`
+///
+/// The function can be called from any task while the viam server is running
+///
+/// # Safety
+/// `model`, `out` must be valid pointers for the duration of the call
+/// `model` must be a null terminated C string
+#[no_mangle]
+pub unsafe extern "C" fn viam_server_get_callback_stats(
+    model: *const c_char,
+    out: *mut viam_callback_stats,
+) -> viam_code {
+    if model.is_null() || out.is_null() {
+        return viam_code::VIAM_INVALID_ARG;
+    }
+    let model = if let Ok(s) = unsafe { CStr::from_ptr(model) }.to_str() {
+        s
+    } else {
+        return viam_code::VIAM_INVALID_ARG;
+    };
+    let models = MODEL_STATS.lock().unwrap();
+    let stats = match models.iter().find(|(name, _)| *name == model) {
+        Some((_, stats)) => stats,
+        None => return viam_code::VIAM_KEY_NOT_FOUND,
+    };
+    unsafe {
+        *out = viam_callback_stats {
+            config_count: stats.config.count(),
+            config_p50_us: stats.config.percentile_us(50),
+            config_p99_us: stats.config.percentile_us(99),
+            config_max_us: stats.config.max_us(),
+            readings_count: stats.readings.count(),
+            readings_p50_us: stats.readings.percentile_us(50),
+            readings_p99_us: stats.readings.percentile_us(99),
+            readings_max_us: stats.readings.max_us(),
+        }
+    };
+    viam_code::VIAM_OK
+}
+
+/// Heap, stack and connection usage of the viam server, sizes are expressed in bytes. Heap fields
+/// are zero outside of the ESP32, PSRAM fields are zero on boards without PSRAM
+#[repr(C)]
+#[allow(non_camel_case_types)]
+#[derive(Default)]
+pub struct viam_telemetry {
+    pub internal_free: usize,
+    pub internal_largest_free_block: usize,
+    pub internal_minimum_free: usize,
+    pub psram_free: usize,
+    pub psram_largest_free_block: usize,
+    pub psram_minimum_free: usize,
+    /// lowest free stack of the task running the server, zero when unknown
+    pub server_stack_minimum_free: usize,
+    pub executor_tasks: u32,
+    pub connections: u32,
+    /// bytes held in the data store and bytes it can hold, summed over the collectors
+    pub data_store_stored: usize,
+    pub data_store_capacity: usize,
+    /// collection ticks skipped because collecting took longer than the minimum interval
+    pub data_missed_deadlines: u32,
+    pub data_collection_errors: u32,
+    /// upload metrics of the data manager, counters wrap around
+    pub data_uploaded_bytes: u32,
+    pub data_uploaded_messages: u32,
+    pub data_failed_uploads: u32,
+    pub data_in_flight_bytes: u32,
+    pub data_backlog_bytes: u32,
+    /// bytes per second acknowledged during the last sync
+    pub data_sync_throughput: u32,
+}
+
+/// Get the telemetry of the viam server, the result is written to `out`
+///
+/// The function can be called from any task, the data fields remain zero until data is collected
+///
+/// # Safety
+/// `out` must be a valid pointer for the duration of the call
+#[no_mangle]
+pub unsafe extern "C" fn viam_server_get_telemetry(out: *mut viam_telemetry) -> viam_code {
+    if out.is_null() {
+        return viam_code::VIAM_INVALID_ARG;
+    }
+    let telemetry = Telemetry::snapshot();
+    let data_store = telemetry.data_store_total();
+    let server_stack_minimum_free = telemetry
+        .task_stacks
+        .iter()
+        .find(|(name, _)| *name == SERVER_TASK_NAME)
+        .map_or(0, |(_, free)| *free);
+    unsafe {
+        *out = viam_telemetry {
+            internal_free: telemetry.internal_heap.free,
+            internal_largest_free_block: telemetry.internal_heap.largest_free_block,
+            internal_minimum_free: telemetry.internal_heap.minimum_free,
+            psram_free: telemetry.psram_heap.free,
+            psram_largest_free_block: telemetry.psram_heap.largest_free_block,
+            psram_minimum_free: telemetry.psram_heap.minimum_free,
+            server_stack_minimum_free,
+            executor_tasks: telemetry.executor_tasks,
+            connections: telemetry.connections,
+            data_store_stored: data_store.stored,
+            data_store_capacity: data_store.capacity,
+            data_missed_deadlines: telemetry.data_collection.missed_deadlines,
+            data_collection_errors: telemetry.data_collection.collection_errors,
+            data_uploaded_bytes: telemetry.data_sync.uploaded_bytes,
+            data_uploaded_messages: telemetry.data_sync.uploaded_messages,
+            data_failed_uploads: telemetry.data_sync.failed_uploads,
+            data_in_flight_bytes: telemetry.data_sync.in_flight_bytes,
+            data_backlog_bytes: telemetry.data_sync.backlog_bytes,
+            data_sync_throughput: telemetry.data_sync.last_sync_throughput,
+        }
+    };
+    viam_code::VIAM_OK
+}
+
+/// Get the bytes held in the data store by the collector of `method` on component `name`, and the
+/// bytes it can hold, written to `stored` and `capacity`
+///
+/// # Safety
+/// `name`, `method`, `stored`, `capacity` must be valid pointers for the duration of the call
+/// `name` and `method` must be null terminated C strings
+#[no_mangle]
+pub unsafe extern "C" fn viam_server_get_data_store_fill(
+    name: *const c_char,
+    method: *const c_char,
+    stored: *mut usize,
+    capacity: *mut usize,
+) -> viam_code {
+    if name.is_null() || method.is_null() || stored.is_null() || capacity.is_null() {
+        return viam_code::VIAM_INVALID_ARG;
+    }
+    let (name, method) = match (
+        unsafe { CStr::from_ptr(name) }.to_str(),
+        unsafe { CStr::from_ptr(method) }.to_str(),
+    ) {
+        (Ok(name), Ok(method)) => (name, method),
+        _ => return viam_code::VIAM_INVALID_ARG,
+    };
+    let fill = match Telemetry::snapshot().data_store_fill(name, method) {
+        Some(fill) => fill,
+        None => return viam_code::VIAM_KEY_NOT_FOUND,
+    };
+    unsafe {
+        *stored = fill.stored;
+        *capacity = fill.capacity;
+    }
+    viam_code::VIAM_OK
+}
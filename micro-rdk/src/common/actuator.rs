@@ -9,6 +9,10 @@ pub enum ActuatorError {
     CouldntStop,
     #[error(transparent)]
     BoardError(#[from] BoardError),
+    #[error("actuator: method {0} unimplemented")]
+    ActuatorMethodUnimplemented(&'static str),
+    #[error("actuator error code {0}")]
+    ActuatorCodeError(i32),
 }
 
 pub trait Actuator {
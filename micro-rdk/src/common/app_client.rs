@@ -324,7 +324,12 @@ impl AppClient {
         &self,
         data_req: DataCaptureUploadRequest,
     ) -> Result<(), AppClientError> {
-        let body = encode_request(data_req)?;
+        self.upload_encoded_data(encode_request(data_req)?).await
+    }
+
+    /// Uploads a DataCaptureUploadRequest that is already encoded, with its gRPC message prefix
+    #[cfg(feature = "data")]
+    pub(crate) async fn upload_encoded_data(&self, body: Bytes) -> Result<(), AppClientError> {
         let r = self
             .grpc_client
             .build_request(
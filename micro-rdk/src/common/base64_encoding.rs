@@ -0,0 +1,211 @@
+//! Base64 encoding (standard alphabet, padded) of the binary blobs added to readings.
+//!
+//! Groups of 12 bytes are encoded into 16 characters at once with SSSE3 on x86_64 (detected at
+//! runtime) and with NEON on aarch64, the remaining bytes go through the scalar loop. The PIE
+//! vector extensions of the ESP32-S3 aren't exposed by the Rust toolchain, Xtensa and RISC-V
+//! targets only use the scalar loop.
+
+const ALPHABET: &[u8; 64] = b"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/// Length of the encoding of `len` bytes
+pub const fn encoded_len(len: usize) -> usize {
+    (len + 2) / 3 * 4
+}
+
+pub fn encode(input: &[u8]) -> String {
+    let mut output = String::new();
+    encode_into(input, &mut output);
+    output
+}
+
+/// Replaces the content of `output` by the encoding of `input`, reusing its buffer
+pub fn encode_into(input: &[u8], output: &mut String) {
+    // the alphabet, the padding and the zeroes written by `resize` are ASCII
+    let output = unsafe { output.as_mut_vec() };
+    output.clear();
+    output.resize(encoded_len(input.len()), 0);
+    let written = encode_blocks(input, output);
+    encode_scalar(&input[written / 4 * 3..], &mut output[written..]);
+}
+
+fn sextet(group: u32, shift: u32) -> u8 {
+    ALPHABET[((group >> shift) & 0x3f) as usize]
+}
+
+fn encode_scalar(input: &[u8], output: &mut [u8]) {
+    let full = input.len() / 3 * 3;
+    for (bytes, chars) in input[..full]
+        .chunks_exact(3)
+        .zip(output.chunks_exact_mut(4))
+    {
+        let group = (bytes[0] as u32) << 16 | (bytes[1] as u32) << 8 | bytes[2] as u32;
+        chars.copy_from_slice(&[
+            sextet(group, 18),
+            sextet(group, 12),
+            sextet(group, 6),
+            sextet(group, 0),
+        ]);
+    }
+    let chars = &mut output[full / 3 * 4..];
+    match input[full..] {
+        [a] => {
+            let group = (a as u32) << 16;
+            chars.copy_from_slice(&[sextet(group, 18), sextet(group, 12), b'=', b'=']);
+        }
+        [a, b] => {
+            let group = (a as u32) << 16 | (b as u32) << 8;
+            chars.copy_from_slice(&[sextet(group, 18), sextet(group, 12), sextet(group, 6), b'=']);
+        }
+        _ => {}
+    }
+}
+
+// The vector encoders load 16 bytes to encode 12, they stop when less than 16 bytes are left.
+// Every 32 bits lane is given the 3 bytes of a group in big endian order, the lane then becomes the
+// 4 indices in the alphabet of the group: `v >> 18 | (v >> 4) & 0x3f00 | (v << 10) & 0x3f0000 |
+// (v << 24) & 0x3f000000`. Return the number of characters written.
+
+#[cfg(target_arch = "x86_64")]
+fn encode_blocks(input: &[u8], output: &mut [u8]) -> usize {
+    if is_x86_feature_detected!("ssse3") {
+        unsafe { encode_blocks_ssse3(input, output) }
+    } else {
+        0
+    }
+}
+
+#[cfg(target_arch = "x86_64")]
+#[target_feature(enable = "ssse3")]
+unsafe fn encode_blocks_ssse3(input: &[u8], output: &mut [u8]) -> usize {
+    use std::arch::x86_64::*;
+    let groups = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    // offset from an index to its character, selected by the range of the index (see below)
+    let offsets = _mm_setr_epi8(
+        b'a' as i8 - 26,
+        b'0' as i8 - 52,
+        b'0' as i8 - 52,
+        b'0' as i8 - 52,
+        b'0' as i8 - 52,
+        b'0' as i8 - 52,
+        b'0' as i8 - 52,
+        b'0' as i8 - 52,
+        b'0' as i8 - 52,
+        b'0' as i8 - 52,
+        b'0' as i8 - 52,
+        b'+' as i8 - 62,
+        b'/' as i8 - 63,
+        b'A' as i8,
+        0,
+        0,
+    );
+    let mut read = 0;
+    let mut written = 0;
+    while input.len() - read >= 16 {
+        let v = _mm_shuffle_epi8(
+            _mm_loadu_si128(input.as_ptr().add(read) as *const __m128i),
+            groups,
+        );
+        let indices = _mm_or_si128(
+            _mm_or_si128(
+                _mm_srli_epi32(v, 18),
+                _mm_and_si128(_mm_srli_epi32(v, 4), _mm_set1_epi32(0x3f00)),
+            ),
+            _mm_or_si128(
+                _mm_and_si128(_mm_slli_epi32(v, 10), _mm_set1_epi32(0x3f0000)),
+                _mm_and_si128(_mm_slli_epi32(v, 24), _mm_set1_epi32(0x3f000000)),
+            ),
+        );
+        // 0..=25 -> 13, 26..=51 -> 0, 52..=61 -> 1..=10, 62 -> 11, 63 -> 12
+        let ranges = _mm_or_si128(
+            _mm_subs_epu8(indices, _mm_set1_epi8(51)),
+            _mm_and_si128(
+                _mm_cmpgt_epi8(_mm_set1_epi8(26), indices),
+                _mm_set1_epi8(13),
+            ),
+        );
+        let chars = _mm_add_epi8(_mm_shuffle_epi8(offsets, ranges), indices);
+        _mm_storeu_si128(output.as_mut_ptr().add(written) as *mut __m128i, chars);
+        read += 12;
+        written += 16;
+    }
+    written
+}
+
+#[cfg(target_arch = "aarch64")]
+fn encode_blocks(input: &[u8], output: &mut [u8]) -> usize {
+    // NEON is part of the aarch64 baseline
+    unsafe { encode_blocks_neon(input, output) }
+}
+
+#[cfg(target_arch = "aarch64")]
+#[target_feature(enable = "neon")]
+unsafe fn encode_blocks_neon(input: &[u8], output: &mut [u8]) -> usize {
+    use std::arch::aarch64::*;
+    // out of range indices select 0
+    const GROUPS: [u8; 16] = [2, 1, 0, 255, 5, 4, 3, 255, 8, 7, 6, 255, 11, 10, 9, 255];
+    let groups = vld1q_u8(GROUPS.as_ptr());
+    let alphabet = uint8x16x4_t(
+        vld1q_u8(ALPHABET.as_ptr()),
+        vld1q_u8(ALPHABET.as_ptr().add(16)),
+        vld1q_u8(ALPHABET.as_ptr().add(32)),
+        vld1q_u8(ALPHABET.as_ptr().add(48)),
+    );
+    let mut read = 0;
+    let mut written = 0;
+    while input.len() - read >= 16 {
+        let v = vreinterpretq_u32_u8(vqtbl1q_u8(vld1q_u8(input.as_ptr().add(read)), groups));
+        let indices = vorrq_u32(
+            vorrq_u32(
+                vshrq_n_u32::<18>(v),
+                vandq_u32(vshrq_n_u32::<4>(v), vdupq_n_u32(0x3f00)),
+            ),
+            vorrq_u32(
+                vandq_u32(vshlq_n_u32::<10>(v), vdupq_n_u32(0x3f0000)),
+                vandq_u32(vshlq_n_u32::<24>(v), vdupq_n_u32(0x3f000000)),
+            ),
+        );
+        let chars = vqtbl4q_u8(alphabet, vreinterpretq_u8_u32(indices));
+        vst1q_u8(output.as_mut_ptr().add(written), chars);
+        read += 12;
+        written += 16;
+    }
+    written
+}
+
+#[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+fn encode_blocks(_input: &[u8], _output: &mut [u8]) -> usize {
+    0
+}
+
+#[cfg(test)]
+mod tests {
+    use base64::{engine::general_purpose::STANDARD, Engine};
+
+    use super::{encode, encode_into, encode_scalar, encoded_len};
+
+    #[test_log::test]
+    fn test_base64_encode() {
+        let data: Vec<u8> = (0..2100_u32).map(|i| (i * 7 + i / 13) as u8).collect();
+        for len in (0..64).chain([2047, 2048, 2049, 2100]) {
+            assert_eq!(encode(&data[..len]), STANDARD.encode(&data[..len]));
+            let mut scalar = vec![0; encoded_len(len)];
+            encode_scalar(&data[..len], &mut scalar);
+            assert_eq!(scalar, STANDARD.encode(&data[..len]).into_bytes());
+        }
+        // a reused buffer only holds the last encoding
+        let mut reused = encode(&data);
+        for len in [2100, 64, 3, 0] {
+            encode_into(&data[..len], &mut reused);
+            assert_eq!(reused, STANDARD.encode(&data[..len]));
+        }
+        // every index of the alphabet
+        let all: Vec<u8> = (0..16_u32)
+            .flat_map(|i| {
+                let group = (i * 4) << 18 | (i * 4 + 1) << 12 | (i * 4 + 2) << 6 | (i * 4 + 3);
+                [(group >> 16) as u8, (group >> 8) as u8, group as u8]
+            })
+            .collect();
+        assert_eq!(encode(&all), STANDARD.encode(&all));
+        assert_eq!(encode(&[0xff; 40]), STANDARD.encode([0xff; 40]));
+    }
+}
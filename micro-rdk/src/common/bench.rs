@@ -0,0 +1,68 @@
+//! Benchmarks of the hot paths, written as ignored tests named `bench_*` next to the code they
+//! measure and run with `make bench`.
+//!
+//! Each benchmark reports the mean latency of an operation along with the heap allocations it made,
+//! counted by the allocator of the test binary. Benchmarks have to run on a single test thread for
+//! the counts to be exact.
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::hint::black_box;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::time::{Duration, Instant};
+
+struct CountingAllocator;
+
+static ALLOCATIONS: AtomicUsize = AtomicUsize::new(0);
+
+#[global_allocator]
+static ALLOCATOR: CountingAllocator = CountingAllocator;
+
+unsafe impl GlobalAlloc for CountingAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        let _ = ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        unsafe { System.alloc(layout) }
+    }
+    unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
+        let _ = ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        unsafe { System.alloc_zeroed(layout) }
+    }
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        let _ = ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        unsafe { System.realloc(ptr, layout, new_size) }
+    }
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        unsafe { System.dealloc(ptr, layout) }
+    }
+}
+
+#[derive(Debug)]
+pub(crate) struct BenchResult {
+    pub(crate) mean: Duration,
+    pub(crate) allocations_per_op: f64,
+}
+
+/// Runs `op` `iterations` times after a warm up of a tenth of them, and prints its mean latency,
+/// throughput and allocations
+pub(crate) fn bench<T>(name: &str, iterations: u32, mut op: impl FnMut() -> T) -> BenchResult {
+    for _ in 0..(iterations / 10).max(1) {
+        let _ = black_box(op());
+    }
+    let allocations = ALLOCATIONS.load(Ordering::Relaxed);
+    let start = Instant::now();
+    for _ in 0..iterations {
+        let _ = black_box(op());
+    }
+    let elapsed = start.elapsed();
+    let result = BenchResult {
+        mean: elapsed / iterations,
+        allocations_per_op: (ALLOCATIONS.load(Ordering::Relaxed) - allocations) as f64
+            / iterations as f64,
+    };
+    println!(
+        "{:<40} {:>10} ns/op {:>12.0} ops/s {:>8.2} allocs/op",
+        name,
+        result.mean.as_nanos(),
+        iterations as f64 / elapsed.as_secs_f64(),
+        result.allocations_per_op
+    );
+    result
+}
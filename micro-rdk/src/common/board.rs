@@ -39,6 +39,8 @@ pub enum BoardError {
     BoardMethodNotSupported(&'static str),
     #[error(transparent)]
     BoardI2CError(#[from] I2CErrors),
+    #[error("board error code {0}")]
+    BoardCodeError(i32),
 }
 
 pub static COMPONENT_NAME: &str = "board";
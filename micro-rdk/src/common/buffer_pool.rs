@@ -0,0 +1,133 @@
+//! Buffers shared by the connections of the server.
+//!
+//! Connections don't own a buffer sized for their largest message while they are idle: a buffer
+//! is taken from a pool when a request is processed and given back afterward, so the memory of
+//! the server grows with the number of requests in flight rather than with the number of opened
+//! connections.
+use std::{
+    ops::{Deref, DerefMut},
+    sync::{
+        atomic::{AtomicU32, Ordering},
+        Mutex,
+    },
+};
+
+use bytes::BytesMut;
+
+pub struct BufferPool {
+    size: usize,
+    max_free: usize,
+    free: Mutex<Vec<BytesMut>>,
+    /// buffers that had to be allocated because the pool was empty
+    pub allocated: AtomicU32,
+}
+
+impl BufferPool {
+    /// A pool of buffers of `size` bytes, keeping at most `max_free` of them once given back
+    pub const fn new(size: usize, max_free: usize) -> Self {
+        Self {
+            size,
+            max_free,
+            free: Mutex::new(Vec::new()),
+            allocated: AtomicU32::new(0),
+        }
+    }
+
+    /// Size of the buffers of the pool
+    pub fn size(&self) -> usize {
+        self.size
+    }
+
+    /// A free buffer of the pool, None when the pool is empty
+    pub fn take(&self) -> Option<BytesMut> {
+        self.free.lock().unwrap().pop()
+    }
+
+    /// Gives `buf` back to the pool. Buffers smaller than the pool size or much larger (grown for
+    /// an unusual message) are released instead.
+    pub fn put(&self, mut buf: BytesMut) {
+        let capacity = buf.capacity();
+        if capacity < self.size || capacity > 2 * self.size {
+            return;
+        }
+        let mut free = self.free.lock().unwrap();
+        if free.len() < self.max_free {
+            buf.clear();
+            free.push(buf);
+        }
+    }
+
+    /// A buffer of the pool, allocated when the pool is empty. It goes back to the pool when dropped.
+    pub fn get(&'static self) -> PooledBuffer {
+        let buf = self.take().unwrap_or_else(|| {
+            let _ = self.allocated.fetch_add(1, Ordering::Relaxed);
+            BytesMut::with_capacity(self.size)
+        });
+        PooledBuffer { buf, pool: self }
+    }
+
+    /// Releases every free buffer of the pool
+    pub fn shrink(&self) {
+        self.free.lock().unwrap().clear();
+    }
+}
+
+pub struct PooledBuffer {
+    buf: BytesMut,
+    pool: &'static BufferPool,
+}
+
+impl Deref for PooledBuffer {
+    type Target = BytesMut;
+    fn deref(&self) -> &Self::Target {
+        &self.buf
+    }
+}
+
+impl DerefMut for PooledBuffer {
+    fn deref_mut(&mut self) -> &mut Self::Target {
+        &mut self.buf
+    }
+}
+
+impl Drop for PooledBuffer {
+    fn drop(&mut self) {
+        self.pool.put(std::mem::take(&mut self.buf));
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::sync::atomic::Ordering;
+
+    use super::BufferPool;
+
+    #[test_log::test]
+    fn test_buffer_pool() {
+        static POOL: BufferPool = BufferPool::new(64, 2);
+        {
+            let mut a = POOL.get();
+            let b = POOL.get();
+            let c = POOL.get();
+            assert!(a.capacity() >= 64 && b.capacity() >= 64 && c.capacity() >= 64);
+            a.extend_from_slice(&[1; 10]);
+        }
+        assert_eq!(POOL.allocated.load(Ordering::Relaxed), 3);
+        assert_eq!(POOL.free.lock().unwrap().len(), 2);
+
+        // buffers are given back empty and reused
+        let a = POOL.get();
+        assert!(a.is_empty());
+        assert_eq!(POOL.allocated.load(Ordering::Relaxed), 3);
+        drop(a);
+
+        // grown buffers are released
+        let mut a = POOL.get();
+        a.reserve(1024);
+        drop(a);
+        assert_eq!(POOL.free.lock().unwrap().len(), 1);
+
+        POOL.shrink();
+        assert!(POOL.take().is_none());
+    }
+}
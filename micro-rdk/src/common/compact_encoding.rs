@@ -0,0 +1,321 @@
+//! Compact encoding of the samples kept in a data store.
+//!
+//! Collected readings are a SensorData holding both timestamps and a Struct wrapping a single
+//! Struct of numbers and booleans (see `From<GenericReadingsResult> for Data`). Most of the bytes of
+//! such a message are framing and keys repeated by every sample. For these messages a record is
+//! made of:
+//! - a marker byte, which can't start an encoded SensorData
+//! - the index of the schema (wrapping key and sorted keys and kinds) kept by the `CompactCodec`
+//! - the time requested as a zigzag varint delta in nanoseconds from the first sample, then the
+//!   time received as a delta from the time requested
+//! - a bitmap of the numbers stored as f32 (when it is lossless) and a bitmap of the booleans
+//! - the numbers in the order of the schema
+//!
+//! Any other message is stored as a regular encoded SensorData. Schemas and the time origin are only
+//! kept in memory, so records can only be expanded by the codec that produced them.
+use std::collections::HashMap;
+
+use bytes::{Buf, BufMut};
+use prost::encoding::{decode_varint, encode_varint};
+
+use super::data_store::DataStoreError;
+use crate::google::protobuf::{value::Kind, Struct, Timestamp, Value};
+use crate::proto::app::data_sync::v1::{sensor_data::Data, SensorData, SensorMetadata};
+
+/// First byte of a compact record. As the first byte of a protobuf key it has the continuation bit
+/// set and wire type 1 (64 bits), it starts the key of a fixed64 field numbered 8 or more. SensorData
+/// only has length delimited fields 1 to 3, whose keys are single bytes, so an encoded SensorData
+/// never starts with it
+pub(crate) const COMPACT_MARKER: u8 = 0xC1;
+const MAX_SCHEMAS: usize = 16;
+const NANOS_PER_SEC: i64 = 1_000_000_000;
+
+#[derive(Clone, Copy, PartialEq, Eq)]
+enum FieldKind {
+    Number,
+    Bool,
+}
+
+#[derive(PartialEq, Eq)]
+struct Schema {
+    wrapper: String,
+    fields: Vec<(String, FieldKind)>,
+}
+
+impl Schema {
+    fn count(&self, kind: FieldKind) -> usize {
+        self.fields.iter().filter(|(_, k)| *k == kind).count()
+    }
+}
+
+fn zigzag(value: i64) -> u64 {
+    ((value << 1) ^ (value >> 63)) as u64
+}
+
+fn unzigzag(value: u64) -> i64 {
+    ((value >> 1) as i64) ^ -((value & 1) as i64)
+}
+
+fn timestamp_nanos(ts: &Timestamp) -> Option<i64> {
+    if !(0..NANOS_PER_SEC).contains(&(ts.nanos as i64)) {
+        return None;
+    }
+    ts.seconds
+        .checked_mul(NANOS_PER_SEC)?
+        .checked_add(ts.nanos as i64)
+}
+
+fn nanos_timestamp(nanos: i64) -> Timestamp {
+    Timestamp {
+        seconds: nanos.div_euclid(NANOS_PER_SEC),
+        nanos: nanos.rem_euclid(NANOS_PER_SEC) as i32,
+    }
+}
+
+fn bitmap_len(bits: usize) -> usize {
+    (bits + 7) / 8
+}
+
+/// Encodes and expands the samples of one collector
+#[derive(Default)]
+pub(crate) struct CompactCodec {
+    origin_nanos: Option<i64>,
+    schemas: Vec<Schema>,
+}
+
+impl CompactCodec {
+    fn schema_index(&mut self, schema: Schema) -> Option<usize> {
+        if let Some(index) = self.schemas.iter().position(|s| *s == schema) {
+            return Some(index);
+        }
+        if self.schemas.len() == MAX_SCHEMAS {
+            return None;
+        }
+        self.schemas.push(schema);
+        Some(self.schemas.len() - 1)
+    }
+
+    /// Returns the compact record of `message`, or None when it has to be stored as is
+    pub(crate) fn encode(&mut self, message: &SensorData) -> Option<Vec<u8>> {
+        let metadata = message.metadata.as_ref()?;
+        let requested = timestamp_nanos(metadata.time_requested.as_ref()?)?;
+        let received = timestamp_nanos(metadata.time_received.as_ref()?)?;
+        let (wrapper, readings) = match &message.data {
+            Some(Data::Struct(data)) if data.fields.len() == 1 => {
+                match data.fields.iter().next()? {
+                    (
+                        wrapper,
+                        Value {
+                            kind: Some(Kind::StructValue(readings)),
+                        },
+                    ) => (wrapper, readings),
+                    _ => return None,
+                }
+            }
+            _ => return None,
+        };
+        let mut fields = Vec::with_capacity(readings.fields.len());
+        for (key, value) in readings.fields.iter() {
+            match value.kind {
+                Some(Kind::NumberValue(v)) => fields.push((key, FieldKind::Number, v, false)),
+                Some(Kind::BoolValue(b)) => fields.push((key, FieldKind::Bool, 0.0, b)),
+                _ => return None,
+            }
+        }
+        fields.sort_unstable_by(|a, b| a.0.cmp(b.0));
+
+        let origin = *self.origin_nanos.get_or_insert(requested);
+        let requested_delta = requested.checked_sub(origin)?;
+        let received_delta = received.checked_sub(requested)?;
+        let schema = self.schema_index(Schema {
+            wrapper: wrapper.clone(),
+            fields: fields.iter().map(|f| (f.0.clone(), f.1)).collect(),
+        })?;
+
+        let numbers: Vec<f64> = fields
+            .iter()
+            .filter(|f| f.1 == FieldKind::Number)
+            .map(|f| f.2)
+            .collect();
+        let bools = fields
+            .iter()
+            .filter(|f| f.1 == FieldKind::Bool)
+            .map(|f| f.3);
+        let mut narrow = vec![0_u8; bitmap_len(numbers.len())];
+        for (i, v) in numbers.iter().enumerate() {
+            if (*v as f32) as f64 == *v {
+                narrow[i / 8] |= 1 << (i % 8);
+            }
+        }
+        let mut bool_bits = vec![0_u8; bitmap_len(fields.len() - numbers.len())];
+        for (i, b) in bools.enumerate() {
+            if b {
+                bool_bits[i / 8] |= 1 << (i % 8);
+            }
+        }
+
+        let mut buf = Vec::with_capacity(24 + narrow.len() + bool_bits.len() + numbers.len() * 8);
+        buf.put_u8(COMPACT_MARKER);
+        buf.put_u8(schema as u8);
+        encode_varint(zigzag(requested_delta), &mut buf);
+        encode_varint(zigzag(received_delta), &mut buf);
+        buf.put_slice(&narrow);
+        buf.put_slice(&bool_bits);
+        for (i, v) in numbers.iter().enumerate() {
+            if narrow[i / 8] & (1 << (i % 8)) != 0 {
+                buf.put_f32_le(*v as f32);
+            } else {
+                buf.put_f64_le(*v);
+            }
+        }
+        Some(buf)
+    }
+
+    /// Expands a record produced by `encode`
+    pub(crate) fn decode(&self, mut record: &[u8]) -> Result<SensorData, DataStoreError> {
+        if record.len() < 2 || record.get_u8() != COMPACT_MARKER {
+            return Err(DataStoreError::DataIntegrityError);
+        }
+        let schema = self
+            .schemas
+            .get(record.get_u8() as usize)
+            .ok_or(DataStoreError::DataIntegrityError)?;
+        let origin = self
+            .origin_nanos
+            .ok_or(DataStoreError::DataIntegrityError)?;
+        let requested = origin
+            .checked_add(unzigzag(decode_varint(&mut record)?))
+            .ok_or(DataStoreError::DataIntegrityError)?;
+        let received = requested
+            .checked_add(unzigzag(decode_varint(&mut record)?))
+            .ok_or(DataStoreError::DataIntegrityError)?;
+
+        let number_count = schema.count(FieldKind::Number);
+        let bool_count = schema.count(FieldKind::Bool);
+        if record.remaining() < bitmap_len(number_count) + bitmap_len(bool_count) {
+            return Err(DataStoreError::DataIntegrityError);
+        }
+        let (narrow, rest) = record.split_at(bitmap_len(number_count));
+        let (bool_bits, mut values) = rest.split_at(bitmap_len(bool_count));
+
+        let mut fields = HashMap::with_capacity(schema.fields.len());
+        let (mut number_idx, mut bool_idx) = (0, 0);
+        for (key, kind) in schema.fields.iter() {
+            let kind = match kind {
+                FieldKind::Number => {
+                    let is_narrow = narrow[number_idx / 8] & (1 << (number_idx % 8)) != 0;
+                    number_idx += 1;
+                    let len = if is_narrow { 4 } else { 8 };
+                    if values.remaining() < len {
+                        return Err(DataStoreError::DataIntegrityError);
+                    }
+                    Kind::NumberValue(if is_narrow {
+                        values.get_f32_le() as f64
+                    } else {
+                        values.get_f64_le()
+                    })
+                }
+                FieldKind::Bool => {
+                    let b = bool_bits[bool_idx / 8] & (1 << (bool_idx % 8)) != 0;
+                    bool_idx += 1;
+                    Kind::BoolValue(b)
+                }
+            };
+            fields.insert(key.clone(), Value { kind: Some(kind) });
+        }
+
+        Ok(SensorData {
+            metadata: Some(SensorMetadata {
+                time_requested: Some(nanos_timestamp(requested)),
+                time_received: Some(nanos_timestamp(received)),
+            }),
+            data: Some(Data::Struct(Struct {
+                fields: HashMap::from([(
+                    schema.wrapper.clone(),
+                    Value {
+                        kind: Some(Kind::StructValue(Struct { fields })),
+                    },
+                )]),
+            })),
+        })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::collections::HashMap;
+
+    use super::CompactCodec;
+    use crate::google::protobuf::{value::Kind, Struct, Timestamp, Value};
+    use crate::proto::app::data_sync::v1::{sensor_data::Data, SensorData, SensorMetadata};
+    use prost::Message;
+
+    fn readings(seconds: i64, nanos: i32, fields: Vec<(&str, Kind)>) -> SensorData {
+        SensorData {
+            metadata: Some(SensorMetadata {
+                time_requested: Some(Timestamp { seconds, nanos }),
+                time_received: Some(Timestamp {
+                    seconds,
+                    nanos: nanos + 1500,
+                }),
+            }),
+            data: Some(Data::Struct(Struct {
+                fields: HashMap::from([(
+                    "readings".to_string(),
+                    Value {
+                        kind: Some(Kind::StructValue(Struct {
+                            fields: fields
+                                .into_iter()
+                                .map(|(k, v)| (k.to_string(), Value { kind: Some(v) }))
+                                .collect(),
+                        })),
+                    },
+                )]),
+            })),
+        }
+    }
+
+    #[test_log::test]
+    fn test_compact_encoding() {
+        let mut codec = CompactCodec::default();
+        let samples = vec![
+            readings(
+                1_700_000_000,
+                12_345,
+                vec![
+                    ("temperature", Kind::NumberValue(21.5)),
+                    ("humidity", Kind::NumberValue(0.1)),
+                    ("ok", Kind::BoolValue(true)),
+                ],
+            ),
+            readings(
+                1_700_000_001,
+                999_000_000,
+                vec![
+                    ("temperature", Kind::NumberValue(f64::MAX)),
+                    ("humidity", Kind::NumberValue(-3.0)),
+                    ("ok", Kind::BoolValue(false)),
+                ],
+            ),
+            readings(1_699_999_999, 0, vec![("other", Kind::NumberValue(1.0))]),
+        ];
+        for sample in samples {
+            let record = codec.encode(&sample).unwrap();
+            assert!(record.len() * 3 < sample.encoded_len());
+            assert_eq!(codec.decode(&record).unwrap(), sample);
+        }
+        assert_eq!(codec.schemas.len(), 2);
+
+        // messages that aren't scalar readings are stored as is
+        let mut sample = readings(0, 0, vec![("name", Kind::StringValue("a".to_string()))]);
+        assert!(codec.encode(&sample).is_none());
+        sample.metadata = None;
+        assert!(codec.encode(&sample).is_none());
+        assert!(codec
+            .encode(&SensorData {
+                metadata: None,
+                data: Some(Data::Binary(vec![1, 2, 3])),
+            })
+            .is_none());
+    }
+}
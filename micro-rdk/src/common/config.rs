@@ -115,6 +115,13 @@ impl<'b> TryFrom<&'b Kind> for &'b str {
     }
 }
 
+impl<'b> TryFrom<&'b Kind> for &'b Kind {
+    type Error = AttributeError;
+    fn try_from(value: &'b Kind) -> Result<Self, Self::Error> {
+        Ok(value)
+    }
+}
+
 impl TryFrom<&Kind> for String {
     type Error = AttributeError;
     fn try_from(value: &Kind) -> Result<Self, Self::Error> {
@@ -391,8 +398,7 @@ impl Component for DynamicComponentConfig {
         T: std::convert::TryFrom<&'a Kind, Error = AttributeError>,
     {
         if let Some(v) = self.attributes.as_ref() {
-            let key_string = key.to_owned();
-            if let Some(v) = v.get(&key_string) {
+            if let Some(v) = v.get(key) {
                 return v.try_into();
             }
         }
@@ -558,6 +564,14 @@ mod tests {
 
         assert_eq!(val.as_ref().ok(), None);
         assert_eq!(val.err().unwrap(), AttributeError::ParseNumError);
+
+        let val = robot_config[2].get_attribute::<&Kind>("float");
+
+        assert!(matches!(val, Ok(Kind::NumberValue(v)) if *v == 10.556));
+
+        let val = robot_config[1].get_attribute::<&str>("board");
+
+        assert_eq!(val.ok(), Some("board"));
     }
 
     #[cfg(feature = "data")]
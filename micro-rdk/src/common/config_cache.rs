@@ -0,0 +1,237 @@
+//! Cache of the last configuration received from app, so the robot can be built at boot without
+//! waiting for it.
+//!
+//! A cached configuration is the FNV-1a hash of the encoded ConfigResponse (8 bytes, little
+//! endian) followed by the encoding, a cache that doesn't match its hash is ignored. Once the fresh
+//! configuration is received the robot built from the cache is reconciled with it, see
+//! `LocalRobot::reconcile`.
+use std::collections::HashSet;
+use std::sync::{Arc, Mutex};
+
+use chrono::{DateTime, FixedOffset};
+use prost::Message;
+use thiserror::Error;
+
+use super::entry::RobotRepresentation;
+use super::registry::ComponentRegistry;
+use super::robot::{LocalRobot, RobotError};
+use crate::proto::{app::v1::ConfigResponse, common::v1::ResourceName};
+
+#[cfg(feature = "provisioning")]
+use super::provisioning::storage::RobotConfigurationStorage;
+#[cfg(feature = "data")]
+use super::{
+    app_client::PeriodicAppClientTask, config_monitor::services_changed,
+    data_manager::CollectorUpdater,
+};
+#[cfg(feature = "data")]
+use async_executor::Task;
+
+const HASH_LEN: usize = 8;
+
+#[derive(Error, Debug)]
+pub enum ConfigCacheError {
+    #[error("cached config doesn't match its hash")]
+    ConfigCacheHashMismatch,
+    #[error(transparent)]
+    ConfigCacheDecodeError(#[from] prost::DecodeError),
+}
+
+/// 64 bits FNV-1a hash of `data`
+pub const fn config_hash(data: &[u8]) -> u64 {
+    let mut hash = 0xcbf29ce484222325_u64;
+    let mut i = 0;
+    while i < data.len() {
+        hash = (hash ^ data[i] as u64).wrapping_mul(0x00000100000001b3);
+        i += 1;
+    }
+    hash
+}
+
+pub fn encode_cached_config(config: &ConfigResponse) -> Vec<u8> {
+    let mut cached = Vec::with_capacity(HASH_LEN + config.encoded_len());
+    cached.extend_from_slice(&[0; HASH_LEN]);
+    // encoding into a Vec with enough capacity can't fail
+    config.encode(&mut cached).unwrap();
+    let hash = config_hash(&cached[HASH_LEN..]);
+    cached[..HASH_LEN].copy_from_slice(&hash.to_le_bytes());
+    cached
+}
+
+pub fn decode_cached_config(cached: &[u8]) -> Result<ConfigResponse, ConfigCacheError> {
+    if cached.len() < HASH_LEN {
+        return Err(ConfigCacheError::ConfigCacheHashMismatch);
+    }
+    let (hash, encoded) = cached.split_at(HASH_LEN);
+    if hash != config_hash(encoded).to_le_bytes() {
+        return Err(ConfigCacheError::ConfigCacheHashMismatch);
+    }
+    Ok(ConfigResponse::decode(encoded)?)
+}
+
+/// Caches `config` in `storage` if any, a failure only costs the next boot its head start
+#[cfg(feature = "provisioning")]
+pub(crate) fn store_config<S: RobotConfigurationStorage>(
+    storage: Option<&S>,
+    config: &ConfigResponse,
+) {
+    if let Some(Err(err)) = storage.map(|storage| storage.store_robot_configuration(config)) {
+        log::warn!("couldn't cache the robot config: {:?}", err);
+    }
+}
+
+/// Robot built from the cached configuration, running until the fresh configuration is received
+pub struct CachedRobot {
+    pub(crate) config: ConfigResponse,
+    pub(crate) robot: Arc<Mutex<LocalRobot>>,
+    // registry the robot is reconciled with
+    pub(crate) registry: Box<ComponentRegistry>,
+    // data collection started at boot, along with the sync task to give to the server
+    #[cfg(feature = "data")]
+    pub(crate) data_tasks: Option<(Box<dyn PeriodicAppClientTask>, Task<()>, CollectorUpdater)>,
+}
+
+impl CachedRobot {
+    pub(crate) fn new(
+        config: ConfigResponse,
+        registry: Box<ComponentRegistry>,
+    ) -> Result<Self, (RobotError, Box<ComponentRegistry>)> {
+        match LocalRobot::from_cloud_config(&config, registry.clone(), None) {
+            Ok(robot) => Ok(Self {
+                config,
+                robot: Arc::new(Mutex::new(robot)),
+                registry,
+                #[cfg(feature = "data")]
+                data_tasks: None,
+            }),
+            Err(err) => Err((err, registry)),
+        }
+    }
+
+    /// Reconciles the robot with the configuration received from app, returns the resources that
+    /// were rebuilt. Data collection is stopped when the data manager can't take the new
+    /// collectors, it has to be rebuilt for the new configuration.
+    pub(crate) async fn reconcile(
+        &mut self,
+        config: &ConfigResponse,
+        build_time: Option<DateTime<FixedOffset>>,
+    ) -> Result<HashSet<ResourceName>, RobotError> {
+        let changed = self.robot.lock().unwrap().reconcile(
+            &self.config,
+            config,
+            self.registry.clone(),
+            build_time,
+        )?;
+        #[cfg(feature = "data")]
+        if self.config != *config {
+            let updated = !services_changed(&self.config, config)
+                && self.data_tasks.as_ref().map_or(true, |(_, _, updater)| {
+                    matches!(
+                        updater.update(&self.robot.lock().unwrap(), &changed),
+                        Ok(true)
+                    )
+                });
+            if !updated {
+                if let Some((_, task, _)) = self.data_tasks.take() {
+                    task.cancel().await;
+                }
+            }
+        }
+        self.config = config.clone();
+        Ok(changed)
+    }
+}
+
+pub enum BootRobot {
+    Cached(CachedRobot),
+    Uncached(RobotRepresentation),
+}
+
+impl BootRobot {
+    /// Builds the robot from the configuration in `storage` when there is one, a robot that was
+    /// already built is left as is
+    #[cfg(feature = "provisioning")]
+    pub(crate) fn new<S: RobotConfigurationStorage>(
+        repr: RobotRepresentation,
+        storage: Option<&S>,
+    ) -> Self {
+        let (registry, storage) = match (repr, storage) {
+            (RobotRepresentation::WithRegistry(registry), Some(storage))
+                if storage.has_robot_configuration() =>
+            {
+                (registry, storage)
+            }
+            (repr, _) => return Self::Uncached(repr),
+        };
+        let config = match storage.get_robot_configuration() {
+            Ok(config) => config,
+            Err(err) => {
+                log::warn!("ignoring cached config: {:?}", err);
+                return Self::Uncached(RobotRepresentation::WithRegistry(registry));
+            }
+        };
+        log::info!("building robot from cached config");
+        match CachedRobot::new(config, registry) {
+            Ok(cached) => Self::Cached(cached),
+            Err((err, registry)) => {
+                log::warn!("couldn't build robot from cached config: {:?}", err);
+                Self::Uncached(RobotRepresentation::WithRegistry(registry))
+            }
+        }
+    }
+
+    /// Stops the robot built from the cache and erases the cache, for when the robot credentials
+    /// may change
+    #[cfg(feature = "provisioning")]
+    pub(crate) async fn discard<S: RobotConfigurationStorage>(self, storage: &S) -> Self {
+        if storage.has_robot_configuration() {
+            if let Err(err) = storage.reset_robot_configuration() {
+                log::error!("couldn't erase cached config {:?}", err);
+            }
+        }
+        match self {
+            Self::Cached(cached) => {
+                #[cfg(feature = "data")]
+                if let Some((_, task, _)) = cached.data_tasks {
+                    task.cancel().await;
+                }
+                Self::Uncached(RobotRepresentation::WithRegistry(cached.registry))
+            }
+            uncached => uncached,
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{decode_cached_config, encode_cached_config, ConfigCacheError};
+    use crate::proto::app::v1::{ComponentConfig, ConfigResponse, RobotConfig};
+
+    #[test_log::test]
+    fn test_cached_config() {
+        let config = ConfigResponse {
+            config: Some(RobotConfig {
+                components: vec![ComponentConfig {
+                    name: "m1".to_string(),
+                    model: "rdk:builtin:fake".to_string(),
+                    r#type: "motor".to_string(),
+                    ..Default::default()
+                }],
+                ..Default::default()
+            }),
+        };
+        let mut cached = encode_cached_config(&config);
+        assert_eq!(decode_cached_config(&cached).unwrap(), config);
+
+        let last = cached.len() - 1;
+        cached[last] ^= 1;
+        assert!(matches!(
+            decode_cached_config(&cached),
+            Err(ConfigCacheError::ConfigCacheHashMismatch)
+        ));
+        assert!(matches!(
+            decode_cached_config(&cached[..4]),
+            Err(ConfigCacheError::ConfigCacheHashMismatch)
+        ));
+    }
+}
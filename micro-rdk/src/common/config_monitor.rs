@@ -0,0 +1,144 @@
+//! Applies the configuration changes made in app to the running robot.
+//!
+//! Component changes are reconciled in place (see `LocalRobot::reconcile`), the data manager gets
+//! the collectors of the reconfigured components so the other ones keep capturing. Service changes,
+//! or collectors being added or removed, still restart the robot.
+use std::collections::HashSet;
+use std::net::Ipv4Addr;
+use std::pin::Pin;
+use std::sync::{Arc, Mutex};
+use std::time::Duration;
+
+use chrono::{DateTime, FixedOffset};
+use futures_lite::Future;
+
+use super::app_client::{AppClient, AppClientError, PeriodicAppClientTask};
+use super::log::config_log_entry;
+use super::registry::ComponentRegistry;
+use super::robot::{LocalRobot, RobotError};
+use crate::proto::{app::v1::ConfigResponse, common::v1::ResourceName};
+
+#[cfg(feature = "data")]
+use super::data_manager::CollectorUpdater;
+
+/// Whether the services differ between `old` and `new`, they can't be reconfigured in place
+pub(crate) fn services_changed(old: &ConfigResponse, new: &ConfigResponse) -> bool {
+    let services = |cfg: &ConfigResponse| cfg.config.as_ref().map(|cfg| cfg.services.clone());
+    services(old) != services(new)
+}
+
+pub struct ConfigMonitor<'a> {
+    config: ConfigResponse,
+    robot: Arc<Mutex<LocalRobot>>,
+    registry: Box<ComponentRegistry>,
+    ip: Ipv4Addr,
+    #[cfg(feature = "data")]
+    collector_updater: Option<CollectorUpdater>,
+    // called with every config applied, so it can be cached
+    on_applied: Box<dyn Fn(&ConfigResponse) + 'a>,
+    // last config that failed to apply, so it isn't retried on every poll
+    rejected: Option<ConfigResponse>,
+    restart_hook: Option<Box<dyn FnOnce() + 'a>>,
+}
+
+impl<'a> ConfigMonitor<'a> {
+    pub fn new(
+        config: ConfigResponse,
+        robot: Arc<Mutex<LocalRobot>>,
+        registry: Box<ComponentRegistry>,
+        ip: Ipv4Addr,
+        restart_hook: impl FnOnce() + 'a,
+    ) -> Self {
+        Self {
+            config,
+            robot,
+            registry,
+            ip,
+            #[cfg(feature = "data")]
+            collector_updater: None,
+            on_applied: Box::new(|_| {}),
+            rejected: None,
+            restart_hook: Some(Box::new(restart_hook)),
+        }
+    }
+
+    /// Hands the collectors of reconfigured components to the data manager behind `updater`
+    #[cfg(feature = "data")]
+    pub fn with_collector_updater(mut self, updater: CollectorUpdater) -> Self {
+        self.collector_updater = Some(updater);
+        self
+    }
+
+    pub fn with_on_applied(mut self, on_applied: impl Fn(&ConfigResponse) + 'a) -> Self {
+        self.on_applied = Box::new(on_applied);
+        self
+    }
+
+    fn restart(&mut self) -> ! {
+        log::warn!("config change can't be applied in place - restarting now...");
+        (self.restart_hook.take().unwrap())();
+        unreachable!();
+    }
+
+    fn apply(
+        &mut self,
+        config: &ConfigResponse,
+        build_time: Option<DateTime<FixedOffset>>,
+    ) -> Result<HashSet<ResourceName>, RobotError> {
+        if services_changed(&self.config, config) {
+            self.restart();
+        }
+        let robot = self.robot.clone();
+        let mut robot = robot.lock().unwrap();
+        let changed = robot.reconcile(&self.config, config, self.registry.clone(), build_time)?;
+        #[cfg(feature = "data")]
+        let collectors_updated = match self.collector_updater.as_ref() {
+            Some(updater) if !changed.is_empty() => {
+                matches!(updater.update(&robot, &changed), Ok(true))
+            }
+            _ => true,
+        };
+        drop(robot);
+        #[cfg(feature = "data")]
+        if !collectors_updated {
+            self.restart();
+        }
+        self.config = config.clone();
+        (self.on_applied)(config);
+        Ok(changed)
+    }
+}
+
+impl<'a> PeriodicAppClientTask for ConfigMonitor<'a> {
+    fn name(&self) -> &str {
+        "ConfigMonitor"
+    }
+
+    fn get_default_period(&self) -> Duration {
+        Duration::from_secs(10)
+    }
+
+    fn invoke<'c, 'b: 'c>(
+        &'b mut self,
+        app_client: &'c AppClient,
+    ) -> Pin<Box<dyn Future<Output = Result<Option<Duration>, AppClientError>> + 'c>> {
+        Box::pin(async move {
+            let (config, received_datetime) = app_client.get_config(self.ip).await?;
+            if *config == self.config || self.rejected.as_ref() == Some(&*config) {
+                return Ok(None);
+            }
+            log::info!("config changed, reconfiguring");
+            let err = self.apply(&config, received_datetime).err();
+            if let Some(err) = err.as_ref() {
+                log::error!("couldn't apply config: {:?}", err);
+                self.rejected = Some(*config);
+            }
+            if let Some(datetime) = received_datetime {
+                app_client
+                    .push_logs(vec![config_log_entry(datetime, err)])
+                    .await?;
+            }
+            Ok(None)
+        })
+    }
+}
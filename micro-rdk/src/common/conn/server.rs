@@ -17,6 +17,7 @@ use crate::{
         grpc::{GrpcBody, GrpcServer},
         grpc_client::GrpcClient,
         robot::LocalRobot,
+        telemetry,
         webrtc::{
             api::{WebRtcApi, WebRtcError, WebRtcSdp},
             certificate::Certificate,
@@ -43,7 +44,10 @@ use std::{
     net::Ipv4Addr,
     pin::Pin,
     rc::Rc,
-    sync::{Arc, Mutex},
+    sync::{
+        atomic::{AtomicU32, Ordering},
+        Arc, Mutex,
+    },
     task::Poll,
     time::Duration,
 };
@@ -59,6 +63,40 @@ pub trait TlsClientConnector {
     fn connect(&mut self) -> impl std::future::Future<Output = Result<Self::Stream, ServerError>>;
 }
 
+/// Handshakes completed by a TLS or DTLS implementation since boot
+#[derive(Debug, Default)]
+pub struct HandshakeStats {
+    /// handshakes with a full key exchange
+    pub full: AtomicU32,
+    /// handshakes resuming a previous session
+    pub resumed: AtomicU32,
+    /// handshakes that offered a previous session without the implementation reporting whether the
+    /// peer resumed it, they are counted neither as full nor as resumed
+    pub offered: AtomicU32,
+}
+
+impl HandshakeStats {
+    pub const fn new() -> Self {
+        Self {
+            full: AtomicU32::new(0),
+            resumed: AtomicU32::new(0),
+            offered: AtomicU32::new(0),
+        }
+    }
+    pub fn record(&self, resumed: bool) {
+        let counter = if resumed { &self.resumed } else { &self.full };
+        let _ = counter.fetch_add(1, Ordering::Relaxed);
+    }
+    pub fn record_offered(&self) {
+        let _ = self.offered.fetch_add(1, Ordering::Relaxed);
+    }
+}
+
+/// TLS handshakes with app. On ESP32 esp-tls doesn't report whether app accepted the session ticket
+/// it was offered, so those handshakes are only counted as offered. rustls doesn't report
+/// resumptions so native connections aren't counted.
+pub static TLS_HANDSHAKES: HandshakeStats = HandshakeStats::new();
+
 pub struct RobotCloudConfig {
     local_fqdn: String,
     name: String,
@@ -506,9 +544,9 @@ where
                     Ok(c) => {
                         let robot = robot.clone();
                         let exec = self.exec.clone();
-                        let t = self
-                            .exec
-                            .spawn(async move { Self::serve_http2(c, exec, robot).await });
+                        let t = self.exec.spawn(telemetry::connection(async move {
+                            Self::serve_http2(c, exec, robot).await
+                        }));
                         // Incoming direct HTTP2 connections take top priority.
                         self.incoming_connection_manager
                             .insert_new_conn(t, u32::MAX)
@@ -520,7 +558,9 @@ where
                     Err(e) => Err(e),
                     Ok(_) => {
                         let prio = c.prio;
-                        let t = self.exec.spawn(async move { c.run().await });
+                        let t = self
+                            .exec
+                            .spawn(telemetry::connection(async move { c.run().await }));
                         self.incoming_connection_manager
                             .insert_new_conn(t, prio)
                             .await;
@@ -716,18 +756,45 @@ impl IncomingConnectionTask {
     }
 }
 
+/// Memory needed by a new connection (DTLS, SCTP association and request buffers), a connection
+/// is only added to the active ones when this much memory is free.
+#[cfg(feature = "esp32")]
+pub const CONNECTION_MEMORY_BUDGET: usize = 40 * 1024;
+
+/// Whether there is enough free memory for one more connection
+fn connection_fits_in_memory() -> bool {
+    #[cfg(feature = "esp32")]
+    {
+        use crate::esp32::esp_idf_svc::sys::{heap_caps_get_free_size, MALLOC_CAP_8BIT};
+        unsafe { heap_caps_get_free_size(MALLOC_CAP_8BIT) >= CONNECTION_MEMORY_BUDGET }
+    }
+    #[cfg(not(feature = "esp32"))]
+    true
+}
+
 struct IncomingConnectionManager {
+    // slots are added as connections come in, up to `max_connections`
     connections: Vec<IncomingConnectionTask>,
+    max_connections: usize,
 }
 
 impl IncomingConnectionManager {
     fn new(size: usize) -> Self {
-        let mut connections = Vec::with_capacity(size);
-        connections.resize_with(size, Default::default);
-        Self { connections }
+        Self {
+            connections: Vec::new(),
+            max_connections: size.max(1),
+        }
+    }
+    // whether a new connection can be served without replacing an active one
+    fn has_room(&self) -> bool {
+        self.connections.iter().any(|c| c.is_finished())
+            || (self.connections.len() < self.max_connections && connection_fits_in_memory())
     }
     // return the lowest priority of active webrtc tasks or 0
     fn get_lowest_prio(&self) -> u32 {
+        if self.has_room() {
+            return 0;
+        }
         self.connections
             .iter()
             .min_by(|a, b| a.get_prio().cmp(&b.get_prio()))
@@ -735,6 +802,12 @@ impl IncomingConnectionManager {
     }
     // function will never fail and the lowest priority will always be replaced
     async fn insert_new_conn(&mut self, task: Task<Result<(), ServerError>>, prio: u32) {
+        if !self.connections.iter().any(|c| c.is_finished())
+            && (self.connections.is_empty()
+                || (self.connections.len() < self.max_connections && connection_fits_in_memory()))
+        {
+            self.connections.push(Default::default());
+        }
         if let Some(slot) = self
             .connections
             .iter_mut()
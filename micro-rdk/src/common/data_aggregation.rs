@@ -0,0 +1,336 @@
+//! Aggregation of the readings of a collector over a time window, so a sensor sampled at a high
+//! rate only stores (and uploads) a summary of each window.
+//!
+//! Enabled with the "aggregate" attribute of a capture method, for example
+//! `{"window_ms": 1000, "stats": ["min", "max", "mean", "rms"]}` (every statistic when "stats" is
+//! omitted). Each numeric reading `key` of the window produces the readings `key_min`, `key_max`,
+//! `key_mean` and `key_rms`, other values are ignored.
+use std::collections::HashMap;
+use std::time::{Duration, Instant};
+
+use super::config::{AttributeError, Kind};
+use super::sensor::GenericReadingsResult;
+use crate::google::protobuf::{self, Timestamp};
+use crate::proto::app::data_sync::v1::{SensorData, SensorMetadata};
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum AggregateStat {
+    Min,
+    Max,
+    Mean,
+    Rms,
+}
+
+impl AggregateStat {
+    const ALL: [AggregateStat; 4] = [Self::Min, Self::Max, Self::Mean, Self::Rms];
+
+    fn suffix(&self) -> &'static str {
+        match self {
+            Self::Min => "_min",
+            Self::Max => "_max",
+            Self::Mean => "_mean",
+            Self::Rms => "_rms",
+        }
+    }
+}
+
+impl TryFrom<&Kind> for AggregateStat {
+    type Error = AttributeError;
+    fn try_from(value: &Kind) -> Result<Self, Self::Error> {
+        let stat: String = value.try_into()?;
+        match stat.as_str() {
+            "min" => Ok(Self::Min),
+            "max" => Ok(Self::Max),
+            "mean" => Ok(Self::Mean),
+            "rms" => Ok(Self::Rms),
+            _ => Err(AttributeError::ConversionImpossibleError),
+        }
+    }
+}
+
+#[derive(Debug, Clone)]
+pub struct AggregateConfig {
+    pub window: Duration,
+    pub stats: Vec<AggregateStat>,
+}
+
+impl TryFrom<&Kind> for AggregateConfig {
+    type Error = AttributeError;
+    fn try_from(value: &Kind) -> Result<Self, Self::Error> {
+        let window_ms: f64 = value
+            .get("window_ms")?
+            .ok_or(AttributeError::KeyNotFound("window_ms".to_string()))?
+            .try_into()?;
+        if !window_ms.is_finite() || window_ms < 1.0 {
+            return Err(AttributeError::ConversionImpossibleError);
+        }
+        let stats = match value.get("stats")? {
+            Some(Kind::VecValue(stats)) if !stats.is_empty() => stats
+                .iter()
+                .map(AggregateStat::try_from)
+                .collect::<Result<Vec<_>, _>>()?,
+            Some(_) => return Err(AttributeError::ConversionImpossibleError),
+            None => AggregateStat::ALL.to_vec(),
+        };
+        Ok(Self {
+            window: Duration::from_millis(window_ms as u64),
+            stats,
+        })
+    }
+}
+
+#[derive(Clone, Copy)]
+struct Accumulator {
+    count: u32,
+    min: f64,
+    max: f64,
+    sum: f64,
+    sum_squares: f64,
+}
+
+impl Default for Accumulator {
+    fn default() -> Self {
+        Self {
+            count: 0,
+            min: f64::INFINITY,
+            max: f64::NEG_INFINITY,
+            sum: 0.0,
+            sum_squares: 0.0,
+        }
+    }
+}
+
+impl Accumulator {
+    fn add(&mut self, value: f64) {
+        self.count += 1;
+        self.min = self.min.min(value);
+        self.max = self.max.max(value);
+        self.sum += value;
+        self.sum_squares += value * value;
+    }
+
+    fn value(&self, stat: AggregateStat) -> f64 {
+        match stat {
+            AggregateStat::Min => self.min,
+            AggregateStat::Max => self.max,
+            AggregateStat::Mean => self.sum / self.count as f64,
+            AggregateStat::Rms => (self.sum_squares / self.count as f64).sqrt(),
+        }
+    }
+}
+
+/// Running statistics of the readings of the current window
+pub(crate) struct Aggregator {
+    config: AggregateConfig,
+    // keys are kept from one window to the next so adding a sample doesn't allocate
+    accumulators: Vec<(String, Accumulator)>,
+    window_start: Option<(Instant, Timestamp)>,
+    last_received: Option<Timestamp>,
+}
+
+impl Aggregator {
+    pub(crate) fn new(config: AggregateConfig) -> Self {
+        Self {
+            config,
+            accumulators: vec![],
+            window_start: None,
+            last_received: None,
+        }
+    }
+
+    /// Adds a sample taken at `now`, returns the aggregated readings of the previous window when the
+    /// sample starts a new one
+    pub(crate) fn add(
+        &mut self,
+        readings: &GenericReadingsResult,
+        requested: Timestamp,
+        received: Timestamp,
+        now: Instant,
+    ) -> Option<SensorData> {
+        let aggregated = match self.window_start {
+            Some((start, _)) if now.duration_since(start) >= self.config.window => self.finish(),
+            _ => None,
+        };
+        if self.window_start.is_none() {
+            self.window_start = Some((now, requested));
+        }
+        for (key, value) in readings.iter() {
+            let value = match value.kind {
+                Some(protobuf::value::Kind::NumberValue(value)) => value,
+                _ => continue,
+            };
+            match self.accumulators.iter_mut().find(|(k, _)| k == key) {
+                Some((_, acc)) => acc.add(value),
+                None => {
+                    let mut acc = Accumulator::default();
+                    acc.add(value);
+                    self.accumulators.push((key.clone(), acc));
+                }
+            }
+        }
+        self.last_received = Some(received);
+        aggregated
+    }
+
+    fn finish(&mut self) -> Option<SensorData> {
+        let (_, requested) = self.window_start.take()?;
+        let mut readings =
+            HashMap::with_capacity(self.accumulators.len() * self.config.stats.len());
+        for (key, acc) in self.accumulators.iter_mut() {
+            if acc.count == 0 {
+                continue;
+            }
+            for stat in self.config.stats.iter() {
+                readings.insert(
+                    format!("{}{}", key, stat.suffix()),
+                    protobuf::Value {
+                        kind: Some(protobuf::value::Kind::NumberValue(acc.value(*stat))),
+                    },
+                );
+            }
+            *acc = Accumulator::default();
+        }
+        if readings.is_empty() {
+            return None;
+        }
+        Some(SensorData {
+            metadata: Some(SensorMetadata {
+                time_requested: Some(requested),
+                time_received: self.last_received.take(),
+            }),
+            data: Some(readings.into()),
+        })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::collections::HashMap;
+    use std::time::{Duration, Instant};
+
+    use super::{AggregateConfig, AggregateStat, Aggregator};
+    use crate::common::config::{AttributeError, Kind};
+    use crate::common::sensor::GenericReadingsResult;
+    use crate::google::protobuf::{self, Timestamp};
+    use crate::proto::app::data_sync::v1::sensor_data::Data;
+
+    fn readings(value: f64) -> GenericReadingsResult {
+        HashMap::from([
+            (
+                "thing".to_string(),
+                protobuf::Value {
+                    kind: Some(protobuf::value::Kind::NumberValue(value)),
+                },
+            ),
+            (
+                "name".to_string(),
+                protobuf::Value {
+                    kind: Some(protobuf::value::Kind::StringValue("a".to_string())),
+                },
+            ),
+        ])
+    }
+
+    fn timestamp(seconds: i64) -> Timestamp {
+        Timestamp { seconds, nanos: 0 }
+    }
+
+    #[test_log::test]
+    fn test_aggregate_config() -> Result<(), AttributeError> {
+        let conf = Kind::StructValue(HashMap::from([(
+            "window_ms".to_string(),
+            Kind::NumberValue(1000.0),
+        )]));
+        let conf = AggregateConfig::try_from(&conf)?;
+        assert_eq!(conf.window, Duration::from_secs(1));
+        assert_eq!(conf.stats, AggregateStat::ALL.to_vec());
+
+        let conf = Kind::StructValue(HashMap::from([
+            ("window_ms".to_string(), Kind::NumberValue(500.0)),
+            (
+                "stats".to_string(),
+                Kind::VecValue(vec![Kind::StringValue("rms".to_string())]),
+            ),
+        ]));
+        assert_eq!(
+            AggregateConfig::try_from(&conf)?.stats,
+            vec![AggregateStat::Rms]
+        );
+
+        let conf = Kind::StructValue(HashMap::from([
+            ("window_ms".to_string(), Kind::NumberValue(500.0)),
+            (
+                "stats".to_string(),
+                Kind::VecValue(vec![Kind::StringValue("median".to_string())]),
+            ),
+        ]));
+        assert!(AggregateConfig::try_from(&conf).is_err());
+        let conf = Kind::StructValue(HashMap::from([(
+            "window_ms".to_string(),
+            Kind::NumberValue(0.0),
+        )]));
+        assert!(AggregateConfig::try_from(&conf).is_err());
+        Ok(())
+    }
+
+    #[test_log::test]
+    fn test_aggregator() {
+        let mut aggregator = Aggregator::new(AggregateConfig {
+            window: Duration::from_secs(1),
+            stats: AggregateStat::ALL.to_vec(),
+        });
+        let start = Instant::now();
+        for (i, value) in [3.0, -4.0, 1.0].into_iter().enumerate() {
+            let at = start + Duration::from_millis(300 * i as u64);
+            let aggregated = aggregator.add(
+                &readings(value),
+                timestamp(i as i64),
+                timestamp(i as i64),
+                at,
+            );
+            assert!(aggregated.is_none());
+        }
+
+        let aggregated = aggregator
+            .add(
+                &readings(10.0),
+                timestamp(10),
+                timestamp(10),
+                start + Duration::from_secs(1),
+            )
+            .unwrap();
+        let metadata = aggregated.metadata.unwrap();
+        assert_eq!(metadata.time_requested, Some(timestamp(0)));
+        assert_eq!(metadata.time_received, Some(timestamp(2)));
+        let fields = match aggregated.data {
+            Some(Data::Struct(data)) => match data.fields.get("readings").unwrap().kind.clone() {
+                Some(protobuf::value::Kind::StructValue(readings)) => readings.fields,
+                _ => panic!("readings was not a struct"),
+            },
+            _ => panic!("expected struct data"),
+        };
+        let value = |key: &str| match fields.get(key).unwrap().kind {
+            Some(protobuf::value::Kind::NumberValue(v)) => v,
+            _ => panic!("{} is not a number", key),
+        };
+        assert_eq!(fields.len(), 4);
+        assert_eq!(value("thing_min"), -4.0);
+        assert_eq!(value("thing_max"), 3.0);
+        assert_eq!(value("thing_mean"), 0.0);
+        assert_eq!(value("thing_rms"), (26.0_f64 / 3.0).sqrt());
+
+        // the sample closing the window starts the next one
+        let aggregated = aggregator
+            .add(
+                &readings(0.0),
+                timestamp(20),
+                timestamp(20),
+                start + Duration::from_secs(2),
+            )
+            .unwrap();
+        assert_eq!(
+            aggregated.metadata.unwrap().time_requested,
+            Some(timestamp(10))
+        );
+    }
+}
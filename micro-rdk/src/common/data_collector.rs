@@ -1,17 +1,19 @@
 use std::fmt::Display;
-use std::time::Duration;
+use std::time::{Duration, Instant};
 
 use crate::google::protobuf::Timestamp;
 use crate::proto::app::data_sync::v1::{SensorData, SensorMetadata};
 
 use super::{
     config::{AttributeError, Kind},
+    data_aggregation::{AggregateConfig, Aggregator},
     movement_sensor::MovementSensor,
     robot::ResourceType,
     sensor::{Readings, SensorError},
 };
 
 use chrono::offset::Local;
+use futures_lite::future;
 use thiserror::Error;
 
 /// A DataCollectorConfig instance is a representation of an element
@@ -23,6 +25,12 @@ use thiserror::Error;
 pub struct DataCollectorConfig {
     pub method: CollectionMethod,
     pub capture_frequency_hz: f32,
+    /// relative share of the data store given to the collector, defaults to 1.0
+    pub buffer_weight: f32,
+    /// name of the bus the resource is on, collectors sharing a bus never run concurrently
+    pub bus: Option<String>,
+    /// when set, readings are aggregated over a window and one summary is stored per window
+    pub aggregate: Option<AggregateConfig>,
 }
 
 impl TryFrom<&Kind> for DataCollectorConfig {
@@ -38,6 +46,24 @@ impl TryFrom<&Kind> for DataCollectorConfig {
                 "capture_frequency_hz".to_string(),
             ))?
             .try_into()?;
+        let buffer_weight = match value.get("buffer_weight")? {
+            Some(weight) => {
+                let weight: f32 = weight.try_into()?;
+                if !weight.is_finite() || weight <= 0.0 {
+                    return Err(AttributeError::ConversionImpossibleError);
+                }
+                weight
+            }
+            None => 1.0,
+        };
+        let bus = match value.get("bus")? {
+            Some(bus) => Some(bus.try_into()?),
+            None => None,
+        };
+        let aggregate = match value.get("aggregate")? {
+            Some(aggregate) => Some(aggregate.try_into()?),
+            None => None,
+        };
         // TODO: RSDK-7127 - Collectors that take arguments (ex. Board Analogs)
         let method = match method_str.as_str() {
             "Readings" => CollectionMethod::Readings,
@@ -51,6 +77,9 @@ impl TryFrom<&Kind> for DataCollectorConfig {
         Ok(DataCollectorConfig {
             method,
             capture_frequency_hz,
+            buffer_weight,
+            bus,
+            aggregate,
         })
     }
 }
@@ -108,6 +137,8 @@ pub enum DataCollectionError {
     NoSupportedMethods,
     #[error("capture frequency cannot be 0.0")]
     UnsupportedCaptureFrequency,
+    #[error("method {0} can't be aggregated")]
+    UnsupportedAggregation(CollectionMethod),
     #[error(transparent)]
     SensorCollectionError(#[from] SensorError),
 }
@@ -121,6 +152,18 @@ pub struct DataCollector {
     resource: ResourceType,
     method: CollectionMethod,
     time_interval: Duration,
+    buffer_weight: f32,
+    bus: Option<String>,
+    error_count: u32,
+    aggregator: Option<Aggregator>,
+}
+
+fn now_timestamp() -> Timestamp {
+    let now = Local::now().fixed_offset();
+    Timestamp {
+        seconds: now.timestamp(),
+        nanos: now.timestamp_subsec_nanos() as i32,
+    }
 }
 
 fn resource_method_pair_is_valid(resource: &ResourceType, method: &CollectionMethod) -> bool {
@@ -162,6 +205,10 @@ impl DataCollector {
             resource,
             method,
             time_interval,
+            buffer_weight: 1.0,
+            bus: None,
+            error_count: 0,
+            aggregator: None,
         })
     }
 
@@ -170,12 +217,23 @@ impl DataCollector {
         resource: ResourceType,
         conf: &DataCollectorConfig,
     ) -> Result<Self, DataCollectionError> {
-        Self::new(
+        let mut collector = Self::new(
             name,
             resource,
             conf.method.clone(),
             conf.capture_frequency_hz,
-        )
+        )?;
+        collector.buffer_weight = conf.buffer_weight;
+        collector.bus = conf.bus.clone();
+        if let Some(aggregate) = conf.aggregate.as_ref() {
+            if collector.method != CollectionMethod::Readings {
+                return Err(DataCollectionError::UnsupportedAggregation(
+                    collector.method,
+                ));
+            }
+            collector.aggregator = Some(Aggregator::new(aggregate.clone()));
+        }
+        Ok(collector)
     }
 
     pub fn name(&self) -> String {
@@ -190,6 +248,19 @@ impl DataCollector {
         self.time_interval
     }
 
+    pub fn buffer_weight(&self) -> f32 {
+        self.buffer_weight
+    }
+
+    pub fn bus(&self) -> Option<&str> {
+        self.bus.as_deref()
+    }
+
+    /// number of collections that failed since the collector was created
+    pub fn error_count(&self) -> u32 {
+        self.error_count
+    }
+
     pub fn method_str(&self) -> String {
         self.method.to_string()
     }
@@ -245,6 +316,61 @@ impl DataCollector {
         })
     }
 
+    /// calls the method associated with the collector and returns all the resulting data, sensors
+    /// buffering several samples between collections will produce one SensorData per sample
+    pub(crate) fn call_method_batch(&mut self) -> Result<Vec<SensorData>, DataCollectionError> {
+        if let (ResourceType::Sensor(res), CollectionMethod::Readings) =
+            (&mut self.resource, &self.method)
+        {
+            return Ok(res.get_readings_data_batch()?);
+        }
+        Ok(vec![self.call_method()?])
+    }
+
+    /// like `call_method_batch` but sensors implementing `poll_readings_data_batch` yield while
+    /// waiting on their hardware, failures are counted by the collector. Aggregating collectors only
+    /// return data when a window is over.
+    pub(crate) async fn collect(&mut self) -> Result<Vec<SensorData>, DataCollectionError> {
+        let res = if self.aggregator.is_some() {
+            self.collect_aggregated()
+                .await
+                .map(|data| data.into_iter().collect())
+        } else {
+            match (&mut self.resource, &self.method) {
+                (ResourceType::Sensor(res), CollectionMethod::Readings) => {
+                    future::poll_fn(|cx| res.poll_readings_data_batch(cx))
+                        .await
+                        .map_err(DataCollectionError::from)
+                }
+                _ => self.call_method_batch(),
+            }
+        };
+        if res.is_err() {
+            self.error_count = self.error_count.saturating_add(1);
+        }
+        res
+    }
+
+    async fn collect_aggregated(&mut self) -> Result<Option<SensorData>, DataCollectionError> {
+        let requested = now_timestamp();
+        let readings = match &mut self.resource {
+            ResourceType::Sensor(res) => {
+                future::poll_fn(|cx| res.poll_generic_readings(cx)).await?
+            }
+            ResourceType::MovementSensor(res) => res.get_generic_readings()?,
+            _ => return Err(DataCollectionError::NoSupportedMethods),
+        };
+        let received = now_timestamp();
+        let data = self
+            .aggregator
+            .as_mut()
+            .and_then(|aggregator| aggregator.add(&readings, requested, received, Instant::now()));
+        if let ResourceType::Sensor(res) = &mut self.resource {
+            res.recycle_generic_readings(readings);
+        }
+        Ok(data)
+    }
+
     pub fn resource_method_key(&self) -> ResourceMethodKey {
         ResourceMethodKey {
             r_name: self.name(),
@@ -280,6 +406,38 @@ mod tests {
         let conf: DataCollectorConfig = (&conf_kind).try_into()?;
         assert!(matches!(conf.method, CollectionMethod::Readings));
         assert_eq!(conf.capture_frequency_hz, 100.0);
+        assert_eq!(conf.buffer_weight, 1.0);
+        assert_eq!(conf.bus, None);
+        assert!(conf.aggregate.is_none());
+
+        let kind_map = HashMap::from([
+            (
+                "method".to_string(),
+                Kind::StringValue("Readings".to_string()),
+            ),
+            ("capture_frequency_hz".to_string(), Kind::NumberValue(100.0)),
+            ("buffer_weight".to_string(), Kind::NumberValue(3.0)),
+            ("bus".to_string(), Kind::StringValue("i2c0".to_string())),
+        ]);
+        let conf_kind = Kind::StructValue(kind_map);
+        let conf: DataCollectorConfig = (&conf_kind).try_into()?;
+        assert_eq!(conf.buffer_weight, 3.0);
+        assert_eq!(conf.bus.as_deref(), Some("i2c0"));
+
+        let kind_map = HashMap::from([
+            (
+                "method".to_string(),
+                Kind::StringValue("Readings".to_string()),
+            ),
+            ("capture_frequency_hz".to_string(), Kind::NumberValue(100.0)),
+            ("buffer_weight".to_string(), Kind::NumberValue(0.0)),
+        ]);
+        let conf_kind = Kind::StructValue(kind_map);
+        let conf: Result<DataCollectorConfig, AttributeError> = (&conf_kind).try_into();
+        assert!(matches!(
+            conf,
+            Err(AttributeError::ConversionImpossibleError)
+        ));
 
         let kind_map = HashMap::from([
             (
@@ -1,25 +1,34 @@
+use std::cell::RefCell;
+use std::collections::{HashSet, VecDeque};
 use std::pin::Pin;
 use std::rc::Rc;
+use std::sync::atomic::{AtomicU32, Ordering};
 use std::sync::{Arc, Mutex};
-use std::time::Duration;
+use std::time::{Duration, Instant};
 
 use crate::common::data_collector::{DataCollectionError, DataCollector};
 use crate::common::data_store::DataStore;
 use crate::google::protobuf::value::Kind;
-use crate::proto::app::data_sync::v1::{
-    DataCaptureUploadRequest, DataType, SensorData, UploadMetadata,
-};
+use crate::proto::app::data_sync::v1::{DataType, SensorData, UploadMetadata};
 use crate::proto::app::v1::ConfigResponse;
+use crate::proto::common::v1::ResourceName;
 
 use super::app_client::{AppClient, AppClientConfig, AppClientError, PeriodicAppClientTask};
 use super::data_collector::ResourceMethodKey;
-use super::data_store::{DataStoreError, DataStoreReader, WriteMode};
+use super::data_store::{DataStoreError, DataStoreReader, ReadPosition, WriteMode};
 use super::robot::{LocalRobot, RobotError};
+use super::telemetry::{self, DataManagerCounters, DataStoreFill};
 use async_io::Timer;
-use bytes::BytesMut;
+use bytes::{BufMut, Bytes, BytesMut};
 use futures_lite::prelude::Future;
+use futures_lite::StreamExt;
+use futures_util::future::join_all;
 use futures_util::lock::Mutex as AsyncMutex;
-use prost::Message;
+use futures_util::stream::FuturesUnordered;
+use prost::encoding::{
+    decode_key, decode_varint, encode_key, encode_varint, encoded_len_varint, key_len, message,
+    WireType,
+};
 use thiserror::Error;
 
 // Maximum size in bytes of readings that should be sent in a single request
@@ -27,6 +36,14 @@ use thiserror::Error;
 // the smaller amount of available RAM, we've halved it
 static MAX_SENSOR_CONTENTS_SIZE: usize = 32000;
 
+// Upload requests in flight when the data manager config doesn't set "max_outstanding_uploads".
+// Every request in flight holds its encoded body, up to MAX_SENSOR_CONTENTS_SIZE bytes of readings,
+// until app answers, so the ESP32 only keeps one while native targets afford ~128KB
+#[cfg(feature = "esp32")]
+const DEFAULT_MAX_OUTSTANDING_UPLOADS: usize = 1;
+#[cfg(not(feature = "esp32"))]
+const DEFAULT_MAX_OUTSTANDING_UPLOADS: usize = 4;
+
 #[derive(Debug, Error)]
 pub enum DataManagerError {
     #[error("no data collectors in manager")]
@@ -80,14 +97,125 @@ fn get_data_sync_interval(cfg: &ConfigResponse) -> Result<Option<Duration>, Data
     )
 }
 
+fn get_max_outstanding_uploads(cfg: &ConfigResponse) -> usize {
+    cfg.config
+        .as_ref()
+        .and_then(|robot_config| {
+            robot_config
+                .services
+                .iter()
+                .find(|svc_cfg| svc_cfg.r#type == *"data_manager")
+        })
+        .and_then(|data_cfg| data_cfg.attributes.as_ref())
+        .and_then(|attrs| attrs.fields.get("max_outstanding_uploads"))
+        .and_then(|value| match value.kind {
+            Some(Kind::NumberValue(n)) if n >= 1.0 => Some(n as usize),
+            _ => None,
+        })
+        .unwrap_or(DEFAULT_MAX_OUTSTANDING_UPLOADS)
+}
+
+/// Metrics of the upload of collected data, counters wrap around
+#[derive(Debug, Default)]
+pub struct DataSyncStats {
+    /// bytes of readings acknowledged by app
+    pub uploaded_bytes: AtomicU32,
+    pub uploaded_messages: AtomicU32,
+    pub failed_uploads: AtomicU32,
+    /// bytes of readings sent and waiting for an acknowledgement
+    pub in_flight_bytes: AtomicU32,
+    /// bytes left in the store at the end of the last sync, when the store can tell
+    pub backlog_bytes: AtomicU32,
+    /// bytes per second acknowledged during the last sync
+    pub last_sync_throughput: AtomicU32,
+}
+
+/// Hands the collectors of reconfigured resources to a running data manager, so the other
+/// collectors keep capturing across a config change
+#[derive(Clone)]
+pub struct CollectorUpdater {
+    // keys and weights the store was sized for
+    keys: Rc<Vec<(ResourceMethodKey, f32)>>,
+    // names of the reconfigured resources and their new collectors
+    pending: Rc<RefCell<Option<(Vec<String>, Vec<DataCollector>)>>>,
+}
+
+impl CollectorUpdater {
+    fn new(collectors: &[DataCollector]) -> Self {
+        Self {
+            keys: Rc::new(
+                collectors
+                    .iter()
+                    .map(|c| (c.resource_method_key(), c.buffer_weight()))
+                    .collect(),
+            ),
+            pending: Rc::default(),
+        }
+    }
+
+    /// Replaces the collectors of the `changed` resources with the ones `robot` has for them,
+    /// before the next collection. Returns false when the collectors don't write to the keys the
+    /// store was sized for, the data manager has to be rebuilt then.
+    pub fn update(
+        &self,
+        robot: &LocalRobot,
+        changed: &HashSet<ResourceName>,
+    ) -> Result<bool, DataManagerError> {
+        let names: Vec<String> = changed.iter().map(|name| name.name.clone()).collect();
+        let collectors: Vec<DataCollector> = robot
+            .data_collectors()?
+            .into_iter()
+            .filter(|c| names.contains(&c.name()))
+            .collect();
+        Ok(self.replace(names, collectors))
+    }
+
+    fn replace(&self, names: Vec<String>, collectors: Vec<DataCollector>) -> bool {
+        let kept = self
+            .keys
+            .iter()
+            .filter(|(key, _)| !names.contains(&key.r_name));
+        let new_keys: Vec<(ResourceMethodKey, f32)> = kept
+            .cloned()
+            .chain(
+                collectors
+                    .iter()
+                    .map(|c| (c.resource_method_key(), c.buffer_weight())),
+            )
+            .collect();
+        if new_keys.len() != self.keys.len() || new_keys.iter().any(|k| !self.keys.contains(k)) {
+            return false;
+        }
+        let _ = self.pending.borrow_mut().insert((names, collectors));
+        true
+    }
+}
+
 pub struct DataManager<StoreType> {
     collectors: Vec<DataCollector>,
+    updater: CollectorUpdater,
     store: Rc<AsyncMutex<StoreType>>,
     sync_interval: Duration,
     min_interval: Duration,
+    // distinct collection intervals in ms, each a multiple of min_interval
+    intervals: Vec<u64>,
+    missed_deadlines: Arc<AtomicU32>,
+    collection_errors: Arc<AtomicU32>,
+    max_outstanding_uploads: usize,
+    sync_stats: Arc<DataSyncStats>,
     part_id: String,
 }
 
+fn collection_intervals(collectors: &[DataCollector], min_interval_ms: u64) -> Vec<u64> {
+    let mut intervals: Vec<u64> = collectors
+        .iter()
+        .map(|x| (x.time_interval().as_millis() as u64 / min_interval_ms) * min_interval_ms)
+        .collect();
+    intervals.sort();
+    intervals.dedup();
+    intervals
+}
+
 impl<StoreType> DataManager<StoreType>
 where
     StoreType: DataStore,
@@ -100,11 +228,18 @@ where
     ) -> Result<Self, DataManagerError> {
         let intervals = collectors.iter().map(|x| x.time_interval());
         let min_interval = intervals.min().ok_or(DataManagerError::NoCollectors)?;
+        let intervals = collection_intervals(&collectors, min_interval.as_millis() as u64);
         Ok(Self {
+            updater: CollectorUpdater::new(&collectors),
             collectors,
             store: Rc::new(AsyncMutex::new(store)),
             sync_interval,
             min_interval,
+            intervals,
+            missed_deadlines: Arc::new(AtomicU32::new(0)),
+            collection_errors: Arc::new(AtomicU32::new(0)),
+            max_outstanding_uploads: DEFAULT_MAX_OUTSTANDING_UPLOADS,
+            sync_stats: Arc::default(),
             part_id,
         })
     }
@@ -118,16 +253,26 @@ where
         let sync_interval = get_data_sync_interval(cfg)?;
         if let Some(sync_interval) = sync_interval {
             let collectors = robot.lock().unwrap().data_collectors()?;
-            let collector_keys: Vec<ResourceMethodKey> =
-                collectors.iter().map(|c| c.resource_method_key()).collect();
-            let store = StoreType::from_resource_method_keys(collector_keys)?;
-            let data_manager_svc = DataManager::new(collectors, store, sync_interval, part_id)?;
+            let weighted_keys: Vec<(ResourceMethodKey, f32)> = collectors
+                .iter()
+                .map(|c| (c.resource_method_key(), c.buffer_weight()))
+                .collect();
+            let store = StoreType::from_weighted_resource_method_keys(weighted_keys)?;
+            let data_manager_svc = DataManager::new(collectors, store, sync_interval, part_id)?
+                .with_max_outstanding_uploads(get_max_outstanding_uploads(cfg));
             Ok(Some(data_manager_svc))
         } else {
             Ok(None)
         }
     }
 
+    /// Sets how many upload requests the sync task keeps in flight, 1 waits for each upload to be
+    /// acknowledged before reading the next chunk
+    pub fn with_max_outstanding_uploads(mut self, max_outstanding_uploads: usize) -> Self {
+        self.max_outstanding_uploads = max_outstanding_uploads.max(1);
+        self
+    }
+
     pub fn sync_interval_ms(&self) -> u64 {
         self.sync_interval.as_millis() as u64
     }
@@ -140,32 +285,83 @@ where
         self.part_id.clone()
     }
 
-    pub(crate) fn collection_intervals(&self) -> Vec<u64> {
-        let mut intervals: Vec<u64> = self
+    pub(crate) fn collection_intervals(&self) -> &[u64] {
+        &self.intervals
+    }
+
+    /// Counts the collection ticks skipped because collecting took longer than the minimum interval
+    pub fn missed_deadlines(&self) -> Arc<AtomicU32> {
+        self.missed_deadlines.clone()
+    }
+
+    /// Counts the collections that failed, the readings of the other collectors are still stored
+    pub fn collection_errors(&self) -> Arc<AtomicU32> {
+        self.collection_errors.clone()
+    }
+
+    pub fn sync_stats(&self) -> Arc<DataSyncStats> {
+        self.sync_stats.clone()
+    }
+
+    pub fn collector_updater(&self) -> CollectorUpdater {
+        self.updater.clone()
+    }
+
+    // swaps in the collectors handed to the updater, returns whether there were any
+    fn apply_collector_update(&mut self) -> bool {
+        let Some((names, collectors)) = self.updater.pending.borrow_mut().take() else {
+            return false;
+        };
+        self.collectors.retain(|c| !names.contains(&c.name()));
+        self.collectors.extend(collectors);
+        // the keys are unchanged so there is at least one collector
+        self.min_interval = self
             .collectors
             .iter()
-            .map(|x| {
-                (x.time_interval().as_millis() as u64 / self.min_interval_ms())
-                    * self.min_interval_ms()
-            })
-            .collect();
-        intervals.sort();
-        intervals.dedup();
-        intervals
+            .map(|c| c.time_interval())
+            .min()
+            .unwrap_or(self.min_interval);
+        self.intervals =
+            collection_intervals(&self.collectors, self.min_interval.as_millis() as u64);
+        true
     }
 
+    /// Collects every `min_interval`, ticks are scheduled at absolute deadlines from the start of the
+    /// task so the time spent collecting doesn't add up. When collecting overruns, the ticks that
+    /// passed are skipped (and counted as missed) to keep the following ones on schedule.
     pub async fn data_collection_task(&mut self) -> Result<(), DataManagerError> {
+        let mut start = Instant::now();
+        let mut period_ns = self.min_interval.as_nanos();
         let mut loop_counter: u64 = 0;
         loop {
             self.collect_data_inner(loop_counter).await?;
             loop_counter += 1;
-            Timer::after(self.min_interval).await;
+            if self.apply_collector_update() {
+                // the schedule of the new collectors starts at the next tick
+                start += Duration::from_nanos((period_ns * loop_counter as u128) as u64);
+                period_ns = self.min_interval.as_nanos();
+                loop_counter = 0;
+                Timer::at(start).await;
+                continue;
+            }
+            let elapsed_ns = start.elapsed().as_nanos();
+            let due = (elapsed_ns / period_ns) as u64 + 1;
+            if due > loop_counter {
+                let missed = due - loop_counter;
+                log::debug!("data collection overran, skipping {} ticks", missed);
+                self.missed_deadlines
+                    .fetch_add(missed as u32, Ordering::Relaxed);
+                loop_counter = due;
+            }
+            Timer::at(start + Duration::from_nanos((period_ns * loop_counter as u128) as u64))
+                .await;
         }
     }
 
     pub async fn collect_data_inner(&mut self, loop_counter: u64) -> Result<(), DataManagerError> {
         let min_interval_ms = self.min_interval_ms();
-        for interval in self.collection_intervals() {
+        for i in 0..self.intervals.len() {
+            let interval = self.intervals[i];
             if loop_counter % (interval / min_interval_ms) == 0 {
                 self.collect_and_store_readings(interval).await?;
             }
@@ -177,18 +373,21 @@ where
         &mut self,
         time_interval_ms: u64,
     ) -> Result<(), DataManagerError> {
-        let readings = self.collect_readings_for_interval(time_interval_ms)?;
+        let readings = self.collect_readings_for_interval(time_interval_ms).await?;
         let mut store_guard = self.store.lock().await;
         for (collector_key, reading) in readings {
             store_guard.write_message(&collector_key, reading, WriteMode::OverwriteOldest)?;
+            record_store_fill(&*store_guard, &collector_key);
         }
         Ok(())
     }
 
     // Here, time_interval_ms is required to be a multiple of the minimum time_interval among the collectors.
     // This function then collects readings from collectors whose time_interval is greater than time_interval_ms but
-    // less than the next largest multiple of self.min_interval_ms
-    fn collect_readings_for_interval(
+    // less than the next largest multiple of self.min_interval_ms. Collectors on the same bus run one after the
+    // other while different buses (and collectors without a bus) run concurrently. A failing collector is logged
+    // and counted, readings are returned in the order of the collectors.
+    async fn collect_readings_for_interval(
         &mut self,
         time_interval_ms: u64,
     ) -> Result<Vec<(ResourceMethodKey, SensorData)>, DataManagerError> {
@@ -199,14 +398,44 @@ where
                 min_interval_ms,
             ));
         }
-        self.collectors
-            .iter_mut()
-            .filter(|coll| {
-                (coll.time_interval().as_millis() as u64 / min_interval_ms)
-                    == (time_interval_ms / min_interval_ms)
-            })
-            .map(|coll| Ok((coll.resource_method_key(), coll.call_method()?)))
-            .collect()
+        let mut groups: Vec<(Option<String>, Vec<(usize, &mut DataCollector)>)> = vec![];
+        for (idx, coll) in self.collectors.iter_mut().enumerate().filter(|(_, coll)| {
+            (coll.time_interval().as_millis() as u64 / min_interval_ms)
+                == (time_interval_ms / min_interval_ms)
+        }) {
+            let bus = coll.bus().map(str::to_owned);
+            match groups
+                .iter_mut()
+                .find(|(group_bus, _)| bus.is_some() && *group_bus == bus)
+            {
+                Some((_, group)) => group.push((idx, coll)),
+                None => groups.push((bus, vec![(idx, coll)])),
+            }
+        }
+        let mut results: Vec<_> = join_all(groups.into_iter().map(|(_, group)| async move {
+            let mut results = Vec::with_capacity(group.len());
+            for (idx, coll) in group {
+                results.push((idx, coll.resource_method_key(), coll.collect().await));
+            }
+            results
+        }))
+        .await
+        .into_iter()
+        .flatten()
+        .collect();
+        results.sort_unstable_by_key(|(idx, _, _)| *idx);
+
+        let mut readings = vec![];
+        for (_, collector_key, result) in results {
+            match result {
+                Ok(data) => readings.extend(data.into_iter().map(|d| (collector_key.clone(), d))),
+                Err(err) => {
+                    log::warn!("error collecting data for {}: {}", collector_key, err);
+                    self.collection_errors.fetch_add(1, Ordering::Relaxed);
+                }
+            }
+        }
+        Ok(readings)
     }
 
     pub fn get_sync_task(&self) -> DataSyncTask<StoreType> {
@@ -219,11 +448,49 @@ where
             store: self.store.clone(),
             resource_method_keys,
             sync_interval: self.sync_interval,
+            max_outstanding_uploads: self.max_outstanding_uploads,
+            stats: self.sync_stats.clone(),
             part_id: self.part_id(),
         }
     }
 }
 
+/// The sync task and the collection future of a data manager, with the type of its store erased so
+/// the store can be picked at runtime, and the updater of its collectors
+pub type DataManagerTasks = (
+    Box<dyn PeriodicAppClientTask>,
+    Pin<Box<dyn Future<Output = ()>>>,
+    CollectorUpdater,
+);
+
+impl<StoreType> DataManager<StoreType>
+where
+    StoreType: DataStore + 'static,
+{
+    /// Also reports the counters of the data manager and the fill of its store in the telemetry
+    pub fn into_tasks(mut self) -> DataManagerTasks {
+        telemetry::register_data_manager(DataManagerCounters {
+            missed_deadlines: self.missed_deadlines(),
+            collection_errors: self.collection_errors(),
+            sync_stats: self.sync_stats(),
+        });
+        let sync_task = Box::new(self.get_sync_task());
+        // a store persisted in flash may already hold data, nothing else uses it yet
+        if let Some(store) = self.store.try_lock() {
+            for collector_key in &sync_task.resource_method_keys {
+                record_store_fill(&*store, collector_key);
+            }
+        }
+        let updater = self.collector_updater();
+        let collection_future = Box::pin(async move {
+            if let Err(err) = self.data_collection_task().await {
+                log::error!("error running data manager: {:?}", err)
+            }
+        });
+        (sync_task, collection_future, updater)
+    }
+}
+
 #[derive(Debug, Error)]
 pub enum DataSyncError {
     #[error(transparent)]
@@ -236,9 +503,213 @@ pub struct DataSyncTask<StoreType> {
     store: Rc<AsyncMutex<StoreType>>,
     resource_method_keys: Vec<ResourceMethodKey>,
     sync_interval: Duration,
+    max_outstanding_uploads: usize,
+    stats: Arc<DataSyncStats>,
     part_id: String,
 }
 
+// Readings of one collector read from the store, up to `end`
+struct UploadChunk {
+    end: ReadPosition,
+    // encoded SensorData messages
+    data: Vec<BytesMut>,
+    bytes: usize,
+    // no message was left after the chunk
+    last: bool,
+}
+
+struct UploadCompletion {
+    key_index: usize,
+    end: ReadPosition,
+    bytes: usize,
+    messages: usize,
+    result: Result<(), AppClientError>,
+}
+
+/// Encodes a DataCaptureUploadRequest, with its gRPC message prefix, from SensorData messages
+/// encoded as they are read from the store, so they aren't decoded only to be encoded again
+fn encode_upload_request(metadata: &UploadMetadata, sensor_contents: &[BytesMut]) -> Bytes {
+    // fields of DataCaptureUploadRequest
+    const METADATA: u32 = 1;
+    const SENSOR_CONTENTS: u32 = 2;
+    let len = message::encoded_len(METADATA, metadata)
+        + sensor_contents
+            .iter()
+            .map(|data| {
+                key_len(SENSOR_CONTENTS) + encoded_len_varint(data.len() as u64) + data.len()
+            })
+            .sum::<usize>();
+    let mut buf = BytesMut::with_capacity(5 + len);
+    buf.put_u8(0);
+    buf.put_u32(len as u32);
+    message::encode(METADATA, metadata, &mut buf);
+    for data in sensor_contents {
+        encode_key(SENSOR_CONTENTS, WireType::LengthDelimited, &mut buf);
+        encode_varint(data.len() as u64, &mut buf);
+        buf.put_slice(data);
+    }
+    buf.freeze()
+}
+
+// Reports how much of its share of `store` the collector uses, for stores that can tell
+fn record_store_fill<StoreType: DataStore>(store: &StoreType, collector_key: &ResourceMethodKey) {
+    if let (Some(stored), Some(capacity)) = (
+        store.stored_len(collector_key),
+        store.capacity(collector_key),
+    ) {
+        telemetry::record_data_store_fill(collector_key, DataStoreFill { stored, capacity });
+    }
+}
+
+// Nesting of the readings deeper than prost's recursion limit doesn't decode
+const MAX_READINGS_DEPTH: u32 = 100;
+
+// Whether `msg` is a SensorData message app can decode, nested readings included. A message app
+// would reject would otherwise be uploaded again by every sync since it is only flushed once
+// acknowledged. Only the tags and lengths of the fields are checked, nothing is decoded or
+// allocated: the stored bytes are what gets uploaded
+fn is_well_formed(msg: &[u8]) -> bool {
+    walk_fields(msg, |tag, wire_type, buf| match tag {
+        1 => check_metadata(length_delimited(wire_type, buf)?),
+        // struct
+        2 => check_struct(length_delimited(wire_type, buf)?, 0),
+        // binary
+        3 => length_delimited(wire_type, buf).map(drop),
+        _ => skip_value(wire_type, buf),
+    })
+    .is_some()
+}
+
+// Calls `field` with the tag and wire type of every field of the message `buf`, it has to advance
+// `buf` past the value of the field
+fn walk_fields(
+    mut buf: &[u8],
+    mut field: impl FnMut(u32, WireType, &mut &[u8]) -> Option<()>,
+) -> Option<()> {
+    while !buf.is_empty() {
+        let (tag, wire_type) = decode_key(&mut buf).ok()?;
+        field(tag, wire_type, &mut buf)?;
+    }
+    Some(())
+}
+
+// Moves `buf` past a length delimited value and returns it
+fn length_delimited<'a>(wire_type: WireType, buf: &mut &'a [u8]) -> Option<&'a [u8]> {
+    if wire_type != WireType::LengthDelimited {
+        return None;
+    }
+    let len = usize::try_from(decode_varint(buf).ok()?).ok()?;
+    if len > buf.len() {
+        return None;
+    }
+    let (value, rest) = buf.split_at(len);
+    *buf = rest;
+    Some(value)
+}
+
+// Moves `buf` past a value of `wire_type`, groups are never used by the messages stored
+fn skip_value(wire_type: WireType, buf: &mut &[u8]) -> Option<()> {
+    let len = match wire_type {
+        WireType::Varint => return decode_varint(buf).ok().map(drop),
+        WireType::LengthDelimited => return length_delimited(wire_type, buf).map(drop),
+        WireType::SixtyFourBit => 8,
+        WireType::ThirtyTwoBit => 4,
+        WireType::StartGroup | WireType::EndGroup => return None,
+    };
+    *buf = buf.get(len..)?;
+    Some(())
+}
+
+// Moves `buf` past a value that has to be of `expected` wire type
+fn check_scalar(wire_type: WireType, expected: WireType, buf: &mut &[u8]) -> Option<()> {
+    if wire_type != expected {
+        return None;
+    }
+    skip_value(wire_type, buf)
+}
+
+fn check_string(wire_type: WireType, buf: &mut &[u8]) -> Option<()> {
+    std::str::from_utf8(length_delimited(wire_type, buf)?)
+        .ok()
+        .map(drop)
+}
+
+// SensorMetadata, the timestamps the readings were requested and received at
+fn check_metadata(buf: &[u8]) -> Option<()> {
+    walk_fields(buf, |tag, wire_type, buf| match tag {
+        1 | 2 => check_timestamp(length_delimited(wire_type, buf)?),
+        _ => skip_value(wire_type, buf),
+    })
+}
+
+fn check_timestamp(buf: &[u8]) -> Option<()> {
+    walk_fields(buf, |tag, wire_type, buf| match tag {
+        // seconds and nanos
+        1 | 2 => check_scalar(wire_type, WireType::Varint, buf),
+        _ => skip_value(wire_type, buf),
+    })
+}
+
+// google.protobuf.Struct, its fields are map entries
+fn check_struct(buf: &[u8], depth: u32) -> Option<()> {
+    walk_fields(buf, |tag, wire_type, buf| match tag {
+        1 => check_struct_entry(length_delimited(wire_type, buf)?, depth),
+        _ => skip_value(wire_type, buf),
+    })
+}
+
+fn check_struct_entry(buf: &[u8], depth: u32) -> Option<()> {
+    walk_fields(buf, |tag, wire_type, buf| match tag {
+        1 => check_string(wire_type, buf),
+        2 => check_value(length_delimited(wire_type, buf)?, depth + 1),
+        _ => skip_value(wire_type, buf),
+    })
+}
+
+// google.protobuf.Value
+fn check_value(buf: &[u8], depth: u32) -> Option<()> {
+    if depth > MAX_READINGS_DEPTH {
+        return None;
+    }
+    walk_fields(buf, |tag, wire_type, buf| match tag {
+        // null and bool
+        1 | 4 => check_scalar(wire_type, WireType::Varint, buf),
+        // number
+        2 => check_scalar(wire_type, WireType::SixtyFourBit, buf),
+        3 => check_string(wire_type, buf),
+        5 => check_struct(length_delimited(wire_type, buf)?, depth),
+        6 => check_list(length_delimited(wire_type, buf)?, depth),
+        _ => skip_value(wire_type, buf),
+    })
+}
+
+// google.protobuf.ListValue, its values are repeated
+fn check_list(buf: &[u8], depth: u32) -> Option<()> {
+    walk_fields(buf, |tag, wire_type, buf| match tag {
+        1 => check_value(length_delimited(wire_type, buf)?, depth + 1),
+        _ => skip_value(wire_type, buf),
+    })
+}
+
+async fn upload_chunk<F>(
+    upload: F,
+    key_index: usize,
+    end: ReadPosition,
+    bytes: usize,
+    messages: usize,
+) -> UploadCompletion
+where
+    F: Future<Output = Result<(), AppClientError>>,
+{
+    UploadCompletion {
+        key_index,
+        end,
+        bytes,
+        messages,
+        result: upload.await,
+    }
+}
+
 impl<StoreType> DataSyncTask<StoreType>
 where
     StoreType: DataStore,
@@ -248,154 +719,255 @@ where
         self.store.lock().await
     }
 
-    async fn run<'b>(&mut self, app_client: &'b AppClient) -> Result<(), AppClientError> {
-        for collector_key in self.resource_method_keys.iter() {
-            let mut current_chunk: Vec<BytesMut> = vec![];
-            let mut current_chunk_size: usize = 0;
-            // we process the data for this region of the store in chunks, each iteration of this loop
-            // should represent the processing and uploading of a single chunk of data
-            loop {
-                let store_lock = self.store.lock().await;
-                let mut reader = match store_lock.get_reader(collector_key) {
-                    Ok(reader) => reader,
-                    Err(err) => {
-                        log::error!(
-                            "error acquiring reader for collector key ({:?}): {:?}",
-                            collector_key,
-                            err
-                        );
-                        break;
-                    }
-                };
-                let next_message = match reader.read_next_message() {
-                    Ok(msg) => msg,
-                    Err(err) => {
-                        log::error!(
-                            "error reading message from store for collector key ({:?}): {:?}",
-                            collector_key,
-                            err
-                        );
-
-                        // we don't want to panic, and creating an AppClientError variant for this case
-                        // feels too specific, so we'll move on to the next collector
-                        break;
-                    }
-                };
-
-                // if the first message is empty, we've reached the end of the store region
-                // and it's time to move on to the next collector
-                if next_message.is_empty() {
-                    break;
-                } else if next_message.len() > MAX_SENSOR_CONTENTS_SIZE {
+    /// Reads the messages of a collector following `start` until they fill a chunk, without
+    /// consuming them. Returns None when there is nothing after `start`.
+    async fn read_chunk(
+        &self,
+        collector_key: &ResourceMethodKey,
+        start: Option<ReadPosition>,
+    ) -> Option<UploadChunk> {
+        let store_lock = self.store.lock().await;
+        let mut reader = match store_lock.get_reader(collector_key) {
+            Ok(reader) => reader,
+            Err(err) => {
+                log::error!(
+                    "error acquiring reader for collector key ({:?}): {:?}",
+                    collector_key,
+                    err
+                );
+                return None;
+            }
+        };
+        if let Some(start) = start {
+            reader.seek(start);
+        }
+        let start = reader.position();
+        let mut current_chunk: Vec<BytesMut> = vec![];
+        let mut current_chunk_size: usize = 0;
+        let mut end = start;
+        let last = loop {
+            let next_message = match reader.read_next_message() {
+                Ok(msg) => msg,
+                Err(err) => {
                     log::error!(
-                        "message encountered that was too large (>32K bytes) for collector {:?}",
-                        collector_key
+                        "error reading message from store for collector key ({:?}): {:?}",
+                        collector_key,
+                        err
                     );
-                } else {
-                    current_chunk_size = next_message.len();
-                    current_chunk.push(next_message);
+                    // we don't want to panic, so we upload what was read and move on to the
+                    // next collector
+                    break true;
                 }
+            };
+            if next_message.is_empty() {
+                break true;
+            }
+            // skip this message if it's too big, it's consumed along with the chunk
+            if next_message.len() > MAX_SENSOR_CONTENTS_SIZE {
+                log::error!(
+                    "message encountered that was too large (>32K bytes) for collector {:?}",
+                    collector_key
+                );
+                end = reader.position();
+                continue;
+            }
+            // the message that doesn't fit starts the next chunk
+            if next_message.len() + current_chunk_size > MAX_SENSOR_CONTENTS_SIZE {
+                break false;
+            }
+            current_chunk_size += next_message.len();
+            current_chunk.push(next_message);
+            end = reader.position();
+        };
+        // the messages stay in the store until app acknowledges them
+        std::mem::drop(reader);
+        std::mem::drop(store_lock);
+        if end == start {
+            return None;
+        }
 
-                // We want to fill current_chunk until its size reaches just under
-                // MAX_SENSOR_CONTENTS_SIZE and then upload the data. Since we will have
-                // needed to pull the first message of the next chunk to realize that
-                // we have reached capacity, we return that message as well to be placed
-                // at the beginning of the now empty current_chunk once we have successfully
-                // uploaded it
-                let (upload_data, next_chunk_first_message) = loop {
-                    let next_message = match reader.read_next_message() {
-                        Ok(msg) => msg,
-                        Err(err) => {
-                            log::error!(
-                                "error reading message from store for collector key ({:?}): {:?}",
-                                collector_key,
-                                err
-                            );
-
-                            // we don't want to panic, and creating an AppClientError variant for this case
-                            // feels too specific, so we'll move on to the next collector without flushing
-                            // this region of the store
-                            break (vec![], None);
-                        }
-                    };
+        // messages are uploaded as they are stored, a chunk holding one that doesn't decode is
+        // dropped
+        let data = if current_chunk.iter().all(|msg| is_well_formed(msg)) {
+            current_chunk
+        } else {
+            log::error!(
+                "error decoding readings for collector key ({:?})",
+                collector_key
+            );
+            vec![]
+        };
+        Some(UploadChunk {
+            end,
+            data,
+            bytes: current_chunk_size,
+            last,
+        })
+    }
 
-                    // skip this message if it's too big
-                    if next_message.len() > MAX_SENSOR_CONTENTS_SIZE {
-                        log::error!(
-                            "message encountered that was too large (>32K bytes) for collector {:?}",
-                            collector_key
-                        );
-                        continue;
-                    }
-                    if next_message.is_empty()
-                        || ((next_message.len() + current_chunk_size) > MAX_SENSOR_CONTENTS_SIZE)
-                    {
-                        let data: Result<Vec<SensorData>, prost::DecodeError> =
-                            current_chunk.drain(..).map(SensorData::decode).collect();
-                        let data = match data {
-                            Ok(data) => data,
-                            Err(err) => {
-                                log::error!(
-                                    "error decoding readings for collector key ({:?}): {:?}",
-                                    collector_key,
-                                    err
-                                );
-                                vec![]
-                            }
-                        };
-                        if next_message.is_empty() {
-                            break (data, None);
-                        }
-                        break (data, Some(next_message));
-                    } else {
-                        current_chunk_size += next_message.len();
-                        current_chunk.push(next_message);
+    async fn flush_until(&self, collector_key: &ResourceMethodKey, position: ReadPosition) {
+        let store = self.store.lock().await;
+        match store.get_reader(collector_key) {
+            Ok(reader) => reader.flush_until(position),
+            Err(err) => log::error!(
+                "error acquiring reader for collector key ({:?}): {:?}",
+                collector_key,
+                err
+            ),
+        }
+        record_store_fill(&*store, collector_key);
+    }
+
+    /// Records the completion of an upload. The messages of a collector are only consumed once every
+    /// chunk before them was acknowledged, a failed chunk is read again by the next sync.
+    async fn complete_upload(
+        &self,
+        chunks: &mut [VecDeque<(ReadPosition, bool)>],
+        completion: UploadCompletion,
+    ) -> Result<(), AppClientError> {
+        self.stats
+            .in_flight_bytes
+            .fetch_sub(completion.bytes as u32, Ordering::Relaxed);
+        if let Err(err) = completion.result {
+            self.stats.failed_uploads.fetch_add(1, Ordering::Relaxed);
+            log::error!(
+                "error uploading data ({:?} messages), it will be uploaded again: {:?}",
+                completion.messages,
+                err
+            );
+            return Err(err);
+        }
+        self.stats
+            .uploaded_bytes
+            .fetch_add(completion.bytes as u32, Ordering::Relaxed);
+        self.stats
+            .uploaded_messages
+            .fetch_add(completion.messages as u32, Ordering::Relaxed);
+        self.acknowledge(chunks, completion.key_index, completion.end)
+            .await;
+        Ok(())
+    }
+
+    async fn acknowledge(
+        &self,
+        chunks: &mut [VecDeque<(ReadPosition, bool)>],
+        key_index: usize,
+        end: ReadPosition,
+    ) {
+        let chunks = &mut chunks[key_index];
+        if let Some(chunk) = chunks.iter_mut().find(|(chunk_end, _)| *chunk_end == end) {
+            chunk.1 = true;
+        }
+        let mut acknowledged = None;
+        while let Some((end, true)) = chunks.front() {
+            acknowledged = Some(*end);
+            chunks.pop_front();
+        }
+        if let Some(position) = acknowledged {
+            self.flush_until(&self.resource_method_keys[key_index], position)
+                .await;
+        }
+    }
+
+    async fn run<'b>(&mut self, app_client: &'b AppClient) -> Result<(), AppClientError> {
+        self.sync(|body| app_client.upload_encoded_data(body)).await
+    }
+
+    // Up to `max_outstanding_uploads` chunks are uploaded at once with `upload`, from one or several
+    // collectors. Chunks are read without consuming them and flushed once app acknowledged them, so
+    // a failed upload doesn't lose data. Every upload is awaited until it resolves since hyper only
+    // frees the memory of a request then. After a failure no new chunk is sent and the error is
+    // returned once the uploads in flight resolved.
+    async fn sync<U, F>(&mut self, upload: U) -> Result<(), AppClientError>
+    where
+        U: Fn(Bytes) -> F,
+        F: Future<Output = Result<(), AppClientError>>,
+    {
+        let started = Instant::now();
+        let acknowledged_bytes = self.stats.uploaded_bytes.load(Ordering::Relaxed);
+        let mut uploads = FuturesUnordered::new();
+        // chunks of each collector sent to app, oldest first, with whether they were acknowledged
+        let mut chunks: Vec<VecDeque<(ReadPosition, bool)>> = self
+            .resource_method_keys
+            .iter()
+            .map(|_| VecDeque::new())
+            .collect();
+        let mut result = Ok(());
+        'collectors: for key_index in 0..self.resource_method_keys.len() {
+            let collector_key = self.resource_method_keys[key_index].clone();
+            let mut position = None;
+            loop {
+                while uploads.len() >= self.max_outstanding_uploads {
+                    let completion = uploads.next().await.unwrap();
+                    if let Err(err) = self.complete_upload(&mut chunks, completion).await {
+                        result = Err(err);
+                        break 'collectors;
                     }
+                }
+                let chunk = match self.read_chunk(&collector_key, position).await {
+                    Some(chunk) => chunk,
+                    None => break,
                 };
-
-                // We don't want to hold on to the store lock over a potentially long-running upload attempt.
-                // However, when a request is sent using the hyper library, the memory representing the request data
-                // is only cleaned up when the future to send the request somehow resolves. So if we put our own
-                // timeout on this upload request, this leaked data will accumulate on every subsequent failed
-                // upload attempt. To accomodate this, we flush the store before attempting to upload the data
-                // and accept that the current chunk of data (in addition to the very first message of the next chunk)
-                // will be lost on failure. Because an inability to connect to app will result in no longer having an
-                // AppClient available, this task will not attempt to run again and additional data loss will be prevented
-                reader.flush();
-                std::mem::drop(store_lock);
-
-                if !upload_data.is_empty() {
-                    let data_len = upload_data.len();
-                    let upload_request = DataCaptureUploadRequest {
-                        metadata: Some(UploadMetadata {
-                            part_id: self.part_id.clone(),
-                            component_type: collector_key.component_type.clone(),
-                            r#type: DataType::TabularSensor.into(),
-                            component_name: collector_key.r_name.clone(),
-                            method_name: collector_key.method.to_string(),
-                            ..Default::default()
-                        }),
-                        sensor_contents: upload_data,
-                    };
-                    match app_client.upload_data(upload_request).await {
-                        Ok(_) => {
-                            if let Some(next_message) = next_chunk_first_message {
-                                current_chunk_size = next_message.len();
-                                current_chunk = vec![next_message];
-                            }
-                        }
-                        Err(err) => {
-                            log::error!(
-                                "error uploading data, data lost ({:?} messages)",
-                                data_len + 1
-                            );
-                            return Err(err);
-                        }
+                position = Some(chunk.end);
+                chunks[key_index].push_back((chunk.end, false));
+                if chunk.data.is_empty() {
+                    // only messages that can't be uploaded, they are dropped
+                    self.acknowledge(&mut chunks, key_index, chunk.end).await;
+                } else {
+                    let metadata = UploadMetadata {
+                        part_id: self.part_id.clone(),
+                        component_type: collector_key.component_type.clone(),
+                        r#type: DataType::TabularSensor.into(),
+                        component_name: collector_key.r_name.clone(),
+                        method_name: collector_key.method.to_string(),
+                        ..Default::default()
                     };
+                    self.stats
+                        .in_flight_bytes
+                        .fetch_add(chunk.bytes as u32, Ordering::Relaxed);
+                    // the messages are freed once copied in the body
+                    let body = encode_upload_request(&metadata, &chunk.data);
+                    uploads.push(upload_chunk(
+                        upload(body),
+                        key_index,
+                        chunk.end,
+                        chunk.bytes,
+                        chunk.data.len(),
+                    ));
+                }
+                if chunk.last {
+                    break;
                 }
             }
         }
-        Ok(())
+        while let Some(completion) = uploads.next().await {
+            if let Err(err) = self.complete_upload(&mut chunks, completion).await {
+                result = result.and(Err(err));
+            }
+        }
+
+        let elapsed_ms = started.elapsed().as_millis().max(1) as u64;
+        let uploaded = self
+            .stats
+            .uploaded_bytes
+            .load(Ordering::Relaxed)
+            .wrapping_sub(acknowledged_bytes);
+        self.stats.last_sync_throughput.store(
+            (uploaded as u64 * 1000 / elapsed_ms) as u32,
+            Ordering::Relaxed,
+        );
+        let store_lock = self.store.lock().await;
+        let backlog: Option<usize> = self
+            .resource_method_keys
+            .iter()
+            .map(|key| store_lock.stored_len(key))
+            .sum();
+        if let Some(backlog) = backlog {
+            self.stats
+                .backlog_bytes
+                .store(backlog as u32, Ordering::Relaxed);
+        }
+        result
     }
 }
 
@@ -419,22 +991,31 @@ where
 
 #[cfg(test)]
 mod tests {
-    use std::cell::RefCell;
+    use std::cell::{Cell, RefCell};
     use std::collections::HashMap;
     use std::mem::MaybeUninit;
     use std::rc::Rc;
-    use std::sync::{Arc, Mutex};
-    use std::time::Duration;
-
-    use bytes::BytesMut;
+    use std::sync::atomic::Ordering;
+    use std::sync::{Arc, Mutex, PoisonError};
+    use std::task::{Context, Poll};
+    use std::time::{Duration, Instant};
+
+    use async_io::Timer;
+    use bytes::{BufMut, BytesMut};
+    use futures_lite::future;
+    use prost::encoding::{encode_key, encode_varint, WireType};
     use prost::Message;
     use ringbuf::{LocalRb, Rb};
 
-    use super::DataManager;
-    use crate::common::data_store::{DataStoreReader, WriteMode};
+    use super::{encode_upload_request, is_well_formed, DataManager, DataSyncTask};
+    use crate::common::app_client::AppClientError;
+    use crate::common::bench::bench;
+    use crate::common::data_store::{
+        DataStoreReader, ReadPosition, StaticMemoryDataStore, WriteMode,
+    };
     use crate::common::encoder::EncoderError;
     use crate::common::{
-        data_collector::{CollectionMethod, DataCollector, ResourceMethodKey},
+        data_collector::{CollectionMethod, DataCollector, DataCollectorConfig, ResourceMethodKey},
         data_store::{DataStore, DataStoreError},
         robot::ResourceType,
         sensor::{
@@ -442,10 +1023,13 @@ mod tests {
             TypedReadingsResult,
         },
         status::{Status, StatusError},
+        telemetry::{Telemetry, DATA_TELEMETRY_TESTS},
     };
     use crate::google::protobuf::value::Kind;
-    use crate::google::protobuf::Struct;
-    use crate::proto::app::data_sync::v1::{sensor_data::Data, SensorData};
+    use crate::google::protobuf::{ListValue, Struct, Timestamp, Value};
+    use crate::proto::app::data_sync::v1::{
+        sensor_data::Data, DataCaptureUploadRequest, SensorData, SensorMetadata, UploadMetadata,
+    };
 
     #[derive(DoCommand)]
     struct TestSensorFailure {}
@@ -506,6 +1090,11 @@ mod tests {
             Err(DataStoreError::Unimplemented)
         }
         fn flush(self) {}
+        fn position(&self) -> ReadPosition {
+            0
+        }
+        fn seek(&mut self, _position: ReadPosition) {}
+        fn flush_until(self, _position: ReadPosition) {}
     }
 
     struct NoOpStore {}
@@ -583,6 +1172,40 @@ mod tests {
         );
     }
 
+    #[test_log::test]
+    fn test_collector_update() {
+        let collector = |name: &str, frequency: f32| {
+            let resource = ResourceType::Sensor(Arc::new(Mutex::new(TestSensor {})));
+            DataCollector::new(
+                name.to_string(),
+                resource,
+                CollectionMethod::Readings,
+                frequency,
+            )
+            .unwrap()
+        };
+        let mut data_manager = DataManager::new(
+            vec![collector("r1", 10.0), collector("r2", 50.0)],
+            NoOpStore {},
+            Duration::from_millis(30),
+            "1".to_string(),
+        )
+        .unwrap();
+        let updater = data_manager.collector_updater();
+
+        // a new collector needs a store sized for it
+        assert!(!updater.replace(vec!["r3".to_string()], vec![collector("r3", 10.0)]));
+        assert!(!updater.replace(vec!["r2".to_string()], vec![]));
+        assert!(!data_manager.apply_collector_update());
+
+        assert!(updater.replace(vec!["r2".to_string()], vec![collector("r2", 5.0)]));
+        assert!(data_manager.apply_collector_update());
+        assert_eq!(data_manager.collectors.len(), 2);
+        assert_eq!(data_manager.min_interval_ms(), 100);
+        assert_eq!(data_manager.collection_intervals(), vec![100, 200]);
+        assert!(!data_manager.apply_collector_update());
+    }
+
     #[test_log::test]
     fn test_collect_readings_for_interval() {
         let resource_1 = ResourceType::Sensor(Arc::new(Mutex::new(TestSensor {})));
@@ -629,7 +1252,7 @@ mod tests {
         assert!(data_manager.is_ok());
         let mut data_manager = data_manager.unwrap();
 
-        let sensor_data = data_manager.collect_readings_for_interval(100);
+        let sensor_data = async_io::block_on(data_manager.collect_readings_for_interval(100));
         assert!(sensor_data.is_ok());
         let sensor_data = sensor_data.unwrap();
         assert_eq!(sensor_data.len(), 2);
@@ -719,6 +1342,7 @@ mod tests {
         );
         assert!(data_coll_3.is_ok());
         let data_coll_3 = data_coll_3.unwrap();
+        let method_key_3 = data_coll_3.resource_method_key();
 
         let data_manager = DataManager::new(
             vec![data_coll_1, data_coll_3],
@@ -729,8 +1353,275 @@ mod tests {
         assert!(data_manager.is_ok());
         let mut data_manager = data_manager.unwrap();
 
-        let readings = data_manager.collect_readings_for_interval(100);
-        assert!(readings.is_err());
+        let readings = async_io::block_on(data_manager.collect_readings_for_interval(100));
+        assert!(readings.is_ok());
+        let readings = readings.unwrap();
+        assert_eq!(readings.len(), 1);
+        assert_eq!(readings[0].0, method_key_3);
+        assert_eq!(data_manager.collection_errors().load(Ordering::Relaxed), 1);
+        assert_eq!(data_manager.collectors[0].error_count(), 1);
+        assert_eq!(data_manager.collectors[1].error_count(), 0);
+    }
+
+    // records when it is read, reading it takes `slow` instead of no time on the `slow_read`th read
+    #[derive(DoCommand)]
+    struct TestSlowSensor {
+        reads: Arc<Mutex<Vec<Instant>>>,
+        slow_read: usize,
+        slow: Duration,
+    }
+
+    impl Sensor for TestSlowSensor {}
+
+    impl Readings for TestSlowSensor {
+        fn get_generic_readings(&mut self) -> Result<GenericReadingsResult, SensorError> {
+            let mut reads = self.reads.lock().unwrap();
+            reads.push(Instant::now());
+            if reads.len() == self.slow_read {
+                std::thread::sleep(self.slow);
+            }
+            Ok(HashMap::from([(
+                "thing".to_string(),
+                SensorResult::<f64> { value: 1.0 }.into(),
+            )]))
+        }
+    }
+
+    impl Status for TestSlowSensor {
+        fn get_status(&self) -> Result<Option<Struct>, StatusError> {
+            Ok(None)
+        }
+    }
+
+    #[test_log::test]
+    fn test_data_collection_task_missed_deadlines() {
+        let _tests = DATA_TELEMETRY_TESTS
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner);
+        let reads = Arc::new(Mutex::new(vec![]));
+        let sensor = TestSlowSensor {
+            reads: reads.clone(),
+            slow_read: 2,
+            slow: Duration::from_millis(250),
+        };
+        let collector = DataCollector::new(
+            "r1".to_string(),
+            ResourceType::Sensor(Arc::new(Mutex::new(sensor))),
+            CollectionMethod::Readings,
+            10.0,
+        )
+        .unwrap();
+        let failing = DataCollector::new(
+            "r2".to_string(),
+            ResourceType::Sensor(Arc::new(Mutex::new(TestSensorFailure {}))),
+            CollectionMethod::Readings,
+            10.0,
+        )
+        .unwrap();
+        let manager = DataManager::new(
+            vec![collector, failing],
+            ReadSavingStore::new(),
+            Duration::from_secs(1),
+            "1".to_string(),
+        )
+        .unwrap();
+        let missed_deadlines = manager.missed_deadlines();
+        let (_, collection_future, _) = manager.into_tasks();
+
+        async_io::block_on(future::or(collection_future, async {
+            let _ = Timer::after(Duration::from_millis(650)).await;
+        }));
+
+        // the second read ends at 350ms, past the ticks of 200ms and 300ms which are skipped
+        // while the following ones keep their schedule
+        let reads = reads.lock().unwrap();
+        let start = reads[0];
+        let ticks: Vec<u128> = reads
+            .iter()
+            .map(|read| {
+                let offset = read.duration_since(start).as_millis();
+                let tick = (offset + 50) / 100;
+                // the schedule starts right before the first read, reads happen on their tick
+                // or late but never early
+                assert!(
+                    offset + 5 >= tick * 100 && offset < tick * 100 + 50,
+                    "read {}ms after the start",
+                    offset
+                );
+                tick
+            })
+            .collect();
+        assert_eq!(ticks, vec![0, 1, 4, 5, 6]);
+        assert_eq!(missed_deadlines.load(Ordering::Relaxed), 2);
+        let telemetry = Telemetry::snapshot();
+        assert_eq!(telemetry.data_collection.missed_deadlines, 2);
+        // "r2" fails on every tick
+        assert_eq!(telemetry.data_collection.collection_errors, 5);
+    }
+
+    #[derive(DoCommand)]
+    struct TestBatchSensor {}
+
+    impl Sensor for TestBatchSensor {}
+
+    impl Readings for TestBatchSensor {
+        fn get_generic_readings(&mut self) -> Result<GenericReadingsResult, SensorError> {
+            Ok(HashMap::from([(
+                "thing".to_string(),
+                SensorResult::<f64> { value: 1.0 }.into(),
+            )]))
+        }
+        fn get_readings_data_batch(&mut self) -> Result<Vec<SensorData>, SensorError> {
+            Ok((0..3)
+                .map(|i| {
+                    let readings: GenericReadingsResult = HashMap::from([(
+                        "thing".to_string(),
+                        SensorResult::<f64> { value: i as f64 }.into(),
+                    )]);
+                    SensorData {
+                        metadata: None,
+                        data: Some(readings.into()),
+                    }
+                })
+                .collect())
+        }
+    }
+
+    impl Status for TestBatchSensor {
+        fn get_status(&self) -> Result<Option<Struct>, StatusError> {
+            Ok(None)
+        }
+    }
+
+    #[test_log::test]
+    fn test_collect_readings_for_interval_batch() {
+        let resource_1 = ResourceType::Sensor(Arc::new(Mutex::new(TestBatchSensor {})));
+        let data_coll_1 = DataCollector::new(
+            "r1".to_string(),
+            resource_1,
+            CollectionMethod::Readings,
+            10.0,
+        );
+        assert!(data_coll_1.is_ok());
+        let data_coll_1 = data_coll_1.unwrap();
+        let method_key_1 = data_coll_1.resource_method_key();
+
+        let resource_2 = ResourceType::Sensor(Arc::new(Mutex::new(TestSensor {})));
+        let data_coll_2 = DataCollector::new(
+            "r2".to_string(),
+            resource_2,
+            CollectionMethod::Readings,
+            10.0,
+        );
+        assert!(data_coll_2.is_ok());
+        let data_coll_2 = data_coll_2.unwrap();
+        let method_key_2 = data_coll_2.resource_method_key();
+
+        let data_manager = DataManager::new(
+            vec![data_coll_1, data_coll_2],
+            NoOpStore {},
+            Duration::from_millis(30),
+            "1".to_string(),
+        );
+        assert!(data_manager.is_ok());
+        let mut data_manager = data_manager.unwrap();
+
+        let sensor_data = async_io::block_on(data_manager.collect_readings_for_interval(100));
+        assert!(sensor_data.is_ok());
+        let sensor_data = sensor_data.unwrap();
+        assert_eq!(sensor_data.len(), 4);
+        assert!(sensor_data[..3].iter().all(|(k, _)| k == &method_key_1));
+        assert_eq!(sensor_data[3].0, method_key_2);
+    }
+
+    // yields once per collection, recording when its collection starts and ends
+    #[derive(DoCommand)]
+    struct TestYieldingSensor {
+        name: &'static str,
+        events: Arc<Mutex<Vec<String>>>,
+        started: bool,
+    }
+
+    impl Sensor for TestYieldingSensor {}
+
+    impl Readings for TestYieldingSensor {
+        fn get_generic_readings(&mut self) -> Result<GenericReadingsResult, SensorError> {
+            Ok(HashMap::from([(
+                "thing".to_string(),
+                SensorResult::<f64> { value: 1.0 }.into(),
+            )]))
+        }
+        fn poll_readings_data_batch(
+            &mut self,
+            cx: &mut Context<'_>,
+        ) -> Poll<Result<Vec<SensorData>, SensorError>> {
+            let event = if self.started { "end" } else { "start" };
+            self.events
+                .lock()
+                .unwrap()
+                .push(format!("{} {}", event, self.name));
+            if !self.started {
+                self.started = true;
+                cx.waker().wake_by_ref();
+                return Poll::Pending;
+            }
+            self.started = false;
+            Poll::Ready(self.get_readings_data_batch())
+        }
+    }
+
+    impl Status for TestYieldingSensor {
+        fn get_status(&self) -> Result<Option<Struct>, StatusError> {
+            Ok(None)
+        }
+    }
+
+    #[test_log::test]
+    fn test_collect_readings_for_interval_buses() {
+        let events = Arc::new(Mutex::new(vec![]));
+        let collectors: Vec<DataCollector> =
+            [("a", Some("i2c0")), ("b", Some("i2c0")), ("c", None)]
+                .into_iter()
+                .map(|(name, bus)| {
+                    let sensor = TestYieldingSensor {
+                        name,
+                        events: events.clone(),
+                        started: false,
+                    };
+                    let conf = DataCollectorConfig {
+                        method: CollectionMethod::Readings,
+                        capture_frequency_hz: 10.0,
+                        buffer_weight: 1.0,
+                        bus: bus.map(str::to_string),
+                        aggregate: None,
+                    };
+                    DataCollector::from_config(
+                        name.to_string(),
+                        ResourceType::Sensor(Arc::new(Mutex::new(sensor))),
+                        &conf,
+                    )
+                    .unwrap()
+                })
+                .collect();
+        let names: Vec<String> = collectors.iter().map(|c| c.name()).collect();
+
+        let mut data_manager = DataManager::new(
+            collectors,
+            NoOpStore {},
+            Duration::from_millis(30),
+            "1".to_string(),
+        )
+        .unwrap();
+        let sensor_data =
+            async_io::block_on(data_manager.collect_readings_for_interval(100)).unwrap();
+        let collected: Vec<String> = sensor_data.iter().map(|(k, _)| k.r_name.clone()).collect();
+        assert_eq!(collected, names);
+
+        // "c" runs alongside the i2c0 bus, on which "b" only starts once "a" is done
+        assert_eq!(
+            *events.lock().unwrap(),
+            vec!["start a", "start c", "end a", "start b", "end c", "end b"]
+        );
     }
 
     #[derive(DoCommand)]
@@ -785,6 +1676,11 @@ mod tests {
             }
         }
         fn flush(self) {}
+        fn position(&self) -> ReadPosition {
+            0
+        }
+        fn seek(&mut self, _position: ReadPosition) {}
+        fn flush_until(self, _position: ReadPosition) {}
     }
 
     struct ReadSavingStore {
@@ -935,4 +1831,397 @@ mod tests {
             assert_eq!(read_data, expected_data);
         });
     }
+
+    #[test_log::test]
+    fn test_encode_upload_request() {
+        let metadata = UploadMetadata {
+            part_id: "boop".to_string(),
+            component_name: "r1".to_string(),
+            method_name: "Readings".to_string(),
+            ..Default::default()
+        };
+        let sensor_contents = vec![
+            TestSensor {}.get_readings_data().unwrap(),
+            TestSensor {}.get_readings_data().unwrap(),
+        ];
+        let encoded: Vec<BytesMut> = sensor_contents
+            .iter()
+            .map(|data| BytesMut::from(&data.encode_to_vec()[..]))
+            .collect();
+        assert!(encoded.iter().all(|msg| is_well_formed(msg)));
+        let body = encode_upload_request(&metadata, &encoded);
+        let request = DataCaptureUploadRequest {
+            metadata: Some(metadata),
+            sensor_contents,
+        };
+        assert_eq!(
+            body,
+            crate::common::app_client::encode_request(request).unwrap()
+        );
+        // a message cut short isn't uploaded
+        assert!(!is_well_formed(&encoded[0][..encoded[0].len() - 1]));
+        // nor one whose framing is fine but whose readings are corrupted
+        let mut corrupted = BytesMut::new();
+        encode_key(2, WireType::LengthDelimited, &mut corrupted);
+        encode_varint(1, &mut corrupted);
+        corrupted.put_u8(0xff);
+        assert!(!is_well_formed(&corrupted));
+    }
+
+    // readings nesting every kind of value
+    fn nested_sensor_data() -> SensorData {
+        let value = |kind| Value { kind: Some(kind) };
+        let nested = Struct {
+            fields: HashMap::from([("nested".to_string(), value(Kind::StringValue("é".into())))]),
+        };
+        let readings = Struct {
+            fields: HashMap::from([
+                ("number".to_string(), value(Kind::NumberValue(0.5))),
+                ("bool".to_string(), value(Kind::BoolValue(true))),
+                ("null".to_string(), value(Kind::NullValue(0))),
+                (
+                    "list".to_string(),
+                    value(Kind::ListValue(ListValue {
+                        values: vec![
+                            value(Kind::NumberValue(1.0)),
+                            value(Kind::StructValue(nested)),
+                        ],
+                    })),
+                ),
+            ]),
+        };
+        let timestamp = Timestamp {
+            seconds: 1_704_067_200,
+            nanos: 42,
+        };
+        SensorData {
+            metadata: Some(SensorMetadata {
+                time_requested: Some(timestamp.clone()),
+                time_received: Some(timestamp),
+            }),
+            data: Some(Data::Struct(readings)),
+        }
+    }
+
+    #[test_log::test]
+    fn test_is_well_formed() {
+        let encoded = nested_sensor_data().encode_to_vec();
+        assert!(is_well_formed(&encoded));
+        // a message cut anywhere is only accepted when prost decodes it too
+        for len in 0..encoded.len() {
+            assert_eq!(
+                is_well_formed(&encoded[..len]),
+                SensorData::decode(&encoded[..len]).is_ok(),
+                "message cut at {}",
+                len
+            );
+        }
+        let readings = |value: &[u8]| {
+            let mut entry = BytesMut::new();
+            encode_key(1, WireType::LengthDelimited, &mut entry);
+            encode_varint(1, &mut entry);
+            entry.put_u8(b'k');
+            encode_key(2, WireType::LengthDelimited, &mut entry);
+            encode_varint(value.len() as u64, &mut entry);
+            entry.put_slice(value);
+            let mut msg = BytesMut::new();
+            encode_key(2, WireType::LengthDelimited, &mut msg);
+            encode_varint(entry.len() as u64 + 2, &mut msg);
+            encode_key(1, WireType::LengthDelimited, &mut msg);
+            encode_varint(entry.len() as u64, &mut msg);
+            msg.put_slice(&entry);
+            msg
+        };
+        // a string value that isn't UTF-8
+        let msg = readings(&[0x1a, 0x01, 0xff]);
+        assert!(SensorData::decode(&msg[..]).is_err());
+        assert!(!is_well_formed(&msg));
+        // a number encoded as a varint
+        let msg = readings(&[0x10, 0x01]);
+        assert!(SensorData::decode(&msg[..]).is_err());
+        assert!(!is_well_formed(&msg));
+        // a bool is accepted
+        let msg = readings(&[0x20, 0x01]);
+        assert!(SensorData::decode(&msg[..]).is_ok());
+        assert!(is_well_formed(&msg));
+    }
+
+    // messages of a single collector, they keep their position once consumed
+    #[derive(Default)]
+    struct PositionedMessages {
+        messages: Vec<BytesMut>,
+        consumed: usize,
+        // positions the messages were flushed until
+        flushes: Vec<ReadPosition>,
+    }
+
+    struct PositionedReader {
+        messages: Rc<RefCell<PositionedMessages>>,
+        idx: usize,
+    }
+
+    impl DataStoreReader for PositionedReader {
+        fn read_next_message(&mut self) -> Result<BytesMut, DataStoreError> {
+            let messages = self.messages.borrow();
+            match messages.messages.get(self.idx) {
+                Some(msg) => {
+                    self.idx += 1;
+                    Ok(msg.clone())
+                }
+                None => Ok(BytesMut::new()),
+            }
+        }
+        fn flush(self) {
+            self.messages.borrow_mut().consumed = self.idx;
+        }
+        fn position(&self) -> ReadPosition {
+            self.idx as ReadPosition
+        }
+        fn seek(&mut self, position: ReadPosition) {
+            self.idx = position as usize;
+        }
+        fn flush_until(self, position: ReadPosition) {
+            let mut messages = self.messages.borrow_mut();
+            messages.consumed = position as usize;
+            messages.flushes.push(position);
+        }
+    }
+
+    struct PositionedStore {
+        messages: Rc<RefCell<PositionedMessages>>,
+    }
+
+    impl DataStore for PositionedStore {
+        type Reader = PositionedReader;
+        fn write_message(
+            &mut self,
+            _collector_key: &ResourceMethodKey,
+            _message: SensorData,
+            _write_mode: WriteMode,
+        ) -> Result<(), DataStoreError> {
+            Err(DataStoreError::Unimplemented)
+        }
+        fn from_resource_method_keys(
+            _collector_keys: Vec<ResourceMethodKey>,
+        ) -> Result<Self, DataStoreError> {
+            Ok(Self {
+                messages: Rc::default(),
+            })
+        }
+        fn get_reader(
+            &self,
+            _collector_key: &ResourceMethodKey,
+        ) -> Result<PositionedReader, DataStoreError> {
+            Ok(PositionedReader {
+                messages: self.messages.clone(),
+                idx: self.messages.borrow().consumed,
+            })
+        }
+        fn stored_len(&self, _collector_key: &ResourceMethodKey) -> Option<usize> {
+            let messages = self.messages.borrow();
+            Some(
+                messages.messages[messages.consumed..]
+                    .iter()
+                    .map(|m| m.len())
+                    .sum(),
+            )
+        }
+        fn capacity(&self, _collector_key: &ResourceMethodKey) -> Option<usize> {
+            Some(1 << 20)
+        }
+    }
+
+    // sync task of a collector holding `count` messages too large to share a chunk, the payload of
+    // the ith message is filled with i
+    fn positioned_sync_task(
+        count: u8,
+        max_outstanding_uploads: usize,
+    ) -> (
+        DataSyncTask<PositionedStore>,
+        Rc<RefCell<PositionedMessages>>,
+    ) {
+        positioned_sync_task_of("r1", count, max_outstanding_uploads)
+    }
+
+    fn positioned_sync_task_of(
+        name: &str,
+        count: u8,
+        max_outstanding_uploads: usize,
+    ) -> (
+        DataSyncTask<PositionedStore>,
+        Rc<RefCell<PositionedMessages>>,
+    ) {
+        let messages = Rc::new(RefCell::new(PositionedMessages {
+            messages: (0..count)
+                .map(|i| {
+                    let msg = SensorData {
+                        metadata: None,
+                        data: Some(Data::Binary(vec![i; 20000])),
+                    };
+                    BytesMut::from(&msg.encode_to_vec()[..])
+                })
+                .collect(),
+            ..Default::default()
+        }));
+        let resource = ResourceType::Sensor(Arc::new(Mutex::new(TestSensor {})));
+        let collector =
+            DataCollector::new(name.to_string(), resource, CollectionMethod::Readings, 1.0)
+                .unwrap();
+        let store = PositionedStore {
+            messages: messages.clone(),
+        };
+        let manager = DataManager::new(
+            vec![collector],
+            store,
+            Duration::from_secs(1),
+            "1".to_string(),
+        )
+        .unwrap()
+        .with_max_outstanding_uploads(max_outstanding_uploads);
+        (manager.get_sync_task(), messages)
+    }
+
+    // runs a sync where the nth upload resolves after script[n].0 ms, and fails unless script[n].1,
+    // along with the events of the uploads
+    fn scripted_sync(
+        sync_task: &mut DataSyncTask<PositionedStore>,
+        script: &[(u64, bool)],
+    ) -> (Result<(), AppClientError>, Vec<String>) {
+        let events = RefCell::new(vec![]);
+        let sent = Cell::new(0);
+        let (events_ref, sent) = (&events, &sent);
+        let result = async_io::block_on(sync_task.sync(move |body| {
+            // the payload of the single message of the chunk ends the request
+            let message = body[body.len() - 1];
+            let (delay, succeeds) = script[sent.get()];
+            sent.set(sent.get() + 1);
+            events_ref.borrow_mut().push(format!("sent {}", message));
+            async move {
+                let _ = Timer::after(Duration::from_millis(delay)).await;
+                events_ref.borrow_mut().push(format!("done {}", message));
+                if succeeds {
+                    Ok(())
+                } else {
+                    Err(AppClientError::AppClientRequestTimeout)
+                }
+            }
+        }));
+        (result, events.into_inner())
+    }
+
+    #[test_log::test]
+    fn test_sync_refreshes_store_fill() {
+        let _tests = DATA_TELEMETRY_TESTS
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner);
+        let (mut sync_task, messages) = positioned_sync_task_of("fill_after_sync", 3, 1);
+        // the first message is acknowledged, the second upload fails
+        let (result, _) = scripted_sync(&mut sync_task, &[(0, true), (0, false)]);
+        assert!(result.is_err());
+        let remaining: usize = messages.borrow().messages[1..]
+            .iter()
+            .map(|m| m.len())
+            .sum();
+        let fill = Telemetry::snapshot()
+            .data_store_fill("fill_after_sync", "Readings")
+            .unwrap();
+        assert_eq!(fill.stored, remaining);
+    }
+
+    #[test_log::test]
+    fn test_sync_flushes_in_order() {
+        let (mut sync_task, messages) = positioned_sync_task(3, 1);
+        let (result, events) = scripted_sync(&mut sync_task, &[(0, true); 3]);
+        assert!(result.is_ok());
+        // a single upload in flight, each one is flushed once acknowledged
+        assert_eq!(
+            events,
+            vec!["sent 0", "done 0", "sent 1", "done 1", "sent 2", "done 2"]
+        );
+        assert_eq!(messages.borrow().flushes, vec![1, 2, 3]);
+        assert_eq!(sync_task.stats.uploaded_messages.load(Ordering::Relaxed), 3);
+        assert_eq!(sync_task.stats.in_flight_bytes.load(Ordering::Relaxed), 0);
+    }
+
+    #[test_log::test]
+    fn test_sync_out_of_order_completions() {
+        let (mut sync_task, messages) = positioned_sync_task(3, 4);
+        let (result, events) = scripted_sync(&mut sync_task, &[(0, true), (60, true), (30, true)]);
+        assert!(result.is_ok());
+        assert_eq!(
+            events,
+            vec!["sent 0", "sent 1", "sent 2", "done 0", "done 2", "done 1"]
+        );
+        // the third chunk is only flushed along with the second one
+        assert_eq!(messages.borrow().flushes, vec![1, 3]);
+        assert_eq!(sync_task.stats.in_flight_bytes.load(Ordering::Relaxed), 0);
+    }
+
+    #[test_log::test]
+    fn test_sync_failed_upload_is_read_again() {
+        let (mut sync_task, messages) = positioned_sync_task(3, 4);
+        let (result, events) = scripted_sync(&mut sync_task, &[(0, true), (20, false), (40, true)]);
+        assert!(result.is_err());
+        assert_eq!(
+            events,
+            vec!["sent 0", "sent 1", "sent 2", "done 0", "done 1", "done 2"]
+        );
+        // the chunk following the failed one is acknowledged but kept
+        assert_eq!(messages.borrow().flushes, vec![1]);
+        assert_eq!(sync_task.stats.failed_uploads.load(Ordering::Relaxed), 1);
+
+        let (result, events) = scripted_sync(&mut sync_task, &[(0, true), (10, true)]);
+        assert!(result.is_ok());
+        assert_eq!(events, vec!["sent 1", "sent 2", "done 1", "done 2"]);
+        assert_eq!(messages.borrow().flushes, vec![1, 3]);
+    }
+
+    #[test_log::test]
+    #[ignore]
+    fn bench_upload_chunk() {
+        let resource = ResourceType::Sensor(Arc::new(Mutex::new(TestSensor {})));
+        let collector =
+            DataCollector::new("r1".to_string(), resource, CollectionMethod::Readings, 50.0)
+                .unwrap();
+        let collector_key = collector.resource_method_key();
+        let store = StaticMemoryDataStore::new(vec![collector_key.clone()]).unwrap();
+        let manager = DataManager::new(
+            vec![collector],
+            store,
+            Duration::from_secs(1),
+            "boop".to_string(),
+        )
+        .unwrap();
+        let mut sync_task = manager.get_sync_task();
+        let message = TestSensor {}.get_readings_data().unwrap();
+
+        async_io::block_on(async {
+            {
+                let mut store = sync_task.get_store_lock().await;
+                while store
+                    .write_message(&collector_key, message.clone(), WriteMode::PreserveOrFail)
+                    .is_ok()
+                {}
+            }
+            // chunks are read without consuming the messages, every iteration reads the full store
+            let chunk = sync_task.read_chunk(&collector_key, None).await.unwrap();
+            assert!(!chunk.data.is_empty());
+            bench("DataSyncTask chunk assembly", 2_000, || {
+                futures_lite::future::block_on(sync_task.read_chunk(&collector_key, None))
+                    .unwrap()
+                    .data
+                    .len()
+            });
+        });
+    }
+
+    #[test_log::test]
+    #[ignore]
+    fn bench_is_well_formed() {
+        let encoded = nested_sensor_data().encode_to_vec();
+        let result = bench("SensorData validation", 100_000, || {
+            is_well_formed(&encoded)
+        });
+        assert_eq!(result.allocations_per_op, 0.0);
+    }
 }
@@ -4,16 +4,21 @@
 
 use crate::proto::app::data_sync::v1::SensorData;
 use bytes::{Buf, BufMut, BytesMut};
-use prost::{encoding::decode_varint, length_delimiter_len, DecodeError, EncodeError, Message};
+use prost::{
+    encode_length_delimiter, encoding::decode_varint, length_delimiter_len, DecodeError,
+    EncodeError, Message,
+};
 use ringbuf::{ring_buffer::RbBase, Consumer, LocalRb, Producer};
 use scopeguard::defer;
 use std::{
+    cell::{Cell, RefCell},
     mem::MaybeUninit,
     rc::Rc,
-    sync::atomic::{AtomicBool, Ordering},
+    sync::atomic::{AtomicBool, AtomicPtr, AtomicUsize, Ordering},
 };
 use thiserror::Error;
 
+use super::compact_encoding::{CompactCodec, COMPACT_MARKER};
 use super::data_collector::ResourceMethodKey;
 
 #[derive(Debug, Clone, Copy)]
@@ -30,6 +35,10 @@ impl Default for WriteMode {
 
 static mut DATA_STORE: [MaybeUninit<u8>; 10240] = [MaybeUninit::uninit(); 10240];
 
+// Region replacing DATA_STORE when set with `set_data_store_region`
+static DATA_STORE_REGION: AtomicPtr<MaybeUninit<u8>> = AtomicPtr::new(std::ptr::null_mut());
+static DATA_STORE_REGION_LEN: AtomicUsize = AtomicUsize::new(0);
+
 #[derive(Clone, Error, Debug)]
 pub enum DataStoreError {
     #[error("No collector keys supplied")]
@@ -54,12 +63,81 @@ pub enum DataStoreError {
     BufferInUse(ResourceMethodKey),
     #[error("unimplemented")]
     Unimplemented,
+    #[error("invalid weight {1} for collector {0}")]
+    InvalidWeight(ResourceMethodKey, f32),
+    #[error("not enough storage for {0} collectors")]
+    InsufficientStorage(usize),
+    #[error("storage error: {0}")]
+    StorageError(String),
 }
 
 lazy_static::lazy_static! {
     static ref DATA_STORE_INITIALIZED: AtomicBool = AtomicBool::new(false);
 }
 
+/// Replaces the memory backing the StaticMemoryDataStore (by default a static region of 10KB), for
+/// example with a larger region allocated in PSRAM. Should be called while no store exists, the
+/// region will be used by all the stores created afterward.
+pub fn set_data_store_region(region: &'static mut [MaybeUninit<u8>]) -> Result<(), DataStoreError> {
+    if DATA_STORE_INITIALIZED.load(Ordering::Acquire) {
+        return Err(DataStoreError::DataStoreInitialized);
+    }
+    DATA_STORE_REGION_LEN.store(region.len(), Ordering::Relaxed);
+    DATA_STORE_REGION.store(region.as_mut_ptr(), Ordering::Release);
+    Ok(())
+}
+
+fn data_store_region() -> &'static mut [MaybeUninit<u8>] {
+    let region = DATA_STORE_REGION.load(Ordering::Acquire);
+    if region.is_null() {
+        unsafe { &mut *std::ptr::addr_of_mut!(DATA_STORE) }
+    } else {
+        unsafe {
+            std::slice::from_raw_parts_mut(region, DATA_STORE_REGION_LEN.load(Ordering::Relaxed))
+        }
+    }
+}
+
+/// Smallest share of the memory store given to a collector, room for a few readings whatever its
+/// weight
+pub(crate) const MIN_REGION_LEN: usize = 512;
+
+/// Splits `total_len` bytes proportionally to `weights`, every region being at least `min_len`
+/// long. Regions boundaries are rounded down and the last region ends at `total_len`. Returns None
+/// when `total_len` can't hold `min_len` for every region.
+pub(crate) fn weighted_region_lengths(
+    total_len: usize,
+    weights: &[f32],
+    min_len: usize,
+) -> Option<Vec<usize>> {
+    let spare_len = total_len.checked_sub(min_len.checked_mul(weights.len())?)?;
+    let total_weight: f64 = weights.iter().map(|w| *w as f64).sum();
+    let mut cumulative_weight = 0.0_f64;
+    let mut start = 0;
+    Some(
+        weights
+            .iter()
+            .enumerate()
+            .map(|(i, w)| {
+                cumulative_weight += *w as f64;
+                let end = if i == weights.len() - 1 {
+                    spare_len
+                } else {
+                    ((spare_len as f64 * cumulative_weight / total_weight) as usize)
+                        .clamp(start, spare_len)
+                };
+                let len = end - start;
+                start = end;
+                min_len + len
+            })
+            .collect(),
+    )
+}
+
+/// Position in the messages of a collector, it only increases as messages are written and stays
+/// valid when older messages are flushed or overwritten
+pub type ReadPosition = u64;
+
 /// A trait for an entity that is capable of reading from a store without consuming
 /// the messages until a command to flush the read messages is sent
 pub trait DataStoreReader {
@@ -67,6 +145,13 @@ pub trait DataStoreReader {
     /// an empty BytesMut with 0 capacity when there are no available messages left.
     fn read_next_message(&mut self) -> Result<BytesMut, DataStoreError>;
     fn flush(self);
+    /// Position following the last message read
+    fn position(&self) -> ReadPosition;
+    /// Skips the messages before `position`, it has to be a position returned by a reader of the
+    /// same collector
+    fn seek(&mut self, position: ReadPosition);
+    /// Consumes the messages before `position` that are still in the store, whatever was read
+    fn flush_until(self, position: ReadPosition);
 }
 
 pub trait DataStore {
@@ -88,9 +173,30 @@ pub trait DataStore {
     where
         Self: std::marker::Sized;
 
+    /// Initializes from resource-method keys along with the relative share of the store each
+    /// collector should get, stores that don't partition their memory can ignore the weights.
+    fn from_weighted_resource_method_keys(
+        weighted_keys: Vec<(ResourceMethodKey, f32)>,
+    ) -> Result<Self, DataStoreError>
+    where
+        Self: std::marker::Sized,
+    {
+        Self::from_resource_method_keys(weighted_keys.into_iter().map(|(k, _)| k).collect())
+    }
+
     // Gets a reader that should implement `DataStoreReader`
     fn get_reader(&self, collector_key: &ResourceMethodKey)
         -> Result<Self::Reader, DataStoreError>;
+
+    /// Bytes held for the collector that haven't been flushed, stores that can't tell return None
+    fn stored_len(&self, _collector_key: &ResourceMethodKey) -> Option<usize> {
+        None
+    }
+
+    /// Bytes the store can hold for the collector, stores that can't tell return None
+    fn capacity(&self, _collector_key: &ResourceMethodKey) -> Option<usize> {
+        None
+    }
 }
 
 pub type StoreRegion = Rc<LocalRb<u8, &'static mut [MaybeUninit<u8>]>>;
@@ -98,13 +204,18 @@ pub type StoreRegion = Rc<LocalRb<u8, &'static mut [MaybeUninit<u8>]>>;
 /// StaticMemoryDataStore is an entity that governs the static bytes memory
 /// reserved in DATA_STORE. The memory is segmented based according to the DataCollectors expected
 /// (identified by collector keys) and each segment view is treated as a separate ring buffer of SensorData
-/// messages. Currently, an equal amount of space is alloted to each collector, which will affect
+/// messages. By default an equal amount of space is alloted to each collector, which will affect
 /// the maximum allowed size of a single message (computed as the length of DATA_STORE divided by
-/// the number of collector keys). It should be treated as a global struct that should only be initialized once
+/// the number of collector keys), collectors can be weighted to get a larger share with `new_weighted`.
+/// The memory can be replaced with `set_data_store_region`. Collected readings are kept in the compact
+/// encoding of `compact_encoding` and expanded back to SensorData when read. It should be treated as a global struct that should only be initialized once
 /// and is not thread-safe (all interactions should be blocking).
 pub struct StaticMemoryDataStore {
     buffers: Vec<StoreRegion>,
     buffer_usages: Vec<Rc<AtomicBool>>,
+    codecs: Vec<Rc<RefCell<CompactCodec>>>,
+    // bytes that left each buffer (flushed or overwritten), the ReadPosition of its head
+    departed: Vec<Rc<Cell<u64>>>,
     collector_keys: Vec<ResourceMethodKey>,
 }
 
@@ -113,18 +224,37 @@ pub struct StaticMemoryDataStoreReader {
     start_idx: usize,
     current_idx: usize,
     buffer_registration: Rc<AtomicBool>,
+    codec: Rc<RefCell<CompactCodec>>,
+    departed: Rc<Cell<u64>>,
 }
 
 impl StaticMemoryDataStoreReader {
-    fn new(cons: Consumer<u8, StoreRegion>, buffer_registration: Rc<AtomicBool>) -> Self {
+    fn new(
+        cons: Consumer<u8, StoreRegion>,
+        buffer_registration: Rc<AtomicBool>,
+        codec: Rc<RefCell<CompactCodec>>,
+        departed: Rc<Cell<u64>>,
+    ) -> Self {
         let start_idx = cons.rb().head();
         Self {
             cons,
             start_idx,
             current_idx: start_idx,
             buffer_registration,
+            codec,
+            departed,
         }
     }
+
+    // bytes between the head of the buffer and `position`
+    fn bytes_before(&self, position: ReadPosition) -> usize {
+        (position.saturating_sub(self.departed.get()) as usize).min(self.cons.len())
+    }
+
+    fn skip(&mut self, len: usize) {
+        self.cons.skip(len);
+        self.departed.set(self.departed.get() + len as u64);
+    }
 }
 
 impl DataStoreReader for StaticMemoryDataStoreReader {
@@ -145,10 +275,25 @@ impl DataStoreReader for StaticMemoryDataStoreReader {
         let chained_iter = chained.into_iter().take(encoded_len);
         msg_bytes.extend(chained_iter);
         self.current_idx += len_len + encoded_len;
+        if msg_bytes.first() == Some(&COMPACT_MARKER) {
+            let message = self.codec.borrow().decode(&msg_bytes)?;
+            msg_bytes.clear();
+            message.encode(&mut msg_bytes)?;
+        }
         Ok(msg_bytes)
     }
     fn flush(mut self) {
-        self.cons.skip(self.current_idx - self.start_idx);
+        self.skip(self.current_idx - self.start_idx);
+    }
+    fn position(&self) -> ReadPosition {
+        self.departed.get() + (self.current_idx - self.start_idx) as u64
+    }
+    fn seek(&mut self, position: ReadPosition) {
+        self.current_idx = self.start_idx + self.bytes_before(position);
+    }
+    fn flush_until(mut self, position: ReadPosition) {
+        let len = self.bytes_before(position);
+        self.skip(len);
     }
 }
 
@@ -160,29 +305,47 @@ impl Drop for StaticMemoryDataStoreReader {
 
 impl StaticMemoryDataStore {
     pub fn new(collector_keys: Vec<ResourceMethodKey>) -> Result<Self, DataStoreError> {
+        Self::new_weighted(collector_keys.into_iter().map(|k| (k, 1.0)).collect())
+    }
+
+    /// Creates a store where each collector gets a share of the memory proportional to its weight
+    pub fn new_weighted(
+        weighted_keys: Vec<(ResourceMethodKey, f32)>,
+    ) -> Result<Self, DataStoreError> {
         if !DATA_STORE_INITIALIZED.load(Ordering::Acquire) {
-            if collector_keys.is_empty() {
+            if weighted_keys.is_empty() {
                 return Err(DataStoreError::NoCollectors);
             }
-            let len_per_buffer = unsafe { DATA_STORE.len() } / collector_keys.len();
+            if let Some((key, weight)) = weighted_keys
+                .iter()
+                .find(|(_, w)| !w.is_finite() || *w <= 0.0)
+            {
+                return Err(DataStoreError::InvalidWeight(key.clone(), *weight));
+            }
+            let (collector_keys, weights): (Vec<_>, Vec<_>) = weighted_keys.into_iter().unzip();
+            let mut remaining = data_store_region();
+            let lengths = weighted_region_lengths(remaining.len(), &weights, MIN_REGION_LEN)
+                .ok_or(DataStoreError::InsufficientStorage(collector_keys.len()))?;
             let mut buffers = Vec::new();
             let mut buffer_usages = Vec::new();
-            for i in 0..(collector_keys.len()) {
-                let start_idx = i * len_per_buffer;
-                let end_idx = (i + 1) * len_per_buffer;
+            for len in lengths {
+                let (region, rest) = std::mem::take(&mut remaining).split_at_mut(len);
+                remaining = rest;
                 unsafe {
-                    buffers.push(Rc::new(LocalRb::from_raw_parts(
-                        &mut DATA_STORE[start_idx..end_idx],
-                        0,
-                        0,
-                    )));
+                    buffers.push(Rc::new(LocalRb::from_raw_parts(region, 0, 0)));
                 }
                 buffer_usages.push(Rc::new(AtomicBool::new(false)));
             }
+            let departed = collector_keys.iter().map(|_| Rc::default()).collect();
             DATA_STORE_INITIALIZED.store(true, Ordering::Release);
             return Ok(Self {
                 buffers,
                 buffer_usages,
+                codecs: collector_keys
+                    .iter()
+                    .map(|_| Rc::new(RefCell::new(CompactCodec::default())))
+                    .collect(),
+                departed,
                 collector_keys,
             });
         }
@@ -242,7 +405,10 @@ impl DataStore for StaticMemoryDataStore {
         defer! {
             self.unregister_buffer_usage(buffer_index);
         }
-        let encode_len = message.encoded_len();
+        let compact = self.codecs[buffer_index].borrow_mut().encode(&message);
+        let encode_len = compact
+            .as_ref()
+            .map_or_else(|| message.encoded_len(), |record| record.len());
         let total_encode_len = length_delimiter_len(encode_len) + encode_len;
 
         while total_encode_len > buffer.vacant_len() {
@@ -257,12 +423,20 @@ impl DataStore for StaticMemoryDataStore {
             let advance = length_delimiter_len(encoded_len);
             unsafe { cons.advance(advance) };
             cons.skip(encoded_len);
+            let departed = &self.departed[buffer_index];
+            departed.set(departed.get() + (advance + encoded_len) as u64);
         }
         unsafe {
             let mut prod = Producer::new(buffer.clone());
             let (left, right) = prod.free_space_as_slices();
             let mut chained = BufMut::chain_mut(left, right);
-            message.encode_length_delimited(&mut chained)?;
+            match compact {
+                Some(record) => {
+                    encode_length_delimiter(encode_len, &mut chained)?;
+                    chained.put_slice(&record);
+                }
+                None => message.encode_length_delimited(&mut chained)?,
+            }
             prod.advance(total_encode_len);
         }
         Ok(())
@@ -274,6 +448,12 @@ impl DataStore for StaticMemoryDataStore {
         Self::new(collector_keys)
     }
 
+    fn from_weighted_resource_method_keys(
+        weighted_keys: Vec<(ResourceMethodKey, f32)>,
+    ) -> Result<Self, DataStoreError> {
+        Self::new_weighted(weighted_keys)
+    }
+
     fn get_reader(
         &self,
         collector_key: &ResourceMethodKey,
@@ -289,8 +469,20 @@ impl DataStore for StaticMemoryDataStore {
         Ok(StaticMemoryDataStoreReader::new(
             unsafe { Consumer::new(buffer) },
             buffer_registration,
+            Rc::clone(&self.codecs[buffer_index]),
+            Rc::clone(&self.departed[buffer_index]),
         ))
     }
+
+    fn stored_len(&self, collector_key: &ResourceMethodKey) -> Option<usize> {
+        let buffer_index = self.get_index_for_collector(collector_key).ok()?;
+        Some(self.buffers[buffer_index].occupied_len())
+    }
+
+    fn capacity(&self, collector_key: &ResourceMethodKey) -> Option<usize> {
+        let buffer_index = self.get_index_for_collector(collector_key).ok()?;
+        Some(self.buffers[buffer_index].capacity_nonzero().get())
+    }
 }
 
 impl Drop for StaticMemoryDataStore {
@@ -315,6 +507,36 @@ mod tests {
     use crate::proto::app::data_sync::v1::{SensorData, SensorMetadata};
     use prost::{length_delimiter_len, Message};
 
+    use crate::common::bench::bench;
+
+    #[test_log::test]
+    fn test_weighted_region_lengths() {
+        assert_eq!(
+            super::weighted_region_lengths(10240, &[1.0, 1.0], 0),
+            Some(vec![5120, 5120])
+        );
+        assert_eq!(
+            super::weighted_region_lengths(10240, &[1.0, 3.0], 0),
+            Some(vec![2560, 7680])
+        );
+        let lengths = super::weighted_region_lengths(1000, &[1.0, 1.0, 1.0], 0).unwrap();
+        assert_eq!(lengths, vec![333, 333, 334]);
+        assert_eq!(lengths.iter().sum::<usize>(), 1000);
+        // a tiny weight still gets the minimal region
+        assert_eq!(
+            super::weighted_region_lengths(100, &[0.001, 1000.0], 10),
+            Some(vec![10, 90])
+        );
+        assert_eq!(
+            super::weighted_region_lengths(10240, &[1.0, 3.0], 1024),
+            Some(vec![3072, 7168])
+        );
+        assert_eq!(
+            super::weighted_region_lengths(100, &[1.0, 1.0, 1.0], 40),
+            None
+        );
+    }
+
     #[test_log::test]
     fn test_data_store() {
         // test failure on attempt to initialize with no collectors
@@ -704,5 +926,114 @@ mod tests {
             );
             assert!(res.is_ok());
         }
+
+        // positions stay valid while messages are overwritten
+        let count_messages = |reader: &mut super::StaticMemoryDataStoreReader| {
+            let mut count = 0;
+            while !reader.read_next_message().unwrap().is_empty() {
+                count += 1;
+            }
+            count
+        };
+        let mut reader = store.get_reader(&collector_key).unwrap();
+        let start = reader.position();
+        assert!(!reader.read_next_message().unwrap().is_empty());
+        let position = reader.position();
+        assert_eq!(position - start, message_byte_size_total as u64);
+        std::mem::drop(reader);
+
+        let mut reader = store.get_reader(&collector_key).unwrap();
+        reader.seek(position);
+        assert_eq!(reader.position(), position);
+        assert_eq!(count_messages(&mut reader), message_capacity_for_buffer - 1);
+        std::mem::drop(reader);
+
+        let res = store.write_message(&collector_key, data.clone(), WriteMode::OverwriteOldest);
+        assert!(res.is_ok());
+        // the message before `position` was overwritten, nothing else is consumed
+        store
+            .get_reader(&collector_key)
+            .unwrap()
+            .flush_until(position);
+        let mut reader = store.get_reader(&collector_key).unwrap();
+        assert_eq!(reader.position(), position);
+        assert_eq!(count_messages(&mut reader), message_capacity_for_buffer);
+        std::mem::drop(reader);
+        assert_eq!(
+            store.stored_len(&collector_key),
+            Some(message_capacity_for_buffer * message_byte_size_total)
+        );
+        assert!(
+            store.capacity(&collector_key).unwrap()
+                >= message_capacity_for_buffer * message_byte_size_total
+        );
+
+        let mut reader = store.get_reader(&collector_key).unwrap();
+        reader.seek(position + message_byte_size_total as u64);
+        let end = {
+            count_messages(&mut reader);
+            reader.position()
+        };
+        reader.flush_until(position + 2 * message_byte_size_total as u64);
+        let mut reader = store.get_reader(&collector_key).unwrap();
+        assert_eq!(count_messages(&mut reader), message_capacity_for_buffer - 2);
+        assert_eq!(reader.position(), end);
+    }
+
+    #[test_log::test]
+    #[ignore]
+    fn bench_data_store() {
+        let collector_key = ResourceMethodKey {
+            r_name: "thing".to_string(),
+            component_type: "rdk::component::sensor".to_string(),
+            method: CollectionMethod::Readings,
+        };
+        let mut store = super::StaticMemoryDataStore::new(vec![collector_key.clone()]).unwrap();
+        let data = SensorData {
+            metadata: Some(SensorMetadata {
+                time_requested: Some(Timestamp {
+                    seconds: 1_700_000_000,
+                    nanos: 1_000,
+                }),
+                time_received: Some(Timestamp {
+                    seconds: 1_700_000_000,
+                    nanos: 2_000,
+                }),
+            }),
+            data: Some(Data::Struct(Struct {
+                fields: HashMap::from([(
+                    "readings".to_string(),
+                    Value {
+                        kind: Some(Kind::StructValue(Struct {
+                            fields: (0..8)
+                                .map(|i| {
+                                    (
+                                        format!("reading_{}", i),
+                                        Value {
+                                            kind: Some(Kind::NumberValue(i as f64 * 1.5)),
+                                        },
+                                    )
+                                })
+                                .collect(),
+                        })),
+                    },
+                )]),
+            })),
+        };
+
+        // writes take the message, its clone is part of what is measured
+        bench("StaticMemoryDataStore write", 50_000, || {
+            store
+                .write_message(&collector_key, data.clone(), WriteMode::OverwriteOldest)
+                .unwrap()
+        });
+        // reads don't consume, every iteration reads the oldest message again
+        bench("StaticMemoryDataStore read", 50_000, || {
+            store
+                .get_reader(&collector_key)
+                .unwrap()
+                .read_next_message()
+                .unwrap()
+        });
     }
 }
@@ -0,0 +1,720 @@
+//! A DataStore persisting collected data in flash so it survives reboots and long periods without
+//! connectivity.
+//!
+//! The storage (see `FlashRegion`) is split in sectors, each collector owns a contiguous range of
+//! sectors used as a circular log. A sector starts with a header holding a sequence number (used to
+//! recover the order of the log at boot) and the hash of the collector key owning it, followed by
+//! length delimited SensorData records. Records are never rewritten: consuming a record only clears
+//! bits of its state byte and sectors are erased once, right before being reused, so erases are
+//! spread evenly over the range of the collector.
+use std::{
+    cell::RefCell,
+    collections::VecDeque,
+    rc::Rc,
+    sync::atomic::{AtomicBool, Ordering},
+};
+
+use bytes::BytesMut;
+use prost::Message;
+
+use super::{
+    data_collector::ResourceMethodKey,
+    data_store::{
+        weighted_region_lengths, DataStore, DataStoreError, DataStoreReader, ReadPosition,
+        WriteMode,
+    },
+};
+use crate::proto::app::data_sync::v1::SensorData;
+
+const SECTOR_MAGIC: u32 = 0x5644_5331;
+const SECTOR_HEADER_LEN: usize = 12;
+const RECORD_HEADER_LEN: usize = 3;
+const ERASED_LEN: u16 = u16::MAX;
+
+const RECORD_ERASED: u8 = 0xFF;
+const RECORD_VALID: u8 = 0xFE;
+const RECORD_CONSUMED: u8 = 0x00;
+
+/// Storage with the semantics of NOR flash: it is erased one sector at a time (setting every byte
+/// to 0xFF) and erased bytes are programmed once
+pub trait FlashRegion {
+    /// Opens the region backing stores created with `DataStore::from_resource_method_keys`
+    fn open() -> Result<Self, DataStoreError>
+    where
+        Self: Sized;
+    /// Size in bytes of the erase unit
+    fn sector_size(&self) -> usize;
+    fn sector_count(&self) -> usize;
+    fn read(&mut self, offset: usize, buf: &mut [u8]) -> Result<(), DataStoreError>;
+    /// Programs `data` at `offset`, bits may only go from 1 to 0
+    fn write(&mut self, offset: usize, data: &[u8]) -> Result<(), DataStoreError>;
+    fn erase_sector(&mut self, sector: usize) -> Result<(), DataStoreError>;
+}
+
+// FNV-1a, the hash has to be stable across builds since it is persisted
+fn collector_key_hash(key: &ResourceMethodKey) -> u32 {
+    [
+        key.component_type.as_bytes(),
+        b"/",
+        key.r_name.as_bytes(),
+        b"/",
+        key.method.to_string().as_bytes(),
+    ]
+    .iter()
+    .flat_map(|part| part.iter())
+    .fold(0x811c_9dc5_u32, |hash, b| {
+        (hash ^ *b as u32).wrapping_mul(0x0100_0193)
+    })
+}
+
+struct RecordHeader {
+    state: u8,
+    len: u16,
+}
+
+impl RecordHeader {
+    fn is_erased(&self) -> bool {
+        self.state == RECORD_ERASED && self.len == ERASED_LEN
+    }
+}
+
+struct UsedSector {
+    sector: usize,
+    seq: u32,
+}
+
+/// State of the circular log of one collector
+struct CollectorLog {
+    key_hash: u32,
+    first_sector: usize,
+    sector_count: usize,
+    /// sectors holding data, oldest first, records are appended to the last one
+    used: VecDeque<UsedSector>,
+    /// last sector written to (relative to `first_sector`), kept once the log is empty so writes keep
+    /// rotating through the whole range
+    tail: usize,
+    write_offset: usize,
+    next_seq: u32,
+}
+
+impl CollectorLog {
+    fn sector_offset<R: FlashRegion>(&self, region: &R, sector: usize) -> usize {
+        (self.first_sector + sector) * region.sector_size()
+    }
+
+    fn read_record_header<R: FlashRegion>(
+        &self,
+        region: &mut R,
+        sector: usize,
+        offset: usize,
+    ) -> Result<Option<RecordHeader>, DataStoreError> {
+        if offset + RECORD_HEADER_LEN > region.sector_size() {
+            return Ok(None);
+        }
+        let mut header = [0_u8; RECORD_HEADER_LEN];
+        region.read(self.sector_offset(region, sector) + offset, &mut header)?;
+        let header = RecordHeader {
+            state: header[0],
+            len: u16::from_le_bytes([header[1], header[2]]),
+        };
+        // a record started but never committed also ends the sector
+        if header.state == RECORD_ERASED {
+            return Ok(if header.is_erased() {
+                None
+            } else {
+                Some(header)
+            });
+        }
+        if offset + RECORD_HEADER_LEN + header.len as usize > region.sector_size() {
+            return Err(DataStoreError::DataIntegrityError);
+        }
+        Ok(Some(header))
+    }
+
+    /// Rebuilds the log from the content of its sectors
+    fn recover<R: FlashRegion>(
+        region: &mut R,
+        key_hash: u32,
+        first_sector: usize,
+        sector_count: usize,
+    ) -> Result<Self, DataStoreError> {
+        let mut log = CollectorLog {
+            key_hash,
+            first_sector,
+            sector_count,
+            used: VecDeque::new(),
+            tail: sector_count - 1,
+            write_offset: region.sector_size(),
+            next_seq: 0,
+        };
+        let mut used = vec![];
+        for sector in 0..sector_count {
+            let mut header = [0_u8; SECTOR_HEADER_LEN];
+            region.read(log.sector_offset(region, sector), &mut header)?;
+            let magic = u32::from_le_bytes(header[0..4].try_into().unwrap());
+            let seq = u32::from_le_bytes(header[4..8].try_into().unwrap());
+            let hash = u32::from_le_bytes(header[8..12].try_into().unwrap());
+            // sectors of other collectors (or of a previous layout) are free
+            if magic == SECTOR_MAGIC && hash == key_hash {
+                used.push(UsedSector { sector, seq });
+            }
+        }
+        used.sort_by_key(|s| s.seq);
+        log.used = used.into();
+        if let Some((tail, seq)) = log.used.back().map(|last| (last.sector, last.seq)) {
+            log.tail = tail;
+            log.next_seq = seq.wrapping_add(1);
+            let mut offset = SECTOR_HEADER_LEN;
+            loop {
+                match log.read_record_header(region, tail, offset) {
+                    Ok(Some(header)) if header.state != RECORD_ERASED => {
+                        offset += RECORD_HEADER_LEN + header.len as usize
+                    }
+                    Ok(None) => break,
+                    // torn write or corrupted record, the rest of the sector can't be trusted
+                    _ => {
+                        offset = region.sector_size();
+                        break;
+                    }
+                }
+            }
+            log.write_offset = offset;
+        }
+        while log.used.len() > 1 && !log.has_valid_records(region, 0)? {
+            log.used.pop_front();
+        }
+        Ok(log)
+    }
+
+    fn has_valid_records<R: FlashRegion>(
+        &self,
+        region: &mut R,
+        index: usize,
+    ) -> Result<bool, DataStoreError> {
+        let sector = self.used[index].sector;
+        let mut offset = SECTOR_HEADER_LEN;
+        while let Some(header) = self.read_record_header(region, sector, offset)? {
+            match header.state {
+                RECORD_VALID => return Ok(true),
+                RECORD_ERASED => break,
+                _ => offset += RECORD_HEADER_LEN + header.len as usize,
+            }
+        }
+        Ok(false)
+    }
+
+    /// Erases the next sector of the range and starts writing into it, dropping the oldest sectors
+    /// if needed and allowed by `write_mode`
+    fn start_sector<R: FlashRegion>(
+        &mut self,
+        region: &mut R,
+        write_mode: &WriteMode,
+    ) -> Result<bool, DataStoreError> {
+        let next = (self.tail + 1) % self.sector_count;
+        while self.used.iter().any(|s| s.sector == next) {
+            if !matches!(write_mode, WriteMode::OverwriteOldest) {
+                return Ok(false);
+            }
+            self.used.pop_front();
+        }
+        region.erase_sector(self.first_sector + next)?;
+        let mut header = [0_u8; SECTOR_HEADER_LEN];
+        header[0..4].copy_from_slice(&SECTOR_MAGIC.to_le_bytes());
+        header[4..8].copy_from_slice(&self.next_seq.to_le_bytes());
+        header[8..12].copy_from_slice(&self.key_hash.to_le_bytes());
+        region.write(self.sector_offset(region, next), &header)?;
+        self.used.push_back(UsedSector {
+            sector: next,
+            seq: self.next_seq,
+        });
+        self.next_seq = self.next_seq.wrapping_add(1);
+        self.tail = next;
+        self.write_offset = SECTOR_HEADER_LEN;
+        Ok(true)
+    }
+
+    fn append<R: FlashRegion>(
+        &mut self,
+        region: &mut R,
+        message: &SensorData,
+        write_mode: &WriteMode,
+    ) -> Result<bool, DataStoreError> {
+        let len = message.encoded_len();
+        let record_len = RECORD_HEADER_LEN + len;
+        if SECTOR_HEADER_LEN + record_len > region.sector_size() || len >= ERASED_LEN as usize {
+            return Err(DataStoreError::DataTooLarge);
+        }
+        if (self.used.is_empty() || self.write_offset + record_len > region.sector_size())
+            && !self.start_sector(region, write_mode)?
+        {
+            return Ok(false);
+        }
+        let mut buf = Vec::with_capacity(record_len - 1);
+        buf.extend_from_slice(&(len as u16).to_le_bytes());
+        message.encode(&mut buf)?;
+        let offset = self.sector_offset(region, self.tail) + self.write_offset;
+        // the state byte is programmed last, committing the record
+        region.write(offset + 1, &buf)?;
+        region.write(offset, &[RECORD_VALID])?;
+        self.write_offset += record_len;
+        Ok(true)
+    }
+}
+
+/// DataStore keeping collected data in a `FlashRegion`, the region is shared between collectors
+/// according to their weights. A single message has to fit in one sector.
+pub struct FlashDataStore<R> {
+    region: Rc<RefCell<R>>,
+    logs: Vec<Rc<RefCell<CollectorLog>>>,
+    buffer_usages: Vec<Rc<AtomicBool>>,
+    collector_keys: Vec<ResourceMethodKey>,
+}
+
+impl<R: FlashRegion> FlashDataStore<R> {
+    /// Creates a store on `region`, recovering the data previously stored for these collectors
+    pub fn new(
+        mut region: R,
+        weighted_keys: Vec<(ResourceMethodKey, f32)>,
+    ) -> Result<Self, DataStoreError> {
+        if weighted_keys.is_empty() {
+            return Err(DataStoreError::NoCollectors);
+        }
+        if let Some((key, weight)) = weighted_keys
+            .iter()
+            .find(|(_, w)| !w.is_finite() || *w <= 0.0)
+        {
+            return Err(DataStoreError::InvalidWeight(key.clone(), *weight));
+        }
+        let (collector_keys, weights): (Vec<_>, Vec<_>) = weighted_keys.into_iter().unzip();
+        // every collector needs at least a sector
+        let sector_counts = weighted_region_lengths(region.sector_count(), &weights, 1)
+            .ok_or(DataStoreError::InsufficientStorage(collector_keys.len()))?;
+        let mut logs = vec![];
+        let mut first_sector = 0;
+        for (key, sector_count) in collector_keys.iter().zip(sector_counts) {
+            let log = CollectorLog::recover(
+                &mut region,
+                collector_key_hash(key),
+                first_sector,
+                sector_count,
+            )?;
+            logs.push(Rc::new(RefCell::new(log)));
+            first_sector += sector_count;
+        }
+        Ok(Self {
+            region: Rc::new(RefCell::new(region)),
+            logs,
+            buffer_usages: collector_keys
+                .iter()
+                .map(|_| Rc::new(AtomicBool::new(false)))
+                .collect(),
+            collector_keys,
+        })
+    }
+
+    fn get_index_for_collector(
+        &self,
+        collector_key: &ResourceMethodKey,
+    ) -> Result<usize, DataStoreError> {
+        self.collector_keys
+            .iter()
+            .position(|key| key == collector_key)
+            .ok_or(DataStoreError::UnknownCollectorKey(collector_key.clone()))
+    }
+}
+
+impl<R: FlashRegion> DataStore for FlashDataStore<R> {
+    type Reader = FlashDataStoreReader<R>;
+
+    fn write_message(
+        &mut self,
+        collector_key: &ResourceMethodKey,
+        message: SensorData,
+        write_mode: WriteMode,
+    ) -> Result<(), DataStoreError> {
+        let index = self.get_index_for_collector(collector_key)?;
+        if self.buffer_usages[index].load(Ordering::Relaxed) {
+            return Err(DataStoreError::BufferInUse(collector_key.clone()));
+        }
+        let mut region = self.region.borrow_mut();
+        if !self.logs[index]
+            .borrow_mut()
+            .append(&mut *region, &message, &write_mode)?
+        {
+            return Err(DataStoreError::DataBufferFull(collector_key.clone()));
+        }
+        Ok(())
+    }
+
+    fn from_resource_method_keys(
+        collector_keys: Vec<ResourceMethodKey>,
+    ) -> Result<Self, DataStoreError> {
+        Self::from_weighted_resource_method_keys(
+            collector_keys.into_iter().map(|k| (k, 1.0)).collect(),
+        )
+    }
+
+    fn from_weighted_resource_method_keys(
+        weighted_keys: Vec<(ResourceMethodKey, f32)>,
+    ) -> Result<Self, DataStoreError> {
+        Self::new(R::open()?, weighted_keys)
+    }
+
+    fn get_reader(
+        &self,
+        collector_key: &ResourceMethodKey,
+    ) -> Result<FlashDataStoreReader<R>, DataStoreError> {
+        let index = self.get_index_for_collector(collector_key)?;
+        if self.buffer_usages[index].load(Ordering::Relaxed) {
+            return Err(DataStoreError::BufferInUse(collector_key.clone()));
+        }
+        self.buffer_usages[index].store(true, Ordering::Relaxed);
+        Ok(FlashDataStoreReader {
+            region: self.region.clone(),
+            log: self.logs[index].clone(),
+            cursor: (0, SECTOR_HEADER_LEN),
+            buffer_registration: self.buffer_usages[index].clone(),
+        })
+    }
+
+    /// Counts whole sectors, including the records of the oldest sector already consumed
+    fn stored_len(&self, collector_key: &ResourceMethodKey) -> Option<usize> {
+        let index = self.get_index_for_collector(collector_key).ok()?;
+        let collector_log = self.logs[index].borrow();
+        let sector_size = self.region.borrow().sector_size();
+        Some(match collector_log.used.len() {
+            0 => 0,
+            n => (n - 1) * sector_size + collector_log.write_offset,
+        })
+    }
+
+    fn capacity(&self, collector_key: &ResourceMethodKey) -> Option<usize> {
+        let index = self.get_index_for_collector(collector_key).ok()?;
+        Some(self.logs[index].borrow().sector_count * self.region.borrow().sector_size())
+    }
+}
+
+pub struct FlashDataStoreReader<R> {
+    region: Rc<RefCell<R>>,
+    log: Rc<RefCell<CollectorLog>>,
+    /// index in the used sectors of the log and offset in that sector of the next record to read,
+    /// the log doesn't change while a reader exists
+    cursor: (usize, usize),
+    buffer_registration: Rc<AtomicBool>,
+}
+
+impl<R: FlashRegion> FlashDataStoreReader<R> {
+    // a position is the sequence number of a sector and an offset in it
+    fn cursor_for(&self, position: ReadPosition) -> (usize, usize) {
+        let (seq, offset) = ((position >> 32) as u32, position as u32 as usize);
+        let collector_log = self.log.borrow();
+        match collector_log.used.iter().position(|s| s.seq >= seq) {
+            Some(index) if collector_log.used[index].seq == seq => (index, offset),
+            Some(index) => (index, SECTOR_HEADER_LEN),
+            None => (collector_log.used.len(), SECTOR_HEADER_LEN),
+        }
+    }
+
+    /// Marks the records before `cursor` as consumed and releases the sectors left behind
+    fn consume(&self, cursor: (usize, usize)) {
+        let mut collector_log = self.log.borrow_mut();
+        let mut region = self.region.borrow_mut();
+        let mut position = (0, SECTOR_HEADER_LEN);
+        while position < cursor && position.0 < collector_log.used.len() {
+            let sector = collector_log.used[position.0].sector;
+            let header = match collector_log.read_record_header(&mut *region, sector, position.1) {
+                Ok(Some(header)) if header.state != RECORD_ERASED => header,
+                Ok(_) => {
+                    position = (position.0 + 1, SECTOR_HEADER_LEN);
+                    continue;
+                }
+                Err(err) => {
+                    log::error!("error flushing data store: {:?}", err);
+                    return;
+                }
+            };
+            if header.state == RECORD_VALID {
+                let offset = collector_log.sector_offset(&*region, sector) + position.1;
+                if let Err(err) = region.write(offset, &[RECORD_CONSUMED]) {
+                    log::error!("error flushing data store: {:?}", err);
+                    return;
+                }
+            }
+            position.1 += RECORD_HEADER_LEN + header.len as usize;
+        }
+        // sectors fully read are released, the last one is kept to avoid an erase per flush
+        let released = cursor.0.min(collector_log.used.len().saturating_sub(1));
+        collector_log.used.drain(..released);
+    }
+}
+
+impl<R: FlashRegion> DataStoreReader for FlashDataStoreReader<R> {
+    fn read_next_message(&mut self) -> Result<BytesMut, DataStoreError> {
+        let collector_log = self.log.borrow();
+        let mut region = self.region.borrow_mut();
+        while self.cursor.0 < collector_log.used.len() {
+            let (index, offset) = self.cursor;
+            let sector = collector_log.used[index].sector;
+            match collector_log.read_record_header(&mut *region, sector, offset)? {
+                Some(header) if header.state != RECORD_ERASED => {
+                    self.cursor.1 += RECORD_HEADER_LEN + header.len as usize;
+                    if header.state == RECORD_VALID {
+                        let mut msg = BytesMut::zeroed(header.len as usize);
+                        let payload_offset = collector_log.sector_offset(&*region, sector)
+                            + offset
+                            + RECORD_HEADER_LEN;
+                        region.read(payload_offset, &mut msg)?;
+                        return Ok(msg);
+                    }
+                }
+                // the cursor stays at the end of the last sector so its position is before the
+                // records appended later
+                _ if index + 1 == collector_log.used.len() => break,
+                _ => self.cursor = (index + 1, SECTOR_HEADER_LEN),
+            }
+        }
+        Ok(BytesMut::with_capacity(0))
+    }
+
+    fn flush(self) {
+        self.consume(self.cursor);
+    }
+
+    fn position(&self) -> ReadPosition {
+        let collector_log = self.log.borrow();
+        let (seq, offset) = match collector_log.used.get(self.cursor.0) {
+            Some(used) => (used.seq, self.cursor.1),
+            // records written later go to a new sector
+            None => (collector_log.next_seq, SECTOR_HEADER_LEN),
+        };
+        ((seq as u64) << 32) | offset as u64
+    }
+
+    fn seek(&mut self, position: ReadPosition) {
+        let cursor = self.cursor_for(position);
+        self.cursor = self.cursor.max(cursor);
+    }
+
+    fn flush_until(self, position: ReadPosition) {
+        self.consume(self.cursor_for(position));
+    }
+}
+
+impl<R> Drop for FlashDataStoreReader<R> {
+    fn drop(&mut self) {
+        self.buffer_registration.store(false, Ordering::Relaxed);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::collections::HashMap;
+
+    use super::{FlashDataStore, FlashRegion};
+    use crate::common::data_collector::{CollectionMethod, ResourceMethodKey};
+    use crate::common::data_store::{DataStore, DataStoreError, DataStoreReader, WriteMode};
+    use crate::google::protobuf::{value::Kind, Struct, Value};
+    use crate::proto::app::data_sync::v1::{sensor_data::Data, SensorData};
+    use prost::Message;
+
+    const SECTOR_SIZE: usize = 256;
+
+    #[derive(Clone)]
+    struct MemoryRegion {
+        bytes: Vec<u8>,
+        erase_counts: Vec<usize>,
+    }
+
+    impl MemoryRegion {
+        fn new(sector_count: usize) -> Self {
+            Self {
+                bytes: vec![0xFF; sector_count * SECTOR_SIZE],
+                erase_counts: vec![0; sector_count],
+            }
+        }
+    }
+
+    impl FlashRegion for MemoryRegion {
+        fn open() -> Result<Self, DataStoreError> {
+            Err(DataStoreError::Unimplemented)
+        }
+        fn sector_size(&self) -> usize {
+            SECTOR_SIZE
+        }
+        fn sector_count(&self) -> usize {
+            self.erase_counts.len()
+        }
+        fn read(&mut self, offset: usize, buf: &mut [u8]) -> Result<(), DataStoreError> {
+            buf.copy_from_slice(&self.bytes[offset..offset + buf.len()]);
+            Ok(())
+        }
+        fn write(&mut self, offset: usize, data: &[u8]) -> Result<(), DataStoreError> {
+            // NOR flash can only clear bits
+            for (byte, new) in self.bytes[offset..offset + data.len()].iter_mut().zip(data) {
+                *byte &= *new;
+            }
+            Ok(())
+        }
+        fn erase_sector(&mut self, sector: usize) -> Result<(), DataStoreError> {
+            self.bytes[sector * SECTOR_SIZE..(sector + 1) * SECTOR_SIZE].fill(0xFF);
+            self.erase_counts[sector] += 1;
+            Ok(())
+        }
+    }
+
+    fn key(name: &str) -> ResourceMethodKey {
+        ResourceMethodKey {
+            r_name: name.to_string(),
+            component_type: "rdk:component:sensor".to_string(),
+            method: CollectionMethod::Readings,
+        }
+    }
+
+    fn message(value: f64) -> SensorData {
+        SensorData {
+            metadata: None,
+            data: Some(Data::Struct(Struct {
+                fields: HashMap::from([(
+                    "value".to_string(),
+                    Value {
+                        kind: Some(Kind::NumberValue(value)),
+                    },
+                )]),
+            })),
+        }
+    }
+
+    fn drain(store: &FlashDataStore<MemoryRegion>, key: &ResourceMethodKey) -> Vec<SensorData> {
+        let mut reader = store.get_reader(key).unwrap();
+        let mut messages = vec![];
+        loop {
+            let msg = reader.read_next_message().unwrap();
+            if msg.is_empty() {
+                break;
+            }
+            messages.push(SensorData::decode(msg).unwrap());
+        }
+        reader.flush();
+        messages
+    }
+
+    #[test_log::test]
+    fn test_flash_data_store() {
+        let (a, b) = (key("a"), key("b"));
+        let mut store = FlashDataStore::new(
+            MemoryRegion::new(8),
+            vec![(a.clone(), 1.0), (b.clone(), 1.0)],
+        )
+        .unwrap();
+
+        for i in 0..20 {
+            store
+                .write_message(&a, message(i as f64), WriteMode::OverwriteOldest)
+                .unwrap();
+        }
+        store
+            .write_message(&b, message(100.0), WriteMode::OverwriteOldest)
+            .unwrap();
+
+        // data survives a reboot
+        let region = store.region.borrow().clone();
+        let mut store =
+            FlashDataStore::new(region, vec![(a.clone(), 1.0), (b.clone(), 1.0)]).unwrap();
+        let messages = drain(&store, &a);
+        assert_eq!(messages.len(), 20);
+        assert_eq!(messages[0], message(0.0));
+        assert_eq!(messages[19], message(19.0));
+        assert_eq!(drain(&store, &b), vec![message(100.0)]);
+
+        // flushed data isn't read again, even after a reboot
+        assert!(drain(&store, &a).is_empty());
+        store
+            .write_message(&a, message(20.0), WriteMode::OverwriteOldest)
+            .unwrap();
+        let region = store.region.borrow().clone();
+        let store = FlashDataStore::new(region, vec![(a.clone(), 1.0), (b.clone(), 1.0)]).unwrap();
+        assert_eq!(drain(&store, &a), vec![message(20.0)]);
+        assert!(drain(&store, &b).is_empty());
+    }
+
+    #[test_log::test]
+    fn test_flash_data_store_positions() {
+        let a = key("a");
+        let mut store = FlashDataStore::new(MemoryRegion::new(8), vec![(a.clone(), 1.0)]).unwrap();
+        for i in 0..20 {
+            store
+                .write_message(&a, message(i as f64), WriteMode::OverwriteOldest)
+                .unwrap();
+        }
+        let mut reader = store.get_reader(&a).unwrap();
+        for _ in 0..5 {
+            assert!(!reader.read_next_message().unwrap().is_empty());
+        }
+        let acked = reader.position();
+        while !reader.read_next_message().unwrap().is_empty() {}
+        let end = reader.position();
+        std::mem::drop(reader);
+
+        // records appended after the end of the data aren't before its position
+        for i in 20..23 {
+            store
+                .write_message(&a, message(i as f64), WriteMode::OverwriteOldest)
+                .unwrap();
+        }
+        let mut reader = store.get_reader(&a).unwrap();
+        reader.seek(end);
+        let msg = reader.read_next_message().unwrap();
+        assert_eq!(SensorData::decode(msg).unwrap(), message(20.0));
+        std::mem::drop(reader);
+
+        store.get_reader(&a).unwrap().flush_until(acked);
+        let messages = drain(&store, &a);
+        assert_eq!(messages.len(), 18);
+        assert_eq!(messages[0], message(5.0));
+        assert_eq!(messages[17], message(22.0));
+        assert!(store.stored_len(&a).unwrap() > 0);
+    }
+
+    #[test_log::test]
+    fn test_flash_data_store_full() {
+        let a = key("a");
+        let mut store = FlashDataStore::new(MemoryRegion::new(4), vec![(a.clone(), 1.0)]).unwrap();
+        let mut written = 0;
+        while store
+            .write_message(&a, message(written as f64), WriteMode::PreserveOrFail)
+            .is_ok()
+        {
+            written += 1;
+        }
+        assert!(matches!(
+            store.write_message(&a, message(0.0), WriteMode::PreserveOrFail),
+            Err(DataStoreError::DataBufferFull(_))
+        ));
+
+        // overwriting drops the oldest sector and wears every sector evenly
+        for i in 0..(written * 10) {
+            store
+                .write_message(&a, message(i as f64), WriteMode::OverwriteOldest)
+                .unwrap();
+        }
+        let messages = drain(&store, &a);
+        assert!(!messages.is_empty() && messages.len() <= written);
+        assert_eq!(messages.last(), Some(&message((written * 10 - 1) as f64)));
+        let region = store.region.borrow();
+        let erase_counts = &region.erase_counts;
+        let (min, max) = (
+            erase_counts.iter().min().unwrap(),
+            erase_counts.iter().max().unwrap(),
+        );
+        assert!(max - min <= 1);
+
+        let too_large = SensorData {
+            metadata: None,
+            data: Some(Data::Binary(vec![0; 512])),
+        };
+        assert!(matches!(
+            store.write_message(&a, too_large, WriteMode::OverwriteOldest),
+            Err(DataStoreError::DataTooLarge)
+        ));
+    }
+}
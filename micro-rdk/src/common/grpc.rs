@@ -1,9 +1,13 @@
 use core::fmt;
 use std::{
+    collections::HashMap,
     convert::Infallible,
     fmt::Debug,
     marker::PhantomData,
-    sync::{Arc, Mutex},
+    sync::{
+        atomic::{AtomicU32, Ordering},
+        Arc, Mutex,
+    },
     time::{Duration, Instant},
 };
 
@@ -32,12 +36,23 @@ use std::rc::Rc;
 use std::task::{Context, Poll};
 use thiserror::Error;
 
+use super::buffer_pool::BufferPool;
+use super::readings_encoding;
+use super::readings_stream::{stream_period, STREAM_READINGS_PATH};
+use super::sensor::GenericReadingsResult;
 use super::webrtc::grpc::WebRtcGrpcService;
 
 #[cfg(feature = "camera")]
-static GRPC_BUFFER_SIZE: usize = 1024 * 30; // 30KB
+const GRPC_BUFFER_SIZE: usize = 1024 * 30; // 30KB
 #[cfg(not(feature = "camera"))]
-static GRPC_BUFFER_SIZE: usize = 4096;
+const GRPC_BUFFER_SIZE: usize = 4096;
+
+/// Response buffers of closed connections, reused by the next ones
+pub static GRPC_BUFFERS: BufferPool = BufferPool::new(GRPC_BUFFER_SIZE, 2);
+
+/// Bytes left free in front of every encoded response, so a transport can write its own framing
+/// in place instead of copying the message (see `WebRtcGrpcServer::send_rpc_response`)
+pub(crate) const RESPONSE_HEADROOM: usize = 32;
 
 #[derive(Clone, Debug)]
 pub struct GrpcBody {
@@ -118,6 +133,15 @@ impl Body for GrpcBody {
 
 pub trait GrpcResponse {
     fn put_data(&mut self, data: Bytes);
+    /// Stores a response made of `RESPONSE_HEADROOM` free bytes followed by the gRPC message
+    fn put_frame(&mut self, mut frame: BytesMut) {
+        let _ = frame.split_to(RESPONSE_HEADROOM);
+        self.put_data(frame.freeze());
+    }
+    /// Takes the response stored by `put_frame`, headroom included, when it was kept as is
+    fn take_frame(&mut self) -> Option<BytesMut> {
+        None
+    }
     fn insert_trailer(&mut self, key: &'static str, value: &'_ str);
     fn set_status(&mut self, code: i32, message: Option<String>);
     fn get_data(&mut self) -> Bytes;
@@ -128,6 +152,8 @@ pub struct GrpcServer<R> {
     pub(crate) response: R,
     pub(crate) buffer: Rc<RefCell<BytesMut>>,
     robot: Arc<Mutex<LocalRobot>>,
+    // generation of the readings last sent by each readings stream
+    readings_streams: HashMap<u32, u64>,
 }
 
 impl<R> Debug for GrpcServer<R>
@@ -148,13 +174,27 @@ where
     R: GrpcResponse,
 {
     pub fn new(robot: Arc<Mutex<LocalRobot>>, body: R) -> Self {
+        // the buffer is allocated by the first request when the pool is empty
         GrpcServer {
             response: body,
-            buffer: Rc::new(RefCell::new(BytesMut::with_capacity(GRPC_BUFFER_SIZE))),
+            buffer: Rc::new(RefCell::new(GRPC_BUFFERS.take().unwrap_or_default())),
             robot,
+            readings_streams: HashMap::new(),
         }
     }
 
+    /// The response stored by the last handler with its headroom, only copied when the response
+    /// type doesn't keep frames
+    fn take_response_frame(&mut self) -> BytesMut {
+        self.response.take_frame().unwrap_or_else(|| {
+            let data = self.response.get_data();
+            let mut frame = BytesMut::with_capacity(RESPONSE_HEADROOM + data.len());
+            frame.put_bytes(0, RESPONSE_HEADROOM);
+            frame.put(data);
+            frame
+        })
+    }
+
     fn validate_rpc(message: &Bytes) -> Result<&[u8], GrpcError> {
         // Per https://github.com/grpc/grpc/blob/master/doc/PROTOCOL-HTTP2.md, we're expecting a
         // 5-byte header followed by the actual protocol buffer data. The 5 bytes in the header are
@@ -175,137 +215,39 @@ where
         Ok(rest)
     }
 
-    pub(crate) fn handle_rpc_stream(
+    pub(crate) async fn handle_rpc_stream(
         &mut self,
+        stream: u32,
         path: &str,
         payload: &[u8],
     ) -> Result<std::time::Instant, ServerError> {
         match path {
             "/viam.robot.v1.RobotService/StreamStatus" => self.robot_status_stream(payload),
+            STREAM_READINGS_PATH => self.sensor_readings_stream(stream, payload).await,
             _ => Err(ServerError::from(GrpcError::RpcUnavailable)),
         }
     }
 
-    pub(crate) fn handle_request(&mut self, path: &str, payload: &[u8]) -> Result<(), ServerError> {
-        match path {
-            "/viam.component.base.v1.BaseService/SetPower" => self.base_set_power(payload),
-            "/viam.component.base.v1.BaseService/Stop" => self.base_stop(payload),
-            "/viam.component.base.v1.BaseService/MoveStraight" => self.base_move_straight(payload),
-            "/viam.component.base.v1.BaseService/Spin" => self.base_spin(payload),
-            "/viam.component.base.v1.BaseService/SetVelocity" => self.base_set_velocity(payload),
-            "/viam.component.base.v1.BaseService/IsMoving" => self.base_is_moving(payload),
-            "/viam.component.board.v1.BoardService/GetDigitalInterruptValue" => {
-                self.board_get_digital_interrupt_value(payload)
-            }
-            "/viam.component.board.v1.BoardService/GetGPIO" => self.board_get_pin(payload),
-            "/viam.component.board.v1.BoardService/PWM" => self.board_pwm(payload),
-            "/viam.component.board.v1.BoardService/PWMFrequency" => {
-                self.board_pwm_frequency(payload)
-            }
-            "/viam.component.board.v1.BoardService/ReadAnalogReader" => {
-                self.board_read_analog_reader(payload)
-            }
-            "/viam.component.board.v1.BoardService/SetGPIO" => self.board_set_pin(payload),
-            "/viam.component.board.v1.BoardService/SetPWM" => self.board_set_pwm(payload),
-            "/viam.component.board.v1.BoardService/SetPWMFrequency" => {
-                self.board_set_pwm_frequency(payload)
-            }
-            "/viam.component.board.v1.BoardService/SetPowerMode" => {
-                self.board_set_power_mode(payload)
-            }
-            "/viam.component.board.v1.BoardService/DoCommand" => self.board_do_command(payload),
-            "/viam.component.generic.v1.GenericService/DoCommand" => {
-                self.generic_component_do_command(payload)
-            }
-            #[cfg(feature = "camera")]
-            "/viam.component.camera.v1.CameraService/GetImage" => self.camera_get_image(payload),
-            #[cfg(feature = "camera")]
-            "/viam.component.camera.v1.CameraService/DoCommand" => self.camera_do_command(payload),
-            "/viam.component.motor.v1.MotorService/GetPosition" => self.motor_get_position(payload),
-            "/viam.component.motor.v1.MotorService/GetProperties" => {
-                self.motor_get_properties(payload)
-            }
-            "/viam.component.motor.v1.MotorService/GoFor" => self.motor_go_for(payload),
-            "/viam.component.motor.v1.MotorService/GoTo" => self.motor_go_to(payload),
-            "/viam.component.motor.v1.MotorService/IsPowered" => self.motor_is_powered(payload),
-            "/viam.component.motor.v1.MotorService/IsMoving" => self.motor_is_moving(payload),
-            "/viam.component.motor.v1.MotorService/ResetZeroPosition" => {
-                self.motor_reset_zero_position(payload)
-            }
-            "/viam.component.motor.v1.MotorService/SetPower" => self.motor_set_power(payload),
-            "/viam.component.motor.v1.MotorService/Stop" => self.motor_stop(payload),
-            "/viam.component.motor.v1.MotorService/DoCommand" => self.motor_do_command(payload),
-            "/viam.robot.v1.RobotService/ResourceNames" => self.resource_names(payload),
-            "/viam.robot.v1.RobotService/GetStatus" => self.robot_status(payload),
-            "/viam.robot.v1.RobotService/GetOperations" => self.robot_get_oprations(payload),
-            "/proto.rpc.v1.AuthService/Authenticate" => self.auth_service_authentificate(payload),
-            "/viam.component.sensor.v1.SensorService/GetReadings" => {
-                self.sensor_get_readings(payload)
-            }
-            "/viam.component.sensor.v1.SensorService/DoCommand" => self.sensor_do_command(payload),
-            "/viam.component.movementsensor.v1.MovementSensorService/GetPosition" => {
-                self.movement_sensor_get_position(payload)
-            }
-            "/viam.component.movementsensor.v1.MovementSensorService/GetLinearVelocity" => {
-                self.movement_sensor_get_linear_velocity(payload)
-            }
-            "/viam.component.movementsensor.v1.MovementSensorService/GetAngularVelocity" => {
-                self.movement_sensor_get_angular_velocity(payload)
-            }
-            "/viam.component.movementsensor.v1.MovementSensorService/GetLinearAcceleration" => {
-                self.movement_sensor_get_linear_acceleration(payload)
-            }
-            "/viam.component.movementsensor.v1.MovementSensorService/GetCompassHeading" => {
-                self.movement_sensor_get_compass_heading(payload)
-            }
-            "/viam.component.movementsensor.v1.MovementSensorService/GetProperties" => {
-                self.movement_sensor_get_properties(payload)
-            }
-            "/viam.component.movementsensor.v1.MovementSensorService/GetOrientation" => {
-                self.movement_sensor_get_orientation(payload)
-            }
-            "/viam.component.movementsensor.v1.MovementSensorService/GetAccuracy" => {
-                self.movement_sensor_get_accuracy(payload)
-            }
-            "/viam.component.movementsensor.v1.MovementSensorService/DoCommand" => {
-                self.movement_sensor_do_command(payload)
-            }
-            "/viam.component.encoder.v1.EncoderService/GetPosition" => {
-                self.encoder_get_position(payload)
-            }
-            "/viam.component.encoder.v1.EncoderService/ResetPosition" => {
-                self.encoder_reset_position(payload)
-            }
-            "/viam.component.encoder.v1.EncoderService/GetProperties" => {
-                self.encoder_get_properties(payload)
-            }
-            "/viam.component.encoder.v1.EncoderService/DoCommand" => {
-                self.encoder_do_command(payload)
-            }
-            "/viam.component.powersensor.v1.PowerSensorService/GetVoltage" => {
-                self.power_sensor_get_voltage(payload)
-            }
-            "/viam.component.powersensor.v1.PowerSensorService/GetCurrent" => {
-                self.power_sensor_get_current(payload)
-            }
-            "/viam.component.powersensor.v1.PowerSensorService/GetPower" => {
-                self.power_sensor_get_power(payload)
-            }
-            "/viam.component.powersensor.v1.PowerSensorService/DoCommand" => {
-                self.power_sensor_do_command(payload)
-            }
-            "/viam.component.servo.v1.ServoService/Move" => self.servo_move(payload),
-            "/viam.component.servo.v1.ServoService/GetPosition" => self.servo_get_position(payload),
-            "/viam.component.servo.v1.ServoService/IsMoving" => self.servo_is_moving(payload),
-            "/viam.component.servo.v1.ServoService/Stop" => self.servo_stop(payload),
-            "/viam.component.servo.v1.ServoService/DoCommand" => self.servo_do_command(payload),
-            _ => Err(ServerError::from(GrpcError::RpcUnimplemented)),
-        }
+    // Requests that may have to wait on hardware are awaited rather than blocking the executor,
+    // every other request is handled synchronously (see `rpc_methods!`)
+    pub(crate) async fn handle_request_async(
+        &mut self,
+        path: &str,
+        payload: &[u8],
+    ) -> Result<(), ServerError> {
+        let method = RpcMethod::from_path(path).ok_or(GrpcError::RpcUnimplemented)?;
+        let start = Instant::now();
+        let res = self.dispatch(method, payload).await;
+        RPC_METHOD_STATS[method as usize].record(start.elapsed(), res.is_ok());
+        res
     }
 
-    fn process_request(&mut self, path: &str, msg: Bytes) {
-        let payload = Self::validate_rpc(&msg).map_err(ServerError::from);
-        match payload.and_then(|payload| self.handle_request(path, payload)) {
+    async fn process_request(&mut self, path: &str, msg: Bytes) {
+        let res = match Self::validate_rpc(&msg).map_err(ServerError::from) {
+            Ok(payload) => self.handle_request_async(path, payload).await,
+            Err(e) => Err(e),
+        };
+        match res {
             Ok(_) => {}
             Err(e) => {
                 let message = Some(e.to_string());
@@ -759,7 +701,7 @@ where
         self.encode_message(resp)
     }
 
-    fn sensor_get_readings(&mut self, message: &[u8]) -> Result<(), ServerError> {
+    async fn sensor_get_readings(&mut self, message: &[u8]) -> Result<(), ServerError> {
         let req = proto::common::v1::GetReadingsRequest::decode(message)
             .map_err(|_| ServerError::from(GrpcError::RpcInvalidArgument))?;
         let sensor = match self.robot.lock().unwrap().get_sensor_by_name(req.name) {
@@ -767,13 +709,43 @@ where
             None => return Err(ServerError::from(GrpcError::RpcUnavailable)),
         };
 
-        let readings = sensor
-            .lock()
-            .unwrap()
-            .get_generic_readings()
+        // the sensor is only locked while being polled so other requests can use it while
+        // the readings are pending
+        let readings = future::poll_fn(|cx| sensor.lock().unwrap().poll_generic_readings(cx))
+            .await
             .map_err(|err| ServerError::new(GrpcError::RpcInternal, Some(err.into())))?;
-        let resp = proto::common::v1::GetReadingsResponse { readings };
-        self.encode_message(resp)
+        let ret = self.encode_readings(&readings);
+        sensor.lock().unwrap().recycle_generic_readings(readings);
+        ret
+    }
+
+    async fn sensor_readings_stream(
+        &mut self,
+        stream: u32,
+        message: &[u8],
+    ) -> Result<std::time::Instant, ServerError> {
+        let req = proto::common::v1::GetReadingsRequest::decode(message)
+            .map_err(|_| ServerError::from(GrpcError::RpcInvalidArgument))?;
+        let period = stream_period(req.extra.as_ref()).ok_or(GrpcError::RpcInvalidArgument)?;
+        let (sensor, cache) = {
+            let robot = self.robot.lock().unwrap();
+            (
+                robot
+                    .get_sensor_by_name(req.name.clone())
+                    .ok_or(GrpcError::RpcUnavailable)?,
+                robot.readings_cache(),
+            )
+        };
+        let now = Instant::now();
+        let since = self.readings_streams.get(&stream).copied().unwrap_or(0);
+        // readings younger than half a period are shared, so subscribers ticking a bit apart
+        // still cost one read
+        let (readings, generation) = cache
+            .readings_since(&req.name, &sensor, since, period / 2, now)
+            .await
+            .map_err(|err| ServerError::new(GrpcError::RpcInternal, Some(err.into())))?;
+        let _ = self.readings_streams.insert(stream, generation);
+        self.encode_readings(&readings).map(|_| now + period)
     }
 
     fn sensor_do_command(&mut self, message: &[u8]) -> Result<(), ServerError> {
@@ -1223,7 +1195,7 @@ where
             .ok_or(GrpcError::RpcUnavailable)?;
 
         let mut buffer = RefCell::borrow_mut(&self.buffer).split_off(0);
-        let msg_buf = buffer.split_off(5);
+        let msg_buf = buffer.split_off(RESPONSE_HEADROOM + 5);
 
         let msg_buf = camera
             .lock()
@@ -1231,10 +1203,11 @@ where
             .get_image(msg_buf)
             .map_err(|err| ServerError::new(GrpcError::RpcInternal, Some(err.into())))?;
 
+        buffer.put_bytes(0, RESPONSE_HEADROOM);
         buffer.put_u8(0);
         buffer.put_u32(msg_buf.len() as u32);
         buffer.unsplit(msg_buf);
-        self.response.put_data(buffer.freeze());
+        self.response.put_frame(buffer);
         Ok(())
     }
 
@@ -1267,45 +1240,256 @@ where
     }
 
     fn encode_message<M: Message>(&mut self, m: M) -> Result<(), ServerError> {
+        // the length was checked against the buffer, `encode` would compute it again
+        self.encode_response(m.encoded_len(), |buffer| m.encode_raw(buffer))
+    }
+
+    /// Encodes a `GetReadingsResponse` straight from the readings, it only has the readings field
+    fn encode_readings(&mut self, readings: &GenericReadingsResult) -> Result<(), ServerError> {
+        self.encode_response(readings_encoding::encoded_len(1, readings), |buffer| {
+            readings_encoding::encode(1, readings, buffer)
+        })
+    }
+
+    /// Writes a response of `len` bytes with `encode`
+    fn encode_response(
+        &mut self,
+        len: usize,
+        encode: impl FnOnce(&mut BytesMut),
+    ) -> Result<(), ServerError> {
         let mut buffer = RefCell::borrow_mut(&self.buffer).split_off(0);
-        // The buffer will have a null byte, then 4 bytes containing the big-endian length of the
-        // data (*not* including this 5-byte header), and then the data from the message itself.
-        if 5 + m.encoded_len() > buffer.capacity() {
+        // The buffer will have the transport headroom, a null byte, then 4 bytes containing the
+        // big-endian length of the data (*not* including this 5-byte header), and then the data
+        // from the message itself. The message is encoded once, in place.
+        if RESPONSE_HEADROOM + 5 + len > buffer.capacity() {
             return Err(GrpcError::RpcResourceExhausted.into());
         }
+        buffer.put_bytes(0, RESPONSE_HEADROOM);
         buffer.put_u8(0);
-        buffer.put_u32(m.encoded_len().try_into().unwrap());
-        let mut msg = buffer.split_off(5);
-        m.encode(&mut msg)
-            .map_err(|_| ServerError::from(GrpcError::RpcInternal))?;
-        buffer.unsplit(msg);
-        self.response.put_data(buffer.freeze());
+        buffer.put_u32(len.try_into().unwrap());
+        encode(&mut buffer);
+        self.response.put_frame(buffer);
         Ok(())
     }
 }
 
+// Every unary method is declared once in `rpc_methods!`, which generates `RpcMethod`, the path of
+// each method and the dispatch to its handler. Handlers listed after `async:` are awaited
+macro_rules! rpc_methods {
+    (
+        $($(#[$attr:meta])* $path:literal => $handler:ident,)*
+        async:
+        $($(#[$async_attr:meta])* $async_path:literal => $async_handler:ident,)*
+    ) => {
+        /// Unary methods served by `GrpcServer`, variants are named after their handler
+        #[allow(non_camel_case_types)]
+        #[derive(Clone, Copy, Debug, PartialEq, Eq)]
+        enum RpcMethod {
+            $($(#[$attr])* $handler,)*
+            $($(#[$async_attr])* $async_handler,)*
+        }
+
+        /// Path of every method, indexed by `RpcMethod`
+        const RPC_METHODS: &[(&str, RpcMethod)] = &[
+            $($(#[$attr])* ($path, RpcMethod::$handler),)*
+            $($(#[$async_attr])* ($async_path, RpcMethod::$async_handler),)*
+        ];
+
+        impl<R> GrpcServer<R>
+        where
+            R: GrpcResponse,
+        {
+            async fn dispatch(
+                &mut self,
+                method: RpcMethod,
+                payload: &[u8],
+            ) -> Result<(), ServerError> {
+                match method {
+                    $($(#[$attr])* RpcMethod::$handler => self.$handler(payload),)*
+                    $($(#[$async_attr])* RpcMethod::$async_handler => {
+                        self.$async_handler(payload).await
+                    })*
+                }
+            }
+        }
+    };
+}
+
+rpc_methods! {
+    "/viam.component.base.v1.BaseService/SetPower" => base_set_power,
+    "/viam.component.base.v1.BaseService/Stop" => base_stop,
+    "/viam.component.base.v1.BaseService/MoveStraight" => base_move_straight,
+    "/viam.component.base.v1.BaseService/Spin" => base_spin,
+    "/viam.component.base.v1.BaseService/SetVelocity" => base_set_velocity,
+    "/viam.component.base.v1.BaseService/IsMoving" => base_is_moving,
+    "/viam.component.board.v1.BoardService/GetDigitalInterruptValue" => board_get_digital_interrupt_value,
+    "/viam.component.board.v1.BoardService/GetGPIO" => board_get_pin,
+    "/viam.component.board.v1.BoardService/PWM" => board_pwm,
+    "/viam.component.board.v1.BoardService/PWMFrequency" => board_pwm_frequency,
+    "/viam.component.board.v1.BoardService/ReadAnalogReader" => board_read_analog_reader,
+    "/viam.component.board.v1.BoardService/SetGPIO" => board_set_pin,
+    "/viam.component.board.v1.BoardService/SetPWM" => board_set_pwm,
+    "/viam.component.board.v1.BoardService/SetPWMFrequency" => board_set_pwm_frequency,
+    "/viam.component.board.v1.BoardService/SetPowerMode" => board_set_power_mode,
+    "/viam.component.board.v1.BoardService/DoCommand" => board_do_command,
+    "/viam.component.generic.v1.GenericService/DoCommand" => generic_component_do_command,
+    #[cfg(feature = "camera")]
+    "/viam.component.camera.v1.CameraService/GetImage" => camera_get_image,
+    #[cfg(feature = "camera")]
+    "/viam.component.camera.v1.CameraService/DoCommand" => camera_do_command,
+    "/viam.component.motor.v1.MotorService/GetPosition" => motor_get_position,
+    "/viam.component.motor.v1.MotorService/GetProperties" => motor_get_properties,
+    "/viam.component.motor.v1.MotorService/GoFor" => motor_go_for,
+    "/viam.component.motor.v1.MotorService/GoTo" => motor_go_to,
+    "/viam.component.motor.v1.MotorService/IsPowered" => motor_is_powered,
+    "/viam.component.motor.v1.MotorService/IsMoving" => motor_is_moving,
+    "/viam.component.motor.v1.MotorService/ResetZeroPosition" => motor_reset_zero_position,
+    "/viam.component.motor.v1.MotorService/SetPower" => motor_set_power,
+    "/viam.component.motor.v1.MotorService/Stop" => motor_stop,
+    "/viam.component.motor.v1.MotorService/DoCommand" => motor_do_command,
+    "/viam.robot.v1.RobotService/ResourceNames" => resource_names,
+    "/viam.robot.v1.RobotService/GetStatus" => robot_status,
+    "/viam.robot.v1.RobotService/GetOperations" => robot_get_oprations,
+    "/proto.rpc.v1.AuthService/Authenticate" => auth_service_authentificate,
+    "/viam.component.sensor.v1.SensorService/DoCommand" => sensor_do_command,
+    "/viam.component.movementsensor.v1.MovementSensorService/GetPosition" => movement_sensor_get_position,
+    "/viam.component.movementsensor.v1.MovementSensorService/GetLinearVelocity" => movement_sensor_get_linear_velocity,
+    "/viam.component.movementsensor.v1.MovementSensorService/GetAngularVelocity" => movement_sensor_get_angular_velocity,
+    "/viam.component.movementsensor.v1.MovementSensorService/GetLinearAcceleration" => movement_sensor_get_linear_acceleration,
+    "/viam.component.movementsensor.v1.MovementSensorService/GetCompassHeading" => movement_sensor_get_compass_heading,
+    "/viam.component.movementsensor.v1.MovementSensorService/GetProperties" => movement_sensor_get_properties,
+    "/viam.component.movementsensor.v1.MovementSensorService/GetOrientation" => movement_sensor_get_orientation,
+    "/viam.component.movementsensor.v1.MovementSensorService/GetAccuracy" => movement_sensor_get_accuracy,
+    "/viam.component.movementsensor.v1.MovementSensorService/DoCommand" => movement_sensor_do_command,
+    "/viam.component.encoder.v1.EncoderService/GetPosition" => encoder_get_position,
+    "/viam.component.encoder.v1.EncoderService/ResetPosition" => encoder_reset_position,
+    "/viam.component.encoder.v1.EncoderService/GetProperties" => encoder_get_properties,
+    "/viam.component.encoder.v1.EncoderService/DoCommand" => encoder_do_command,
+    "/viam.component.powersensor.v1.PowerSensorService/GetVoltage" => power_sensor_get_voltage,
+    "/viam.component.powersensor.v1.PowerSensorService/GetCurrent" => power_sensor_get_current,
+    "/viam.component.powersensor.v1.PowerSensorService/GetPower" => power_sensor_get_power,
+    "/viam.component.powersensor.v1.PowerSensorService/DoCommand" => power_sensor_do_command,
+    "/viam.component.servo.v1.ServoService/Move" => servo_move,
+    "/viam.component.servo.v1.ServoService/GetPosition" => servo_get_position,
+    "/viam.component.servo.v1.ServoService/IsMoving" => servo_is_moving,
+    "/viam.component.servo.v1.ServoService/Stop" => servo_stop,
+    "/viam.component.servo.v1.ServoService/DoCommand" => servo_do_command,
+    async:
+    "/viam.component.sensor.v1.SensorService/GetReadings" => sensor_get_readings,
+}
+
+// Open addressing table of the indices of `RPC_METHODS` (RPC_TABLE_EMPTY for a free slot)
+// built at compile time, a lookup hashes the path and usually compares a single string
+const RPC_TABLE_SIZE: usize = 128;
+const RPC_TABLE_EMPTY: u8 = u8::MAX;
+static RPC_TABLE: [u8; RPC_TABLE_SIZE] = build_rpc_table();
+
+const fn fnv1a(data: &[u8]) -> u32 {
+    let mut hash = 0x811c9dc5_u32;
+    let mut i = 0;
+    while i < data.len() {
+        hash = (hash ^ data[i] as u32).wrapping_mul(0x01000193);
+        i += 1;
+    }
+    hash
+}
+
+const fn build_rpc_table() -> [u8; RPC_TABLE_SIZE] {
+    assert!(RPC_METHODS.len() < RPC_TABLE_SIZE / 2);
+    let mut table = [RPC_TABLE_EMPTY; RPC_TABLE_SIZE];
+    let mut i = 0;
+    while i < RPC_METHODS.len() {
+        let mut slot = fnv1a(RPC_METHODS[i].0.as_bytes()) as usize % RPC_TABLE_SIZE;
+        while table[slot] != RPC_TABLE_EMPTY {
+            slot = (slot + 1) % RPC_TABLE_SIZE;
+        }
+        table[slot] = i as u8;
+        i += 1;
+    }
+    table
+}
+
+impl RpcMethod {
+    fn from_path(path: &str) -> Option<Self> {
+        let mut slot = fnv1a(path.as_bytes()) as usize % RPC_TABLE_SIZE;
+        loop {
+            let (method_path, method) = RPC_METHODS.get(RPC_TABLE[slot] as usize)?;
+            if *method_path == path {
+                return Some(*method);
+            }
+            slot = (slot + 1) % RPC_TABLE_SIZE;
+        }
+    }
+}
+
+/// Calls and handling time of a gRPC method since boot, times are in microseconds and the total
+/// wraps around
+#[derive(Debug, Default)]
+pub struct RpcMethodStats {
+    pub calls: AtomicU32,
+    pub errors: AtomicU32,
+    pub total_us: AtomicU32,
+    pub max_us: AtomicU32,
+}
+
+impl RpcMethodStats {
+    #[allow(clippy::declare_interior_mutable_const)]
+    const INIT: Self = Self {
+        calls: AtomicU32::new(0),
+        errors: AtomicU32::new(0),
+        total_us: AtomicU32::new(0),
+        max_us: AtomicU32::new(0),
+    };
+
+    fn record(&self, elapsed: Duration, ok: bool) {
+        let us = elapsed.as_micros().min(u32::MAX as u128) as u32;
+        let _ = self.calls.fetch_add(1, Ordering::Relaxed);
+        if !ok {
+            let _ = self.errors.fetch_add(1, Ordering::Relaxed);
+        }
+        let _ = self.total_us.fetch_add(us, Ordering::Relaxed);
+        let _ = self.max_us.fetch_max(us, Ordering::Relaxed);
+    }
+}
+
+static RPC_METHOD_STATS: [RpcMethodStats; RPC_METHODS.len()] =
+    [RpcMethodStats::INIT; RPC_METHODS.len()];
+
+/// Statistics of every unary method served, by method path
+pub fn rpc_method_stats() -> impl Iterator<Item = (&'static str, &'static RpcMethodStats)> {
+    RPC_METHODS
+        .iter()
+        .map(|(path, method)| (*path, &RPC_METHOD_STATS[*method as usize]))
+}
+
 impl<R> WebRtcGrpcService for GrpcServer<R>
 where
     R: GrpcResponse + 'static,
 {
-    fn unary_rpc(&mut self, method: &str, data: &Bytes) -> Result<Bytes, ServerError> {
+    async fn unary_rpc(&mut self, method: &str, data: &Bytes) -> Result<BytesMut, ServerError> {
         {
             RefCell::borrow_mut(&self.buffer).reserve(GRPC_BUFFER_SIZE);
         }
-        self.handle_request(method, data)
-            .map(|_| self.response.get_data().split_off(5))
+        self.handle_request_async(method, data)
+            .await
+            .map(|_| self.take_response_frame())
     }
-    fn server_stream_rpc(
+    async fn server_stream_rpc(
         &mut self,
+        stream: u32,
         method: &str,
         data: &Bytes,
-    ) -> Result<(Bytes, Instant), ServerError> {
+    ) -> Result<(BytesMut, Instant), ServerError> {
         {
             RefCell::borrow_mut(&self.buffer).reserve(GRPC_BUFFER_SIZE);
         }
         log::debug!("stream req is {:?}, ", method);
-        self.handle_rpc_stream(method, data)
-            .map(|dur| (self.response.get_data().split_off(5), dur))
+        self.handle_rpc_stream(stream, method, data)
+            .await
+            .map(|dur| (self.take_response_frame(), dur))
+    }
+    fn close_stream(&mut self, stream: u32) {
+        let _ = self.readings_streams.remove(&stream);
     }
 }
 
@@ -1338,7 +1522,7 @@ where
                 Some(path) => path.as_str(),
                 None => return Err(GrpcError::RpcInvalidArgument),
             };
-            svc.process_request(path, msg);
+            svc.process_request(path, msg).await;
             Response::builder()
                 .header("content-type", "application/grpc")
                 .status(200)
@@ -1350,6 +1534,14 @@ where
 impl<R> Drop for GrpcServer<R> {
     fn drop(&mut self) {
         debug!("Server dropped");
+        // clones made for each HTTP2 request share the buffer, the last one gives it back
+        if Rc::strong_count(&self.buffer) == 1 {
+            let mut buffer = std::mem::take(&mut *RefCell::borrow_mut(&self.buffer));
+            // responses are split off the buffer, their frames are sent by now so this reclaims
+            // their memory
+            buffer.reserve(GRPC_BUFFER_SIZE);
+            GRPC_BUFFERS.put(buffer);
+        }
     }
 }
 #[derive(Error, Debug, Clone, Copy)]
@@ -1472,3 +1664,75 @@ impl<T> Service<T> for MakeSvcGrpcServer {
         future::ready(Ok(self.server.clone()))
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use std::sync::{Arc, Mutex};
+
+    use bytes::Bytes;
+    use prost::Message;
+
+    use super::{rpc_method_stats, GrpcServer, RpcMethod, RPC_METHODS};
+    use crate::common::{
+        bench::bench,
+        robot::LocalRobot,
+        webrtc::grpc::{WebRtcGrpcBody, WebRtcGrpcService},
+    };
+    use crate::proto::{
+        app::v1::{ComponentConfig, ConfigResponse, RobotConfig},
+        common::v1::{GetReadingsRequest, GetReadingsResponse},
+    };
+
+    #[test_log::test]
+    fn test_rpc_method_table() {
+        for (i, (path, method)) in RPC_METHODS.iter().enumerate() {
+            assert_eq!(*method as usize, i);
+            assert_eq!(RpcMethod::from_path(path), Some(*method));
+        }
+        assert_eq!(
+            RpcMethod::from_path("/viam.component.sensor.v1.SensorService/GetReadings"),
+            Some(RpcMethod::sensor_get_readings)
+        );
+        assert_eq!(
+            RpcMethod::from_path("/viam.component.sensor.v1.SensorService/GetReading"),
+            None
+        );
+        assert_eq!(RpcMethod::from_path(""), None);
+        assert_eq!(rpc_method_stats().count(), RPC_METHODS.len());
+    }
+
+    #[test_log::test]
+    #[ignore]
+    fn bench_get_readings() {
+        let config = ConfigResponse {
+            config: Some(RobotConfig {
+                components: vec![ComponentConfig {
+                    name: "s1".to_string(),
+                    model: "rdk:builtin:fake".to_string(),
+                    r#type: "sensor".to_string(),
+                    namespace: "rdk".to_string(),
+                    ..Default::default()
+                }],
+                ..Default::default()
+            }),
+        };
+        let robot = LocalRobot::from_cloud_config(&config, Box::default(), None).unwrap();
+        let mut server = GrpcServer::new(Arc::new(Mutex::new(robot)), WebRtcGrpcBody::default());
+        let request: Bytes = GetReadingsRequest {
+            name: "s1".to_string(),
+            extra: None,
+        }
+        .encode_to_vec()
+        .into();
+        let path = "/viam.component.sensor.v1.SensorService/GetReadings";
+
+        let mut frame = futures_lite::future::block_on(server.unary_rpc(path, &request)).unwrap();
+        let _ = frame.split_to(super::RESPONSE_HEADROOM + 5);
+        let resp = GetReadingsResponse::decode(frame).unwrap();
+        assert!(resp.readings.contains_key("fake_sensor"));
+
+        bench("GrpcServer GetReadings", 10_000, || {
+            futures_lite::future::block_on(server.unary_rpc(path, &request)).unwrap()
+        });
+    }
+}
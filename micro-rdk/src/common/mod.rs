@@ -32,9 +32,15 @@ pub mod adxl345;
 pub mod analog;
 pub mod app_client;
 pub mod base;
+pub mod base64_encoding;
+#[cfg(test)]
+pub(crate) mod bench;
 pub mod board;
+pub mod buffer_pool;
 pub mod camera;
 pub mod config;
+pub mod config_cache;
+pub mod config_monitor;
 pub mod digital_interrupt;
 pub mod encoder;
 pub mod entry;
@@ -57,12 +63,15 @@ pub mod movement_sensor;
 #[cfg(feature = "builtin-components")]
 pub mod mpu6050;
 pub mod power_sensor;
+pub mod readings_encoding;
+pub mod readings_stream;
 pub mod registry;
 pub mod restart_monitor;
 pub mod robot;
 pub mod sensor;
 pub mod servo;
 pub mod status;
+pub mod telemetry;
 #[cfg(feature = "builtin-components")]
 pub mod wheeled_base;
 pub mod webrtc {
@@ -85,11 +94,17 @@ pub mod conn {
     mod utils;
 }
 #[cfg(feature = "data")]
+pub(crate) mod compact_encoding;
+#[cfg(feature = "data")]
+pub mod data_aggregation;
+#[cfg(feature = "data")]
 pub mod data_collector;
 #[cfg(feature = "data")]
 pub mod data_manager;
 #[cfg(feature = "data")]
 pub mod data_store;
+#[cfg(feature = "data")]
+pub mod flash_data_store;
 
 #[cfg(feature = "provisioning")]
 pub mod provisioning;
@@ -52,6 +52,8 @@ pub enum MotorError {
     ActuatorError(#[from] ActuatorError),
     #[error("unimplemented: {0}")]
     MotorMethodUnimplemented(&'static str),
+    #[error("motor error code {0}")]
+    MotorCodeError(i32),
 }
 
 #[cfg(feature = "builtin-components")]
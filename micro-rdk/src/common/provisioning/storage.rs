@@ -3,7 +3,10 @@ use std::{convert::Infallible, error::Error, fmt::Debug, rc::Rc, sync::Mutex};
 
 use crate::{
     common::grpc::ServerError,
-    proto::provisioning::v1::{CloudConfig, SetNetworkCredentialsRequest},
+    proto::{
+        app::v1::ConfigResponse,
+        provisioning::v1::{CloudConfig, SetNetworkCredentialsRequest},
+    },
 };
 
 #[derive(Clone, Default, Debug)]
@@ -71,10 +74,20 @@ pub trait RobotCredentialStorage {
     fn reset_robot_credentials(&self) -> Result<(), Self::Error>;
 }
 
+/// Storage of the last configuration received from app, see `common::config_cache`
+pub trait RobotConfigurationStorage {
+    type Error: Error + Debug + Into<ServerError>;
+    fn has_robot_configuration(&self) -> bool;
+    fn store_robot_configuration(&self, cfg: &ConfigResponse) -> Result<(), Self::Error>;
+    fn get_robot_configuration(&self) -> Result<ConfigResponse, Self::Error>;
+    fn reset_robot_configuration(&self) -> Result<(), Self::Error>;
+}
+
 #[derive(Default)]
 struct RAMCredentialStorageInner {
     config: Option<RobotCredentials>,
     wifi_creds: Option<WifiCredentials>,
+    robot_config: Option<ConfigResponse>,
 }
 
 /// Simple CrendentialStorage made for testing purposes
@@ -94,6 +107,7 @@ impl RAMStorage {
         Self(Rc::new(Mutex::new(RAMCredentialStorageInner {
             config: Some(config),
             wifi_creds: Some(wifi_creds),
+            robot_config: None,
         })))
     }
 }
@@ -145,6 +159,28 @@ impl WifiCredentialStorage for RAMStorage {
     }
 }
 
+impl RobotConfigurationStorage for RAMStorage {
+    type Error = Infallible;
+    fn has_robot_configuration(&self) -> bool {
+        let inner_ref = self.0.lock().unwrap();
+        inner_ref.robot_config.is_some()
+    }
+    fn store_robot_configuration(&self, cfg: &ConfigResponse) -> Result<(), Self::Error> {
+        let mut inner_ref = self.0.lock().unwrap();
+        let _ = inner_ref.robot_config.insert(cfg.clone());
+        Ok(())
+    }
+    fn get_robot_configuration(&self) -> Result<ConfigResponse, Self::Error> {
+        let inner_ref = self.0.lock().unwrap();
+        Ok(inner_ref.robot_config.clone().unwrap_or_default())
+    }
+    fn reset_robot_configuration(&self) -> Result<(), Self::Error> {
+        let mut inner_ref = self.0.lock().unwrap();
+        let _ = inner_ref.robot_config.take();
+        Ok(())
+    }
+}
+
 impl From<Infallible> for ServerError {
     fn from(_: Infallible) -> Self {
         unreachable!()
@@ -0,0 +1,157 @@
+//! Protobuf encoding of readings, the `map<string, google.protobuf.Value>` fields of responses,
+//! written straight from a `GenericReadingsResult`.
+//!
+//! prost computes the length of a nested message again at every level it is written at, and
+//! computes the length of the whole message once more when encoding it. Readings are mostly flat
+//! (numbers, strings and base64 blobs), their lengths are computed once here and the bytes written
+//! in one pass. Struct and list values are left to prost. The encoding is the one of prost.
+use bytes::BufMut;
+use prost::encoding::{encode_key, encode_varint, encoded_len_varint, key_len, message, WireType};
+
+use super::sensor::GenericReadingsResult;
+use crate::google::protobuf::{value::Kind, Value};
+
+// fields of a map entry
+const ENTRY_KEY: u32 = 1;
+const ENTRY_VALUE: u32 = 2;
+
+// fields of google.protobuf.Value
+const NULL_VALUE: u32 = 1;
+const NUMBER_VALUE: u32 = 2;
+const STRING_VALUE: u32 = 3;
+const BOOL_VALUE: u32 = 4;
+const STRUCT_VALUE: u32 = 5;
+const LIST_VALUE: u32 = 6;
+
+fn delimited_len(tag: u32, len: usize) -> usize {
+    key_len(tag) + encoded_len_varint(len as u64) + len
+}
+
+fn kind_len(kind: &Kind) -> usize {
+    match kind {
+        Kind::NullValue(value) => key_len(NULL_VALUE) + encoded_len_varint(*value as u64),
+        Kind::NumberValue(_) => key_len(NUMBER_VALUE) + 8,
+        Kind::StringValue(value) => delimited_len(STRING_VALUE, value.len()),
+        Kind::BoolValue(_) => key_len(BOOL_VALUE) + 1,
+        Kind::StructValue(value) => message::encoded_len(STRUCT_VALUE, value),
+        Kind::ListValue(value) => message::encoded_len(LIST_VALUE, value),
+    }
+}
+
+// like prost, an empty key and a value without kind are left out of the entry
+fn entry_len(key: &str, value_len: Option<usize>) -> usize {
+    let key_len = if key.is_empty() {
+        0
+    } else {
+        delimited_len(ENTRY_KEY, key.len())
+    };
+    key_len + value_len.map_or(0, |len| delimited_len(ENTRY_VALUE, len))
+}
+
+fn value_len(value: &Value) -> Option<usize> {
+    value.kind.as_ref().map(kind_len)
+}
+
+/// Length of `readings` encoded as field `tag`
+pub fn encoded_len(tag: u32, readings: &GenericReadingsResult) -> usize {
+    readings
+        .iter()
+        .map(|(key, value)| delimited_len(tag, entry_len(key, value_len(value))))
+        .sum()
+}
+
+/// Writes `readings` as field `tag`, `buf` has to hold `encoded_len(tag, readings)` more bytes
+pub fn encode(tag: u32, readings: &GenericReadingsResult, buf: &mut impl BufMut) {
+    for (key, value) in readings {
+        let len = value_len(value);
+        encode_key(tag, WireType::LengthDelimited, buf);
+        encode_varint(entry_len(key, len) as u64, buf);
+        if !key.is_empty() {
+            encode_key(ENTRY_KEY, WireType::LengthDelimited, buf);
+            encode_varint(key.len() as u64, buf);
+            buf.put_slice(key.as_bytes());
+        }
+        if let (Some(kind), Some(len)) = (value.kind.as_ref(), len) {
+            encode_key(ENTRY_VALUE, WireType::LengthDelimited, buf);
+            encode_varint(len as u64, buf);
+            encode_kind(kind, buf);
+        }
+    }
+}
+
+fn encode_kind(kind: &Kind, buf: &mut impl BufMut) {
+    match kind {
+        Kind::NullValue(value) => {
+            encode_key(NULL_VALUE, WireType::Varint, buf);
+            encode_varint(*value as u64, buf);
+        }
+        Kind::NumberValue(value) => {
+            encode_key(NUMBER_VALUE, WireType::SixtyFourBit, buf);
+            buf.put_f64_le(*value);
+        }
+        Kind::StringValue(value) => {
+            encode_key(STRING_VALUE, WireType::LengthDelimited, buf);
+            encode_varint(value.len() as u64, buf);
+            buf.put_slice(value.as_bytes());
+        }
+        Kind::BoolValue(value) => {
+            encode_key(BOOL_VALUE, WireType::Varint, buf);
+            encode_varint(*value as u64, buf);
+        }
+        Kind::StructValue(value) => message::encode(STRUCT_VALUE, value, buf),
+        Kind::ListValue(value) => message::encode(LIST_VALUE, value, buf),
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::collections::HashMap;
+
+    use prost::Message;
+
+    use super::{encode, encoded_len};
+    use crate::common::sensor::GenericReadingsResult;
+    use crate::google::protobuf::{value::Kind, ListValue, Struct, Value};
+    use crate::proto::common::v1::GetReadingsResponse;
+
+    fn value(kind: Kind) -> Value {
+        Value { kind: Some(kind) }
+    }
+
+    #[test_log::test]
+    fn test_readings_encoding() {
+        let readings: GenericReadingsResult = HashMap::from([
+            ("number".to_string(), value(Kind::NumberValue(-42.5))),
+            (
+                "blob".to_string(),
+                value(Kind::StringValue("Wlpa".repeat(700))),
+            ),
+            ("empty".to_string(), value(Kind::StringValue(String::new()))),
+            ("bool".to_string(), value(Kind::BoolValue(true))),
+            ("null".to_string(), value(Kind::NullValue(0))),
+            ("none".to_string(), Value { kind: None }),
+            (String::new(), value(Kind::NumberValue(1.0))),
+            (
+                "struct".to_string(),
+                value(Kind::StructValue(Struct {
+                    fields: HashMap::from([("x".to_string(), value(Kind::NumberValue(2.0)))]),
+                })),
+            ),
+            (
+                "list".to_string(),
+                value(Kind::ListValue(ListValue {
+                    values: vec![value(Kind::BoolValue(false)), Value { kind: None }],
+                })),
+            ),
+        ]);
+        let mut encoded = vec![];
+        encode(1, &readings, &mut encoded);
+        assert_eq!(encoded.len(), encoded_len(1, &readings));
+        let resp = GetReadingsResponse { readings };
+        assert_eq!(encoded, resp.encode_to_vec());
+        assert_eq!(GetReadingsResponse::decode(&encoded[..]).unwrap(), resp);
+
+        let empty = GenericReadingsResult::new();
+        assert_eq!(encoded_len(1, &empty), 0);
+    }
+}
@@ -0,0 +1,246 @@
+//! Server streaming of sensor readings.
+//!
+//! `/viam.component.sensor.v1.SensorService/StreamReadings` takes a `GetReadingsRequest`, the
+//! "every_ms" number of its extra sets the period of the stream (1s when omitted). Every message is
+//! a `GetReadingsResponse` holding the readings that changed since the previous message of the
+//! stream, the first one holds all of them. Streams of a sensor share its last readings through the
+//! `ReadingsCache` of the robot, so the hardware is read once per period whatever the number of
+//! subscribers.
+use std::collections::HashMap;
+use std::sync::{Arc, Mutex, Weak};
+use std::time::{Duration, Instant};
+
+use futures_lite::future;
+
+use super::sensor::{GenericReadingsResult, Sensor, SensorError};
+use crate::google::protobuf::{value::Kind, Struct, Value};
+
+pub const STREAM_READINGS_PATH: &str = "/viam.component.sensor.v1.SensorService/StreamReadings";
+
+const DEFAULT_PERIOD: Duration = Duration::from_secs(1);
+
+/// Period requested by the extra of a `StreamReadings` request, `None` when it isn't a number of
+/// at least 1ms
+pub(crate) fn stream_period(extra: Option<&Struct>) -> Option<Duration> {
+    let value = match extra.and_then(|extra| extra.fields.get("every_ms")) {
+        Some(value) => value,
+        None => return Some(DEFAULT_PERIOD),
+    };
+    match value.kind {
+        Some(Kind::NumberValue(ms)) if ms.is_finite() && ms >= 1.0 => {
+            Some(Duration::from_millis(ms as u64))
+        }
+        _ => None,
+    }
+}
+
+struct CachedReadings {
+    sensor: Weak<Mutex<dyn Sensor>>,
+    read_at: Instant,
+    generation: u64,
+    // every reading with the generation it last changed in
+    readings: HashMap<String, (Value, u64)>,
+}
+
+#[derive(Default)]
+struct CacheState {
+    // shared by every sensor so a sensor added again under the same name never goes back to a
+    // generation its subscribers already saw
+    generation: u64,
+    sensors: HashMap<String, CachedReadings>,
+}
+
+/// Last readings of the streamed sensors
+#[derive(Default)]
+pub struct ReadingsCache {
+    state: Mutex<CacheState>,
+}
+
+impl ReadingsCache {
+    /// Readings of `sensor` that changed after generation `since` (all of them for 0), along with
+    /// the generation they were read in. The sensor is only read when its cached readings are older
+    /// than `max_age`. Readings the sensor stops reporting are not notified.
+    ///
+    /// The cache isn't locked while the sensor is read, so other streams aren't held up by a
+    /// sensor waiting on its hardware.
+    pub(crate) async fn readings_since(
+        &self,
+        name: &str,
+        sensor: &Arc<Mutex<dyn Sensor>>,
+        since: u64,
+        max_age: Duration,
+        now: Instant,
+    ) -> Result<(GenericReadingsResult, u64), SensorError> {
+        let fresh = self
+            .state
+            .lock()
+            .unwrap()
+            .sensors
+            .get(name)
+            .map_or(false, |cached| {
+                // a reconfigured sensor doesn't keep the readings of the one it replaced
+                Weak::ptr_eq(&cached.sensor, &Arc::downgrade(sensor))
+                    && now.saturating_duration_since(cached.read_at) < max_age
+            });
+        let readings = if fresh {
+            None
+        } else {
+            // the sensor is only locked while being polled, like for GetReadings
+            Some(future::poll_fn(|cx| sensor.lock().unwrap().poll_generic_readings(cx)).await?)
+        };
+        let mut state = self.state.lock().unwrap();
+        if let Some(readings) = readings {
+            // entries of sensors that were removed from the robot go with the next read
+            state
+                .sensors
+                .retain(|_, cached| cached.sensor.strong_count() > 0);
+            state.generation += 1;
+            let generation = state.generation;
+            let cached = state
+                .sensors
+                .entry(name.to_string())
+                .or_insert_with(|| CachedReadings {
+                    sensor: Arc::downgrade(sensor),
+                    read_at: now,
+                    generation: 0,
+                    readings: HashMap::new(),
+                });
+            if !Weak::ptr_eq(&cached.sensor, &Arc::downgrade(sensor)) {
+                cached.sensor = Arc::downgrade(sensor);
+                cached.readings.clear();
+            }
+            cached.generation = generation;
+            cached.read_at = now;
+            for (key, value) in readings {
+                match cached.readings.get_mut(&key) {
+                    Some(reading) if reading.0 == value => {}
+                    Some(reading) => *reading = (value, generation),
+                    None => {
+                        let _ = cached.readings.insert(key, (value, generation));
+                    }
+                }
+            }
+        }
+        let cached = state.sensors.get(name).unwrap();
+        let changed = cached
+            .readings
+            .iter()
+            .filter(|(_, (_, generation))| *generation > since)
+            .map(|(key, (value, _))| (key.clone(), value.clone()))
+            .collect();
+        Ok((changed, cached.generation))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::collections::HashMap;
+    use std::sync::{Arc, Mutex};
+    use std::time::{Duration, Instant};
+
+    use futures_lite::future::block_on;
+
+    use super::{stream_period, ReadingsCache, DEFAULT_PERIOD};
+    use crate::common::sensor::{
+        GenericReadingsResult, Readings, Sensor, SensorError, SensorResult,
+    };
+    use crate::common::status::{Status, StatusError};
+    use crate::google::protobuf::{value::Kind, Struct, Value};
+
+    #[derive(DoCommand)]
+    struct CountingSensor {
+        reads: u32,
+    }
+
+    impl Sensor for CountingSensor {}
+
+    impl Readings for CountingSensor {
+        fn get_generic_readings(&mut self) -> Result<GenericReadingsResult, SensorError> {
+            self.reads += 1;
+            Ok(HashMap::from([
+                (
+                    "reads".to_string(),
+                    SensorResult::<f64> {
+                        value: self.reads as f64,
+                    }
+                    .into(),
+                ),
+                (
+                    "constant".to_string(),
+                    SensorResult::<f64> { value: 1.0 }.into(),
+                ),
+            ]))
+        }
+    }
+
+    impl Status for CountingSensor {
+        fn get_status(&self) -> Result<Option<Struct>, StatusError> {
+            Ok(None)
+        }
+    }
+
+    #[test_log::test]
+    fn test_stream_period() {
+        let extra = |kind| Struct {
+            fields: HashMap::from([("every_ms".to_string(), Value { kind: Some(kind) })]),
+        };
+        assert_eq!(stream_period(None), Some(DEFAULT_PERIOD));
+        assert_eq!(
+            stream_period(Some(&extra(Kind::NumberValue(50.0)))),
+            Some(Duration::from_millis(50))
+        );
+        assert_eq!(stream_period(Some(&extra(Kind::NumberValue(0.0)))), None);
+        assert_eq!(
+            stream_period(Some(&extra(Kind::StringValue("50".to_string())))),
+            None
+        );
+    }
+
+    #[test_log::test]
+    fn test_readings_cache() {
+        let cache = ReadingsCache::default();
+        let counting = Arc::new(Mutex::new(CountingSensor { reads: 0 }));
+        let sensor: Arc<Mutex<dyn Sensor>> = counting.clone();
+        let max_age = Duration::from_millis(500);
+        let start = Instant::now();
+
+        // two subscribers within the same period share one read
+        let (first, generation) =
+            block_on(cache.readings_since("s", &sensor, 0, max_age, start)).unwrap();
+        assert_eq!(first.len(), 2);
+        let (second, _) = block_on(cache.readings_since(
+            "s",
+            &sensor,
+            0,
+            max_age,
+            start + Duration::from_millis(10),
+        ))
+        .unwrap();
+        assert_eq!(first, second);
+        assert_eq!(counting.lock().unwrap().reads, 1);
+
+        // a subscriber that is up to date gets nothing until the next read
+        let (none, _) =
+            block_on(cache.readings_since("s", &sensor, generation, max_age, start)).unwrap();
+        assert!(none.is_empty());
+
+        // the next read only reports what changed
+        let (delta, next) =
+            block_on(cache.readings_since("s", &sensor, generation, max_age, start + max_age))
+                .unwrap();
+        assert!(next > generation);
+        assert_eq!(delta.len(), 1);
+        assert_eq!(
+            delta.get("reads").unwrap().kind,
+            Some(Kind::NumberValue(2.0))
+        );
+        assert_eq!(counting.lock().unwrap().reads, 2);
+
+        // a replaced sensor is read again
+        let replaced: Arc<Mutex<dyn Sensor>> = Arc::new(Mutex::new(CountingSensor { reads: 0 }));
+        let (all, _) =
+            block_on(cache.readings_since("s", &replaced, 0, max_age, start + max_age)).unwrap();
+        assert_eq!(all.get("reads").unwrap().kind, Some(Kind::NumberValue(1.0)));
+        assert_eq!(counting.lock().unwrap().reads, 2);
+    }
+}
@@ -133,6 +133,7 @@ type GenericComponentConstructor =
 
 type DependenciesFromConfig = dyn Fn(ConfigType) -> Vec<ResourceKey>;
 
+#[derive(Clone)]
 pub struct ComponentRegistry {
     motors: Map<&'static str, &'static MotorConstructor>,
     board: Map<&'static str, &'static BoardConstructor>,
@@ -152,6 +153,7 @@ impl Default for ComponentRegistry {
     fn default() -> Self {
         let mut r = Self::new();
         crate::common::board::register_models(&mut r);
+        crate::common::telemetry::register_models(&mut r);
         #[cfg(feature = "builtin-components")]
         {
             crate::common::encoder::register_models(&mut r);
@@ -2,7 +2,7 @@
 
 use chrono::{DateTime, FixedOffset};
 use std::{
-    collections::HashMap,
+    collections::{HashMap, HashSet},
     sync::{Arc, Mutex},
 };
 
@@ -20,7 +20,7 @@ use crate::{
     common::status::Status,
     google,
     proto::{
-        app::v1::ConfigResponse,
+        app::v1::{ComponentConfig, ConfigResponse},
         common::{self, v1::ResourceName},
         robot,
     },
@@ -39,6 +39,7 @@ use super::{
     motor::MotorType,
     movement_sensor::MovementSensorType,
     power_sensor::{PowerSensor, PowerSensorType},
+    readings_stream::ReadingsCache,
     registry::{
         get_board_from_dependencies, ComponentRegistry, Dependency, RegistryError, ResourceKey,
     },
@@ -93,6 +94,8 @@ pub struct LocalRobot {
     build_time: Option<DateTime<FixedOffset>>,
     #[cfg(feature = "data")]
     data_collector_configs: Vec<(ResourceName, DataCollectorConfig)>,
+    // kept across reconfigurations, entries of replaced sensors are dropped on their next read
+    readings_cache: Arc<ReadingsCache>,
 }
 
 #[derive(Error, Debug)]
@@ -131,6 +134,40 @@ fn resource_name_from_component_cfg(cfg: &DynamicComponentConfig) -> ResourceNam
     }
 }
 
+fn resource_name_from_component_proto(cfg: &ComponentConfig) -> ResourceName {
+    ResourceName {
+        namespace: cfg.namespace.to_string(),
+        r#type: "component".to_string(),
+        subtype: cfg.r#type.to_string(),
+        name: cfg.name.to_string(),
+    }
+}
+
+fn components_by_name(cfg: &ConfigResponse) -> HashMap<ResourceName, &ComponentConfig> {
+    cfg.config
+        .iter()
+        .flat_map(|cfg| cfg.components.iter())
+        .map(|c| (resource_name_from_component_proto(c), c))
+        .collect()
+}
+
+fn component_name_from_type(r#type: &str) -> Option<&'static str> {
+    Some(match r#type {
+        "motor" => crate::common::motor::COMPONENT_NAME,
+        "board" => crate::common::board::COMPONENT_NAME,
+        #[cfg(feature = "camera")]
+        "camera" => crate::common::camera::COMPONENT_NAME,
+        "encoder" => crate::common::encoder::COMPONENT_NAME,
+        "movement_sensor" => crate::common::movement_sensor::COMPONENT_NAME,
+        "sensor" => crate::common::sensor::COMPONENT_NAME,
+        "base" => crate::common::base::COMPONENT_NAME,
+        "power_sensor" => crate::common::power_sensor::COMPONENT_NAME,
+        "servo" => crate::common::servo::COMPONENT_NAME,
+        "generic" => crate::common::generic::COMPONENT_NAME,
+        &_ => return None,
+    })
+}
+
 // Extracts model string from the full namespace provided by incoming instances of ComponentConfig.
 // TODO: This prefix requirement was put in place due to model names sent from app being otherwise
 // prefixed with "rdk:builtin:". A more ideal and robust method of namespacing is preferred.
@@ -176,6 +213,17 @@ impl LocalRobot {
         } else {
             (None, None)
         };
+        self.build_components(components, board, board_key, &mut registry);
+        Ok(())
+    }
+
+    fn build_components(
+        &mut self,
+        mut components: Vec<Option<DynamicComponentConfig>>,
+        board: Option<BoardType>,
+        board_key: Option<ResourceKey>,
+        registry: &mut ComponentRegistry,
+    ) {
         let mut resource_to_build = components.len();
         let max_iteration = resource_to_build * 2;
         let mut num_iteration = 0;
@@ -185,8 +233,7 @@ impl LocalRobot {
             let cfg_outer = &mut components[iter.next().unwrap()];
             if let Some(cfg) = cfg_outer.as_ref() {
                 // capture the error and make it available to LocalRobot so it can be pushed in the logs?
-                if let Err(e) =
-                    self.build_resource(cfg, board.clone(), board_key.clone(), &mut registry)
+                if let Err(e) = self.build_resource(cfg, board.clone(), board_key.clone(), registry)
                 {
                     log::error!(
                         "Failed to build resource `{}` of type `{}`: {:?}",
@@ -210,7 +257,6 @@ impl LocalRobot {
                     .collect::<Vec<String>>()
             )
         }
-        Ok(())
     }
 
     // Creates a robot from the response of a gRPC call to acquire the robot configuration. The individual
@@ -228,6 +274,7 @@ impl LocalRobot {
             build_time,
             #[cfg(feature = "data")]
             data_collector_configs: vec![],
+            readings_cache: Default::default(),
         };
 
         let components: Result<Vec<Option<DynamicComponentConfig>>, AttributeError> = config_resp
@@ -245,6 +292,150 @@ impl LocalRobot {
         Ok(robot)
     }
 
+    /// Applies `new_config` to a robot built from `old_config`. Components whose config didn't change
+    /// are kept as they are, the others and the components depending on them are rebuilt then
+    /// swapped in. Every component depends on the board, a board change rebuilds the whole robot.
+    ///
+    /// Returns the names of the resources that were removed, rebuilt or added. The robot is left as it
+    /// was when `new_config` is rejected
+    pub fn reconcile(
+        &mut self,
+        old_config: &ConfigResponse,
+        new_config: &ConfigResponse,
+        mut registry: Box<ComponentRegistry>,
+        build_time: Option<DateTime<FixedOffset>>,
+    ) -> Result<HashSet<ResourceName>, RobotError> {
+        let old_components = components_by_name(old_config);
+        let new_components = components_by_name(new_config);
+
+        let mut changed: HashSet<ResourceName> = old_components
+            .iter()
+            .filter(|(name, cfg)| new_components.get(*name) != Some(*cfg))
+            .map(|(name, _)| name.clone())
+            .chain(
+                new_components
+                    .keys()
+                    .filter(|name| !old_components.contains_key(*name))
+                    .cloned(),
+            )
+            .collect();
+
+        if changed.iter().any(|name| name.subtype == "board") {
+            log::info!("board config changed, rebuilding every component");
+            let names = old_components.into_keys().chain(new_components.into_keys());
+            // a config that can't be built leaves the robot as it was
+            let mut robot = Self::from_cloud_config(new_config, registry, build_time)?;
+            robot.readings_cache = self.readings_cache.clone();
+            *self = robot;
+            return Ok(names.collect());
+        }
+
+        let new_configs: HashMap<ResourceName, DynamicComponentConfig> = new_components
+            .iter()
+            .map(|(name, cfg)| {
+                DynamicComponentConfig::try_from(*cfg).map(|cfg| (name.clone(), cfg))
+            })
+            .collect::<Result<_, AttributeError>>()
+            .map_err(RobotError::RobotParseConfigError)?;
+
+        // kept components depending on a changed one are rebuilt too
+        loop {
+            let dependents: Vec<ResourceName> = new_configs
+                .iter()
+                .filter(|(name, _)| !changed.contains(*name))
+                .filter(|(_, cfg)| {
+                    self.dependency_names(cfg, &registry)
+                        .iter()
+                        .any(|dep| changed.contains(dep))
+                })
+                .map(|(name, _)| name.clone())
+                .collect();
+            if dependents.is_empty() {
+                break;
+            }
+            changed.extend(dependents);
+        }
+
+        // changed components are built next to the running ones then swapped in, the old instances
+        // are released once their replacement exists
+        let mut staged = LocalRobot {
+            resources: self
+                .resources
+                .iter()
+                .filter(|(name, _)| !changed.contains(*name))
+                .map(|(name, resource)| (name.clone(), resource.clone()))
+                .collect(),
+            build_time,
+            ..Default::default()
+        };
+        let (board, board_key) = match staged
+            .resources
+            .iter()
+            .find(|(name, _)| name.subtype == "board")
+        {
+            Some((name, ResourceType::Board(board))) => (
+                Some(board.clone()),
+                Some(ResourceKey(
+                    crate::common::board::COMPONENT_NAME,
+                    name.name.clone(),
+                )),
+            ),
+            _ => (None, None),
+        };
+        let to_build = new_configs
+            .into_iter()
+            .filter(|(name, _)| changed.contains(name))
+            .map(|(_, cfg)| Some(cfg))
+            .collect();
+        staged.build_components(to_build, board, board_key, &mut registry);
+
+        self.build_time = build_time;
+        for name in changed.iter() {
+            match staged.resources.remove(name) {
+                Some(resource) => {
+                    let _ = self.resources.insert(name.clone(), resource);
+                }
+                None => {
+                    let _ = self.resources.remove(name);
+                }
+            }
+        }
+        #[cfg(feature = "data")]
+        {
+            self.data_collector_configs
+                .retain(|(name, _)| !changed.contains(name));
+            self.data_collector_configs
+                .append(&mut staged.data_collector_configs);
+        }
+        log::info!("reconfigured {} resources", changed.len());
+        Ok(changed)
+    }
+
+    // names of the resources `config` depends on according to its model
+    fn dependency_names(
+        &self,
+        config: &DynamicComponentConfig,
+        registry: &ComponentRegistry,
+    ) -> Vec<ResourceName> {
+        let (Some(type_as_static), Ok(model)) = (
+            component_name_from_type(config.get_type()),
+            get_model_without_namespace_prefix(&mut config.get_model().to_owned()),
+        ) else {
+            return vec![];
+        };
+        registry
+            .get_dependency_function(type_as_static, &model)
+            .map_or(Vec::new(), |dep_fn| dep_fn(ConfigType::Dynamic(config)))
+            .into_iter()
+            .map(|key| ResourceName {
+                namespace: config.namespace.clone(),
+                r#type: "component".to_owned(),
+                subtype: key.0.to_owned(),
+                name: key.1,
+            })
+            .collect()
+    }
+
     fn build_resource(
         &mut self,
         config: &DynamicComponentConfig,
@@ -283,24 +474,9 @@ impl LocalRobot {
         config: &DynamicComponentConfig,
         registry: &mut ComponentRegistry,
     ) -> Result<Vec<Dependency>, RobotError> {
-        let type_as_static = match config.get_type() {
-            "motor" => crate::common::motor::COMPONENT_NAME,
-            "board" => crate::common::board::COMPONENT_NAME,
-            #[cfg(feature = "camera")]
-            "camera" => crate::common::camera::COMPONENT_NAME,
-            "encoder" => crate::common::encoder::COMPONENT_NAME,
-            "movement_sensor" => crate::common::movement_sensor::COMPONENT_NAME,
-            "sensor" => crate::common::sensor::COMPONENT_NAME,
-            "base" => crate::common::base::COMPONENT_NAME,
-            "power_sensor" => crate::common::power_sensor::COMPONENT_NAME,
-            "servo" => crate::common::servo::COMPONENT_NAME,
-            "generic" => crate::common::generic::COMPONENT_NAME,
-            &_ => {
-                return Err(RobotError::RobotComponentTypeNotSupported(
-                    config.get_type().to_owned(),
-                ))
-            }
-        };
+        let type_as_static = component_name_from_type(config.get_type()).ok_or_else(|| {
+            RobotError::RobotComponentTypeNotSupported(config.get_type().to_owned())
+        })?;
         let model = get_model_without_namespace_prefix(&mut config.get_model().to_owned())?;
         let deps_keys = registry
             .get_dependency_function(type_as_static, &model)
@@ -683,6 +859,10 @@ impl LocalRobot {
             None => None,
         }
     }
+    /// Last readings of the sensors being streamed, shared by their subscribers
+    pub(crate) fn readings_cache(&self) -> Arc<ReadingsCache> {
+        self.readings_cache.clone()
+    }
     pub fn get_sensor_by_name(&self, name: String) -> Option<Arc<Mutex<dyn Sensor>>> {
         let name = ResourceName {
             namespace: "rdk".to_string(),
@@ -806,6 +986,7 @@ impl LocalRobot {
 #[cfg(test)]
 mod tests {
     use std::collections::HashMap;
+    use std::sync::Arc;
 
     use crate::common::analog::AnalogReader;
     use crate::common::board::Board;
@@ -1407,4 +1588,146 @@ mod tests {
 
         assert!(enc.is_some());
     }
+
+    fn fake_component(
+        name: &str,
+        model: &str,
+        r#type: &str,
+        attribute: (&str, Kind),
+    ) -> ComponentConfig {
+        let kind = match attribute.1 {
+            Kind::NumberValue(v) => google::protobuf::value::Kind::NumberValue(v),
+            Kind::StringValue(v) => google::protobuf::value::Kind::StringValue(v),
+            _ => unreachable!(),
+        };
+        ComponentConfig {
+            name: name.to_string(),
+            model: model.to_string(),
+            r#type: r#type.to_string(),
+            namespace: "rdk".to_string(),
+            attributes: Some(Struct {
+                fields: HashMap::from([(
+                    attribute.0.to_string(),
+                    google::protobuf::Value { kind: Some(kind) },
+                )]),
+            }),
+            ..Default::default()
+        }
+    }
+
+    #[test_log::test]
+    fn test_reconcile() {
+        let config = |enc1_deg: f64, with_m2: bool| {
+            let mut components = vec![
+                fake_component(
+                    "enc1",
+                    "rdk:builtin:fake",
+                    "encoder",
+                    ("fake_deg", Kind::NumberValue(enc1_deg)),
+                ),
+                fake_component(
+                    "enc2",
+                    "rdk:builtin:fake",
+                    "encoder",
+                    ("fake_deg", Kind::NumberValue(180.0)),
+                ),
+                fake_component(
+                    "m1",
+                    "rdk:builtin:fake_with_dep",
+                    "motor",
+                    ("encoder", Kind::StringValue("enc1".to_string())),
+                ),
+            ];
+            if with_m2 {
+                components.push(fake_component(
+                    "m2",
+                    "rdk:builtin:fake_with_dep",
+                    "motor",
+                    ("encoder", Kind::StringValue("enc2".to_string())),
+                ));
+            }
+            ConfigResponse {
+                config: Some(RobotConfig {
+                    components,
+                    ..Default::default()
+                }),
+            }
+        };
+        let old_config = config(90.0, true);
+        let mut robot = LocalRobot::from_cloud_config(&old_config, Box::default(), None).unwrap();
+        let enc2 = robot.get_encoder_by_name("enc2".to_string()).unwrap();
+        assert_eq!(
+            robot
+                .get_motor_by_name("m1".to_string())
+                .unwrap()
+                .get_position()
+                .unwrap(),
+            90
+        );
+
+        // unchanged configs are kept as they are
+        let changed = robot
+            .reconcile(&old_config, &old_config, Box::default(), None)
+            .unwrap();
+        assert!(changed.is_empty());
+
+        // m1 depends on enc1 so it is rebuilt with it, m2 is removed
+        let new_config = config(45.0, false);
+        let changed = robot
+            .reconcile(&old_config, &new_config, Box::default(), None)
+            .unwrap();
+        let mut changed: Vec<String> = changed.into_iter().map(|n| n.name).collect();
+        changed.sort();
+        assert_eq!(changed, vec!["enc1", "m1", "m2"]);
+        assert_eq!(
+            robot
+                .get_motor_by_name("m1".to_string())
+                .unwrap()
+                .get_position()
+                .unwrap(),
+            45
+        );
+        assert!(robot.get_motor_by_name("m2".to_string()).is_none());
+        let kept = robot.get_encoder_by_name("enc2".to_string()).unwrap();
+        assert!(std::ptr::eq(
+            Arc::as_ptr(&enc2) as *const (),
+            Arc::as_ptr(&kept) as *const ()
+        ));
+
+        // a rejected board change leaves the running components in place
+        let mut rejected = config(45.0, false);
+        let components = &mut rejected.config.as_mut().unwrap().components;
+        components.push(fake_component(
+            "b",
+            "rdk:builtin:fake",
+            "board",
+            ("fake_deg", Kind::NumberValue(0.0)),
+        ));
+        components.push(ComponentConfig {
+            attributes: Some(Struct {
+                fields: HashMap::from([(
+                    "fake_deg".to_string(),
+                    google::protobuf::Value { kind: None },
+                )]),
+            }),
+            ..fake_component(
+                "enc3",
+                "rdk:builtin:fake",
+                "encoder",
+                ("fake_deg", Kind::NumberValue(0.0)),
+            )
+        });
+        assert!(robot
+            .reconcile(&new_config, &rejected, Box::default(), None)
+            .is_err());
+        assert!(robot.get_encoder_by_name("enc1".to_string()).is_some());
+        assert_eq!(
+            robot
+                .get_motor_by_name("m1".to_string())
+                .unwrap()
+                .get_position()
+                .unwrap(),
+            45
+        );
+    }
 }
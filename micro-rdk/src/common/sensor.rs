@@ -10,6 +10,7 @@ use crate::common::status::Status;
 use crate::google;
 use std::collections::HashMap;
 use std::sync::{Arc, Mutex};
+use std::task::{Context, Poll};
 
 use super::analog::AnalogError;
 use super::board::BoardError;
@@ -84,6 +85,18 @@ pub type TypedReadingsResult<T> = ::std::collections::HashMap<String, T>;
 
 pub trait Readings {
     fn get_generic_readings(&mut self) -> Result<GenericReadingsResult, SensorError>;
+    /// Polls for readings, sensors waiting on slow hardware (e.g. an I2C conversion) should start
+    /// the operation, register the waker and return `Poll::Pending` so the executor can keep serving
+    /// other requests in the meantime. By default readings are obtained synchronously.
+    fn poll_generic_readings(
+        &mut self,
+        _cx: &mut Context<'_>,
+    ) -> Poll<Result<GenericReadingsResult, SensorError>> {
+        Poll::Ready(self.get_generic_readings())
+    }
+    /// Hands back readings the caller is done with, sensors that fill their readings in place
+    /// reuse them for the next call instead of allocating a new map. By default they are dropped.
+    fn recycle_generic_readings(&mut self, _readings: GenericReadingsResult) {}
     #[cfg(feature = "data")]
     fn get_readings_data(&mut self) -> Result<SensorData, SensorError> {
         let reading_requested_dt = chrono::offset::Local::now().fixed_offset();
@@ -104,6 +117,21 @@ pub trait Readings {
             data: Some(readings.into()),
         })
     }
+    /// Returns every sample buffered by the sensor since the last call, each carrying its own
+    /// timestamps. Sensors that don't buffer samples return their current reading.
+    #[cfg(feature = "data")]
+    fn get_readings_data_batch(&mut self) -> Result<Vec<SensorData>, SensorError> {
+        Ok(vec![self.get_readings_data()?])
+    }
+    /// Polls for the samples returned by `get_readings_data_batch`, letting other collectors run
+    /// while the sensor waits on its hardware. By default the batch is obtained synchronously.
+    #[cfg(feature = "data")]
+    fn poll_readings_data_batch(
+        &mut self,
+        _cx: &mut Context<'_>,
+    ) -> Poll<Result<Vec<SensorData>, SensorError>> {
+        Poll::Ready(self.get_readings_data_batch())
+    }
 }
 
 pub trait Sensor: Readings + Status + DoCommand {}
@@ -192,6 +220,26 @@ where
     fn get_generic_readings(&mut self) -> Result<GenericReadingsResult, SensorError> {
         self.get_mut().unwrap().get_generic_readings()
     }
+    fn poll_generic_readings(
+        &mut self,
+        cx: &mut Context<'_>,
+    ) -> Poll<Result<GenericReadingsResult, SensorError>> {
+        self.get_mut().unwrap().poll_generic_readings(cx)
+    }
+    fn recycle_generic_readings(&mut self, readings: GenericReadingsResult) {
+        self.get_mut().unwrap().recycle_generic_readings(readings)
+    }
+    #[cfg(feature = "data")]
+    fn get_readings_data_batch(&mut self) -> Result<Vec<SensorData>, SensorError> {
+        self.get_mut().unwrap().get_readings_data_batch()
+    }
+    #[cfg(feature = "data")]
+    fn poll_readings_data_batch(
+        &mut self,
+        cx: &mut Context<'_>,
+    ) -> Poll<Result<Vec<SensorData>, SensorError>> {
+        self.get_mut().unwrap().poll_readings_data_batch(cx)
+    }
 }
 
 impl<A> Readings for Arc<Mutex<A>>
@@ -201,6 +249,26 @@ where
     fn get_generic_readings(&mut self) -> Result<GenericReadingsResult, SensorError> {
         self.lock().unwrap().get_generic_readings()
     }
+    fn poll_generic_readings(
+        &mut self,
+        cx: &mut Context<'_>,
+    ) -> Poll<Result<GenericReadingsResult, SensorError>> {
+        self.lock().unwrap().poll_generic_readings(cx)
+    }
+    fn recycle_generic_readings(&mut self, readings: GenericReadingsResult) {
+        self.lock().unwrap().recycle_generic_readings(readings)
+    }
+    #[cfg(feature = "data")]
+    fn get_readings_data_batch(&mut self) -> Result<Vec<SensorData>, SensorError> {
+        self.lock().unwrap().get_readings_data_batch()
+    }
+    #[cfg(feature = "data")]
+    fn poll_readings_data_batch(
+        &mut self,
+        cx: &mut Context<'_>,
+    ) -> Poll<Result<Vec<SensorData>, SensorError>> {
+        self.lock().unwrap().poll_readings_data_batch(cx)
+    }
 }
 
 #[cfg(feature = "builtin-components")]
@@ -0,0 +1,494 @@
+//! Runtime telemetry of the server: heap and stack usage, executor tasks, connections, the fill
+//! level of the data store and the counters of the data manager.
+//!
+//! Counters are kept up to date by the code they describe, `Telemetry::snapshot` gathers them along
+//! with the heap statistics of the platform and can be called from any task. The C API reads it with
+//! `viam_server_get_telemetry`, and the "telemetry" sensor model exposes it as readings, so data
+//! management can capture it like any other sensor.
+use std::collections::HashMap;
+use std::future::Future;
+use std::sync::atomic::{AtomicU32, Ordering};
+use std::sync::{Arc, Mutex};
+
+use super::config::ConfigType;
+use super::registry::{ComponentRegistry, Dependency};
+use super::sensor::{GenericReadingsResult, Readings, Sensor, SensorError, SensorType};
+use super::status::{Status, StatusError};
+use crate::google::protobuf::{value::Kind, Struct, Value};
+
+#[cfg(feature = "data")]
+use super::data_collector::ResourceMethodKey;
+#[cfg(feature = "data")]
+use super::data_manager::DataSyncStats;
+
+/// Name the task running the server registers its stack under
+pub const SERVER_TASK_NAME: &str = "micro-rdk";
+
+// Only 32 bits atomics are used since they are the only ones available on the ESP32
+static EXECUTOR_TASKS: AtomicU32 = AtomicU32::new(0);
+static CONNECTIONS: AtomicU32 = AtomicU32::new(0);
+
+// task handles are kept as integers so the registry can be shared between tasks
+#[cfg(feature = "esp32")]
+static TASKS: Mutex<Vec<(&'static str, usize)>> = Mutex::new(Vec::new());
+
+#[cfg(feature = "data")]
+static DATA_STORE_FILL: Mutex<Vec<(ResourceMethodKey, DataStoreFill)>> = Mutex::new(Vec::new());
+
+#[cfg(feature = "data")]
+static DATA_MANAGER: Mutex<Option<DataManagerCounters>> = Mutex::new(None);
+
+// Held by the tests checking the data telemetry, registering a data manager resets it
+#[cfg(all(test, feature = "data"))]
+pub(crate) static DATA_TELEMETRY_TESTS: Mutex<()> = Mutex::new(());
+
+/// Counts `future` in `counter` from now until it completes or is dropped
+fn counted<F: Future>(counter: &'static AtomicU32, future: F) -> impl Future<Output = F::Output> {
+    struct Guard(&'static AtomicU32);
+    impl Drop for Guard {
+        fn drop(&mut self) {
+            let _ = self.0.fetch_sub(1, Ordering::Relaxed);
+        }
+    }
+    let _ = counter.fetch_add(1, Ordering::Relaxed);
+    let guard = Guard(counter);
+    async move {
+        let _guard = guard;
+        future.await
+    }
+}
+
+/// Wraps a future spawned on the executor so it is counted while it is alive
+pub(crate) fn executor_task<F: Future>(future: F) -> impl Future<Output = F::Output> {
+    counted(&EXECUTOR_TASKS, future)
+}
+
+/// Wraps the future serving a connection so it is counted while it is alive
+pub(crate) fn connection<F: Future>(future: F) -> impl Future<Output = F::Output> {
+    counted(&CONNECTIONS, future)
+}
+
+/// Reports the stack usage of the calling task in the telemetry, under `name`
+#[cfg(feature = "esp32")]
+pub fn register_current_task(name: &'static str) {
+    let handle = unsafe { crate::esp32::esp_idf_svc::sys::xTaskGetCurrentTaskHandle() } as usize;
+    let mut tasks = TASKS.lock().unwrap();
+    tasks.retain(|(task, _)| *task != name);
+    tasks.push((name, handle));
+}
+
+/// Records how much of its share of the data store a collector uses, called after every write and
+/// every flush
+#[cfg(feature = "data")]
+pub(crate) fn record_data_store_fill(key: &ResourceMethodKey, fill: DataStoreFill) {
+    let mut fills = DATA_STORE_FILL.lock().unwrap();
+    match fills.iter_mut().find(|(k, _)| k == key) {
+        Some((_, recorded)) => *recorded = fill,
+        None => fills.push((key.clone(), fill)),
+    }
+}
+
+/// Counters kept by a data manager while it runs
+#[cfg(feature = "data")]
+pub(crate) struct DataManagerCounters {
+    pub(crate) missed_deadlines: Arc<AtomicU32>,
+    pub(crate) collection_errors: Arc<AtomicU32>,
+    pub(crate) sync_stats: Arc<DataSyncStats>,
+}
+
+#[cfg(feature = "data")]
+impl DataManagerCounters {
+    fn snapshot(&self) -> (DataCollectionTelemetry, DataSyncTelemetry) {
+        let stats = &self.sync_stats;
+        (
+            DataCollectionTelemetry {
+                missed_deadlines: self.missed_deadlines.load(Ordering::Relaxed),
+                collection_errors: self.collection_errors.load(Ordering::Relaxed),
+            },
+            DataSyncTelemetry {
+                uploaded_bytes: stats.uploaded_bytes.load(Ordering::Relaxed),
+                uploaded_messages: stats.uploaded_messages.load(Ordering::Relaxed),
+                failed_uploads: stats.failed_uploads.load(Ordering::Relaxed),
+                in_flight_bytes: stats.in_flight_bytes.load(Ordering::Relaxed),
+                backlog_bytes: stats.backlog_bytes.load(Ordering::Relaxed),
+                last_sync_throughput: stats.last_sync_throughput.load(Ordering::Relaxed),
+            },
+        )
+    }
+}
+
+/// Reports the counters of a data manager that is starting in the telemetry, in place of the ones
+/// of the data manager it replaces. The fill recorded for the collectors of the previous data
+/// manager is forgotten, it described a store that isn't used anymore
+#[cfg(feature = "data")]
+pub(crate) fn register_data_manager(counters: DataManagerCounters) {
+    let _ = DATA_MANAGER.lock().unwrap().replace(counters);
+    DATA_STORE_FILL.lock().unwrap().clear();
+}
+
+/// Free memory of a heap, in bytes
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct HeapTelemetry {
+    pub free: usize,
+    pub largest_free_block: usize,
+    /// lowest free memory since boot
+    pub minimum_free: usize,
+}
+
+impl HeapTelemetry {
+    #[cfg(feature = "esp32")]
+    fn with_caps(caps: u32) -> Self {
+        use crate::esp32::esp_idf_svc::sys::{
+            heap_caps_get_free_size, heap_caps_get_largest_free_block,
+            heap_caps_get_minimum_free_size,
+        };
+        unsafe {
+            Self {
+                free: heap_caps_get_free_size(caps),
+                largest_free_block: heap_caps_get_largest_free_block(caps),
+                minimum_free: heap_caps_get_minimum_free_size(caps),
+            }
+        }
+    }
+}
+
+/// Bytes held by a collector in the data store, and the bytes it can hold
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct DataStoreFill {
+    pub stored: usize,
+    pub capacity: usize,
+}
+
+/// Counters of the running data manager, zeroed when there is none
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct DataCollectionTelemetry {
+    /// collection ticks skipped because collecting took longer than the minimum interval
+    pub missed_deadlines: u32,
+    /// collections that failed, summed over the collectors
+    pub collection_errors: u32,
+}
+
+/// Upload metrics of the running data manager, zeroed when there is none, see `DataSyncStats`
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct DataSyncTelemetry {
+    pub uploaded_bytes: u32,
+    pub uploaded_messages: u32,
+    pub failed_uploads: u32,
+    pub in_flight_bytes: u32,
+    pub backlog_bytes: u32,
+    /// bytes per second
+    pub last_sync_throughput: u32,
+}
+
+#[derive(Clone, Debug, Default)]
+pub struct Telemetry {
+    /// zeroed on native targets
+    pub internal_heap: HeapTelemetry,
+    /// zeroed on native targets and boards without PSRAM
+    pub psram_heap: HeapTelemetry,
+    /// lowest free stack in bytes of the tasks registered with `register_current_task`
+    pub task_stacks: Vec<(&'static str, usize)>,
+    /// futures spawned on the executor that haven't completed
+    pub executor_tasks: u32,
+    pub connections: u32,
+    #[cfg(feature = "data")]
+    pub data_store: Vec<(ResourceMethodKey, DataStoreFill)>,
+    /// zeroed without the data feature
+    pub data_collection: DataCollectionTelemetry,
+    /// zeroed without the data feature
+    pub data_sync: DataSyncTelemetry,
+}
+
+impl Telemetry {
+    pub fn snapshot() -> Self {
+        #[cfg(feature = "esp32")]
+        let (internal_heap, psram_heap, task_stacks) = {
+            use crate::esp32::esp_idf_svc::sys::{
+                uxTaskGetStackHighWaterMark, MALLOC_CAP_8BIT, MALLOC_CAP_INTERNAL,
+                MALLOC_CAP_SPIRAM,
+            };
+            let task_stacks = TASKS
+                .lock()
+                .unwrap()
+                .iter()
+                .map(|(name, handle)| {
+                    // stack sizes are expressed in bytes on ESP-IDF
+                    let free = unsafe { uxTaskGetStackHighWaterMark(*handle as _) };
+                    (*name, free as usize)
+                })
+                .collect();
+            (
+                HeapTelemetry::with_caps(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT),
+                HeapTelemetry::with_caps(MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT),
+                task_stacks,
+            )
+        };
+        #[cfg(not(feature = "esp32"))]
+        let (internal_heap, psram_heap, task_stacks) = Default::default();
+        #[cfg(feature = "data")]
+        let (data_collection, data_sync) = DATA_MANAGER
+            .lock()
+            .unwrap()
+            .as_ref()
+            .map_or_else(Default::default, DataManagerCounters::snapshot);
+        #[cfg(not(feature = "data"))]
+        let (data_collection, data_sync) = Default::default();
+        Self {
+            internal_heap,
+            psram_heap,
+            task_stacks,
+            executor_tasks: EXECUTOR_TASKS.load(Ordering::Relaxed),
+            connections: CONNECTIONS.load(Ordering::Relaxed),
+            #[cfg(feature = "data")]
+            data_store: DATA_STORE_FILL.lock().unwrap().clone(),
+            data_collection,
+            data_sync,
+        }
+    }
+
+    /// Bytes held in the data store and bytes it can hold, summed over the collectors. Zeroed
+    /// without the data feature
+    pub fn data_store_total(&self) -> DataStoreFill {
+        #[cfg(feature = "data")]
+        let total = self
+            .data_store
+            .iter()
+            .fold(DataStoreFill::default(), |total, (_, fill)| DataStoreFill {
+                stored: total.stored + fill.stored,
+                capacity: total.capacity + fill.capacity,
+            });
+        #[cfg(not(feature = "data"))]
+        let total = DataStoreFill::default();
+        total
+    }
+
+    /// Fill of the share of the data store of the collector of `method` on resource `name`, None
+    /// when there is no such collector or without the data feature
+    pub fn data_store_fill(&self, name: &str, method: &str) -> Option<DataStoreFill> {
+        #[cfg(feature = "data")]
+        let fill = self
+            .data_store
+            .iter()
+            .find(|(key, _)| key.r_name == name && key.method.to_string() == method)
+            .map(|(_, fill)| *fill);
+        #[cfg(not(feature = "data"))]
+        let fill = {
+            let _ = (name, method);
+            None
+        };
+        fill
+    }
+
+    pub fn to_readings(&self) -> GenericReadingsResult {
+        let number = |v: usize| Value {
+            kind: Some(Kind::NumberValue(v as f64)),
+        };
+        let object = |fields: HashMap<String, Value>| Value {
+            kind: Some(Kind::StructValue(Struct { fields })),
+        };
+        let mut readings: GenericReadingsResult = [
+            ("internal_free_bytes", self.internal_heap.free),
+            (
+                "internal_largest_free_block_bytes",
+                self.internal_heap.largest_free_block,
+            ),
+            (
+                "internal_minimum_free_bytes",
+                self.internal_heap.minimum_free,
+            ),
+            ("psram_free_bytes", self.psram_heap.free),
+            (
+                "psram_largest_free_block_bytes",
+                self.psram_heap.largest_free_block,
+            ),
+            ("psram_minimum_free_bytes", self.psram_heap.minimum_free),
+            ("executor_tasks", self.executor_tasks as usize),
+            ("connections", self.connections as usize),
+        ]
+        .into_iter()
+        .map(|(k, v)| (k.to_owned(), number(v)))
+        .collect();
+        let stacks = self
+            .task_stacks
+            .iter()
+            .map(|(name, free)| (name.to_string(), number(*free)))
+            .collect();
+        let _ = readings.insert("stack_minimum_free_bytes".to_owned(), object(stacks));
+        #[cfg(feature = "data")]
+        {
+            let store = self
+                .data_store
+                .iter()
+                .map(|(key, fill)| {
+                    (
+                        format!("{}:{}/{}", key.component_type, key.r_name, key.method),
+                        object(HashMap::from([
+                            ("stored_bytes".to_owned(), number(fill.stored)),
+                            ("capacity_bytes".to_owned(), number(fill.capacity)),
+                        ])),
+                    )
+                })
+                .collect();
+            let _ = readings.insert("data_store".to_owned(), object(store));
+            let collection = HashMap::from([
+                (
+                    "missed_deadlines".to_owned(),
+                    number(self.data_collection.missed_deadlines as usize),
+                ),
+                (
+                    "collection_errors".to_owned(),
+                    number(self.data_collection.collection_errors as usize),
+                ),
+            ]);
+            let _ = readings.insert("data_collection".to_owned(), object(collection));
+            let sync = [
+                ("uploaded_bytes", self.data_sync.uploaded_bytes),
+                ("uploaded_messages", self.data_sync.uploaded_messages),
+                ("failed_uploads", self.data_sync.failed_uploads),
+                ("in_flight_bytes", self.data_sync.in_flight_bytes),
+                ("backlog_bytes", self.data_sync.backlog_bytes),
+                (
+                    "last_sync_throughput_bytes_per_second",
+                    self.data_sync.last_sync_throughput,
+                ),
+            ]
+            .into_iter()
+            .map(|(k, v)| (k.to_owned(), number(v as usize)))
+            .collect();
+            let _ = readings.insert("data_sync".to_owned(), object(sync));
+        }
+        readings
+    }
+}
+
+pub(crate) fn register_models(registry: &mut ComponentRegistry) {
+    if registry
+        .register_sensor("telemetry", &TelemetrySensor::from_config)
+        .is_err()
+    {
+        log::error!("telemetry sensor type is already registered");
+    }
+}
+
+/// Sensor reading the telemetry of the server
+#[derive(DoCommand)]
+pub struct TelemetrySensor;
+
+impl TelemetrySensor {
+    pub(crate) fn from_config(
+        _: ConfigType,
+        _: Vec<Dependency>,
+    ) -> Result<SensorType, SensorError> {
+        Ok(Arc::new(Mutex::new(Self)))
+    }
+}
+
+impl Sensor for TelemetrySensor {}
+
+impl Readings for TelemetrySensor {
+    fn get_generic_readings(&mut self) -> Result<GenericReadingsResult, SensorError> {
+        Ok(Telemetry::snapshot().to_readings())
+    }
+}
+
+impl Status for TelemetrySensor {
+    fn get_status(&self) -> Result<Option<Struct>, StatusError> {
+        Ok(Some(Struct {
+            fields: HashMap::new(),
+        }))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::sync::atomic::{AtomicU32, Ordering};
+
+    use futures_lite::future::block_on;
+
+    use super::counted;
+
+    #[test_log::test]
+    fn test_counted() {
+        static COUNTER: AtomicU32 = AtomicU32::new(0);
+        let first = counted(&COUNTER, async { 1 });
+        let second = counted(&COUNTER, async { 2 });
+        assert_eq!(COUNTER.load(Ordering::Relaxed), 2);
+        assert_eq!(block_on(first), 1);
+        assert_eq!(COUNTER.load(Ordering::Relaxed), 1);
+        // a future dropped before completing isn't counted anymore
+        drop(second);
+        assert_eq!(COUNTER.load(Ordering::Relaxed), 0);
+    }
+
+    #[cfg(feature = "data")]
+    #[test_log::test]
+    fn test_data_store_fill() {
+        use std::sync::{Arc, PoisonError};
+
+        use super::{
+            record_data_store_fill, register_data_manager, DataManagerCounters, DataStoreFill,
+            Telemetry, DATA_TELEMETRY_TESTS,
+        };
+        use crate::common::data_collector::{CollectionMethod, ResourceMethodKey};
+        use crate::google::protobuf::value::Kind;
+
+        let _tests = DATA_TELEMETRY_TESTS
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner);
+
+        let key = ResourceMethodKey {
+            r_name: "telemetry_test".to_string(),
+            component_type: "rdk:component:sensor".to_string(),
+            method: CollectionMethod::Readings,
+        };
+        let fill = |stored| DataStoreFill {
+            stored,
+            capacity: 1024,
+        };
+        record_data_store_fill(&key, fill(10));
+        record_data_store_fill(&key, fill(20));
+        let telemetry = Telemetry::snapshot();
+        let recorded: Vec<_> = telemetry
+            .data_store
+            .iter()
+            .filter(|(k, _)| *k == key)
+            .collect();
+        assert_eq!(recorded, vec![&(key.clone(), fill(20))]);
+        assert!(telemetry.data_store_total().stored >= 20);
+        assert_eq!(
+            telemetry.data_store_fill("telemetry_test", "Readings"),
+            Some(fill(20))
+        );
+
+        let readings = telemetry.to_readings();
+        assert!(readings.contains_key("internal_free_bytes"));
+        assert!(readings.contains_key("data_collection"));
+        assert!(readings.contains_key("data_sync"));
+        let Some(Kind::StructValue(store)) = &readings.get("data_store").unwrap().kind else {
+            panic!("data store fill isn't a struct");
+        };
+        let Some(Kind::StructValue(entry)) = &store
+            .fields
+            .get("rdk:component:sensor:telemetry_test/Readings")
+            .unwrap()
+            .kind
+        else {
+            panic!("collector fill isn't a struct");
+        };
+        assert_eq!(
+            entry.fields.get("stored_bytes").unwrap().kind,
+            Some(Kind::NumberValue(20.0))
+        );
+
+        // a new data manager doesn't report the store of the previous one
+        register_data_manager(DataManagerCounters {
+            missed_deadlines: Arc::default(),
+            collection_errors: Arc::default(),
+            sync_stats: Arc::default(),
+        });
+        assert_eq!(
+            Telemetry::snapshot().data_store_fill("telemetry_test", "Readings"),
+            None
+        );
+    }
+}
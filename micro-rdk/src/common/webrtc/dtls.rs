@@ -3,6 +3,10 @@ use futures_lite::{AsyncRead, AsyncWrite, Future};
 use thiserror::Error;
 
 use super::udp_mux::UdpMux;
+use crate::common::conn::server::HandshakeStats;
+
+/// DTLS handshakes of WebRTC connections
+pub static DTLS_HANDSHAKES: HandshakeStats = HandshakeStats::new();
 
 #[derive(Error, Debug)]
 pub enum DtlsError {
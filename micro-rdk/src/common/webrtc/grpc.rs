@@ -1,16 +1,20 @@
 #![allow(dead_code)]
-#![allow(clippy::read_zero_byte_vec)]
 use std::{
     collections::HashMap,
     time::{Duration, Instant},
 };
 
-use bytes::{Bytes, BytesMut};
-use futures_lite::AsyncReadExt;
-use prost::Message;
+use bytes::{BufMut, Bytes, BytesMut};
+use prost::{
+    encoding::{encode_key, encode_varint, encoded_len_varint, key_len, WireType},
+    Message,
+};
 
 use crate::{
-    common::grpc::{GrpcResponse, ServerError},
+    common::{
+        buffer_pool::BufferPool,
+        grpc::{GrpcResponse, ServerError, RESPONSE_HEADROOM},
+    },
     google::rpc::Status,
     proto::rpc::webrtc::{
         self,
@@ -22,13 +26,17 @@ use super::{api::WebRtcError, sctp::Channel};
 
 #[cfg(feature = "camera")]
 // sizeof(fake_image) + 30bytes for headers
-static WEBRTC_GRPC_BUFFER_SIZE: usize = 10492;
+const WEBRTC_GRPC_BUFFER_SIZE: usize = 10492;
 #[cfg(not(feature = "camera"))]
-static WEBRTC_GRPC_BUFFER_SIZE: usize = 1650;
+const WEBRTC_GRPC_BUFFER_SIZE: usize = 1650;
+
+/// Buffers requests are read into, only held while a request is decoded
+pub static WEBRTC_GRPC_BUFFERS: BufferPool = BufferPool::new(WEBRTC_GRPC_BUFFER_SIZE, 2);
 
 #[derive(Debug, Default)]
 pub struct WebRtcGrpcBody {
     data: Option<Bytes>,
+    frame: Option<BytesMut>,
     status: Status,
     trailers: Option<Metadata>,
 }
@@ -37,6 +45,7 @@ impl WebRtcGrpcBody {
     fn new() -> Self {
         WebRtcGrpcBody {
             data: None,
+            frame: None,
             status: Status {
                 code: 0,
                 message: String::new(),
@@ -51,6 +60,12 @@ impl GrpcResponse for WebRtcGrpcBody {
     fn put_data(&mut self, data: bytes::Bytes) {
         let _ = self.data.insert(data);
     }
+    fn put_frame(&mut self, frame: BytesMut) {
+        let _ = self.frame.insert(frame);
+    }
+    fn take_frame(&mut self) -> Option<BytesMut> {
+        self.frame.take()
+    }
     fn set_status(&mut self, code: i32, message: Option<String>) {
         self.status.code = code;
         if let Some(message) = message {
@@ -76,16 +91,41 @@ pub struct WebRtcGrpcServer<S> {
     stream: Option<webrtc::v1::Stream>,
     headers: Option<RequestHeaders>,
     streams: HashMap<u32, RpcCall>,
-    buffer: BytesMut,
 }
 
+// services are only used from the local executor, futures returned by the trait don't need to be Send
+// responses are `RESPONSE_HEADROOM` free bytes followed by the gRPC message
+#[allow(async_fn_in_trait)]
 pub trait WebRtcGrpcService {
-    fn unary_rpc(&mut self, method: &str, data: &Bytes) -> Result<Bytes, ServerError>;
-    fn server_stream_rpc(
+    async fn unary_rpc(&mut self, method: &str, data: &Bytes) -> Result<BytesMut, ServerError>;
+    /// Called on every period of `stream` with the same request, returns the next message and when
+    /// the following one is due
+    async fn server_stream_rpc(
         &mut self,
+        stream: u32,
         method: &str,
         data: &Bytes,
-    ) -> Result<(Bytes, Instant), ServerError>;
+    ) -> Result<(BytesMut, Instant), ServerError>;
+    /// Called once `stream` is over, releases the state the service kept for it
+    fn close_stream(&mut self, stream: u32);
+}
+
+/// Offset of the message (after its 5 bytes gRPC header) in a response frame
+const MESSAGE_OFFSET: usize = RESPONSE_HEADROOM + 5;
+
+/// Writes the encoding of a `Response` carrying a `PacketMessage` of `data_len` bytes, without the
+/// data. `eom` is written before `data`, decoders accept fields in any order.
+fn encode_message_prefix(stream: &Stream, data_len: usize, buf: &mut impl BufMut) {
+    let packet_len = key_len(2) + 1 + key_len(1) + encoded_len_varint(data_len as u64) + data_len;
+    let message_len = key_len(1) + encoded_len_varint(packet_len as u64) + packet_len;
+    prost::encoding::message::encode(1, stream, buf);
+    encode_key(3, WireType::LengthDelimited, buf);
+    encode_varint(message_len as u64, buf);
+    encode_key(1, WireType::LengthDelimited, buf);
+    encode_varint(packet_len as u64, buf);
+    prost::encoding::bool::encode(2, &true, buf);
+    encode_key(1, WireType::LengthDelimited, buf);
+    encode_varint(data_len as u64, buf);
 }
 
 impl<S> WebRtcGrpcServer<S>
@@ -99,18 +139,14 @@ where
             stream: None,
             headers: None,
             streams: HashMap::new(),
-            buffer: BytesMut::zeroed(WEBRTC_GRPC_BUFFER_SIZE),
         }
     }
     async fn send_response(&mut self, response: webrtc::v1::Response) -> Result<(), WebRtcError> {
-        let len = response.encoded_len();
-        let b = self.buffer.split_off(len);
-        self.buffer.clear();
+        let mut buf = BytesMut::with_capacity(response.encoded_len());
         response
-            .encode(&mut self.buffer)
+            .encode(&mut buf)
             .map_err(WebRtcError::GprcEncodeError)?;
-        self.channel.write(&self.buffer[..len]).await?;
-        self.buffer.unsplit(b);
+        self.channel.write_bytes(buf.freeze()).await?;
         Ok(())
     }
     async fn process_rpc_request(
@@ -123,7 +159,11 @@ where
         log::debug!("processing req {:?}", method);
         let ret = if let Some(pkt) = msg.packet_message.as_ref() {
             if method.contains("Stream") {
-                match self.service.server_stream_rpc(method, &pkt.data) {
+                match self
+                    .service
+                    .server_stream_rpc(stream.id as u32, method, &pkt.data)
+                    .await
+                {
                     Ok(data) => {
                         self.send_rpc_response(data.0, stream).await?;
                         (
@@ -137,7 +177,7 @@ where
                     Err(e) => (e.to_status(), None),
                 }
             } else {
-                match self.service.unary_rpc(method, &pkt.data) {
+                match self.service.unary_rpc(method, &pkt.data).await {
                     Ok(data) => {
                         self.send_rpc_response(data, stream).await?;
                         (
@@ -162,16 +202,23 @@ where
         };
         Ok(ret)
     }
-    async fn send_rpc_response(&mut self, data: Bytes, stream: Stream) -> Result<(), WebRtcError> {
-        let message_response = webrtc::v1::Response {
-            stream: Some(stream),
-            r#type: Some(webrtc::v1::response::Type::Message(
-                webrtc::v1::ResponseMessage {
-                    packet_message: Some(webrtc::v1::PacketMessage { data, eom: true }),
-                },
-            )),
-        };
-        self.send_response(message_response).await
+    /// Sends a frame returned by the service, the response fields are written in its headroom so
+    /// the message itself is never copied
+    async fn send_rpc_response(
+        &mut self,
+        mut frame: BytesMut,
+        stream: Stream,
+    ) -> Result<(), WebRtcError> {
+        let data_len = frame.len() - MESSAGE_OFFSET;
+        let mut prefix = [0_u8; MESSAGE_OFFSET];
+        let mut remaining = &mut prefix[..];
+        encode_message_prefix(&stream, data_len, &mut remaining);
+        let prefix_len = MESSAGE_OFFSET - remaining.len();
+        let start = MESSAGE_OFFSET - prefix_len;
+        frame[start..MESSAGE_OFFSET].copy_from_slice(&prefix[..prefix_len]);
+        let _ = frame.split_to(start);
+        self.channel.write_bytes(frame.freeze()).await?;
+        Ok(())
     }
     async fn send_trailers(&mut self, stream: Stream, status: Status) -> Result<(), WebRtcError> {
         let trailer_response = webrtc::v1::Response {
@@ -188,13 +235,20 @@ where
 
     async fn next_rpc_call(&mut self) -> Result<u32, WebRtcError> {
         loop {
-            let read = self
+            let chunks = self
                 .channel
-                .read(&mut self.buffer)
+                .read_chunks()
                 .await
                 .map_err(WebRtcError::IoError)?;
-            let req = webrtc::v1::Request::decode(&self.buffer[..read])
-                .map_err(WebRtcError::GrpcDecodeError)?;
+            let req = {
+                let mut buffer = WEBRTC_GRPC_BUFFERS.get();
+                buffer.resize(chunks.len(), 0);
+                let read = chunks.read(&mut buffer).map_err(|e| {
+                    WebRtcError::IoError(std::io::Error::new(std::io::ErrorKind::InvalidData, e))
+                })?;
+                webrtc::v1::Request::decode(&buffer[..read])
+                    .map_err(WebRtcError::GrpcDecodeError)?
+            };
             if let Some(wrtc_type) = req.r#type {
                 match wrtc_type {
                     webrtc::v1::request::Type::Headers(hdr) => {
@@ -228,6 +282,7 @@ where
                             let stream = req.stream.unwrap();
                             let key = stream.id as u32;
                             let _ = self.streams.remove(&key);
+                            self.service.close_stream(key);
                             self.send_trailers(
                                 stream,
                                 Status {
@@ -278,9 +333,48 @@ where
                 let _ = call.1.insert(next);
                 let _ = self.streams.insert(id, call);
             } else {
+                self.service.close_stream(id);
                 self.send_trailers(Stream { id: id as u64 }, r.0).await?;
             }
         }
         Ok(())
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use bytes::{BufMut, BytesMut};
+    use prost::Message;
+
+    use super::{encode_message_prefix, MESSAGE_OFFSET};
+    use crate::proto::rpc::webrtc::v1::{
+        response::Type, PacketMessage, Response, ResponseMessage, Stream,
+    };
+
+    #[test_log::test]
+    fn test_message_prefix() {
+        for (id, data_len) in [(0, 0), (1, 127), (u64::MAX, 128), (7, 40_000)] {
+            let stream = Stream { id };
+            let data: Vec<u8> = (0..data_len).map(|i| i as u8).collect();
+            let mut prefix = [0_u8; MESSAGE_OFFSET];
+            let mut remaining = &mut prefix[..];
+            encode_message_prefix(&stream, data.len(), &mut remaining);
+            let prefix_len = MESSAGE_OFFSET - remaining.len();
+
+            let mut encoded = BytesMut::new();
+            encoded.put_slice(&prefix[..prefix_len]);
+            encoded.put_slice(&data);
+            let expected = Response {
+                stream: Some(stream),
+                r#type: Some(Type::Message(ResponseMessage {
+                    packet_message: Some(PacketMessage {
+                        data: data.into(),
+                        eom: true,
+                    }),
+                })),
+            };
+            assert_eq!(encoded.len(), expected.encoded_len());
+            assert_eq!(Response::decode(encoded.freeze()).unwrap(), expected);
+        }
+    }
+}
@@ -15,8 +15,8 @@ use thiserror::Error;
 
 use futures_lite::{future::poll_fn, AsyncRead, AsyncReadExt, AsyncWrite, AsyncWriteExt};
 use sctp_proto::{
-    Association, AssociationHandle, ClientConfig, DatagramEvent, Endpoint, EndpointConfig, Event,
-    Payload, ServerConfig, StreamEvent, StreamId, Transmit,
+    Association, AssociationHandle, Chunks, ClientConfig, DatagramEvent, Endpoint, EndpointConfig,
+    Event, Payload, ServerConfig, StreamEvent, StreamId, Transmit,
 };
 
 //#[derive(Clone)]
@@ -43,23 +43,24 @@ pub struct Channel {
 
 impl Channel {
     pub async fn write(&self, buf: &[u8]) -> std::io::Result<()> {
+        self.write_bytes(Bytes::copy_from_slice(buf)).await
+    }
+    /// Queues `bytes` on the stream without copying them
+    pub async fn write_bytes(&self, bytes: Bytes) -> std::io::Result<()> {
         if *self.closed.lock().unwrap() {
             return Err(std::io::Error::from(std::io::ErrorKind::UnexpectedEof));
         }
-        let bytes = Bytes::copy_from_slice(buf);
         self.tx_event
             .send(SctpEvent::OutgoingStreamData((self.tx_stream_id, bytes)))
             .await
             .map_err(|e| std::io::Error::new(std::io::ErrorKind::Other, e))
     }
-}
-
-impl AsyncRead for Channel {
-    fn poll_read(
-        self: std::pin::Pin<&mut Self>,
-        cx: &mut std::task::Context<'_>,
-        buf: &mut [u8],
-    ) -> Poll<std::io::Result<usize>> {
+    /// Waits for the next message of the stream, it stays in the association until it is read
+    /// so the caller only needs a buffer once the message is there
+    pub async fn read_chunks(&self) -> std::io::Result<Chunks> {
+        poll_fn(|cx| self.poll_read_chunks(cx)).await
+    }
+    fn poll_read_chunks(&self, cx: &mut std::task::Context<'_>) -> Poll<std::io::Result<Chunks>> {
         if *self.closed.lock().unwrap() {
             return Poll::Ready(Err(std::io::Error::from(std::io::ErrorKind::UnexpectedEof)));
         }
@@ -68,12 +69,11 @@ impl AsyncRead for Channel {
             .stream(self.tx_stream_id)
             .map_err(|_| std::io::ErrorKind::BrokenPipe)?;
 
-        if let Some(chunk) = stream
+        if let Some(chunks) = stream
             .read_sctp()
             .map_err(|_| std::io::ErrorKind::BrokenPipe)?
         {
-            let r = chunk.read(buf).unwrap();
-            return Poll::Ready(Ok(r));
+            return Poll::Ready(Ok(chunks));
         }
         let mut rx_stream = self.rx_channel.lock().unwrap();
         let _ = rx_stream.waker.insert(cx.waker().clone());
@@ -81,6 +81,20 @@ impl AsyncRead for Channel {
     }
 }
 
+impl AsyncRead for Channel {
+    fn poll_read(
+        self: std::pin::Pin<&mut Self>,
+        cx: &mut std::task::Context<'_>,
+        buf: &mut [u8],
+    ) -> Poll<std::io::Result<usize>> {
+        let chunks = futures_lite::ready!(self.poll_read_chunks(cx))?;
+        let r = chunks
+            .read(buf)
+            .map_err(|e| std::io::Error::new(std::io::ErrorKind::InvalidData, e))?;
+        Poll::Ready(Ok(r))
+    }
+}
+
 #[derive(Debug)]
 enum SctpEvent {
     IncomingData((SocketAddr, Bytes)),
@@ -374,19 +388,34 @@ where
         Ok(())
     }
 
+    // every packet ready is sent, the chunks of a large write would otherwise wait for the next
+    // event (usually a SACK) to leave
     async fn send_association_packets(&mut self) -> Result<(), SctpError> {
-        let pkt = {
-            self.association
-                .lock()
-                .unwrap()
-                .poll_transmit(Instant::now())
-        };
-        if let Some(pkt) = pkt {
-            let _ = self.write_to_transport(pkt).await;
+        loop {
+            let pkt = {
+                self.association
+                    .lock()
+                    .unwrap()
+                    .poll_transmit(Instant::now())
+            };
+            match pkt {
+                Some(pkt) => {
+                    let _ = self.write_to_transport(pkt).await;
+                }
+                None => break,
+            }
         }
-
         Ok(())
     }
+
+    fn write_stream(&mut self, id: StreamId, buf: &[u8]) {
+        let mut association = self.association.lock().unwrap();
+        if let Ok(mut stream) = association.stream(id) {
+            let _ = stream.write(buf);
+        } else {
+            log::error!("couldn't get stream .....");
+        }
+    }
     pub async fn run(&mut self) {
         let mut sctp_timeout = None;
         loop {
@@ -455,14 +484,7 @@ where
                     let mut association = self.association.lock().unwrap();
                     association.handle_timeout(time);
                 }
-                SctpEvent::OutgoingStreamData((id, buf)) => {
-                    let mut association = self.association.lock().unwrap();
-                    if let Ok(mut stream) = association.stream(id) {
-                        let _ = stream.write(&buf);
-                    } else {
-                        log::error!("couldn't get stream .....");
-                    }
-                }
+                SctpEvent::OutgoingStreamData((id, buf)) => self.write_stream(id, &buf),
                 SctpEvent::Disconnect => {
                     let mut association = self.association.lock().unwrap();
                     let _ = association.close();
@@ -470,6 +492,25 @@ where
                 }
             };
 
+            // writes queued meanwhile are handled before transmitting so their chunks are bundled
+            // in as few packets as possible
+            let mut disconnect = false;
+            while let Ok(event) = self.sctp_event_rx.try_recv() {
+                match event {
+                    SctpEvent::OutgoingStreamData((id, buf)) => self.write_stream(id, &buf),
+                    SctpEvent::Disconnect => {
+                        disconnect = true;
+                        break;
+                    }
+                    _ => {}
+                }
+            }
+            if disconnect {
+                let mut association = self.association.lock().unwrap();
+                let _ = association.close();
+                break;
+            }
+
             self.process_association_events().unwrap();
             self.process_endpoint_events().await.unwrap();
             self.send_association_packets().await.unwrap();
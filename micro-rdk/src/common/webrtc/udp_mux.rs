@@ -1,4 +1,5 @@
 use std::{
+    collections::VecDeque,
     io::Result,
     net::{SocketAddr, UdpSocket},
     ops::{Index, IndexMut},
@@ -7,19 +8,43 @@ use std::{
     task::{Context, Poll, Waker},
 };
 
-use async_io::{Async, Readable};
+use async_io::Async;
 
-use futures_lite::{ready, AsyncRead, AsyncWrite, Future, FutureExt};
+use futures_lite::{future::poll_fn, ready, AsyncRead, AsyncWrite, FutureExt};
 
-#[derive(Clone, Copy, PartialEq)]
+/// Datagrams read from the socket in one pass
+const MUX_BURST: usize = 16;
+/// Datagrams queued for a consumer, the socket isn't read any further while a queue is full
+#[cfg(feature = "esp32")]
+const MUX_QUEUE_DEPTH: usize = 4;
+#[cfg(not(feature = "esp32"))]
+const MUX_QUEUE_DEPTH: usize = 8;
+const MAX_DATAGRAM_SIZE: usize = 1500;
+// shorter datagrams can't hold a DTLS record header, they are discarded
+const MIN_DATAGRAM_SIZE: usize = 13;
+
+#[derive(Clone, Copy, PartialEq, Debug)]
 #[allow(clippy::upper_case_acronyms)]
 enum MuxDirection {
     DTLS,
     STUN,
-    // This is the default value it's a placeholder so we panic if for some reason we try
-    // to index with this.
-    //TODO remove once testing is done
-    NODIR,
+}
+
+impl MuxDirection {
+    fn of(datagram: &[u8]) -> Self {
+        // first byte of a stun message is 0 or 1, anything else is assumed to be a DTLS record
+        if datagram[0] < 2 {
+            MuxDirection::STUN
+        } else {
+            MuxDirection::DTLS
+        }
+    }
+    fn other(&self) -> Self {
+        match self {
+            MuxDirection::DTLS => MuxDirection::STUN,
+            MuxDirection::STUN => MuxDirection::DTLS,
+        }
+    }
 }
 
 impl Index<MuxDirection> for [MuxState] {
@@ -28,7 +53,6 @@ impl Index<MuxDirection> for [MuxState] {
         match index {
             MuxDirection::DTLS => &self[0],
             MuxDirection::STUN => &self[1],
-            MuxDirection::NODIR => panic!(),
         }
     }
 }
@@ -37,15 +61,23 @@ impl IndexMut<MuxDirection> for [MuxState] {
         match index {
             MuxDirection::DTLS => &mut self[0],
             MuxDirection::STUN => &mut self[1],
-            MuxDirection::NODIR => panic!(),
         }
     }
 }
 
+enum RecvState {
+    Received(usize, SocketAddr),
+    WouldBlock,
+    // the queue of the other consumer is full, it will wake us once it read from it
+    Full,
+}
+
 #[derive(Clone)]
 pub(crate) struct UdpMuxer {
     socket: Arc<Async<UdpSocket>>,
     mux: Arc<Mutex<[MuxState; 2]>>,
+    // buffers of datagrams already read by their consumer
+    pool: Arc<Mutex<Vec<Vec<u8>>>>,
 }
 
 impl Drop for UdpMuxer {
@@ -56,53 +88,12 @@ impl Drop for UdpMuxer {
     }
 }
 
-struct UdpMuxReadable<'a> {
-    muxer: &'a UdpMuxer,
-    dir: MuxDirection,
-    readable: Readable<'a, UdpSocket>,
-    ran_once: bool,
-}
-
-impl<'a> Future for UdpMuxReadable<'a> {
-    type Output = Result<()>;
-    fn poll(mut self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
-        let Self {
-            muxer,
-            dir,
-            readable,
-            ran_once,
-        } = &mut *self;
-
-        if *ran_once {
-            return Poll::Ready(Ok(()));
-        }
-        *ran_once = true;
-
-        muxer.register_waker(cx.waker().clone(), *dir);
-        readable.poll(cx)
-    }
-}
-
-impl<'a> Drop for UdpMuxReadable<'a> {
-    fn drop(&mut self) {
-        let state = &mut self.muxer.mux.lock().unwrap()[self.dir];
-        let _ = state.waker.take();
-    }
-}
-
 impl UdpMuxer {
-    fn readable_udp_muxer(&self, dir: MuxDirection) -> UdpMuxReadable<'_> {
-        UdpMuxReadable {
-            muxer: self,
-            dir,
-            readable: self.socket.readable(),
-            ran_once: false,
-        }
-    }
     pub(crate) fn new(socket: Arc<Async<UdpSocket>>) -> Self {
         Self {
             socket: socket.clone(),
             mux: Default::default(),
+            pool: Default::default(),
         }
     }
     pub(crate) fn get_stun_mux(&self) -> Option<UdpMux> {
@@ -132,82 +123,107 @@ impl UdpMuxer {
         }
     }
     async fn recv_from(&self, dir: MuxDirection, buf: &mut [u8]) -> Result<(usize, SocketAddr)> {
-        loop {
-            let r = match self.peek() {
-                Err(e) if e.kind() == std::io::ErrorKind::WouldBlock => (0, MuxDirection::NODIR),
-                Ok(s) => s,
-                Err(e) => return Err(e),
-            };
-            if r.0 != 0 {
-                if dir == r.1 {
-                    let socket = self.socket.as_ref().get_ref();
-                    return socket.recv_from(buf);
-                }
-                if self.yield_or_discard(r.1, r.0)? {
-                    continue;
+        // awaits readiness with its own future, `poll_readable` only keeps the waker of one task
+        // which is the consumer using `poll_recv_from`
+        let mut readable = None;
+        poll_fn(|cx| loop {
+            match self.try_recv_from(dir, buf, cx.waker())? {
+                RecvState::Received(len, addr) => return Poll::Ready(Ok((len, addr))),
+                RecvState::Full => return Poll::Pending,
+                RecvState::WouldBlock => {
+                    let fut = readable.get_or_insert_with(|| self.socket.readable());
+                    ready!(fut.poll(cx))?;
+                    readable = None;
                 }
             }
-            self.readable_udp_muxer(dir).await?;
-        }
+        })
+        .await
     }
 
-    fn register_waker(&self, waker: Waker, dir: MuxDirection) {
-        let mux = &mut self.mux.lock().unwrap()[dir];
-        if let Some(w) = mux.waker.take() {
-            if w.will_wake(&waker) {
-                mux.waker = Some(w);
+    fn register_waker(state: &mut MuxState, waker: &Waker) {
+        if let Some(w) = state.waker.take() {
+            if w.will_wake(waker) {
+                state.waker = Some(w);
                 return;
             }
             w.wake();
         }
-        mux.waker = Some(waker);
-    }
-    fn deregister_waker(&self, dir: MuxDirection) {
-        let mux = &mut self.mux.lock().unwrap()[dir];
-        let _ = mux.waker.take();
+        state.waker = Some(waker.clone());
     }
 
-    fn yield_or_discard(&self, dir: MuxDirection, _len: u16) -> Result<bool> {
-        let socket = self.socket.as_ref().get_ref();
-        let mux = &mut self.mux.lock().unwrap()[dir];
-        if !mux.is_listening {
-            let mut buf = [0_u8; 1];
-            let _ = socket.recv_from(&mut buf)?;
-            return Ok(true);
-        }
-        if let Some(w) = mux.waker.take() {
-            w.wake();
-            return Ok(false);
+    fn recycle(&self, mut datagram: Vec<u8>) {
+        let mut pool = self.pool.lock().unwrap();
+        if pool.len() < 2 * MUX_QUEUE_DEPTH {
+            datagram.clear();
+            pool.push(datagram);
         }
-        Ok(false)
     }
 
-    // will peek at the next available message on the socket
-    // if it's size is less than the minimum header size the packet is discarded
-    // otherwise the type and length will be returned
-    fn peek(&self) -> Result<(u16, MuxDirection)> {
-        let socket = self.socket.as_ref().get_ref();
-        let mut buf = [0_u8; 13];
-        let (len, _) = socket.peek_from(&mut buf)?;
-        if len != 13 {
-            let _ = socket.recv_from(&mut buf)?;
-            return Ok((0, MuxDirection::NODIR));
-        }
-        Ok(self.read_header(buf))
-    }
+    // Pops the next datagram queued for `dir`, reading a burst from the socket into the queues of
+    // both consumers when there is none. Datagrams nobody listens to are discarded.
+    fn try_recv_from(&self, dir: MuxDirection, buf: &mut [u8], waker: &Waker) -> Result<RecvState> {
+        let mut mux = self.mux.lock().unwrap();
+        loop {
+            if let Some((datagram, addr)) = mux[dir].queue.pop_front() {
+                let len = datagram.len().min(buf.len());
+                buf[..len].copy_from_slice(&datagram[..len]);
+                let _ = mux[dir].waker.take();
+                if mux[dir].queue.len() == MUX_QUEUE_DEPTH - 1 {
+                    if let Some(w) = mux[dir.other()].waker.take() {
+                        w.wake();
+                    }
+                }
+                self.recycle(datagram);
+                return Ok(RecvState::Received(len, addr));
+            }
+            Self::register_waker(&mut mux[dir], waker);
 
-    fn read_header(&self, hdr: [u8; 13]) -> (u16, MuxDirection) {
-        let msg_type = hdr[0];
-        if msg_type < 2 {
-            // stun message
-            let len: u16 = u16::from_be_bytes(hdr[2..4].try_into().unwrap());
-            (len, MuxDirection::STUN)
-        } else {
-            // assume DTLS record
-            let len: u16 = u16::from_be_bytes(hdr[11..13].try_into().unwrap());
-            (len, MuxDirection::DTLS)
+            let socket = self.socket.as_ref().get_ref();
+            let mut read = 0;
+            while read < MUX_BURST {
+                if mux.iter().any(|state| state.queue.len() >= MUX_QUEUE_DEPTH) {
+                    break;
+                }
+                let mut datagram = self.pool.lock().unwrap().pop().unwrap_or_default();
+                datagram.resize(MAX_DATAGRAM_SIZE, 0);
+                let (len, addr) = match socket.recv_from(&mut datagram) {
+                    Ok(r) => r,
+                    Err(e) => {
+                        self.recycle(datagram);
+                        if e.kind() != std::io::ErrorKind::WouldBlock {
+                            return Err(e);
+                        }
+                        if read == 0 {
+                            return Ok(RecvState::WouldBlock);
+                        }
+                        break;
+                    }
+                };
+                read += 1;
+                datagram.truncate(len);
+                if len < MIN_DATAGRAM_SIZE {
+                    self.recycle(datagram);
+                    continue;
+                }
+                let to = MuxDirection::of(&datagram);
+                if !mux[to].is_listening {
+                    self.recycle(datagram);
+                    continue;
+                }
+                let state = &mut mux[to];
+                state.queue.push_back((datagram, addr));
+                if to != dir {
+                    if let Some(w) = state.waker.take() {
+                        w.wake();
+                    }
+                }
+            }
+            if read == 0 {
+                return Ok(RecvState::Full);
+            }
         }
     }
+
     async fn send_to(&self, buf: &[u8], peer: SocketAddr) -> Result<usize> {
         loop {
             let socket = self.socket.as_ref().get_ref();
@@ -223,35 +239,19 @@ impl UdpMuxer {
     }
 
     fn poll_recv_from(
-        self: Pin<&mut Self>,
+        &self,
         cx: &mut Context<'_>,
         dir: MuxDirection,
         buf: &mut [u8],
     ) -> Poll<Result<(usize, SocketAddr)>> {
-        self.register_waker(cx.waker().clone(), dir);
         loop {
-            let r = match self.peek() {
-                Err(e) if e.kind() == std::io::ErrorKind::WouldBlock => (0, MuxDirection::NODIR),
-                Ok(s) => s,
-                Err(e) => return Poll::Ready(Err(e)),
-            };
-            if r.0 != 0 {
-                if dir == r.1 {
-                    let socket = self.socket.as_ref().get_ref();
-                    self.deregister_waker(dir);
-                    return Poll::Ready(socket.recv_from(buf));
-                }
-
-                match self.yield_or_discard(r.1, r.0) {
-                    Err(e) => return Poll::Ready(Err(e)),
-                    Ok(s) => {
-                        if s {
-                            continue;
-                        }
-                    }
+            match self.try_recv_from(dir, buf, cx.waker())? {
+                RecvState::Received(len, addr) => return Poll::Ready(Ok((len, addr))),
+                RecvState::Full => return Poll::Pending,
+                RecvState::WouldBlock => {
+                    ready!(self.socket.poll_readable(cx))?;
                 }
             }
-            let _ = ready!(self.socket.poll_readable(cx));
         }
     }
     fn poll_send_to(
@@ -279,6 +279,7 @@ impl UdpMuxer {
 struct MuxState {
     waker: Option<Waker>, // waker is present if a consumer has yield because it's waiting it's turn on the socket
     is_listening: bool,   // whether there is a consumer listening
+    queue: VecDeque<(Vec<u8>, SocketAddr)>, // datagrams read for this consumer
 }
 
 pub struct UdpMux {
@@ -299,9 +300,15 @@ impl UdpMux {
 
 impl Drop for UdpMux {
     fn drop(&mut self) {
-        let state = &mut self.muxer.mux.lock().unwrap()[self.direction];
+        let mut mux = self.muxer.mux.lock().unwrap();
+        let state = &mut mux[self.direction];
         state.is_listening = false;
+        state.queue.clear();
         let _ = state.waker.take();
+        // the other consumer may have been waiting for room in the queue
+        if let Some(w) = mux[self.direction.other()].waker.take() {
+            w.wake();
+        }
     }
 }
 
@@ -312,7 +319,7 @@ impl AsyncRead for UdpMux {
         buf: &mut [u8],
     ) -> Poll<Result<usize>> {
         let direction = self.direction;
-        let r = ready!(Pin::new(&mut self.muxer).poll_recv_from(cx, direction, buf));
+        let r = ready!(self.muxer.poll_recv_from(cx, direction, buf));
         match r {
             Ok((len, peer_addr)) => {
                 let _ = self.peer_addr.insert(peer_addr);
@@ -354,12 +361,10 @@ mod tests {
 
     use async_io::{Async, Timer};
     use bytes::{BufMut, Bytes, BytesMut};
-    //use futures_lite::FutureExt;
-    use futures_lite::{AsyncReadExt, FutureExt as OtherFutureExt, StreamExt};
-    use futures_util::FutureExt;
+    use futures_lite::{AsyncReadExt, FutureExt};
     use rand::Rng;
 
-    use crate::common::webrtc::udp_mux::{MuxDirection, UdpMuxer};
+    use crate::common::webrtc::udp_mux::{MuxDirection, UdpMuxer, MUX_QUEUE_DEPTH};
 
     fn dtls_packet(len: u16, typ: u8) -> Bytes {
         let mut buf = BytesMut::with_capacity(len as usize + 13);
@@ -483,17 +488,10 @@ mod tests {
                     assert!(r.is_ok());
                 }
 
-                // pipeline is stalling
-                let fut = async {
-                    let r = msg_read_rx.clone().recv().into_stream().count().await;
-                    Some(r)
-                }
-                .or(async {
-                    Timer::after(Duration::from_millis(500)).await;
-                    None
-                })
-                .await;
-                assert!(fut.is_none());
+                // dtls packets are read until the queue of the stun packets nobody reads is full,
+                // the pipeline then stalls
+                Timer::after(Duration::from_millis(500)).await;
+                assert_eq!(msg_read_rx.len(), MUX_QUEUE_DEPTH - 1);
             }
             // pipeline not stalling
             let fut = async {
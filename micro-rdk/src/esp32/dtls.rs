@@ -1,5 +1,6 @@
 #![allow(dead_code)]
 use std::{
+    cell::{RefCell, UnsafeCell},
     ffi::{c_char, c_int, c_uchar, c_uint, c_void},
     io::{self, Read, Write},
     marker::PhantomData,
@@ -11,7 +12,7 @@ use std::{
 
 use crate::common::webrtc::{
     certificate::Certificate,
-    dtls::{DtlsBuilder, DtlsConnector, DtlsError},
+    dtls::{DtlsBuilder, DtlsConnector, DtlsError, DTLS_HANDSHAKES},
     udp_mux::UdpMux,
 };
 
@@ -185,46 +186,36 @@ enum MbedTlsStrpProfile {
     MbedtlsSrtpNullHmacSha132,
 }
 
-#[derive(Default)]
-pub(crate) struct SSLContext {
-    dtls_entropy: Box<mbedtls_entropy_context>,
-    drbg_ctx: Box<mbedtls_ctr_drbg_context>,
-    ssl_ctx: Box<mbedtls_ssl_context>,
-    ssl_config: Box<mbedtls_ssl_config>,
-    x509: Box<mbedtls_x509_crt>,
-    pk_ctx: Box<mbedtls_pk_context>,
-    timer_ctx: Box<Esp32DtlsDelay>,
-    strp_profiles: Box<[MbedTlsStrpProfile]>,
+/// Certificate and private key of the WebRTC certificate, parsed for the first connection and
+/// shared by the next ones. mbedtls only reads them during a handshake.
+pub(crate) struct DtlsKeying {
+    x509: Box<UnsafeCell<mbedtls_x509_crt>>,
+    pk_ctx: Box<UnsafeCell<mbedtls_pk_context>>,
 }
 
-impl Drop for SSLContext {
+impl Drop for DtlsKeying {
     fn drop(&mut self) {
         unsafe {
-            mbedtls_ctr_drbg_free(self.drbg_ctx.as_mut());
-            mbedtls_entropy_free(self.dtls_entropy.as_mut());
-            mbedtls_pk_free(self.pk_ctx.as_mut());
-            mbedtls_x509_crt_free(self.x509.as_mut());
-            mbedtls_ssl_config_free(self.ssl_config.as_mut());
-            mbedtls_ssl_free(self.ssl_ctx.as_mut());
+            mbedtls_pk_free(self.pk_ctx.get());
+            mbedtls_x509_crt_free(self.x509.get());
         }
     }
 }
 
-impl SSLContext {
-    fn init<S: Certificate>(&mut self, certificate: Rc<S>) -> Result<(), SSLError> {
-        log::debug!("initializing DTLS context");
+impl DtlsKeying {
+    fn new<S: Certificate>(certificate: &S) -> Result<Self, SSLError> {
+        let keying = Self {
+            x509: Default::default(),
+            pk_ctx: Default::default(),
+        };
         unsafe {
-            mbedtls_ssl_init(self.ssl_ctx.as_mut());
-            mbedtls_ssl_config_init(self.ssl_config.as_mut());
-            mbedtls_x509_crt_init(self.x509.as_mut());
-            mbedtls_pk_init(self.pk_ctx.as_mut());
-            mbedtls_entropy_init(self.dtls_entropy.as_mut());
-            mbedtls_ctr_drbg_init(self.drbg_ctx.as_mut());
+            mbedtls_x509_crt_init(keying.x509.get());
+            mbedtls_pk_init(keying.pk_ctx.get());
         }
         let ret = unsafe {
             //TODO(RSDK-3058) we can avoid an allocation if we use the nocpy version
             mbedtls_x509_crt_parse_der(
-                self.x509.as_mut(),
+                keying.x509.get(),
                 certificate.get_der_certificate().as_ptr(),
                 certificate.get_der_certificate().len(),
             )
@@ -234,7 +225,7 @@ impl SSLContext {
         }
         let ret = unsafe {
             mbedtls_pk_parse_key(
-                self.pk_ctx.as_mut(),
+                keying.pk_ctx.get(),
                 certificate.get_der_keypair().as_ptr(),
                 certificate.get_der_keypair().len(),
                 std::ptr::null(),
@@ -244,6 +235,45 @@ impl SSLContext {
         if ret != 0 {
             return Err(SSLError::SSLKeyParseFail(ret));
         }
+        Ok(keying)
+    }
+}
+
+#[derive(Default)]
+pub(crate) struct SSLContext {
+    dtls_entropy: Box<mbedtls_entropy_context>,
+    drbg_ctx: Box<mbedtls_ctr_drbg_context>,
+    ssl_ctx: Box<mbedtls_ssl_context>,
+    ssl_config: Box<mbedtls_ssl_config>,
+    // dropped after the config referencing it
+    keying: Option<Rc<DtlsKeying>>,
+    timer_ctx: Box<Esp32DtlsDelay>,
+    strp_profiles: Box<[MbedTlsStrpProfile]>,
+}
+
+impl Drop for SSLContext {
+    fn drop(&mut self) {
+        unsafe {
+            mbedtls_ctr_drbg_free(self.drbg_ctx.as_mut());
+            mbedtls_entropy_free(self.dtls_entropy.as_mut());
+            mbedtls_ssl_config_free(self.ssl_config.as_mut());
+            mbedtls_ssl_free(self.ssl_ctx.as_mut());
+        }
+    }
+}
+
+impl SSLContext {
+    fn init(&mut self, keying: Rc<DtlsKeying>) -> Result<(), SSLError> {
+        log::debug!("initializing DTLS context");
+        unsafe {
+            mbedtls_ssl_init(self.ssl_ctx.as_mut());
+            mbedtls_ssl_config_init(self.ssl_config.as_mut());
+            mbedtls_entropy_init(self.dtls_entropy.as_mut());
+            mbedtls_ctr_drbg_init(self.drbg_ctx.as_mut());
+        }
+        let x509 = keying.x509.get();
+        let pk_ctx = keying.pk_ctx.get();
+        let _ = self.keying.insert(keying);
 
         let ret = unsafe {
             mbedtls_ctr_drbg_seed(
@@ -299,16 +329,8 @@ impl SSLContext {
             //mbedtls_ssl_conf_dbg( &conf, my_debug, stdout );
             //mbedtls_ssl_conf_read_timeout(self.ssl_config.as_mut(), 10000);
 
-            mbedtls_ssl_conf_ca_chain(
-                self.ssl_config.as_mut(),
-                self.x509.next,
-                std::ptr::null_mut(),
-            );
-            let ret = mbedtls_ssl_conf_own_cert(
-                self.ssl_config.as_mut(),
-                self.x509.as_mut(),
-                self.pk_ctx.as_mut(),
-            );
+            mbedtls_ssl_conf_ca_chain(self.ssl_config.as_mut(), (*x509).next, std::ptr::null_mut());
+            let ret = mbedtls_ssl_conf_own_cert(self.ssl_config.as_mut(), x509, pk_ctx);
             if ret != 0 {
                 return Err(SSLError::SSLConfigFailure(ret));
             }
@@ -347,6 +369,7 @@ pub struct Esp32Dtls<C> {
     context: Box<SSLContext>,
     transport: Option<UdpMux>,
     certificate: Rc<C>,
+    keying: Option<Rc<DtlsKeying>>,
 }
 
 #[derive(Error, Debug)]
@@ -383,18 +406,38 @@ impl From<i32> for SSLError {
 
 pub struct Esp32DtlsBuilder<C: Certificate> {
     cert: Rc<C>,
+    // the certificate of a builder never changes, it is parsed once for every connection
+    keying: RefCell<Option<Rc<DtlsKeying>>>,
 }
 
 impl<C: Certificate> Esp32DtlsBuilder<C> {
     pub fn new(cert: Rc<C>) -> Self {
-        Self { cert }
+        Self {
+            cert,
+            keying: RefCell::new(None),
+        }
+    }
+    fn keying(&self) -> Result<Rc<DtlsKeying>, SSLError> {
+        let mut keying = self.keying.borrow_mut();
+        if let Some(keying) = keying.as_ref() {
+            return Ok(keying.clone());
+        }
+        let new = Rc::new(DtlsKeying::new(self.cert.as_ref())?);
+        let _ = keying.insert(new.clone());
+        Ok(new)
     }
 }
 
 impl<C: Certificate> DtlsBuilder for Esp32DtlsBuilder<C> {
     type Output = Esp32Dtls<C>;
     fn make(&self) -> Result<Self::Output, DtlsError> {
-        Esp32Dtls::new(self.cert.clone()).map_err(|e| DtlsError::DtlsError(Box::new(e)))
+        let mut dtls =
+            Esp32Dtls::new(self.cert.clone()).map_err(|e| DtlsError::DtlsError(Box::new(e)))?;
+        let keying = self
+            .keying()
+            .map_err(|e| DtlsError::DtlsError(Box::new(e)))?;
+        let _ = dtls.keying.insert(keying);
+        Ok(dtls)
     }
 }
 
@@ -408,6 +451,7 @@ where
             context,
             transport: None,
             certificate,
+            keying: None,
         })
     }
 
@@ -416,7 +460,11 @@ where
             MbedTlsStrpProfile::MbedtlsSrtpAes128CmHmacSha180,
             MbedTlsStrpProfile::MbedtlsSrtpUnsetProfile,
         ]);
-        self.context.init(self.certificate.clone())?;
+        let keying = match self.keying.take() {
+            Some(keying) => keying,
+            None => Rc::new(DtlsKeying::new(self.certificate.as_ref())?),
+        };
+        self.context.init(keying)?;
 
         Ok(())
     }
@@ -704,6 +752,8 @@ where
 
         Ok(Box::pin(async move {
             Pin::new(&mut stream).accept().await?;
+            // sessions aren't cached, every handshake is a full one
+            DTLS_HANDSHAKES.record(false);
             Ok(stream)
         }))
     }
@@ -10,6 +10,8 @@ use std::{
 
 use crate::common::{
     app_client::{AppClientBuilder, AppClientConfig},
+    config_cache::{store_config, BootRobot},
+    config_monitor::ConfigMonitor,
     conn::{
         mdns::NoMdns,
         network::Network,
@@ -18,18 +20,31 @@ use crate::common::{
     entry::RobotRepresentation,
     grpc_client::GrpcClient,
     log::config_log_entry,
-    provisioning::storage::RobotCredentials,
+    provisioning::storage::{RobotConfigurationStorage, RobotCredentials},
     restart_monitor::RestartMonitor,
     robot::LocalRobot,
+    telemetry,
 };
 
 #[cfg(feature = "data")]
-use crate::common::{data_manager::DataManager, data_store::StaticMemoryDataStore};
+use crate::{
+    common::{
+        data_manager::{DataManager, DataManagerTasks},
+        data_store::StaticMemoryDataStore,
+        flash_data_store::FlashDataStore,
+    },
+    esp32::flash_region::EspPartitionRegion,
+    proto::app::v1::ConfigResponse,
+};
+#[cfg(feature = "data")]
+use futures_lite::prelude::Future;
+#[cfg(feature = "data")]
+use std::pin::Pin;
 
 use super::{
     certificate::GeneratedWebRtcCertificateBuilder,
     dtls::Esp32DtlsBuilder,
-    exec::Esp32Executor,
+    exec::{start_reactor_on_core, Esp32Executor, REACTOR_CORE},
     tcp::Esp32Stream,
     tls::{Esp32TLS, Esp32TLSServerConfig},
 };
@@ -44,12 +59,13 @@ use crate::common::{
     provisioning::storage::{RobotCredentialStorage, WifiCredentialStorage},
 };
 
-pub async fn serve_web_inner(
+pub async fn serve_web_inner<C: RobotConfigurationStorage + 'static>(
     robot_creds: RobotCredentials,
-    repr: RobotRepresentation,
+    boot: BootRobot,
     exec: Esp32Executor,
     max_webrtc_connection: usize,
     network: impl Network,
+    config_storage: Option<C>,
 ) {
     // TODO(NPM) this is a workaround so that async-io thread has started before we
     // instantiate the Async<TCPStream> for the connection to app.viam.com
@@ -69,7 +85,13 @@ pub async fn serve_web_inner(
 
     let mut client_connector = Esp32TLS::new_client();
     let mdns = NoMdns {};
+    let ip = network.get_ip();
 
+    #[cfg(feature = "data")]
+    let mut running_data_tasks = None;
+    // registry the config monitor reconciles the robot with, none when the robot was built by
+    // the caller
+    let mut registry = None;
     let (cfg_response, robot, _tls_server_config) = {
         let cloned_exec = exec.clone();
         let conn = client_connector.open_ssl_context(None).unwrap();
@@ -95,8 +117,7 @@ pub async fn serve_web_inner(
             .into_bytes_with_nul();
         let tls_server_config = Esp32TLSServerConfig::new(tls_certs, serv_key, serv_key_len);
 
-        let (cfg_response, cfg_received_datetime) =
-            client.get_config(network.get_ip()).await.unwrap();
+        let (cfg_response, cfg_received_datetime) = client.get_config(ip).await.unwrap();
 
         if let Some(current_dt) = cfg_received_datetime.as_ref() {
             let tz = chrono_tz::Tz::UTC;
@@ -114,16 +135,48 @@ pub async fn serve_web_inner(
             }
         }
 
-        let robot = match repr {
-            RobotRepresentation::WithRobot(robot) => Arc::new(Mutex::new(robot)),
-            RobotRepresentation::WithRegistry(registry) => {
+        let robot = match boot {
+            BootRobot::Cached(mut cached) => {
+                let unchanged = cached.config == *cfg_response;
+                let err = match cached.reconcile(&cfg_response, cfg_received_datetime).await {
+                    Ok(_) => {
+                        if !unchanged {
+                            store_config(config_storage.as_ref(), &cfg_response);
+                        }
+                        None
+                    }
+                    Err(err) => {
+                        log::error!("couldn't apply config, keeping the cached one: {:?}", err);
+                        Some(err)
+                    }
+                };
+                if let Some(datetime) = cfg_received_datetime {
+                    let logs = vec![config_log_entry(datetime, err)];
+                    client
+                        .push_logs(logs)
+                        .await
+                        .expect("could not push logs to app");
+                }
+                #[cfg(feature = "data")]
+                {
+                    running_data_tasks = cached.data_tasks.take();
+                }
+                registry = Some(cached.registry);
+                cached.robot
+            }
+            BootRobot::Uncached(RobotRepresentation::WithRobot(robot)) => {
+                Arc::new(Mutex::new(robot))
+            }
+            BootRobot::Uncached(RobotRepresentation::WithRegistry(from_registry)) => {
                 log::info!("building robot from config");
+                registry = Some(from_registry.clone());
                 let r = match LocalRobot::from_cloud_config(
                     &cfg_response,
-                    registry,
+                    from_registry,
                     cfg_received_datetime,
                 ) {
                     Ok(robot) => {
+                        store_config(config_storage.as_ref(), &cfg_response);
                         if let Some(datetime) = cfg_received_datetime {
                             let logs = vec![config_log_entry(datetime, None)];
                             client
@@ -153,32 +206,21 @@ pub async fn serve_web_inner(
     };
 
     #[cfg(feature = "data")]
-    // TODO: Support implementers of the DataStore trait other than StaticMemoryDataStore in a way that is configurable
-    let data_manager_svc = match DataManager::<StaticMemoryDataStore>::from_robot_and_config(
-        &cfg_response,
-        &app_config,
-        robot.clone(),
-    ) {
-        Ok(svc) => svc,
-        Err(err) => {
-            log::error!("error configuring data management: {:?}", err);
-            None
-        }
+    let (data_sync_task, data_future, collector_updater) = match running_data_tasks {
+        Some((sync_task, task, updater)) => (
+            Some(sync_task),
+            Box::pin(task) as Pin<Box<dyn Future<Output = ()>>>,
+            Some(updater),
+        ),
+        None => match data_manager_tasks(&cfg_response, &app_config, robot.clone()) {
+            Some((sync_task, future, updater)) => (Some(sync_task), future, Some(updater)),
+            None => (
+                None,
+                Box::pin(async move {}) as Pin<Box<dyn Future<Output = ()>>>,
+                None,
+            ),
+        },
     };
-
-    #[cfg(feature = "data")]
-    let data_sync_task = data_manager_svc
-        .as_ref()
-        .map(|data_manager_svc| data_manager_svc.get_sync_task());
-
-    #[cfg(feature = "data")]
-    let data_future = Box::pin(async move {
-        if let Some(mut data_manager_svc) = data_manager_svc {
-            if let Err(err) = data_manager_svc.data_collection_task().await {
-                log::error!("error running data manager: {:?}", err)
-            }
-        }
-    });
     #[cfg(not(feature = "data"))]
     let data_future = async move {};
 
@@ -208,7 +250,26 @@ pub async fn serve_web_inner(
         })));
         #[cfg(feature = "data")]
         let builder = if let Some(task) = data_sync_task {
-            builder.with_periodic_app_client_task(Box::new(task))
+            builder.with_periodic_app_client_task(task)
+        } else {
+            builder
+        };
+        let builder = if let Some(registry) = registry {
+            let monitor = ConfigMonitor::new(
+                (*cfg_response).clone(),
+                robot.clone(),
+                registry,
+                ip,
+                || unsafe { crate::esp32::esp_idf_svc::sys::esp_restart() },
+            )
+            .with_on_applied(move |cfg| store_config(config_storage.as_ref(), cfg));
+            #[cfg(feature = "data")]
+            let monitor = if let Some(updater) = collector_updater {
+                monitor.with_collector_updater(updater)
+            } else {
+                monitor
+            };
+            builder.with_periodic_app_client_task(Box::new(monitor))
         } else {
             builder
         };
@@ -218,6 +279,70 @@ pub async fn serve_web_inner(
     futures_lite::future::zip(Box::pin(srv.serve(robot)), data_future).await;
 }
 
+#[cfg(feature = "data")]
+// collected data is persisted when a flash region is available, otherwise it is kept in memory
+fn data_manager_tasks(
+    cfg: &ConfigResponse,
+    app_config: &AppClientConfig,
+    robot: Arc<Mutex<LocalRobot>>,
+) -> Option<DataManagerTasks> {
+    let tasks = if EspPartitionRegion::is_available() {
+        DataManager::<FlashDataStore<EspPartitionRegion>>::from_robot_and_config(
+            cfg, app_config, robot,
+        )
+        .map(|svc| svc.map(DataManager::into_tasks))
+    } else {
+        DataManager::<StaticMemoryDataStore>::from_robot_and_config(cfg, app_config, robot)
+            .map(|svc| svc.map(DataManager::into_tasks))
+    };
+    match tasks {
+        Ok(tasks) => tasks,
+        Err(err) => {
+            log::error!("error configuring data management: {:?}", err);
+            None
+        }
+    }
+}
+
+// Builds the robot from the cached config of the stored credentials, collection starts right away
+// unless the clock still has to be set by app
+#[cfg(feature = "provisioning")]
+#[cfg_attr(not(feature = "data"), allow(unused_variables))]
+fn boot_robot<S>(repr: RobotRepresentation, storage: &S, exec: &Esp32Executor) -> BootRobot
+where
+    S: RobotCredentialStorage + RobotConfigurationStorage,
+{
+    if !storage.has_stored_credentials() {
+        return BootRobot::Uncached(repr);
+    }
+    #[allow(unused_mut)]
+    let mut boot = BootRobot::new(repr, Some(storage));
+    #[cfg(feature = "data")]
+    if let (BootRobot::Cached(cached), Ok(creds), true) =
+        (&mut boot, storage.get_robot_credentials(), clock_is_set())
+    {
+        let app_config = AppClientConfig::new(
+            creds.robot_secret().to_owned(),
+            creds.robot_id().to_owned(),
+            "".to_owned(),
+        );
+        cached.data_tasks = data_manager_tasks(&cached.config, &app_config, cached.robot.clone())
+            .map(|(sync_task, future, updater)| (sync_task, exec.spawn(future), updater));
+    }
+    boot
+}
+
+// the RTC keeps the time across resets, otherwise readings taken before app sets it would be
+// stamped in 1970
+#[cfg(feature = "data")]
+fn clock_is_set() -> bool {
+    // 2024-01-01
+    const MIN_TIMESTAMP: u64 = 1_704_067_200;
+    std::time::SystemTime::now()
+        .duration_since(std::time::UNIX_EPOCH)
+        .map_or(false, |now| now.as_secs() > MIN_TIMESTAMP)
+}
+
 async fn validate_robot_credentials(
     exec: Esp32Executor,
     robot_creds: &RobotCredentials,
@@ -251,7 +376,7 @@ async fn serve_async<S>(
     max_webrtc_connection: usize,
 ) -> Result<(), Box<dyn std::error::Error>>
 where
-    S: RobotCredentialStorage + WifiCredentialStorage + Clone + 'static,
+    S: RobotCredentialStorage + WifiCredentialStorage + RobotConfigurationStorage + Clone + 'static,
     <S as RobotCredentialStorage>::Error: Debug,
     ServerError: From<<S as RobotCredentialStorage>::Error>,
     <S as WifiCredentialStorage>::Error: Sync + Send + 'static,
@@ -268,6 +393,7 @@ where
     let mut last_error: Option<Box<dyn std::error::Error>> = None;
 
     let info = info.unwrap_or_default();
+    let mut boot = boot_robot(repr, &storage, &exec);
 
     let network = loop {
         // Credentials are present let's check we can connect
@@ -301,6 +427,8 @@ where
                 break network;
             }
         }
+        // provisioning may change the robot, its cached config no longer applies
+        boot = boot.discard(&storage).await;
         // Start the WiFi in AP + STA mode
         let wifi_manager = Esp32WifiProvisioningBuilder::default()
             .build(storage.clone())
@@ -322,10 +450,11 @@ where
     };
     serve_web_inner(
         storage.get_robot_credentials().unwrap(),
-        repr,
+        boot,
         exec,
         max_webrtc_connection,
         network,
+        Some(storage),
     )
     .await;
     Ok(())
@@ -342,7 +471,7 @@ async fn serve_async_with_external_network<S>(
     max_webrtc_connection: usize,
 ) -> Result<(), Box<dyn std::error::Error>>
 where
-    S: RobotCredentialStorage + WifiCredentialStorage + Clone + 'static,
+    S: RobotCredentialStorage + WifiCredentialStorage + RobotConfigurationStorage + Clone + 'static,
     <S as RobotCredentialStorage>::Error: Debug,
     ServerError: From<<S as RobotCredentialStorage>::Error>,
     <S as WifiCredentialStorage>::Error: Sync + Send + 'static,
@@ -353,6 +482,7 @@ where
 
     let info = info.unwrap_or_default();
     let mut last_error: Option<Box<dyn std::error::Error>> = None;
+    let mut boot = boot_robot(repr, &storage, &exec);
 
     loop {
         // Credentials are present let's check we can connect
@@ -386,6 +516,8 @@ where
                 break;
             }
         }
+        // provisioning may change the robot, its cached config no longer applies
+        boot = boot.discard(&storage).await;
         let mut mdns = Esp32Mdns::new("".to_owned())?;
         if let Err(e) = serve_provisioning_async::<_, (), _>(
             exec.clone(),
@@ -402,10 +534,11 @@ where
     }
     serve_web_inner(
         storage.get_robot_credentials().unwrap(),
-        repr,
+        boot,
         exec,
         max_webrtc_connection,
         network,
+        Some(storage),
     )
     .await;
     Ok(())
@@ -417,7 +550,7 @@ pub fn serve_web<S>(
     max_webrtc_connection: usize,
     storage: S,
 ) where
-    S: RobotCredentialStorage + WifiCredentialStorage + Clone + 'static,
+    S: RobotCredentialStorage + WifiCredentialStorage + RobotConfigurationStorage + Clone + 'static,
     <S as RobotCredentialStorage>::Error: Debug,
     ServerError: From<<S as RobotCredentialStorage>::Error>,
     <S as WifiCredentialStorage>::Error: Sync + Send + 'static,
@@ -435,6 +568,11 @@ pub fn serve_web<S>(
         )
     })
     .unwrap();
+    telemetry::register_current_task(telemetry::SERVER_TASK_NAME);
+
+    if let Err(err) = start_reactor_on_core(REACTOR_CORE) {
+        log::warn!("couldn't pin the async-io reactor: {:?}", err);
+    }
 
     let exec = Esp32Executor::new();
     let cloned_exec = exec.clone();
@@ -466,7 +604,7 @@ pub fn serve_web_with_external_network<S>(
     storage: S,
     network: impl Network,
 ) where
-    S: RobotCredentialStorage + WifiCredentialStorage + Clone + 'static,
+    S: RobotCredentialStorage + WifiCredentialStorage + RobotConfigurationStorage + Clone + 'static,
     <S as RobotCredentialStorage>::Error: Debug,
     ServerError: From<<S as RobotCredentialStorage>::Error>,
     <S as WifiCredentialStorage>::Error: Sync + Send + 'static,
@@ -484,6 +622,11 @@ pub fn serve_web_with_external_network<S>(
         )
     })
     .unwrap();
+    telemetry::register_current_task(telemetry::SERVER_TASK_NAME);
+
+    if let Err(err) = start_reactor_on_core(REACTOR_CORE) {
+        log::warn!("couldn't pin the async-io reactor: {:?}", err);
+    }
 
     let exec = Esp32Executor::new();
     let cloned_exec = exec.clone();
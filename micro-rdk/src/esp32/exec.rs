@@ -1,10 +1,52 @@
 //! The exec module exposes helpers to execute futures on an ESP32
-use crate::common::{provisioning::server::ProvisioningExecutor, webrtc::exec::WebRtcExecutor};
+//!
+//! The executor runs on the core of the task that created it (core 1 for the main task with the
+//! provided sdkconfig). Only the async-io reactor thread, which waits on the sockets and timers and
+//! wakes the tasks they belong to, can be moved: `start_reactor_on_core` pins it to the core running
+//! the WiFi and lwIP tasks. Every spawned future, connection handling (TLS, gRPC, WebRTC) included,
+//! still runs on the executor's core alongside data collection and component callbacks.
+//!
+//! There is a single executor, the futures it runs can't be moved to another core: data sync and
+//! collection share their store through `Rc` and hold the components of the robot, which aren't
+//! `Send`.
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::time::Duration;
+
+use crate::common::{
+    provisioning::server::ProvisioningExecutor, telemetry, webrtc::exec::WebRtcExecutor,
+};
+use crate::esp32::esp_idf_svc::{
+    hal::{cpu::Core, task::thread::ThreadSpawnConfiguration},
+    sys::EspError,
+};
 use async_executor::{LocalExecutor, Task};
 use futures_lite::{
     future::{self, block_on},
     Future,
 };
+
+/// Core the async-io reactor thread is pinned to by `serve_web`, the one the WiFi and lwIP tasks are
+/// pinned to by the provided sdkconfig
+pub const REACTOR_CORE: Core = Core::Core0;
+
+static REACTOR_STARTED: AtomicBool = AtomicBool::new(false);
+
+/// Starts the async-io reactor thread on `core`. Only the first call has an effect, and only when
+/// it happens before any socket or timer is polled (the reactor otherwise starts unpinned).
+pub fn start_reactor_on_core(core: Core) -> Result<(), EspError> {
+    if REACTOR_STARTED.swap(true, Ordering::Relaxed) {
+        return Ok(());
+    }
+    let mut conf = ThreadSpawnConfiguration::get().unwrap_or_default();
+    let previous = conf.pin_to_core;
+    conf.pin_to_core = Some(core);
+    conf.set()?;
+    // polling a pending timer registers it with the reactor, which spawns its thread
+    block_on(async_io::Timer::after(Duration::from_millis(1)));
+    // threads spawned later (by components, or the FFI) keep the default affinity
+    conf.pin_to_core = previous;
+    conf.set()
+}
 #[derive(Clone, Debug, Default)]
 pub struct Esp32Executor {}
 
@@ -19,7 +61,7 @@ impl Esp32Executor {
     }
     // Spawn a future onto the local executor
     pub fn spawn<T: 'static>(&self, future: impl Future<Output = T> + 'static) -> Task<T> {
-        EX.with(|e| e.spawn(future))
+        EX.with(|e| e.spawn(telemetry::executor_task(future)))
     }
 
     pub fn block_on<T>(&self, future: impl Future<Output = T>) -> T {
@@ -39,7 +81,7 @@ where
     F: future::Future + 'static,
 {
     fn execute(&self, fut: F) {
-        EX.with(|e| e.spawn(fut)).detach();
+        EX.with(|e| e.spawn(telemetry::executor_task(fut))).detach();
     }
 }
 
@@ -48,6 +90,6 @@ where
     F: future::Future + 'static,
 {
     fn execute(&self, fut: F) {
-        EX.with(|e| e.spawn(fut)).detach();
+        EX.with(|e| e.spawn(telemetry::executor_task(fut))).detach();
     }
 }
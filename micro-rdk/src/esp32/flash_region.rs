@@ -0,0 +1,98 @@
+//! FlashRegion backed by a data partition of the ESP32 flash
+//!
+//! The partition has to be declared in the partition table, for example
+//! `viam_data, data, 0x40, , 0x40000,`, collected data is only persisted when it exists.
+use std::ffi::{c_void, CStr};
+
+use crate::common::{data_store::DataStoreError, flash_data_store::FlashRegion};
+use crate::esp32::esp_idf_svc::sys::{
+    esp, esp_partition_erase_range, esp_partition_find_first, esp_partition_read,
+    esp_partition_subtype_t_ESP_PARTITION_SUBTYPE_ANY, esp_partition_t,
+    esp_partition_type_t_ESP_PARTITION_TYPE_DATA, esp_partition_write, EspError,
+};
+
+/// Label of the partition used to persist collected data
+pub const DATA_PARTITION_LABEL: &CStr = match CStr::from_bytes_with_nul(b"viam_data\0") {
+    Ok(label) => label,
+    Err(_) => panic!(),
+};
+const SECTOR_SIZE: usize = 4096;
+
+impl From<EspError> for DataStoreError {
+    fn from(value: EspError) -> Self {
+        DataStoreError::StorageError(value.to_string())
+    }
+}
+
+pub struct EspPartitionRegion {
+    partition: *const esp_partition_t,
+    sector_count: usize,
+}
+
+impl EspPartitionRegion {
+    fn find_partition() -> *const esp_partition_t {
+        unsafe {
+            esp_partition_find_first(
+                esp_partition_type_t_ESP_PARTITION_TYPE_DATA,
+                esp_partition_subtype_t_ESP_PARTITION_SUBTYPE_ANY,
+                DATA_PARTITION_LABEL.as_ptr(),
+            )
+        }
+    }
+
+    /// Whether the partition table has a partition to persist collected data
+    pub fn is_available() -> bool {
+        !Self::find_partition().is_null()
+    }
+}
+
+impl FlashRegion for EspPartitionRegion {
+    fn open() -> Result<Self, DataStoreError> {
+        let partition = Self::find_partition();
+        if partition.is_null() {
+            return Err(DataStoreError::StorageError(format!(
+                "no {:?} partition",
+                DATA_PARTITION_LABEL
+            )));
+        }
+        let sector_count = unsafe { (*partition).size } as usize / SECTOR_SIZE;
+        Ok(Self {
+            partition,
+            sector_count,
+        })
+    }
+    fn sector_size(&self) -> usize {
+        SECTOR_SIZE
+    }
+    fn sector_count(&self) -> usize {
+        self.sector_count
+    }
+    fn read(&mut self, offset: usize, buf: &mut [u8]) -> Result<(), DataStoreError> {
+        esp!(unsafe {
+            esp_partition_read(
+                self.partition,
+                offset,
+                buf.as_mut_ptr() as *mut c_void,
+                buf.len(),
+            )
+        })?;
+        Ok(())
+    }
+    fn write(&mut self, offset: usize, data: &[u8]) -> Result<(), DataStoreError> {
+        esp!(unsafe {
+            esp_partition_write(
+                self.partition,
+                offset,
+                data.as_ptr() as *const c_void,
+                data.len(),
+            )
+        })?;
+        Ok(())
+    }
+    fn erase_sector(&mut self, sector: usize) -> Result<(), DataStoreError> {
+        esp!(unsafe {
+            esp_partition_erase_range(self.partition, sector * SECTOR_SIZE, SECTOR_SIZE)
+        })?;
+        Ok(())
+    }
+}
@@ -11,6 +11,8 @@ pub mod encoder;
 pub mod entry;
 pub mod esp_idf_svc;
 pub mod exec;
+#[cfg(feature = "data")]
+pub mod flash_region;
 #[cfg(feature = "builtin-components")]
 pub mod hcsr04;
 pub mod i2c;
@@ -7,11 +7,16 @@ use esp_idf_svc::{
 };
 use thiserror::Error;
 
-use crate::common::{
-    grpc::{GrpcError, ServerError},
-    provisioning::storage::{
-        RobotCredentialStorage, RobotCredentials, WifiCredentialStorage, WifiCredentials,
+use crate::{
+    common::{
+        config_cache::{decode_cached_config, encode_cached_config, ConfigCacheError},
+        grpc::{GrpcError, ServerError},
+        provisioning::storage::{
+            RobotConfigurationStorage, RobotCredentialStorage, RobotCredentials,
+            WifiCredentialStorage, WifiCredentials,
+        },
     },
+    proto::app::v1::ConfigResponse,
 };
 
 #[derive(Error, Debug)]
@@ -20,6 +25,8 @@ pub enum NVSStorageError {
     EspError(#[from] EspError),
     #[error("nvs key {0} is absent")]
     NVSKeyAbsent(&'static str),
+    #[error(transparent)]
+    NVSConfigCacheError(#[from] ConfigCacheError),
 }
 
 #[derive(Clone)]
@@ -58,6 +65,23 @@ impl NVSStorage {
         let nvs = self.nvs.borrow();
         Ok(nvs.str_len(key)?.is_some())
     }
+    fn get_blob(&self, key: &'static str) -> Result<Vec<u8>, NVSStorageError> {
+        let nvs = self.nvs.borrow_mut();
+        let len = nvs
+            .blob_len(key)?
+            .ok_or(NVSStorageError::NVSKeyAbsent(key))?;
+        let mut buf = vec![0_u8; len];
+        let blob_len = nvs
+            .get_blob(key, buf.as_mut_slice())?
+            .ok_or(NVSStorageError::NVSKeyAbsent(key))?
+            .len();
+        buf.truncate(blob_len);
+        Ok(buf)
+    }
+    fn set_blob(&self, key: &str, bytes: &[u8]) -> Result<(), NVSStorageError> {
+        let mut nvs = self.nvs.borrow_mut();
+        Ok(nvs.set_blob(key, bytes)?)
+    }
     fn has_key(&self, key: &str) -> Result<bool, NVSStorageError> {
         let nvs = self.nvs.borrow();
 
@@ -119,6 +143,22 @@ impl WifiCredentialStorage for NVSStorage {
     }
 }
 
+impl RobotConfigurationStorage for NVSStorage {
+    type Error = NVSStorageError;
+    fn has_robot_configuration(&self) -> bool {
+        self.has_key("ROBOT_CONFIG").unwrap_or(false)
+    }
+    fn store_robot_configuration(&self, cfg: &ConfigResponse) -> Result<(), Self::Error> {
+        self.set_blob("ROBOT_CONFIG", &encode_cached_config(cfg))
+    }
+    fn get_robot_configuration(&self) -> Result<ConfigResponse, Self::Error> {
+        Ok(decode_cached_config(&self.get_blob("ROBOT_CONFIG")?)?)
+    }
+    fn reset_robot_configuration(&self) -> Result<(), Self::Error> {
+        self.erase_key("ROBOT_CONFIG")
+    }
+}
+
 impl From<NVSStorageError> for ServerError {
     fn from(value: NVSStorageError) -> Self {
         Self::new(GrpcError::RpcUnavailable, Some(value.into()))
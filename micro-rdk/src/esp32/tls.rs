@@ -9,6 +9,10 @@ use crate::esp32::esp_idf_svc::sys::{
 };
 use async_io::Async;
 use either::Either;
+#[cfg(esp_idf_esp_tls_client_session_tickets)]
+use esp_idf_svc::sys::{
+    esp_tls_client_session_t, esp_tls_free_client_session, esp_tls_get_client_session,
+};
 use esp_idf_svc::sys::{
     esp_tls_get_conn_sockfd, lwip_setsockopt, socklen_t, IPPROTO_TCP, SOL_SOCKET, SO_KEEPALIVE,
     TCP_KEEPCNT, TCP_KEEPIDLE, TCP_KEEPINTVL,
@@ -21,27 +25,77 @@ use std::{
     net::TcpStream,
     ops::Deref,
     os::{fd::FromRawFd, raw::c_char, unix::prelude::AsRawFd},
+    sync::{Arc, Mutex},
     task::Poll,
 };
 
 use crate::common::conn::errors::ServerError;
-use crate::common::conn::server::TlsClientConnector;
+use crate::common::conn::server::{TlsClientConnector, TLS_HANDSHAKES};
 
 use super::tcp::Esp32Stream;
 
 unsafe impl Sync for Esp32TLS {}
 unsafe impl Send for Esp32TLS {}
+// the session is only used under the mutex
+unsafe impl Send for ClientSession {}
 
 const TCP_KEEPINTVL_S: i32 = 60; // seconds
 const TCP_KEEPCNT_N: i32 = 4;
 const TCP_KEEPIDLE_S: i32 = 120; // seconds
 
+/// Session of the last connection to app, offered to resume it on the next connection
+#[derive(Default)]
+struct ClientSession {
+    #[cfg(esp_idf_esp_tls_client_session_tickets)]
+    session: Option<std::ptr::NonNull<esp_tls_client_session_t>>,
+}
+
+impl ClientSession {
+    #[cfg(esp_idf_esp_tls_client_session_tickets)]
+    fn as_ptr(&self) -> *mut esp_tls_client_session_t {
+        self.session
+            .map_or(std::ptr::null_mut(), std::ptr::NonNull::as_ptr)
+    }
+    #[cfg(esp_idf_esp_tls_client_session_tickets)]
+    fn replace(&mut self, session: *mut esp_tls_client_session_t) {
+        if let Some(old) = std::mem::replace(&mut self.session, std::ptr::NonNull::new(session)) {
+            unsafe { esp_tls_free_client_session(old.as_ptr()) };
+        }
+    }
+    /// Stores the session of a connection that just completed its handshake, returns whether a
+    /// previous session was offered for it
+    #[cfg(esp_idf_esp_tls_client_session_tickets)]
+    fn update(&mut self, tls_context: &Esp32TLSContext) -> bool {
+        let offered = self.session.is_some();
+        // esp-tls copied the offered session during the handshake, it can be freed
+        self.replace(unsafe { esp_tls_get_client_session(**tls_context) });
+        offered
+    }
+    #[cfg(not(esp_idf_esp_tls_client_session_tickets))]
+    fn update(&mut self, _: &Esp32TLSContext) -> bool {
+        false
+    }
+    #[cfg(esp_idf_esp_tls_client_session_tickets)]
+    fn clear(&mut self) {
+        self.replace(std::ptr::null_mut());
+    }
+    #[cfg(not(esp_idf_esp_tls_client_session_tickets))]
+    fn clear(&mut self) {}
+}
+
+impl Drop for ClientSession {
+    fn drop(&mut self) {
+        self.clear();
+    }
+}
+
 /// structure to store tls configuration
 #[derive(Clone)]
 pub struct Esp32TLS {
     #[allow(dead_code)]
     alpn_ptr: Vec<*const c_char>,
     tls_cfg: Either<Box<esp_tls_cfg_server>, Box<esp_tls_cfg>>,
+    client_session: Arc<Mutex<ClientSession>>,
 }
 
 impl TlsClientConnector for Esp32TLS {
@@ -171,11 +225,14 @@ impl Esp32TLS {
             is_plain_tcp: false,
             timeout_ms: 50000,
             common_name: std::ptr::null(),
+            #[cfg(esp_idf_esp_tls_client_session_tickets)]
+            client_session: std::ptr::null_mut(),
         });
 
         Self {
             alpn_ptr,
             tls_cfg: Either::Right(tls_cfg_client),
+            client_session: Default::default(),
         }
     }
     /// Creates a TLS object ready to accept connection or connect to a server
@@ -210,15 +267,46 @@ impl Esp32TLS {
         Self {
             alpn_ptr,
             tls_cfg: Either::Left(tls_cfg_srv),
+            client_session: Default::default(),
         }
     }
 
     /// open the a TLS (SSL) context either in client or in server mode
+    ///
+    /// In client mode the session of the previous connection is offered to skip the key exchange
+    /// and certificate verification when app accepts it.
     pub fn open_ssl_context(
         &mut self,
         socket: Option<Async<TcpStream>>,
     ) -> Result<Esp32TLSStream, std::io::Error> {
-        Esp32TLSStream::new(socket, &mut self.tls_cfg)
+        if self.tls_cfg.is_left() {
+            return Esp32TLSStream::new(socket, &mut self.tls_cfg);
+        }
+        let mut session = self.client_session.lock().unwrap();
+        #[cfg(esp_idf_esp_tls_client_session_tickets)]
+        if let Either::Right(tls_cfg) = &mut self.tls_cfg {
+            tls_cfg.client_session = session.as_ptr();
+        }
+        let stream = Esp32TLSStream::new(socket, &mut self.tls_cfg);
+        #[cfg(esp_idf_esp_tls_client_session_tickets)]
+        if let Either::Right(tls_cfg) = &mut self.tls_cfg {
+            tls_cfg.client_session = std::ptr::null_mut();
+        }
+        match stream {
+            Ok(stream) => {
+                if session.update(&stream.tls_context) {
+                    TLS_HANDSHAKES.record_offered();
+                } else {
+                    TLS_HANDSHAKES.record(false);
+                }
+                Ok(stream)
+            }
+            Err(err) => {
+                // a rejected session shouldn't fail the next attempt too
+                session.clear();
+                Err(err)
+            }
+        }
     }
 }
 
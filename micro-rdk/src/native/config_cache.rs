@@ -0,0 +1,81 @@
+//! RobotConfigurationStorage backed by a file on native targets
+use std::{path::PathBuf, sync::OnceLock};
+
+use thiserror::Error;
+
+use crate::{
+    common::{
+        config_cache::{decode_cached_config, encode_cached_config, ConfigCacheError},
+        grpc::{GrpcError, ServerError},
+        provisioning::storage::RobotConfigurationStorage,
+    },
+    proto::app::v1::ConfigResponse,
+};
+
+static ROBOT_CONFIG_FILE: OnceLock<PathBuf> = OnceLock::new();
+
+#[derive(Error, Debug)]
+pub enum FileConfigStorageError {
+    #[error("no robot config file")]
+    NoConfigFile,
+    #[error("robot config file already set")]
+    ConfigFileAlreadySet,
+    #[error(transparent)]
+    IoError(#[from] std::io::Error),
+    #[error(transparent)]
+    ConfigCacheError(#[from] ConfigCacheError),
+}
+
+impl From<FileConfigStorageError> for ServerError {
+    fn from(value: FileConfigStorageError) -> Self {
+        Self::new(GrpcError::RpcUnavailable, Some(value.into()))
+    }
+}
+
+/// Caches the configuration received from app in the file at `path`. Has to be called before the
+/// server is started and only once.
+pub fn set_robot_config_file(path: PathBuf) -> Result<(), FileConfigStorageError> {
+    ROBOT_CONFIG_FILE
+        .set(path)
+        .map_err(|_| FileConfigStorageError::ConfigFileAlreadySet)
+}
+
+#[derive(Clone, Copy, Default)]
+pub struct FileConfigStorage;
+
+impl FileConfigStorage {
+    /// Whether a file was set with `set_robot_config_file`
+    pub fn is_available() -> bool {
+        ROBOT_CONFIG_FILE.get().is_some()
+    }
+
+    fn path() -> Result<&'static PathBuf, FileConfigStorageError> {
+        ROBOT_CONFIG_FILE
+            .get()
+            .ok_or(FileConfigStorageError::NoConfigFile)
+    }
+}
+
+impl RobotConfigurationStorage for FileConfigStorage {
+    type Error = FileConfigStorageError;
+    fn has_robot_configuration(&self) -> bool {
+        Self::path().map_or(false, |path| path.is_file())
+    }
+    fn store_robot_configuration(&self, cfg: &ConfigResponse) -> Result<(), Self::Error> {
+        let path = Self::path()?;
+        // written next to the cache then renamed, so a crash can't leave a partial cache
+        let tmp = path.with_extension("tmp");
+        std::fs::write(&tmp, encode_cached_config(cfg))?;
+        Ok(std::fs::rename(tmp, path)?)
+    }
+    fn get_robot_configuration(&self) -> Result<ConfigResponse, Self::Error> {
+        Ok(decode_cached_config(&std::fs::read(Self::path()?)?)?)
+    }
+    fn reset_robot_configuration(&self) -> Result<(), Self::Error> {
+        let path = Self::path()?;
+        if path.exists() {
+            std::fs::remove_file(path)?;
+        }
+        Ok(())
+    }
+}
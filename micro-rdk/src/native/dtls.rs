@@ -2,7 +2,7 @@ use std::io::Write;
 use std::pin::Pin;
 
 use std::time::SystemTime;
-use std::{fs::OpenOptions, rc::Rc};
+use std::{cell::RefCell, fs::OpenOptions, rc::Rc};
 
 use async_std_openssl::SslStream;
 
@@ -17,7 +17,7 @@ use openssl::ssl::{
 };
 
 use crate::common::webrtc::certificate::Certificate;
-use crate::common::webrtc::dtls::{DtlsBuilder, DtlsConnector, DtlsError};
+use crate::common::webrtc::dtls::{DtlsBuilder, DtlsConnector, DtlsError, DTLS_HANDSHAKES};
 use crate::common::webrtc::udp_mux::UdpMux;
 
 fn dtls_log_session_key(_: &SslRef, line: &str) {
@@ -32,11 +32,17 @@ fn dtls_log_session_key(_: &SslRef, line: &str) {
 
 pub struct NativeDtls<C: Certificate> {
     cert: Rc<C>,
+    // shared by every connection so the certificate is only loaded once and openssl's session
+    // cache can resume the sessions of returning peers
+    context: RefCell<Option<SslContext>>,
 }
 
 impl<C: Certificate> NativeDtls<C> {
     pub fn new(cert: Rc<C>) -> Self {
-        Self { cert }
+        Self {
+            cert,
+            context: RefCell::new(None),
+        }
     }
 }
 
@@ -60,6 +66,15 @@ pub fn unix_time() -> i64 {
 
 impl Dtls {
     pub fn new<S: Certificate>(cert: Rc<S>) -> Result<Self, DtlsError> {
+        Ok(Self::with_context(Self::build_context(cert.as_ref())?))
+    }
+    fn with_context(context: SslContext) -> Self {
+        Self {
+            context,
+            transport: None,
+        }
+    }
+    fn build_context<S: Certificate>(cert: &S) -> Result<SslContext, DtlsError> {
         let mut ssl_ctx_builder = SslContextBuilder::new(SslMethod::dtls())
             .map_err(|e| DtlsError::DtlsError(Box::new(e)))?;
         let mut verify = SslVerifyMode::empty();
@@ -93,13 +108,12 @@ impl Dtls {
         dtls_options.insert(SslOptions::NO_DTLSV1);
 
         ssl_ctx_builder.set_options(dtls_options);
+        // sessions of a peer verified by certificate can only be resumed with a context id
+        ssl_ctx_builder
+            .set_session_id_context(b"micro-rdk-webrtc")
+            .map_err(|e| DtlsError::DtlsError(Box::new(e)))?;
 
-        let dtls_ctx = ssl_ctx_builder.build();
-
-        Ok(Self {
-            context: dtls_ctx,
-            transport: None,
-        })
+        Ok(ssl_ctx_builder.build())
     }
 }
 
@@ -121,6 +135,7 @@ impl DtlsConnector for Dtls {
         Ok(Box::pin(async move {
             let pin = unsafe { std::pin::Pin::new_unchecked(&mut stream) };
             pin.accept().await?;
+            DTLS_HANDSHAKES.record(stream.ssl().session_reused());
 
             Ok(stream)
         }))
@@ -133,6 +148,12 @@ impl DtlsConnector for Dtls {
 impl<C: Certificate> DtlsBuilder for NativeDtls<C> {
     type Output = Dtls;
     fn make(&self) -> Result<Self::Output, DtlsError> {
-        Dtls::new(self.cert.clone())
+        let mut context = self.context.borrow_mut();
+        if let Some(context) = context.as_ref() {
+            return Ok(Dtls::with_context(context.clone()));
+        }
+        let new = Dtls::build_context(self.cert.as_ref())?;
+        let _ = context.insert(new.clone());
+        Ok(Dtls::with_context(new))
     }
 }
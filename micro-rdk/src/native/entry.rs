@@ -3,6 +3,8 @@
 use crate::{
     common::{
         app_client::{AppClientBuilder, AppClientConfig},
+        config_cache::{store_config, BootRobot},
+        config_monitor::ConfigMonitor,
         conn::{
             network::Network,
             server::{ViamServerBuilder, WebRtcConfiguration},
@@ -10,12 +12,15 @@ use crate::{
         entry::RobotRepresentation,
         grpc_client::GrpcClient,
         log::config_log_entry,
-        provisioning::storage::RobotCredentials,
+        provisioning::storage::{RobotConfigurationStorage, RobotCredentials},
         restart_monitor::RestartMonitor,
         robot::LocalRobot,
     },
     native::{exec::NativeExecutor, tcp::NativeStream, tls::NativeTls},
 };
+
+#[cfg(feature = "provisioning")]
+use super::config_cache::FileConfigStorage;
 use std::{
     net::SocketAddr,
     rc::Rc,
@@ -40,14 +45,27 @@ use super::{
 };
 
 #[cfg(feature = "data")]
-use crate::common::{data_manager::DataManager, data_store::StaticMemoryDataStore};
+use crate::{
+    common::{
+        data_manager::{DataManager, DataManagerTasks},
+        data_store::StaticMemoryDataStore,
+        flash_data_store::FlashDataStore,
+    },
+    native::flash_region::FileFlashRegion,
+    proto::app::v1::ConfigResponse,
+};
+#[cfg(feature = "data")]
+use futures_lite::prelude::Future;
+#[cfg(feature = "data")]
+use std::pin::Pin;
 
-pub async fn serve_web_inner(
+pub async fn serve_web_inner<C: RobotConfigurationStorage + 'static>(
     robot_creds: RobotCredentials,
-    repr: RobotRepresentation,
+    boot: BootRobot,
     exec: NativeExecutor,
     _max_webrtc_connection: usize,
     network: impl Network,
+    config_storage: Option<C>,
 ) {
     let app_config = AppClientConfig::new(
         robot_creds.robot_secret().to_owned(),
@@ -56,7 +74,13 @@ pub async fn serve_web_inner(
     );
     let client_connector = NativeTls::new_client();
     let mdns = NativeMdns::new("".to_owned(), network.get_ip()).unwrap();
+    let ip = network.get_ip();
 
+    #[cfg(feature = "data")]
+    let mut running_data_tasks = None;
+    // registry the config monitor reconciles the robot with, none when the robot was built by
+    // the caller
+    let mut registry = None;
     let (cfg_response, robot, tls_server_config) = {
         let cloned_exec = exec.clone();
         let conn = client_connector.open_ssl_context(None).await.unwrap();
@@ -75,19 +99,50 @@ pub async fn serve_web_inner(
             certs.tls_private_key.as_bytes().to_vec(),
         );
 
-        let (cfg_response, cfg_received_datetime) =
-            client.get_config(network.get_ip()).await.unwrap();
+        let (cfg_response, cfg_received_datetime) = client.get_config(ip).await.unwrap();
 
-        let robot = match repr {
-            RobotRepresentation::WithRobot(robot) => Arc::new(Mutex::new(robot)),
-            RobotRepresentation::WithRegistry(registry) => {
+        let robot = match boot {
+            BootRobot::Cached(mut cached) => {
+                let unchanged = cached.config == *cfg_response;
+                let err = match cached.reconcile(&cfg_response, cfg_received_datetime).await {
+                    Ok(_) => {
+                        if !unchanged {
+                            store_config(config_storage.as_ref(), &cfg_response);
+                        }
+                        None
+                    }
+                    Err(err) => {
+                        log::error!("couldn't apply config, keeping the cached one: {:?}", err);
+                        Some(err)
+                    }
+                };
+                if let Some(datetime) = cfg_received_datetime {
+                    let logs = vec![config_log_entry(datetime, err)];
+                    client
+                        .push_logs(logs)
+                        .await
+                        .expect("could not push logs to app");
+                }
+                #[cfg(feature = "data")]
+                {
+                    running_data_tasks = cached.data_tasks.take();
+                }
+                registry = Some(cached.registry);
+                cached.robot
+            }
+            BootRobot::Uncached(RobotRepresentation::WithRobot(robot)) => {
+                Arc::new(Mutex::new(robot))
+            }
+            BootRobot::Uncached(RobotRepresentation::WithRegistry(from_registry)) => {
                 log::info!("building robot from config");
+                registry = Some(from_registry.clone());
                 let r = match LocalRobot::from_cloud_config(
                     &cfg_response,
-                    registry,
+                    from_registry,
                     cfg_received_datetime,
                 ) {
                     Ok(robot) => {
+                        store_config(config_storage.as_ref(), &cfg_response);
                         if let Some(datetime) = cfg_received_datetime {
                             let logs = vec![config_log_entry(datetime, None)];
                             client
@@ -117,32 +172,21 @@ pub async fn serve_web_inner(
     };
 
     #[cfg(feature = "data")]
-    // TODO: Support implementers of the DataStore trait other than StaticMemoryDataStore in a way that is configurable
-    let data_manager_svc = match DataManager::<StaticMemoryDataStore>::from_robot_and_config(
-        &cfg_response,
-        &app_config,
-        robot.clone(),
-    ) {
-        Ok(svc) => svc,
-        Err(err) => {
-            log::error!("error configuring data management: {:?}", err);
-            None
-        }
+    let (data_sync_task, data_future, collector_updater) = match running_data_tasks {
+        Some((sync_task, task, updater)) => (
+            Some(sync_task),
+            Box::pin(task) as Pin<Box<dyn Future<Output = ()>>>,
+            Some(updater),
+        ),
+        None => match data_manager_tasks(&cfg_response, &app_config, robot.clone()) {
+            Some((sync_task, future, updater)) => (Some(sync_task), future, Some(updater)),
+            None => (
+                None,
+                Box::pin(async move {}) as Pin<Box<dyn Future<Output = ()>>>,
+                None,
+            ),
+        },
     };
-
-    #[cfg(feature = "data")]
-    let data_sync_task = data_manager_svc
-        .as_ref()
-        .map(|data_manager_svc| data_manager_svc.get_sync_task());
-
-    #[cfg(feature = "data")]
-    let data_future = Box::pin(async move {
-        if let Some(mut data_manager_svc) = data_manager_svc {
-            if let Err(err) = data_manager_svc.data_collection_task().await {
-                log::error!("error running data manager: {:?}", err)
-            }
-        }
-    });
     #[cfg(not(feature = "data"))]
     let data_future = async move {};
 
@@ -171,7 +215,23 @@ pub async fn serve_web_inner(
                 })));
         #[cfg(feature = "data")]
         let builder = if let Some(task) = data_sync_task {
-            builder.with_periodic_app_client_task(Box::new(task))
+            builder.with_periodic_app_client_task(task)
+        } else {
+            builder
+        };
+        let builder = if let Some(registry) = registry {
+            let monitor =
+                ConfigMonitor::new((*cfg_response).clone(), robot.clone(), registry, ip, || {
+                    std::process::exit(0)
+                })
+                .with_on_applied(move |cfg| store_config(config_storage.as_ref(), cfg));
+            #[cfg(feature = "data")]
+            let monitor = if let Some(updater) = collector_updater {
+                monitor.with_collector_updater(updater)
+            } else {
+                monitor
+            };
+            builder.with_periodic_app_client_task(Box::new(monitor))
         } else {
             builder
         };
@@ -181,6 +241,60 @@ pub async fn serve_web_inner(
     futures_lite::future::zip(Box::pin(srv.serve(robot)), data_future).await;
 }
 
+#[cfg(feature = "data")]
+// collected data is persisted when a flash region is available, otherwise it is kept in memory
+fn data_manager_tasks(
+    cfg: &ConfigResponse,
+    app_config: &AppClientConfig,
+    robot: Arc<Mutex<LocalRobot>>,
+) -> Option<DataManagerTasks> {
+    let tasks = if FileFlashRegion::is_available() {
+        DataManager::<FlashDataStore<FileFlashRegion>>::from_robot_and_config(
+            cfg, app_config, robot,
+        )
+        .map(|svc| svc.map(DataManager::into_tasks))
+    } else {
+        DataManager::<StaticMemoryDataStore>::from_robot_and_config(cfg, app_config, robot)
+            .map(|svc| svc.map(DataManager::into_tasks))
+    };
+    match tasks {
+        Ok(tasks) => tasks,
+        Err(err) => {
+            log::error!("error configuring data management: {:?}", err);
+            None
+        }
+    }
+}
+
+// Builds the robot from the cached config of the stored credentials, collection starts right away
+#[cfg(feature = "provisioning")]
+#[cfg_attr(not(feature = "data"), allow(unused_variables))]
+fn boot_robot<S: RobotCredentialStorage>(
+    repr: RobotRepresentation,
+    storage: &S,
+    exec: &NativeExecutor,
+) -> BootRobot {
+    if !storage.has_stored_credentials() {
+        return BootRobot::Uncached(repr);
+    }
+    #[allow(unused_mut)]
+    let mut boot = BootRobot::new(
+        repr,
+        FileConfigStorage::is_available().then_some(&FileConfigStorage),
+    );
+    #[cfg(feature = "data")]
+    if let (BootRobot::Cached(cached), Ok(creds)) = (&mut boot, storage.get_robot_credentials()) {
+        let app_config = AppClientConfig::new(
+            creds.robot_secret().to_owned(),
+            creds.robot_id().to_owned(),
+            "".to_owned(),
+        );
+        cached.data_tasks = data_manager_tasks(&cached.config, &app_config, cached.robot.clone())
+            .map(|(sync_task, future, updater)| (sync_task, exec.spawn(future), updater));
+    }
+    boot
+}
+
 async fn validate_robot_credentials(
     exec: NativeExecutor,
     robot_creds: &RobotCredentials,
@@ -224,6 +338,7 @@ where
     let info = info.unwrap_or_default();
     let mut last_error: Option<Box<dyn std::error::Error>> = None;
     let mut mdns = NativeMdns::new("".to_owned(), network.get_ip()).unwrap();
+    let mut boot = boot_robot(repr, &storage, &exec);
     loop {
         // When Credential are present either provisioning has succeeded or
         // they where stored. We starts by checking that we have a network
@@ -262,6 +377,8 @@ where
                 break;
             }
         }
+        // provisioning may change the robot, its cached config no longer applies
+        boot = boot.discard(&FileConfigStorage).await;
         if let Err(e) = serve_provisioning_async::<_, (), _>(
             exec.clone(),
             info.clone(),
@@ -277,10 +394,11 @@ where
     }
     serve_web_inner(
         storage.get_robot_credentials().unwrap(),
-        repr,
+        boot,
         exec,
         max_webrtc_connection,
         network,
+        FileConfigStorage::is_available().then_some(FileConfigStorage),
     )
     .await;
     Ok(())
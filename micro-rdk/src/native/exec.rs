@@ -5,7 +5,9 @@ use futures_lite::{
     Future,
 };
 
-use crate::common::{provisioning::server::ProvisioningExecutor, webrtc::exec::WebRtcExecutor};
+use crate::common::{
+    provisioning::server::ProvisioningExecutor, telemetry, webrtc::exec::WebRtcExecutor,
+};
 
 #[derive(Clone, Debug, Default)]
 /// This executor is local and bounded to the CPU that created it usually you would create it after spwaning a thread on a specific core
@@ -21,7 +23,7 @@ impl NativeExecutor {
     }
     // Spawn a future onto the local executor
     pub fn spawn<T: 'static>(&self, future: impl Future<Output = T> + 'static) -> Task<T> {
-        EX.with(|e| e.spawn(future))
+        EX.with(|e| e.spawn(telemetry::executor_task(future)))
     }
 
     pub fn block_on<T>(&self, future: impl Future<Output = T>) -> T {
@@ -35,7 +37,7 @@ where
     F: future::Future + 'static,
 {
     fn execute(&self, fut: F) {
-        EX.with(|e| e.spawn(fut)).detach();
+        EX.with(|e| e.spawn(telemetry::executor_task(fut))).detach();
     }
 }
 
@@ -44,7 +46,7 @@ where
     F: future::Future + 'static,
 {
     fn execute(&self, fut: F) {
-        EX.with(|e| e.spawn(fut)).detach();
+        EX.with(|e| e.spawn(telemetry::executor_task(fut))).detach();
     }
 }
 
@@ -0,0 +1,80 @@
+//! FlashRegion backed by a file, emulating a flash partition on native targets
+use std::{
+    fs::{File, OpenOptions},
+    io::{Read, Seek, SeekFrom, Write},
+    path::PathBuf,
+    sync::OnceLock,
+};
+
+use crate::common::{data_store::DataStoreError, flash_data_store::FlashRegion};
+
+const SECTOR_SIZE: usize = 4096;
+
+static DATA_STORE_FILE: OnceLock<(PathBuf, usize)> = OnceLock::new();
+
+impl From<std::io::Error> for DataStoreError {
+    fn from(value: std::io::Error) -> Self {
+        DataStoreError::StorageError(value.to_string())
+    }
+}
+
+/// Persists collected data in the file at `path`, created with a size of `size` bytes if it
+/// doesn't exist. Has to be called before the data manager is started and only once.
+pub fn set_data_store_file(path: PathBuf, size: usize) -> Result<(), DataStoreError> {
+    DATA_STORE_FILE
+        .set((path, size))
+        .map_err(|_| DataStoreError::DataStoreInitialized)
+}
+
+pub struct FileFlashRegion {
+    file: File,
+    sector_count: usize,
+}
+
+impl FileFlashRegion {
+    /// Whether a file was set with `set_data_store_file`
+    pub fn is_available() -> bool {
+        DATA_STORE_FILE.get().is_some()
+    }
+}
+
+impl FlashRegion for FileFlashRegion {
+    fn open() -> Result<Self, DataStoreError> {
+        let (path, size) = DATA_STORE_FILE
+            .get()
+            .ok_or(DataStoreError::StorageError("no data store file".to_string()))?;
+        let sector_count = size / SECTOR_SIZE;
+        let mut file = OpenOptions::new()
+            .read(true)
+            .write(true)
+            .create(true)
+            .truncate(false)
+            .open(path)?;
+        let len = file.metadata()?.len() as usize;
+        if len < sector_count * SECTOR_SIZE {
+            // fresh space reads as erased flash
+            file.seek(SeekFrom::Start(len as u64))?;
+            file.write_all(&vec![0xFF; sector_count * SECTOR_SIZE - len])?;
+        }
+        Ok(Self { file, sector_count })
+    }
+    fn sector_size(&self) -> usize {
+        SECTOR_SIZE
+    }
+    fn sector_count(&self) -> usize {
+        self.sector_count
+    }
+    fn read(&mut self, offset: usize, buf: &mut [u8]) -> Result<(), DataStoreError> {
+        self.file.seek(SeekFrom::Start(offset as u64))?;
+        self.file.read_exact(buf)?;
+        Ok(())
+    }
+    fn write(&mut self, offset: usize, data: &[u8]) -> Result<(), DataStoreError> {
+        self.file.seek(SeekFrom::Start(offset as u64))?;
+        self.file.write_all(data)?;
+        Ok(())
+    }
+    fn erase_sector(&mut self, sector: usize) -> Result<(), DataStoreError> {
+        self.write(sector * SECTOR_SIZE, &[0xFF; SECTOR_SIZE])
+    }
+}
@@ -1,7 +1,11 @@
 pub mod certificate;
+#[cfg(feature = "provisioning")]
+pub mod config_cache;
 pub mod dtls;
 pub mod entry;
 pub mod exec;
+#[cfg(feature = "data")]
+pub mod flash_region;
 pub mod tcp;
 pub mod tls;
 pub mod conn {
@@ -10,6 +10,8 @@ use rustls::{ClientConfig, KeyLogFile, OwnedTrustAnchor, RootCertStore, ServerCo
 #[derive(Clone)]
 pub struct NativeTls {
     server_config: Option<NativeTlsServerConfig>,
+    // kept across connections, its session store lets rustls resume the previous session with app
+    client_config: Option<Arc<ClientConfig>>,
 }
 
 /// TCP like stream for encrypted communication over TLS
@@ -31,12 +33,14 @@ impl NativeTls {
     pub fn new_client() -> Self {
         Self {
             server_config: None,
+            client_config: Some(NativeTlsStream::client_config()),
         }
     }
     /// Creates a TLS object ready to accept connection or connect to a server
     pub fn new_server(cfg: NativeTlsServerConfig) -> Self {
         Self {
             server_config: Some(cfg),
+            client_config: None,
         }
     }
 
@@ -45,7 +49,7 @@ impl NativeTls {
         &self,
         socket: Option<TcpStream>,
     ) -> Result<NativeTlsStream, std::io::Error> {
-        NativeTlsStream::accept_or_connect(socket, &self.server_config).await
+        NativeTlsStream::accept_or_connect(socket, &self.server_config, &self.client_config).await
     }
 }
 
@@ -78,10 +82,30 @@ impl KeyLog for Key {
 }
 
 impl NativeTlsStream {
+    fn client_config() -> Arc<ClientConfig> {
+        let mut root_certs = RootCertStore::empty();
+        root_certs.add_trust_anchors(webpki_roots::TLS_SERVER_ROOTS.0.iter().map(|ta| {
+            OwnedTrustAnchor::from_subject_spki_name_constraints(
+                ta.subject,
+                ta.spki,
+                ta.name_constraints,
+            )
+        }));
+        let log = Arc::new(KeyLogFile::new());
+        let mut cfg = ClientConfig::builder()
+            .with_safe_defaults()
+            .with_root_certificates(root_certs)
+            .with_no_client_auth();
+        cfg.alpn_protocols = vec!["h2".as_bytes().to_vec()];
+        cfg.key_log = log;
+        Arc::new(cfg)
+    }
+
     /// based on a role and a configuration, attempt the setup an SSL context
     async fn accept_or_connect(
         socket: Option<TcpStream>,
         tls_cfg: &Option<NativeTlsServerConfig>,
+        client_cfg: &Option<Arc<ClientConfig>>,
     ) -> Result<Self, std::io::Error> {
         let stream = if let Some(tls_cfg) = tls_cfg {
             let cert_chain =
@@ -106,23 +130,9 @@ impl NativeTlsStream {
 
             futures_rustls::TlsStream::Server(stream)
         } else {
-            let mut root_certs = RootCertStore::empty();
-            root_certs.add_trust_anchors(webpki_roots::TLS_SERVER_ROOTS.0.iter().map(|ta| {
-                OwnedTrustAnchor::from_subject_spki_name_constraints(
-                    ta.subject,
-                    ta.spki,
-                    ta.name_constraints,
-                )
-            }));
-            let log = Arc::new(KeyLogFile::new());
-            let mut cfg = ClientConfig::builder()
-                .with_safe_defaults()
-                .with_root_certificates(root_certs)
-                .with_no_client_auth();
-            cfg.alpn_protocols = vec!["h2".as_bytes().to_vec()];
-            cfg.key_log = log;
+            let cfg = client_cfg.clone().unwrap_or_else(Self::client_config);
             let stream = async_io::Async::new(TcpStream::connect("app.viam.com:443")?)?;
-            let conn = TlsConnector::from(Arc::new(cfg));
+            let conn = TlsConnector::from(cfg);
             let stream = conn
                 .connect(
                     "app.viam.com"